@@ -17,6 +17,9 @@
 
 #include "app_event.h"
 #include "application.h"
+#include "shm_ring.h"
+#include "msg_batch.h"
+#include "epoch.h"
 
 /////////////////////////////////////////////////////////////////////
 
@@ -40,6 +43,26 @@ void *av_rep_ctx;
 /** \brief MQ socket to reply app events */
 void *av_rep_sock;
 
+/** \brief MQ socket to dispatch requests to workers */
+void *av_worker_sock;
+
+/** \brief The shared-memory links replaced by reconnections (unmapped at the end) */
+static shm_link_t *av_shm_retired;
+
+/** \brief The lock for shared-memory links */
+static pthread_mutex_t av_shm_lock;
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to get the configuration published to the app event handler (in an epoch section)
+ * \return Application configuration (NULL: not loaded yet)
+ */
+static app_conf_t *av_conf(void)
+{
+    return __atomic_load_n(&av_ctx->app_conf, __ATOMIC_ACQUIRE);
+}
+
 /////////////////////////////////////////////////////////////////////
 
 /** \brief Switch related trigger function (non-const) */
@@ -50,6 +73,10 @@ void *av_rep_sock;
 //static int host_rw_raise(uint32_t id, uint16_t type, uint16_t len, host_t *data);
 /** \brief Flow related trigger function (non-const) */
 //static int flow_rw_raise(uint32_t id, uint16_t type, uint16_t len, flow_t *data);
+/** \brief Route related trigger function (non-const) */
+static int route_rw_raise(uint32_t id, uint16_t type, uint16_t len, route_t *data);
+/** \brief Tree related trigger function (non-const) */
+static int tree_rw_raise(uint32_t id, uint16_t type, uint16_t len, tree_t *data);
 
 /////////////////////////////////////////////////////////////////////
 
@@ -65,6 +92,10 @@ static int pktin_av_raise(uint32_t id, uint16_t type, uint16_t len, const pktin_
 static int pktout_av_raise(uint32_t id, uint16_t type, uint16_t len, const pktout_t *data);
 /** \brief Flow related trigger function (const) */
 static int flow_av_raise(uint32_t id, uint16_t type, uint16_t len, const flow_t *data);
+/** \brief Bulk flow install related trigger function (const) */
+static int flows_av_raise(uint32_t id, uint16_t type, uint16_t len, const flows_t *data);
+/** \brief Bulk flow install result related trigger function (const) */
+static int batch_av_raise(uint32_t id, uint16_t type, uint16_t len, const flow_batch_t *data);
 /** \brief Log related trigger function (const) */
 static int log_av_raise(uint32_t id, uint16_t type, uint16_t len, const char *data);
 
@@ -86,6 +117,8 @@ void av_dp_port_added(uint32_t id, const port_t *data) { port_av_raise(id, AV_DP
 void av_dp_port_modified(uint32_t id, const port_t *data) { port_av_raise(id, AV_DP_PORT_MODIFIED, sizeof(port_t), data); }
 /** \brief AV_DP_PORT_DELETED */
 void av_dp_port_deleted(uint32_t id, const port_t *data) { port_av_raise(id, AV_DP_PORT_DELETED, sizeof(port_t), data); }
+/** \brief AV_DP_FLOWS_INSTALLED */
+void av_dp_flows_installed(uint32_t id, const flow_batch_t *data) { batch_av_raise(id, AV_DP_FLOWS_INSTALLED, sizeof(flow_batch_t), data); }
 
 // Downstream events ////////////////////////////////////////////////
 
@@ -97,10 +130,15 @@ void av_dp_insert_flow(uint32_t id, const flow_t *data) { flow_av_raise(id, AV_D
 void av_dp_modify_flow(uint32_t id, const flow_t *data) { flow_av_raise(id, AV_DP_MODIFY_FLOW, sizeof(flow_t), data); }
 /** \brief AV_DP_DELETE_FLOW */
 void av_dp_delete_flow(uint32_t id, const flow_t *data) { flow_av_raise(id, AV_DP_DELETE_FLOW, sizeof(flow_t), data); }
+/** \brief AV_DP_INSERT_FLOWS */
+void av_dp_insert_flows(uint32_t id, const flows_t *data) { flows_av_raise(id, AV_DP_INSERT_FLOWS, sizeof(flows_t), data); }
 
 // Internal events (request-response) ///////////////////////////////
 
-//
+/** \brief AV_RT_GET_ROUTE (src, dst, hash) */
+void av_rt_get_route(uint32_t id, route_t *data) { route_rw_raise(id, AV_RT_GET_ROUTE, sizeof(route_t), data); }
+/** \brief AV_RT_GET_TREE (dpid, in_port) */
+void av_rt_get_tree(uint32_t id, tree_t *data) { tree_rw_raise(id, AV_RT_GET_TREE, sizeof(tree_t), data); }
 
 // Internal events (notification) ///////////////////////////////////
 
@@ -183,6 +221,48 @@ void av_log_fatal(uint32_t id, char *format, ...) {
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to raise an app event from its raw data (e.g., a recorded trace)
+ * \param id Trigger ID
+ * \param type App event type
+ * \param len Data length
+ * \param data Data
+ */
+int av_raise_data(uint32_t id, uint16_t type, uint16_t len, const uint8_t *data)
+{
+    uint8_t buf[__MAX_MSG_SIZE+1] = {0};
+
+    if (len > __MAX_MSG_SIZE || type >= AV_NUM_EVENTS) return -1;
+
+    memcpy(buf, data, len);
+
+    switch (type) {
+    // this event refers to an external buffer
+    case AV_DP_INSERT_FLOWS:
+        return -1;
+    case AV_DP_FLOW_EXPIRED:
+    case AV_DP_FLOW_DELETED:
+    case AV_DP_INSERT_FLOW:
+    case AV_DP_MODIFY_FLOW:
+    case AV_DP_DELETE_FLOW:
+        if (len != sizeof(flow_t)) return -1;
+        ((flow_t *)buf)->prev = NULL;
+        ((flow_t *)buf)->next = NULL;
+        break;
+    default:
+        break;
+    }
+
+    msg_t msg = {0};
+    msg.id = id;
+    msg.type = type;
+    msg.data = buf;
+
+    return process_app_events(&msg);
+}
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief Function to process meta app events
  * \param null NULL
@@ -285,22 +365,46 @@ int init_app_event(ctx_t *ctx)
             return -1;
         }
 
-        // reply
+        // batches to external subscribers
+
+        if (pthread_create(&thread, NULL, &flush_app_events, NULL) < 0) {
+            PERROR("pthread_create");
+            return -1;
+        }
+
+        // reply (a router in front of a pool of workers)
+
+        pthread_mutex_init(&av_shm_lock, NULL);
 
         av_rep_ctx = zmq_ctx_new();
-        av_rep_sock = zmq_socket(av_rep_ctx, ZMQ_REP);
+        av_rep_sock = zmq_socket(av_rep_ctx, ZMQ_ROUTER);
 
         if (zmq_bind(av_rep_sock, __EXT_APP_REPLY_ADDR)) {
             PERROR("zmq_bind");
             return -1;
         }
 
-        zmq_setsockopt(av_rep_sock, ZMQ_RCVTIMEO, &timeout, sizeof(int));
+        av_worker_sock = zmq_socket(av_rep_ctx, ZMQ_ROUTER);
 
-        if (pthread_create(&thread, NULL, &reply_app_events, NULL) < 0) {
+        if (zmq_bind(av_worker_sock, __EXT_APP_WORKER_ADDR)) {
+            PERROR("zmq_bind");
+            return -1;
+        }
+
+        if (pthread_create(&thread, NULL, &proxy_app_events, NULL) < 0) {
             PERROR("pthread_create");
             return -1;
         }
+
+        int num_workers = MIN(MAX(get_nprocs(), 2), __EXT_MAX_REPLY_WORKERS);
+
+        int i;
+        for (i=0; i<num_workers; i++) {
+            if (pthread_create(&thread, NULL, &reply_app_events, NULL) < 0) {
+                PERROR("pthread_create");
+                return -1;
+            }
+        }
     }
 
     DEBUG("app_event_handler is initialized\n");
@@ -318,8 +422,11 @@ int destroy_app_event(ctx_t *ctx)
 
     waitsec(1, 0);
 
+    av_shm_detach_all();
+
     zmq_close(av_pull_sock);
     zmq_close(av_rep_sock);
+    zmq_close(av_worker_sock);
 
     zmq_ctx_destroy(av_pull_ctx);
     zmq_ctx_destroy(av_rep_ctx);
@@ -401,6 +508,22 @@ int destroy_app_event(ctx_t *ctx)
 //#undef FUNC_TYPE
 //#undef FUNC_DATA
 
+#define FUNC_NAME route_rw_raise
+#define FUNC_TYPE route_t
+#define FUNC_DATA route_data
+#include "app_event_rw_raise.h"
+#undef FUNC_NAME
+#undef FUNC_TYPE
+#undef FUNC_DATA
+
+#define FUNC_NAME tree_rw_raise
+#define FUNC_TYPE tree_t
+#define FUNC_DATA tree_data
+#include "app_event_rw_raise.h"
+#undef FUNC_NAME
+#undef FUNC_TYPE
+#undef FUNC_DATA
+
 #define FUNC_NAME sw_av_raise
 #define FUNC_TYPE switch_t
 #define FUNC_DATA sw
@@ -461,6 +584,22 @@ int destroy_app_event(ctx_t *ctx)
 #undef FUNC_TYPE
 #undef FUNC_DATA
 
+#define FUNC_NAME flows_av_raise
+#define FUNC_TYPE flows_t
+#define FUNC_DATA flows
+#include "app_event_direct_raise.h"
+#undef FUNC_NAME
+#undef FUNC_TYPE
+#undef FUNC_DATA
+
+#define FUNC_NAME batch_av_raise
+#define FUNC_TYPE flow_batch_t
+#define FUNC_DATA batch
+#include "app_event_direct_raise.h"
+#undef FUNC_NAME
+#undef FUNC_TYPE
+#undef FUNC_DATA
+
 #define FUNC_NAME log_av_raise
 #define FUNC_TYPE char
 #define FUNC_DATA log
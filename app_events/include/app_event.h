@@ -29,6 +29,11 @@ typedef struct _app_event_t {
         const host_t     *host; /**< The pointer of a host */
         const flow_t     *flow; /**< The pointer of a flow */
 
+        const flows_t    *flows; /**< The pointer of flows to install */
+        const flow_batch_t *batch; /**< The pointer of the result of a bulk flow install */
+        const route_t    *route; /**< The pointer of a route */
+        const tree_t     *tree; /**< The pointer of broadcast tree ports */
+
         const pktin_t    *pktin; /**< The pointer of a pktin */
         const pktout_t   *pktout; /**< The pointer of a pktout */
 
@@ -52,6 +57,8 @@ typedef struct _app_event_out_t {
         port_t           *port_data; /**< The pointer of a port */
         host_t           *host_data; /**< The pointer of a host */
         flow_t           *flow_data; /**< The pointer of a flow */
+        route_t          *route_data; /**< The pointer of a route */
+        tree_t           *tree_data; /**< The pointer of broadcast tree ports */
 
         uint8_t          *data; /**< The pointer of data */
     };
@@ -59,3 +66,5 @@ typedef struct _app_event_out_t {
 
 int init_app_event(ctx_t *ctx);
 int destroy_app_event(ctx_t *ctx);
+
+int av_raise_data(uint32_t id, uint16_t type, uint16_t len, const uint8_t *data);
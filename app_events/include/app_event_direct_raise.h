@@ -11,26 +11,19 @@ static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, const FUNC_TYPE *
 {
     int ret = 0;
 
-    int av_num = av_ctx->av_num[type];
-    app_t **av_list = av_ctx->av_list[type];
+    epoch_enter();
 
-    if (av_list == NULL) return -1;
+    app_conf_t *conf = av_conf();
 
     // outbound check:
     // investigate whether the given event type belongs to the component's outbound events
-
-    int i, j, pass = 0;
-    for (i=0; i<av_ctx->num_apps; i++) {
-        app_t *app = av_ctx->app_list[i];
-        for (j=0; j<app->out_num; j++) {
-            if (app->out_list[j] == type) {
-                pass = 1;
-                break;
-            }
-        }
-        if (pass) break;
+    if (conf == NULL || !conf->out_ok[type]) {
+        epoch_exit();
+        return -1;
     }
-    if (!pass) return -1;
+
+    int av_num = conf->av_num[type];
+    app_t **av_list = conf->av_list[type];
 
     app_event_out_t av_out;
     app_event_t *av = (app_event_t *)&av_out;
@@ -46,6 +39,7 @@ static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, const FUNC_TYPE *
 
     av_ctx->num_app_events[type]++;
 
+    int i;
     for (i=0; i<av_num; i++) {
         app_t *app = av_list[i];
 
@@ -53,21 +47,25 @@ static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, const FUNC_TYPE *
         else if (!app->activated) continue; // not activated yet
 
 #ifdef ODP_FUNC
-        if (ODP_FUNC(app->odp, data)) continue;
+        if (ODP_FUNC(__atomic_load_n(&app->odp, __ATOMIC_ACQUIRE), data)) continue;
 #endif /* ODP_FUNC */
 
         app->num_app_events[type]++;
 
         if (app->in_perm[type] & APP_WRITE) {
             if (app->site == APP_INTERNAL) { // internal site
+                MEM_OWNER_PUSH(app->name);
                 ret = app->handler(av, &av_out);
+                MEM_OWNER_POP();
             } else { // external site
                 ret = av_send_msg(app, id, type, len, data, av_out.data);
             }
             if (ret && app->in_perm[type] & APP_EXECUTE) break;
         } else {
             if (app->site == APP_INTERNAL) { // internal site
+                MEM_OWNER_PUSH(app->name);
                 ret = app->handler(av, NULL);
+                MEM_OWNER_POP();
                 if (ret && app->in_perm[type] & APP_EXECUTE) break;
             } else { // external site
                 if (app->in_perm[type] & APP_EXECUTE) {
@@ -80,5 +78,7 @@ static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, const FUNC_TYPE *
         }
     }
 
+    epoch_exit();
+
     return ret;
 }
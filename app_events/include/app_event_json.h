@@ -228,6 +228,53 @@ static int export_to_json(uint32_t id, uint16_t type, const void *input, char *o
         }
         break;
 
+    // internal (request-response)
+    case AV_RT_GET_ROUTE:
+        {
+            const route_t *rt = (const route_t *)input;
+
+            char ports[__CONF_STR_LEN] = {0};
+            char hops[__CONF_STR_LEN] = {0};
+
+            int i;
+            for (i=0; i<rt->num_ports; i++) {
+                sprintf(ports + strlen(ports), "%u", rt->port[i]);
+
+                if ((i+1) < rt->num_ports)
+                    strcat(ports, ",");
+            }
+
+            for (i=0; i<rt->num_hops; i++) {
+                sprintf(hops + strlen(hops), "%lu:%u", rt->hop[i].dpid, rt->hop[i].port);
+
+                if ((i+1) < rt->num_hops)
+                    strcat(hops, ",");
+            }
+
+            sprintf(output, "{\"id\":%u, \"type\": %u, \"src\": %lu, \"dst\": %lu, \"hash\": %u, \"dist\": %u, "
+                            "\"ports\": \"%s\", \"hops\": \"%s\", \"return\": %d}",
+                    id, type, rt->src, rt->dst, rt->hash, rt->dist, ports, hops, ret);
+        }
+        break;
+    case AV_RT_GET_TREE:
+        {
+            const tree_t *tr = (const tree_t *)input;
+
+            char ports[__CONF_STR_LEN] = {0};
+
+            int i;
+            for (i=0; i<tr->num_ports; i++) {
+                sprintf(ports + strlen(ports), "%u", tr->port[i]);
+
+                if ((i+1) < tr->num_ports)
+                    strcat(ports, ",");
+            }
+
+            sprintf(output, "{\"id\":%u, \"type\": %u, \"dpid\": %lu, \"in_port\": %u, \"root\": %lu, \"ports\": \"%s\", \"return\": %d}",
+                    id, type, tr->dpid, tr->in_port, tr->root, ports, ret);
+        }
+        break;
+
     // log
     case AV_LOG_DEBUG:
     case AV_LOG_INFO:
@@ -625,6 +672,71 @@ static int import_from_json(uint32_t *id, uint16_t *type, char *input, void *out
         }
         break;
 
+    // internal (request-response)
+    case AV_RT_GET_ROUTE:
+        {
+            route_t *rt = (route_t *)output;
+
+            GET_JSON_VALUE("src", rt->src);
+            GET_JSON_VALUE("dst", rt->dst);
+            GET_JSON_VALUE("hash", rt->hash);
+            GET_JSON_VALUE("dist", rt->dist);
+
+            rt->num_ports = 0;
+            char ports[__CONF_STR_LEN] = {0};
+            json_t *j_ports = json_object_get(json, "ports");
+            if (json_is_string(j_ports)) {
+                strncpy(ports, json_string_value(j_ports), __CONF_STR_LEN - 1);
+
+                char *port = strtok(ports, ",");
+                while (port != NULL && rt->num_ports < __MAX_ROUTE_PORTS) {
+                    rt->port[rt->num_ports++] = strtoul(port, NULL, 10);
+                    port = strtok(NULL, ",");
+                }
+            }
+
+            rt->num_hops = 0;
+            char hops[__CONF_STR_LEN] = {0};
+            json_t *j_hops = json_object_get(json, "hops");
+            if (json_is_string(j_hops)) {
+                strncpy(hops, json_string_value(j_hops), __CONF_STR_LEN - 1);
+
+                char *hop = strtok(hops, ",");
+                while (hop != NULL && rt->num_hops < __MAX_ROUTE_HOPS) {
+                    sscanf(hop, "%lu:%u", &rt->hop[rt->num_hops].dpid, &rt->hop[rt->num_hops].port);
+                    rt->num_hops++;
+                    hop = strtok(NULL, ",");
+                }
+            }
+
+            GET_JSON_VALUE("return", ret);
+        }
+        break;
+    case AV_RT_GET_TREE:
+        {
+            tree_t *tr = (tree_t *)output;
+
+            GET_JSON_VALUE("dpid", tr->dpid);
+            GET_JSON_VALUE("in_port", tr->in_port);
+            GET_JSON_VALUE("root", tr->root);
+
+            tr->num_ports = 0;
+            char ports[__CONF_STR_LEN] = {0};
+            json_t *j_ports = json_object_get(json, "ports");
+            if (json_is_string(j_ports)) {
+                strncpy(ports, json_string_value(j_ports), __CONF_STR_LEN - 1);
+
+                char *port = strtok(ports, ",");
+                while (port != NULL && tr->num_ports < __MAX_NUM_PORTS) {
+                    tr->port[tr->num_ports++] = strtoul(port, NULL, 10);
+                    port = strtok(NULL, ",");
+                }
+            }
+
+            GET_JSON_VALUE("return", ret);
+        }
+        break;
+
     // log
     case AV_LOG_DEBUG:
     case AV_LOG_INFO:
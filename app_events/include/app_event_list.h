@@ -19,6 +19,7 @@ void av_dp_flow_deleted(uint32_t id, const flow_t *data);
 void av_dp_port_added(uint32_t id, const port_t *data);
 void av_dp_port_modified(uint32_t id, const port_t *data);
 void av_dp_port_deleted(uint32_t id, const port_t *data);
+void av_dp_flows_installed(uint32_t id, const flow_batch_t *data);
 
 // downstream ///////////////////////////////////////////////////////
 
@@ -26,9 +27,13 @@ void av_dp_send_packet(uint32_t id, const pktout_t *data);
 void av_dp_insert_flow(uint32_t id, const flow_t *data);
 void av_dp_modify_flow(uint32_t id, const flow_t *data);
 void av_dp_delete_flow(uint32_t id, const flow_t *data);
+void av_dp_insert_flows(uint32_t id, const flows_t *data);
 
 // internal (request-response) //////////////////////////////////////
 
+void av_rt_get_route(uint32_t id, route_t *data);
+void av_rt_get_tree(uint32_t id, tree_t *data);
+
 // internal (notification) //////////////////////////////////////////
 
 void av_sw_connected(uint32_t id, const switch_t *data);
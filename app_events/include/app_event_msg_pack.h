@@ -21,11 +21,16 @@
 
 /////////////////////////////////////////////////////////////////////
 
+static int av_shm_attach(app_t *a);
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief Function to activate an external application
  * \param msg Handshake message
+ * \param shm The flag whether shared-memory rings are attached (output)
  */
-static int activate_external_application(char *msg)
+static int activate_external_application(char *msg, int *shm)
 {
     json_t *json = NULL;
     json_error_t error;
@@ -46,31 +51,45 @@ static int activate_external_application(char *msg)
     if (json_is_string(j_name))
         strcpy(name, json_string_value(j_name));
 
+    int use_shm = json_is_true(json_object_get(json, "shm"));
+
     if (id == 0 || strlen(name) == 0) {
         json_decref(json);
         return -1;
     }
 
-    int i;
-    for (i=0; i<av_ctx->num_apps; i++) {
-        if (av_ctx->app_list[i]->app_id == id) {
-            if (strcmp(av_ctx->app_list[i]->name, name) == 0) {
-                app_t *app = av_ctx->app_list[i];
+    epoch_enter();
+
+    app_conf_t *conf = av_conf();
+
+    int i, num_apps = (conf) ? conf->num_apps : 0;
+    for (i=0; i<num_apps; i++) {
+        app_t *app = conf->app_list[i];
+
+        if (app->app_id == id) {
+            if (strcmp(app->name, name) == 0) {
+                if (app->site == APP_EXTERNAL) {
+                    if (use_shm)
+                        *shm = (av_shm_attach(app) == 0);
 
-                if (app->site == APP_EXTERNAL)
                     app->activated = TRUE;
+                }
+
+                epoch_exit();
 
                 json_decref(json);
 
                 return 0;
             } else {
                 ALOG_WARN(0, "Blocked the connection of an unauthorized application");
-                ALOG_WARN(0, " - Registered key: %u", av_ctx->app_list[i]->app_id);
-                ALOG_WARN(0, " - Registered configuration: %s", av_ctx->app_list[i]->name);
+                ALOG_WARN(0, " - Registered key: %u", app->app_id);
+                ALOG_WARN(0, " - Registered configuration: %s", app->name);
                 ALOG_WARN(0, " - Given key: %u", id);
                 ALOG_WARN(0, " - Given configuration: %s", name);
                 ALOG_WARN(0, " - Reason: The configuration of the given application is not matched with the registered one.");
 
+                epoch_exit();
+
                 json_decref(json);
 
                 return -1;
@@ -78,6 +97,8 @@ static int activate_external_application(char *msg)
         }
     }
 
+    epoch_exit();
+
     ALOG_WARN(0, "Blocked the connection of an unauthorized application");
     ALOG_WARN(0, " - Given key: %u", id);
     ALOG_WARN(0, " - Given configuration: %s", name);
@@ -90,6 +111,72 @@ static int activate_external_application(char *msg)
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to check whether an app event can be carried through shared-memory rings as it is
+ * \param type Application event type
+ */
+static int av_shm_event(uint16_t type)
+{
+    switch (type) {
+
+    // events pointing to other buffers
+    case AV_DP_INSERT_FLOWS:
+        return FALSE;
+
+    default:
+        return TRUE;
+    }
+}
+
+/**
+ * \brief Function to clear the pointers copied from the other side of shared-memory rings
+ * \param msg Application events
+ */
+static void av_shm_import(msg_t *msg)
+{
+    switch (msg->type) {
+    case AV_DP_FLOW_EXPIRED:
+    case AV_DP_FLOW_DELETED:
+    case AV_DP_INSERT_FLOW:
+    case AV_DP_MODIFY_FLOW:
+    case AV_DP_DELETE_FLOW:
+    case AV_FLOW_ADDED:
+    case AV_FLOW_MODIFIED:
+    case AV_FLOW_DELETED:
+        {
+            flow_t *flow = (flow_t *)msg->data;
+
+            flow->prev = NULL;
+            flow->next = NULL;
+            flow->r_next = NULL;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * \brief Function to get the batch of an external application (created on the first event)
+ * \param a Application context
+ */
+static msg_batch_t *av_batch_get(app_t *a)
+{
+    msg_batch_t *batch = a->batch;
+    if (batch != NULL) return batch;
+
+    batch = msg_batch_create(a->batch_max, a->batch_usec);
+    if (batch == NULL) return NULL;
+
+    // another thread may have created one at the same time
+    if (!__sync_bool_compare_and_swap(&a->batch, NULL, batch)) {
+        msg_batch_destroy(batch);
+        batch = a->batch;
+    }
+
+    return batch;
+}
+
 /**
  * \brief Function to send app events to an external application
  * \param a Application context
@@ -102,9 +189,19 @@ static int av_push_msg(app_t *a, uint32_t id, uint16_t type, uint16_t size, cons
 {
     if (!a->activated) return -1;
 
+    shm_link_t *link = a->shm;
+    if (link != NULL && av_shm_event(type))
+        return shm_ring_push(&link->down, id, type, 0, 0, input, size);
+
     char json[__MAX_EXT_MSG_SIZE] = {0};
     int len = export_to_json(id, type, input, json, 0);
 
+    if (a->batch_max > 0) {
+        msg_batch_t *batch = av_batch_get(a);
+        if (batch != NULL)
+            return msg_batch_add(batch, a->push_ctx, a->push_addr, json, len);
+    }
+
     void *push_sock = zmq_socket(a->push_ctx, ZMQ_PUSH);
 
     if (zmq_connect(push_sock, a->push_addr)) {
@@ -135,6 +232,25 @@ static int av_send_msg(app_t *a, uint32_t id, uint16_t type, uint16_t size, cons
 {
     if (!a->activated) return -1;
 
+    shm_link_t *link = a->shm;
+    if (link != NULL && av_shm_event(type)) {
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+        shm_rec_t rec;
+
+        if (shm_chan_call(&link->down_call, id, type, input, size, &rec, data, __MAX_MSG_SIZE, __SHM_RING_CALL_TIMEOUT))
+            return -1;
+
+        msg_t msg = {0};
+        msg.type = type;
+        msg.data = data;
+        av_shm_import(&msg);
+
+        if (a->in_perm[type] & APP_WRITE && rec.id == id && rec.type == type)
+            memcpy(output, data, size);
+
+        return rec.ret;
+    }
+
     char json_in[__MAX_EXT_MSG_SIZE] = {0};
     int len = export_to_json(id, type, input, json_in, 0);
 
@@ -202,6 +318,9 @@ static int process_app_events(msg_t *msg)
     case AV_DP_PORT_DELETED:
         ret = port_av_raise(msg->id, AV_DP_PORT_DELETED, sizeof(port_t), (const port_t *)msg->data);
         break;
+    case AV_DP_FLOWS_INSTALLED:
+        ret = batch_av_raise(msg->id, AV_DP_FLOWS_INSTALLED, sizeof(flow_batch_t), (const flow_batch_t *)msg->data);
+        break;
 
     // downstream events
 
@@ -220,6 +339,13 @@ static int process_app_events(msg_t *msg)
 
     // internal events (request-reply)
 
+    case AV_RT_GET_ROUTE:
+        ret = route_rw_raise(msg->id, AV_RT_GET_ROUTE, sizeof(route_t), (route_t *)msg->data);
+        break;
+    case AV_RT_GET_TREE:
+        ret = tree_rw_raise(msg->id, AV_RT_GET_TREE, sizeof(tree_t), (tree_t *)msg->data);
+        break;
+
     // internal events (notification)
 
     // log events
@@ -261,18 +387,28 @@ static void *pull_app_events(void *null)
         if (!av_ctx->av_on) break;
         else if (zmq_recv(av_pull_sock, json, __MAX_EXT_MSG_SIZE, 0) < 0) continue;
 
-        //printf("%s: %s\n", __FUNCTION__, json);
+        // a batch comes as one multipart message with an event per frame
+        int more = TRUE;
+        while (more) {
+            //printf("%s: %s\n", __FUNCTION__, json);
 
-        uint8_t data[__MAX_MSG_SIZE] = {0};
+            uint8_t data[__MAX_MSG_SIZE] = {0};
 
-        msg_t msg = {0};
-        msg.data = data;
-        import_from_json(&msg.id, &msg.type, json, msg.data);
+            msg_t msg = {0};
+            msg.data = data;
+            import_from_json(&msg.id, &msg.type, json, msg.data);
 
-        if (msg.id == 0) continue;
-        else if (msg.type > AV_NUM_EVENTS) continue;
+            if (msg.id != 0 && msg.type < AV_NUM_EVENTS)
+                process_app_events(&msg);
 
-        process_app_events(&msg);
+            size_t more_size = sizeof(int);
+            if (zmq_getsockopt(av_pull_sock, ZMQ_RCVMORE, &more, &more_size) || !more) break;
+
+            int len = zmq_recv(av_pull_sock, json, __MAX_EXT_MSG_SIZE - 1, 0);
+            if (len < 0) break;
+
+            json[MIN(len, __MAX_EXT_MSG_SIZE - 1)] = '\0';
+        }
 
         if (!av_ctx->av_on) break;
     }
@@ -282,30 +418,244 @@ static void *pull_app_events(void *null)
     return NULL;
 }
 
+/**
+ * \brief Function to send the batches held longer than their time limits
+ * \param null NULL
+ */
+static void *flush_app_events(void *null)
+{
+    while (av_ctx->av_on) {
+        int wait = 999999; // us
+
+        epoch_enter();
+
+        app_conf_t *conf = av_conf();
+
+        int i, num_apps = (conf) ? conf->num_apps : 0;
+        for (i=0; i<num_apps; i++) {
+            app_t *a = conf->app_list[i];
+
+            if (a == NULL || a->batch == NULL) continue;
+            else if (!a->activated) continue;
+
+            int left = msg_batch_flush(a->batch, a->push_ctx, a->push_addr, FALSE);
+            if (left < 0) left = a->batch->usec;
+
+            if (left < wait) wait = left;
+        }
+
+        epoch_exit();
+
+        waitsec(0, wait * 1000);
+    }
+
+    DEBUG("flush_app_events() is terminated\n");
+
+    return NULL;
+}
+
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to relay all frames of a message from one socket to another
+ * \param from Source socket
+ * \param to Destination socket
+ */
+static void relay_app_events(void *from, void *to)
+{
+    int more = TRUE;
+
+    while (more) {
+        zmq_msg_t part;
+        zmq_msg_init(&part);
+
+        if (zmq_msg_recv(&part, from, 0) < 0) {
+            zmq_msg_close(&part);
+            break;
+        }
+
+        more = zmq_msg_more(&part);
+
+        zmq_msg_send(&part, to, (more) ? ZMQ_SNDMORE : 0);
+        zmq_msg_close(&part);
+    }
+}
+
+/** \brief The maximum number of frames in the routing envelope of a request */
+#define AV_MAX_ENVELOPE 8
+
+/**
+ * \brief Function to receive a request with its routing envelope (reply workers)
+ * \param sock Worker socket
+ * \param env The frames of the envelope (output, released by the reply)
+ * \param num_env The number of the frames (output)
+ * \param json The buffer for the request
+ * \param max The size of the buffer
+ * \return The length of the request, -1 if nothing is received
+ */
+static int recv_app_envelope(void *sock, zmq_msg_t *env, int *num_env, char *json, int max)
+{
+    *num_env = 0;
+
+    while (1) {
+        zmq_msg_t part;
+        zmq_msg_init(&part);
+
+        if (zmq_msg_recv(&part, sock, 0) < 0) {
+            zmq_msg_close(&part);
+            break;
+        }
+
+        if (!zmq_msg_more(&part)) {
+            int len = MIN(zmq_msg_size(&part), max - 1);
+            memcpy(json, zmq_msg_data(&part), len);
+            json[len] = '\0';
+
+            zmq_msg_close(&part);
+
+            return len;
+        }
+
+        // the frames beyond the limit are dropped, so the reply cannot be routed back
+        if (*num_env < AV_MAX_ENVELOPE) {
+            zmq_msg_init(&env[*num_env]);
+            zmq_msg_move(&env[(*num_env)++], &part);
+        }
+
+        zmq_msg_close(&part);
+    }
+
+    int i;
+    for (i=0; i<*num_env; i++)
+        zmq_msg_close(&env[i]);
+    *num_env = 0;
+
+    return -1;
+}
+
+/**
+ * \brief Function to send a reply with the routing envelope of its request (reply workers)
+ * \param sock Worker socket
+ * \param env The frames of the envelope (released)
+ * \param num_env The number of the frames
+ * \param json Reply
+ * \param len The length of the reply
+ */
+static int send_app_envelope(void *sock, zmq_msg_t *env, int num_env, const char *json, int len)
+{
+    int i;
+    for (i=0; i<num_env; i++) {
+        zmq_msg_send(&env[i], sock, ZMQ_SNDMORE);
+        zmq_msg_close(&env[i]);
+    }
+
+    return zmq_send(sock, json, len, 0);
+}
+
+/**
+ * \brief Function to dispatch requests to workers and return their replies to the requesters
+ * \param null NULL
+ */
+static void *proxy_app_events(void *null)
+{
+    // the routing IDs of idle workers (the least recently used first)
+    uint8_t idle[__EXT_MAX_REPLY_WORKERS][256];
+    size_t idle_len[__EXT_MAX_REPLY_WORKERS];
+    int num_idle = 0;
+
+    zmq_pollitem_t items[] = {
+        { av_worker_sock, 0, ZMQ_POLLIN, 0 },
+        { av_rep_sock, 0, ZMQ_POLLIN, 0 },
+    };
+
+    while (av_ctx->av_on) {
+        // requests are taken only when a worker is free, so none waits behind a slow request
+        items[1].revents = 0;
+        if (zmq_poll(items, (num_idle > 0) ? 2 : 1, 1000) <= 0) continue;
+
+        // [worker ID][empty][READY] or [worker ID][empty][envelope of the request][reply]
+        if (items[0].revents & ZMQ_POLLIN) {
+            uint8_t id[256];
+            int id_len = zmq_recv(av_worker_sock, id, sizeof(id), 0);
+
+            zmq_msg_t part;
+            zmq_msg_init(&part);
+
+            if (id_len > 0 && id_len <= sizeof(id) && zmq_recv(av_worker_sock, NULL, 0, 0) >= 0 &&
+                zmq_msg_recv(&part, av_worker_sock, 0) >= 0) {
+                if (zmq_msg_more(&part)) {
+                    zmq_msg_send(&part, av_rep_sock, ZMQ_SNDMORE);
+                    relay_app_events(av_worker_sock, av_rep_sock);
+                }
+
+                if (num_idle < __EXT_MAX_REPLY_WORKERS) {
+                    memcpy(idle[num_idle], id, id_len);
+                    idle_len[num_idle++] = id_len;
+                }
+            }
+
+            zmq_msg_close(&part);
+        }
+
+        // [envelope of the request][request] to the least recently used worker
+        if (num_idle > 0 && (items[1].revents & ZMQ_POLLIN)) {
+            zmq_send(av_worker_sock, idle[0], idle_len[0], ZMQ_SNDMORE);
+            zmq_send(av_worker_sock, NULL, 0, ZMQ_SNDMORE);
+            relay_app_events(av_rep_sock, av_worker_sock);
+
+            num_idle--;
+            memmove(idle[0], idle[1], sizeof(idle[0]) * num_idle);
+            memmove(&idle_len[0], &idle_len[1], sizeof(idle_len[0]) * num_idle);
+        }
+    }
+
+    DEBUG("proxy_app_events() is terminated\n");
+
+    return NULL;
+}
+
 /**
  * \brief Function to handle requests from external applications and reply them
  * \param null NULL
  */
 static void *reply_app_events(void *null)
 {
+    void *sock = zmq_socket(av_rep_ctx, ZMQ_REQ);
+
+    if (zmq_connect(sock, __EXT_APP_WORKER_ADDR)) {
+        PERROR("zmq_connect");
+        zmq_close(sock);
+        return NULL;
+    }
+
+    int timeout = 1000;
+    zmq_setsockopt(sock, ZMQ_RCVTIMEO, &timeout, sizeof(int));
+
+    // tell the router that this worker is free
+    zmq_send(sock, "READY", 5, 0);
+
     while (av_ctx->av_on) {
         char json[__MAX_EXT_MSG_SIZE] = {0};
 
+        // the routing envelope of a request, which goes back with its reply
+        zmq_msg_t env[AV_MAX_ENVELOPE];
+        int num_env = 0;
+
         if (!av_ctx->av_on) break;
-        else if (zmq_recv(av_rep_sock, json, __MAX_EXT_MSG_SIZE, 0) < 0) continue;
+        else if (recv_app_envelope(sock, env, &num_env, json, __MAX_EXT_MSG_SIZE) < 0) continue;
 
         //printf("%s: %s\n", __FUNCTION__, json);
 
-        // handshake with an external appplication
+        // handshake with an external application
         if (json[0] == '#') {
-            if (activate_external_application(json + 1) == 0)
-                strcpy(json, "#{\"return\": 0}");
+            int shm = FALSE;
+
+            if (activate_external_application(json + 1, &shm) == 0)
+                strcpy(json, (shm) ? "#{\"return\": 0, \"shm\": 1}" : "#{\"return\": 0}");
             else
                 strcpy(json, "#{\"return\": -1}");
 
-            zmq_send(av_rep_sock, json, strlen(json), 0);
+            send_app_envelope(sock, env, num_env, json, strlen(json));
 
             continue;
         }
@@ -316,21 +666,178 @@ static void *reply_app_events(void *null)
         msg.data = data;
         import_from_json(&msg.id, &msg.type, json, msg.data);
 
-        if (msg.id == 0) continue;
-        else if (msg.type > AV_NUM_EVENTS) continue;
+        // a REQ socket cannot take the next request before replying to this one
+        if (msg.id == 0 || msg.type >= AV_NUM_EVENTS) {
+            strcpy(json, "{\"return\": -1}");
+            send_app_envelope(sock, env, num_env, json, strlen(json));
+            continue;
+        }
 
         msg.ret = process_app_events(&msg);
         export_to_json(msg.id, msg.type, msg.data, json, msg.ret);
-        zmq_send(av_rep_sock, json, strlen(json), 0);
+        send_app_envelope(sock, env, num_env, json, strlen(json));
 
         if (!av_ctx->av_on) break;
     }
 
+    zmq_close(sock);
+
     DEBUG("reply_app_events() is terminated\n");
 
     return NULL;
 }
 
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to receive app events through shared-memory rings
+ * \param arg Shared-memory link
+ */
+static void *shm_pull_app_events(void *arg)
+{
+    shm_link_t *link = (shm_link_t *)arg;
+
+    while (av_ctx->av_on && link->active) {
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+        shm_rec_t rec;
+
+        if (shm_ring_pop(&link->up, &rec, data, __MAX_MSG_SIZE - 1, 1000) < 0) continue;
+
+        msg_t msg = {0};
+        msg.id = rec.id;
+        msg.type = rec.type;
+        msg.data = data;
+
+        // records carrying the pointers of the other side are never sent through the rings
+        if (msg.id == 0) continue;
+        else if (msg.type >= AV_NUM_EVENTS || !av_shm_event(msg.type)) continue;
+
+        av_shm_import(&msg);
+        process_app_events(&msg);
+    }
+
+    DEBUG("shm_pull_app_events() is terminated\n");
+
+    return NULL;
+}
+
+/**
+ * \brief Function to handle requests through shared-memory rings and reply them
+ * \param arg Shared-memory link
+ */
+static void *shm_reply_app_events(void *arg)
+{
+    shm_link_t *link = (shm_link_t *)arg;
+
+    while (av_ctx->av_on && link->active) {
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+        shm_rec_t rec;
+
+        int len = shm_ring_pop(&link->up_call.req, &rec, data, __MAX_MSG_SIZE - 1, 1000);
+        if (len < 0) continue;
+
+        msg_t msg = {0};
+        msg.id = rec.id;
+        msg.type = rec.type;
+        msg.data = data;
+
+        // records carrying the pointers of the other side are never sent through the rings
+        if (msg.id == 0 || msg.type >= AV_NUM_EVENTS || !av_shm_event(msg.type)) {
+            shm_chan_reply(&link->up_call, &rec, -1, NULL, 0);
+            continue;
+        }
+
+        av_shm_import(&msg);
+
+        msg.ret = process_app_events(&msg);
+        shm_chan_reply(&link->up_call, &rec, msg.ret, msg.data, len);
+    }
+
+    DEBUG("shm_reply_app_events() is terminated\n");
+
+    return NULL;
+}
+
+/**
+ * \brief Function to attach the shared-memory rings created by an external application
+ * \param a Application context
+ */
+static int av_shm_attach(app_t *a)
+{
+    shm_link_t *link = (shm_link_t *)MALLOC(sizeof(shm_link_t));
+    if (link == NULL) {
+        PERROR("malloc");
+        return -1;
+    }
+
+    char prefix[__CONF_WORD_LEN];
+    snprintf(prefix, __CONF_WORD_LEN, "%s.a.%u", __SHM_RING_PATH, a->app_id);
+
+    if (shm_link_open(link, prefix)) {
+        FREE(link);
+        return -1;
+    }
+
+    if (pthread_create(&link->thread[0], NULL, &shm_pull_app_events, link) < 0) {
+        PERROR("pthread_create");
+        shm_link_close(link, FALSE);
+        FREE(link);
+        return -1;
+    } else link->num_threads++;
+
+    if (pthread_create(&link->thread[1], NULL, &shm_reply_app_events, link) < 0) {
+        PERROR("pthread_create");
+        shm_link_close(link, FALSE);
+        FREE(link);
+        return -1;
+    } else link->num_threads++;
+
+    // the link of a restarted application may still be in use, so it is kept until the end
+    pthread_mutex_lock(&av_shm_lock);
+
+    shm_link_t *old = a->shm;
+    if (old != NULL) {
+        old->active = FALSE;
+        old->next = av_shm_retired;
+        av_shm_retired = old;
+    }
+
+    __atomic_store_n(&a->shm, link, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&av_shm_lock);
+
+    ALOG_INFO(0, "Attached the shared-memory rings of %s", a->name);
+
+    return 0;
+}
+
+/**
+ * \brief Function to detach all shared-memory rings
+ */
+static void av_shm_detach_all(void)
+{
+    int i;
+    for (i=0; i<av_ctx->num_apps; i++) {
+        app_t *a = av_ctx->app_list[i];
+        shm_link_t *link = a->shm;
+
+        if (link == NULL) continue;
+
+        a->shm = NULL;
+
+        shm_link_close(link, FALSE);
+        FREE(link);
+    }
+
+    while (av_shm_retired != NULL) {
+        shm_link_t *link = av_shm_retired;
+        av_shm_retired = link->next;
+
+        shm_link_close(link, FALSE);
+        FREE(link);
+    }
+}
+
 /**
  * @}
  *
@@ -11,15 +11,21 @@ static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, FUNC_TYPE *data)
 {
     int ret = 0;
 
-    int av_num = av_ctx->av_num[type];
-    app_t **av_list = av_ctx->av_list[type];
+    epoch_enter();
 
-    if (av_list == NULL) return -1;
+    app_conf_t *conf = av_conf();
+    if (conf == NULL) {
+        epoch_exit();
+        return -1;
+    }
+
+    int av_num = conf->av_num[type];
+    app_t **av_list = conf->av_list[type];
 
     // outbound check
     int i, j, pass = 0;
-    for (i=0; i<av_ctx->num_apps; i++) {
-        app_t *app = av_ctx->app_list[i];
+    for (i=0; i<conf->num_apps; i++) {
+        app_t *app = conf->app_list[i];
         if (app->id == id) {
             for (j=0; j<app->out_num; j++) {
                 if (app->out_list[j] == type) {
@@ -30,7 +36,10 @@ static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, FUNC_TYPE *data)
             if (pass) break;
         }
     }
-    if (!pass) return -1;
+    if (!pass) {
+        epoch_exit();
+        return -1;
+    }
 
     // only for request-response events
     if (AV_ALL_DOWNSTREAM < type && type < AV_WRT_INTSTREAM) {
@@ -58,7 +67,9 @@ static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, FUNC_TYPE *data)
             app->num_app_events[type]++;
 
             if (app->site == APP_INTERNAL) { // internal site
+                MEM_OWNER_PUSH(app->name);
                 ret = app->handler(av, &av_out);
+                MEM_OWNER_POP();
             } else { // external site
                 ret = av_send_msg(app, id, type, len, data, av_out.data);
             }
@@ -67,5 +78,7 @@ static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, FUNC_TYPE *data)
         }
     }
 
+    epoch_exit();
+
     return ret;
 }
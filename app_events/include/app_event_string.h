@@ -13,14 +13,18 @@
 "AV_DP_PORT_ADDED",
 "AV_DP_PORT_MODIFIED",
 "AV_DP_PORT_DELETED",
+"AV_DP_FLOWS_INSTALLED",
 "AV_ALL_UPSTREAM",
 // downstream
 "AV_DP_SEND_PACKET",
 "AV_DP_INSERT_FLOW",
 "AV_DP_MODIFY_FLOW",
 "AV_DP_DELETE_FLOW",
+"AV_DP_INSERT_FLOWS",
 "AV_ALL_DOWNSTREAM",
 // internal (request-response)
+"AV_RT_GET_ROUTE",
+"AV_RT_GET_TREE",
 "AV_WRT_INTSTREAM",
 // internal (notification)
 "AV_SW_CONNECTED",
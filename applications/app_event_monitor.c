@@ -25,8 +25,40 @@
 /* \brief The flag to enable API monitoring */
 int API_monitor_enabled;
 
-/* \brief The file descriptor for logging */
-FILE *av_fp;
+/** \brief The flag whether API monitoring is requested by the environment */
+static int API_monitor_env;
+
+/** \brief The trace file to record app events */
+static trace_t av_trace;
+
+/** \brief The flag to record app events */
+static volatile int av_tracing;
+
+/** \brief The number of handlers writing into the trace */
+static volatile int av_tracing_writers;
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The trace file to replay */
+static trace_t av_replay_trace;
+
+/** \brief The replay thread */
+static pthread_t av_replay_thread;
+
+/** \brief The flag to keep replaying */
+static volatile int av_replaying;
+
+/** \brief The flag whether the replay thread is running */
+static volatile int av_replay_active;
+
+/** \brief The speed-up factor of a replay */
+static double av_replay_speed;
+
+/** \brief The number of replayed events */
+static uint64_t av_replayed;
+
+/** \brief The number of skipped events */
+static uint64_t av_skipped;
 
 /////////////////////////////////////////////////////////////////////
 
@@ -37,6 +69,180 @@ const char application_event_string[__MAX_APP_EVENTS][__CONF_WORD_LEN] = {
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to start recording app events
+ * \param file The path of a trace file
+ * \param payload_len The maximum payload captured in a record
+ */
+static int av_trace_start(const char *file, int payload_len)
+{
+    if (av_tracing) return -1;
+
+    if (trace_create(&av_trace, file, __TRACE_NUM_RECORDS, payload_len))
+        return -1;
+
+    API_monitor_enabled = TRUE;
+    av_tracing = TRUE;
+
+    return 0;
+}
+
+/**
+ * \brief Function to stop recording app events
+ */
+static int av_trace_stop(void)
+{
+    if (!av_tracing) return -1;
+
+    av_tracing = FALSE;
+
+    // wait for the handlers that are still writing records
+    while (av_tracing_writers)
+        waitsec(0, 1000);
+
+    trace_close(&av_trace);
+
+    API_monitor_enabled = API_monitor_env;
+
+    return 0;
+}
+
+/**
+ * \brief Function to raise a recorded event
+ * \param rec Trace record
+ */
+static int av_replay_rec(const trace_rec_t *rec)
+{
+    // only the events whose payloads are fully captured
+    if (rec->captured != rec->length)
+        return -1;
+
+    return av_raise_data(rec->id, rec->type, rec->length, rec->payload);
+}
+
+/**
+ * \brief The replay thread
+ * \param null NULL
+ */
+static void *av_replay_main(void *null)
+{
+    trace_replay(&av_replay_trace, av_replay_speed, &av_replaying, av_replay_rec, &av_replayed, &av_skipped);
+
+    ALOG_INFO(AV_MONITOR_ID, "Replayed %lu app events (%lu skipped) from %s", av_replayed, av_skipped, av_replay_trace.path);
+
+    trace_close(&av_replay_trace);
+
+    av_replaying = FALSE;
+    av_replay_active = FALSE;
+
+    return NULL;
+}
+
+/**
+ * \brief Function to replay a trace file
+ * \param cli The pointer of the Barista CLI
+ * \param file The path of a trace file
+ * \param speed Speed-up factor (1: original speed, 0: as fast as possible)
+ */
+static int av_replay_start(cli_t *cli, const char *file, double speed)
+{
+    if (av_replay_active) {
+        cli_print(cli, "Another trace is being replayed");
+        return -1;
+    }
+
+    if (av_tracing && strcmp(file, av_trace.path) == 0) {
+        cli_print(cli, "%s is being recorded", file);
+        return -1;
+    }
+
+    if (trace_open(&av_replay_trace, file)) {
+        cli_print(cli, "Failed to open %s", file);
+        return -1;
+    }
+
+    av_replay_speed = speed;
+    av_replayed = 0;
+    av_skipped = 0;
+    av_replaying = TRUE;
+    av_replay_active = TRUE;
+
+    if (pthread_create(&av_replay_thread, NULL, av_replay_main, NULL) < 0) {
+        PERROR("pthread_create");
+        av_replaying = FALSE;
+        av_replay_active = FALSE;
+        trace_close(&av_replay_trace);
+        return -1;
+    }
+
+    pthread_detach(av_replay_thread);
+
+    cli_print(cli, "Replaying %lu app events from %s", trace_count(&av_replay_trace), file);
+
+    return 0;
+}
+
+/**
+ * \brief Function to print recorded events
+ * \param cli The pointer of the Barista CLI
+ * \param file The path of a trace file
+ * \param num The number of the latest events to print
+ */
+static int av_trace_dump(cli_t *cli, const char *file, int num)
+{
+    trace_t trace = {0};
+
+    if (trace_open(&trace, file)) {
+        cli_print(cli, "Failed to open %s", file);
+        return -1;
+    }
+
+    uint64_t count = trace_count(&trace);
+    uint64_t i = (num > 0 && count > num) ? count - num : 0;
+
+    for (; i<count; i++) {
+        const trace_rec_t *rec = trace_get(&trace, i);
+        if (rec == NULL) continue;
+
+        int64_t diff = rec->recorded - rec->raised;
+
+        cli_print(cli, "%u\t%u\t%s\t%ld.%09ld\t%ld.%09ld\t%ld.%09ld\t%u\t%08x",
+                  rec->id, rec->type, (rec->type < __MAX_APP_EVENTS) ? application_event_string[rec->type] : "-",
+                  rec->raised / 1000000000, rec->raised % 1000000000,
+                  rec->recorded / 1000000000, rec->recorded % 1000000000,
+                  diff / 1000000000, diff % 1000000000, rec->length, rec->digest);
+    }
+
+    trace_close(&trace);
+
+    return 0;
+}
+
+/**
+ * \brief Function to print the status of the recorder and the replayer
+ * \param cli The pointer of the Barista CLI
+ */
+static int av_trace_show(cli_t *cli)
+{
+    if (av_tracing) {
+        cli_print(cli, "Recording: %s", av_trace.path);
+        cli_print(cli, "  Records: %lu (ring of %u records, %u bytes each)",
+                  av_trace.hdr->next, av_trace.hdr->num_recs, av_trace.hdr->rec_size);
+        cli_print(cli, "  Captured payload: up to %u bytes", av_trace.hdr->payload_len);
+    } else {
+        cli_print(cli, "Recording: off");
+    }
+
+    if (av_replay_active)
+        cli_print(cli, "Replaying: %s (%lu replayed, %lu skipped)", av_replay_trace.path, av_replayed, av_skipped);
+    else
+        cli_print(cli, "Replaying: off");
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief The main function
  * \param activated The activation flag of this application
@@ -48,13 +254,14 @@ int app_event_monitor_main(int *activated, int argc, char **argv)
     ALOG_INFO(AV_MONITOR_ID, "Init - Application event monitor");
 
     const char *API_monitor = getenv("API_monitor");
-    if (API_monitor != NULL && strcmp(API_monitor, "API_monitor") == 0)
+    if (API_monitor != NULL && strcmp(API_monitor, "API_monitor") == 0) {
+        API_monitor_env = TRUE;
         API_monitor_enabled = TRUE;
 
-    av_fp = fopen("log/app_event.log", "a");
-    if (av_fp == NULL) {
-        ALOG_ERROR(AV_MONITOR_ID, "Failed to open log/app_event.log");
-        return -1;
+        if (av_trace_start(__AV_TRACE_FILE, __TRACE_PAYLOAD_LEN)) {
+            ALOG_ERROR(AV_MONITOR_ID, "Failed to create %s", __AV_TRACE_FILE);
+            return -1;
+        }
     }
 
     activate();
@@ -72,8 +279,11 @@ int app_event_monitor_cleanup(int *activated)
 
     deactivate();
 
-    if (av_fp != NULL)
-        fclose(av_fp);
+    av_replaying = FALSE;
+    while (av_replay_active)
+        waitsec(0, 1000);
+
+    av_trace_stop();
 
     return 0;
 }
@@ -85,7 +295,54 @@ int app_event_monitor_cleanup(int *activated)
  */
 int app_event_monitor_cli(cli_t *cli, char **args)
 {
-    cli_print(cli, "No CLI support");
+    if (args[0] != NULL && strcmp(args[0], "trace") == 0 && args[1] != NULL) {
+        if (strcmp(args[1], "start") == 0) {
+            const char *file = (args[2] != NULL) ? args[2] : __AV_TRACE_FILE;
+            int payload_len = (args[2] != NULL && args[3] != NULL) ? atoi(args[3]) : __TRACE_PAYLOAD_LEN;
+
+            if (av_trace_start(file, payload_len))
+                cli_print(cli, "Failed to start recording app events into %s", file);
+            else
+                cli_print(cli, "Started recording app events into %s", file);
+
+            return 0;
+        } else if (strcmp(args[1], "stop") == 0 && args[2] == NULL) {
+            if (av_trace_stop())
+                cli_print(cli, "No app events are being recorded");
+            else
+                cli_print(cli, "Stopped recording app events");
+
+            return 0;
+        } else if (strcmp(args[1], "show") == 0 && args[2] == NULL) {
+            av_trace_show(cli);
+            return 0;
+        } else if (strcmp(args[1], "dump") == 0) {
+            const char *file = (args[2] != NULL) ? args[2] : __AV_TRACE_FILE;
+            int num = (args[2] != NULL && args[3] != NULL) ? atoi(args[3]) : 20;
+
+            av_trace_dump(cli, file, num);
+            return 0;
+        }
+    } else if (args[0] != NULL && strcmp(args[0], "replay") == 0) {
+        if (args[1] != NULL && strcmp(args[1], "stop") == 0 && args[2] == NULL) {
+            av_replaying = FALSE;
+            cli_print(cli, "Stopped replaying app events");
+            return 0;
+        } else if (args[1] != NULL) {
+            double speed = (args[2] != NULL) ? atof(args[2]) : 1.0;
+
+            av_replay_start(cli, args[1], speed);
+            return 0;
+        }
+    }
+
+    cli_print(cli, "< Available Commands >");
+    cli_print(cli, "  app_event_monitor trace start [file] [payload bytes]");
+    cli_print(cli, "  app_event_monitor trace stop");
+    cli_print(cli, "  app_event_monitor trace show");
+    cli_print(cli, "  app_event_monitor trace dump [file] [# of events]");
+    cli_print(cli, "  app_event_monitor replay [file] [speed-up (0: no delay)]");
+    cli_print(cli, "  app_event_monitor replay stop");
 
     return 0;
 }
@@ -97,22 +354,13 @@ int app_event_monitor_cli(cli_t *cli, char **args)
  */
 int app_event_monitor_handler(const app_event_t *av, app_event_out_t *av_out)
 {
-    if (API_monitor_enabled) {
-        struct timespec curr_time, time_diff;
-        clock_gettime(CLOCK_REALTIME, &curr_time);
-
-        time_diff.tv_sec = curr_time.tv_sec - av->time.tv_sec;
-        time_diff.tv_nsec = curr_time.tv_nsec - av->time.tv_nsec;
-
-        char message[__CONF_STR_LEN];
-        sprintf(message, "%u\t%u\t%s\t%lld.%.9ld\t%lld.%9ld\t%lld.%ld\n", 
-            av->id, av->type, application_event_string[av->type],
-            (long long)av->time.tv_sec, av->time.tv_nsec, 
-            (long long)curr_time.tv_sec, curr_time.tv_nsec,
-            (long long)time_diff.tv_sec, time_diff.tv_nsec);
-
-        fputs(message, av_fp);
-        fflush(av_fp);
+    if (av_tracing) {
+        __sync_fetch_and_add(&av_tracing_writers, 1);
+
+        if (av_tracing)
+            trace_record(&av_trace, av->id, av->type, &av->time, av->data, av->length, 0);
+
+        __sync_fetch_and_sub(&av_tracing_writers, 1);
     }
 
     return 0;
@@ -11,3 +11,11 @@
 
 #include "common.h"
 #include "app_event.h"
+#include "trace.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The default trace file of app events */
+#define __AV_TRACE_FILE "log/app_event.trace"
+
+/////////////////////////////////////////////////////////////////////
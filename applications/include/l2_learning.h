@@ -13,6 +13,7 @@
 #include "app_event.h"
 #include "database.h"
 #include "hash.h"
+#include "cpu_affinity.h"
 
 /////////////////////////////////////////////////////////////////////
 
@@ -45,3 +46,45 @@ mac_entry_t *mac_cache;
 pthread_spinlock_t mac_lock[NUM_MAC_ENTRIES];
 
 /////////////////////////////////////////////////////////////////////
+
+/** \brief Forwarding modes */
+enum l2_mode {
+    L2_MODE_EXACT, /**< An exact-match rule per packet-in (IPv4 only) */
+    L2_MODE_MAC,   /**< Destination MAC rules for both directions */
+    L2_MODE_PATH,  /**< Destination MAC rules for both directions along the whole path */
+};
+
+/** \brief The names of forwarding modes */
+#define L2_MODE_STRINGS {"exact", "mac", "path"}
+
+/** \brief The number of pending flow setups */
+#define NUM_PENDING_ENTRIES 4096
+
+/** \brief The time to coalesce packet-ins with a pending flow setup (ms) */
+#define __L2_PENDING_TIME 500
+
+/** \brief The structure of a pending flow setup */
+typedef struct _pending_t {
+    uint64_t dpid; /**< Datapath ID */
+    uint32_t port; /**< Input port */
+    int mode; /**< The forwarding mode when the setup started */
+    pkt_info_t match; /**< Packet information */
+    uint16_t out_port; /**< Output port */
+    uint64_t expire; /**< Expiration time (ns, monotonic) */
+} pending_t;
+
+/** \brief Pending flow setups (direct-mapped) */
+pending_t *pending;
+
+/** \brief The locks for pending flow setups */
+pthread_spinlock_t pending_lock[NUM_PENDING_ENTRIES];
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The locations of hosts (direct-mapped, from host events) */
+host_t *host_loc;
+
+/** \brief The locks for host locations */
+pthread_spinlock_t host_loc_lock[NUM_MAC_ENTRIES];
+
+/////////////////////////////////////////////////////////////////////
@@ -25,6 +25,15 @@
 /* The flag to enable the CBENCH mode */
 int cbench_enabled;
 
+/** \brief The forwarding mode */
+static int l2_mode;
+
+/** \brief The names of forwarding modes */
+static const char *l2_mode_str[] = L2_MODE_STRINGS;
+
+/** \brief The number of packet-ins coalesced with pending flow setups */
+static uint64_t num_coalesced;
+
 /////////////////////////////////////////////////////////////////////
 
 /**
@@ -49,6 +58,54 @@ static int send_packet(const pktin_t *pktin, uint16_t port)
     return 0;
 }
 
+/**
+ * \brief Function to flood a packet along the broadcast tree
+ * \param pktin Pktin message
+ */
+static int flood_packet(const pktin_t *pktin)
+{
+    tree_t tree = {0};
+
+    tree.dpid = pktin->dpid;
+    tree.in_port = pktin->port;
+
+    av_rt_get_tree(L2_LEARNING_ID, &tree);
+
+    // no topology information for the switch
+    if (tree.root == 0)
+        return send_packet(pktin, PORT_FLOOD);
+
+    pktout_t out = {0};
+
+    PKTOUT_INIT(out, pktin);
+
+    // nowhere to flood, but the switch still has to release the buffered packet
+    if (tree.num_ports == 0) {
+        if (pktin->buffer_id != -1)
+            av_dp_send_packet(L2_LEARNING_ID, &out);
+        return 0;
+    }
+
+    out.total_len = pktin->total_len;
+    memmove(&out.data, pktin->data, pktin->total_len);
+
+    // a pktout message carries up to __MAX_NUM_ACTIONS output actions
+    int i;
+    for (i=0; i<tree.num_ports; i++) {
+        out.action[out.num_actions].type = ACTION_OUTPUT;
+        out.action[out.num_actions].port = tree.port[i];
+        out.num_actions++;
+
+        if (out.num_actions == __MAX_NUM_ACTIONS || i == tree.num_ports - 1) {
+            av_dp_send_packet(L2_LEARNING_ID, &out);
+            out.num_actions = 0;
+            out.buffer_id = -1; // the buffered packet is released by the first message
+        }
+    }
+
+    return 0;
+}
+
 /**
  * \brief Function to insert a flow rule into the data plane
  * \param pktin Pktin message
@@ -73,6 +130,269 @@ static int insert_flow(const pktin_t *pktin, uint16_t port)
     return 0;
 }
 
+/**
+ * \brief Function to insert a rule that matches a destination MAC address only
+ * \param dpid Datapath ID
+ * \param mac Destination MAC address
+ * \param port Output port
+ */
+static int insert_mac_flow(uint64_t dpid, const uint8_t *mac, uint16_t port)
+{
+    flow_t out = {0};
+
+    out.dpid = dpid;
+
+    out.info.buffer_id = -1;
+
+    out.meta.idle_timeout = DEFAULT_IDLE_TIMEOUT;
+    out.meta.hard_timeout = DEFAULT_HARD_TIMEOUT;
+    out.meta.priority = DEFAULT_PRIORITY;
+
+    memmove(out.pkt_info.dst_mac, mac, ETH_ALEN);
+    out.pkt_info.wildcards = FLWD_ALL & ~FLWD_DST_MAC;
+
+    out.num_actions = 1;
+    out.action[0].type = ACTION_OUTPUT;
+    out.action[0].port = port;
+
+    av_dp_insert_flow(L2_LEARNING_ID, &out);
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to get the current time for pending flow setups
+ */
+static uint64_t pending_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * \brief Function to get the slot of a packet-in in the pending flow setups
+ * \param pktin Pktin message
+ */
+static uint32_t pending_key(const pktin_t *pktin)
+{
+    const pkt_info_t *info = &pktin->pkt_info;
+    mac_key_t mkey;
+
+    mkey.dpid = pktin->dpid ^ ((uint64_t)pktin->port << 48);
+    mkey.mac = mac2int(info->dst_mac) ^ (mac2int(info->src_mac) << 16);
+
+    if (l2_mode == L2_MODE_EXACT)
+        mkey.mac ^= ((uint64_t)info->src_ip << 32) ^ info->dst_ip ^ ((uint64_t)info->src_port << 16) ^ info->dst_port;
+
+    return hash_func((uint32_t *)&mkey, 4) % NUM_PENDING_ENTRIES;
+}
+
+/**
+ * \brief Function to check whether a pending flow setup covers a packet-in
+ * \param entry Pending flow setup
+ * \param pktin Pktin message
+ */
+static int pending_match(const pending_t *entry, const pktin_t *pktin)
+{
+    if (entry->dpid != pktin->dpid || entry->port != pktin->port || entry->mode != l2_mode)
+        return FALSE;
+
+    // exact-match rules cover the same packet information only
+    if (l2_mode == L2_MODE_EXACT)
+        return (memcmp(&entry->match, &pktin->pkt_info, sizeof(pkt_info_t)) == 0);
+
+    return (memcmp(entry->match.src_mac, pktin->pkt_info.src_mac, ETH_ALEN) == 0 &&
+            memcmp(entry->match.dst_mac, pktin->pkt_info.dst_mac, ETH_ALEN) == 0);
+}
+
+/**
+ * \brief Function to forward a packet-in using a pending flow setup
+ * \param pktin Pktin message
+ * \return 1 if forwarded, 0 otherwise
+ */
+static int pending_forward(const pktin_t *pktin)
+{
+    uint32_t key = pending_key(pktin);
+
+    pthread_spin_lock(&pending_lock[key]);
+
+    if (!pending_match(&pending[key], pktin) || pending[key].expire < pending_now()) {
+        pthread_spin_unlock(&pending_lock[key]);
+        return 0;
+    }
+
+    uint16_t port = pending[key].out_port;
+
+    pthread_spin_unlock(&pending_lock[key]);
+
+    send_packet(pktin, port);
+
+    __sync_fetch_and_add(&num_coalesced, 1);
+
+    return 1;
+}
+
+/**
+ * \brief Function to register a flow setup for a packet-in
+ * \param pktin Pktin message
+ * \param port Output port
+ */
+static int pending_add(const pktin_t *pktin, uint16_t port)
+{
+    uint32_t key = pending_key(pktin);
+
+    pthread_spin_lock(&pending_lock[key]);
+
+    pending[key].dpid = pktin->dpid;
+    pending[key].port = pktin->port;
+    pending[key].mode = l2_mode;
+    pending[key].match = pktin->pkt_info;
+    pending[key].out_port = port;
+    pending[key].expire = pending_now() + __L2_PENDING_TIME * 1000000UL;
+
+    pthread_spin_unlock(&pending_lock[key]);
+
+    return 0;
+}
+
+/**
+ * \brief Function to drop the pending flow setups of a switch
+ * \param dpid Datapath ID
+ */
+static int pending_flush(uint64_t dpid)
+{
+    int i;
+    for (i=0; i<NUM_PENDING_ENTRIES; i++) {
+        if (pending[i].dpid == dpid) {
+            pthread_spin_lock(&pending_lock[i]);
+            memset(&pending[i], 0, sizeof(pending_t));
+            pthread_spin_unlock(&pending_lock[i]);
+        }
+    }
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to get the slot of a MAC address in the host locations
+ * \param mac MAC address
+ */
+static uint32_t host_loc_key(uint64_t mac)
+{
+    mac_key_t mkey = {0};
+
+    mkey.mac = mac;
+
+    return hash_func((uint32_t *)&mkey, 4) % NUM_MAC_ENTRIES;
+}
+
+/**
+ * \brief Function to get the location of a host
+ * \param mac MAC address
+ * \param host The location of the host (output)
+ */
+static int get_host_loc(uint64_t mac, host_t *host)
+{
+    uint32_t key = host_loc_key(mac);
+    int ret = -1;
+
+    pthread_spin_lock(&host_loc_lock[key]);
+
+    if (host_loc[key].mac == mac && host_loc[key].dpid) {
+        *host = host_loc[key];
+        ret = 0;
+    }
+
+    pthread_spin_unlock(&host_loc_lock[key]);
+
+    return ret;
+}
+
+/**
+ * \brief Function to install destination MAC rules from a switch to the location of a host
+ * \param dpid The datapath ID of the first switch
+ * \param mac Destination MAC address
+ * \param hash Flow hash to pick one of the equal-cost paths
+ * \return The output port at the first switch (0: no path)
+ */
+static uint16_t insert_path(uint64_t dpid, uint64_t mac, uint32_t hash)
+{
+    host_t host;
+
+    if (get_host_loc(mac, &host))
+        return 0;
+
+    uint8_t macaddr[ETH_ALEN];
+    int2mac(mac, macaddr);
+
+    if (host.dpid == dpid) {
+        insert_mac_flow(dpid, macaddr, host.port);
+        return host.port;
+    }
+
+    route_t route = {0};
+
+    route.src = dpid;
+    route.dst = host.dpid;
+    route.hash = hash;
+
+    av_rt_get_route(L2_LEARNING_ID, &route);
+
+    if (route.dist == ROUTE_UNREACHABLE || route.num_hops != route.dist)
+        return 0;
+
+    // from the last hop so that packets do not overtake the rules
+    insert_mac_flow(host.dpid, macaddr, host.port);
+
+    int i;
+    for (i=route.num_hops-1; i>=0; i--)
+        insert_mac_flow(route.hop[i].dpid, macaddr, route.hop[i].port);
+
+    return route.hop[0].port;
+}
+
+/**
+ * \brief Function to forward a packet to a learned port in the MAC or path mode
+ * \param pktin Pktin message
+ * \param port The learned port of the destination
+ */
+static int forward_proactive(const pktin_t *pktin, uint16_t port)
+{
+    uint64_t src = mac2int(pktin->pkt_info.src_mac);
+    uint64_t dst = mac2int(pktin->pkt_info.dst_mac);
+
+    if (l2_mode == L2_MODE_PATH) {
+        mac_key_t mkey = {0};
+
+        mkey.dpid = src;
+        mkey.mac = dst;
+
+        uint32_t hash = hash_func((uint32_t *)&mkey, 4);
+
+        uint16_t out_port = insert_path(pktin->dpid, dst, hash);
+        if (out_port) {
+            host_t host;
+
+            // reverse path from the destination host
+            if (get_host_loc(dst, &host) == 0 && insert_path(host.dpid, src, hash) == 0)
+                insert_mac_flow(pktin->dpid, pktin->pkt_info.src_mac, pktin->port);
+
+            return send_packet(pktin, out_port);
+        }
+    }
+
+    insert_mac_flow(pktin->dpid, pktin->pkt_info.dst_mac, port);
+    insert_mac_flow(pktin->dpid, pktin->pkt_info.src_mac, pktin->port);
+
+    return send_packet(pktin, port);
+}
+
 /////////////////////////////////////////////////////////////////////
 
 /**
@@ -134,6 +454,10 @@ static int l2_learning(const pktin_t *pktin)
         return 0;
     }
 
+    // the same flow is being set up
+    if (pending_forward(pktin))
+        return 0;
+
     mac_key_t mkey;
 
     // source check
@@ -173,7 +497,7 @@ static int l2_learning(const pktin_t *pktin)
     mkey.mac = mac2int(pktin->pkt_info.dst_mac);
 
     if (mkey.mac == __BROADCAST_MAC) { // broadcast
-        send_packet(pktin, PORT_FLOOD);
+        flood_packet(pktin);
         return 0;
     }
 
@@ -189,7 +513,7 @@ static int l2_learning(const pktin_t *pktin)
 
         if (get_mac_entry(&dest)) { // not found in database
             pthread_spin_unlock(&mac_lock[key]);
-            send_packet(pktin, PORT_FLOOD);
+            flood_packet(pktin);
             return 0;
         } else {
             mac_cache[key].dpid = mkey.dpid;
@@ -203,7 +527,11 @@ static int l2_learning(const pktin_t *pktin)
 
     // forwarding
 
-    if (pktin->pkt_info.proto & PROTO_IPV4) { // IPv4
+    pending_add(pktin, mac_cache[key].port);
+
+    if (l2_mode != L2_MODE_EXACT) {
+        forward_proactive(pktin, mac_cache[key].port);
+    } else if (pktin->pkt_info.proto & PROTO_IPV4) { // IPv4
         insert_flow(pktin, mac_cache[key].port);
     } else { // Otherwise
         send_packet(pktin, mac_cache[key].port);
@@ -228,6 +556,16 @@ int l2_learning_main(int *activated, int argc, char **argv)
     if (CBENCH != NULL && strcmp(CBENCH, "CBENCH") == 0)
         cbench_enabled = TRUE;
 
+    // the forwarding mode comes from the arguments in the application configuration
+    int k;
+    for (k=1; k<argc; k++) {
+        int i;
+        for (i=L2_MODE_EXACT; i<=L2_MODE_PATH; i++) {
+            if (strcmp(argv[k], l2_mode_str[i]) == 0)
+                l2_mode = i;
+        }
+    }
+
     if (get_database_info(&l2_learning_info, "l2_learning")) {
         ALOG_ERROR(L2_LEARNING_ID, "Failed to get the information of a l2_learning database");
         return -1;
@@ -241,11 +579,37 @@ int l2_learning_main(int *activated, int argc, char **argv)
         return -1;
     }
 
+    host_loc = (host_t *)CALLOC(NUM_MAC_ENTRIES, sizeof(host_t));
+    if (host_loc == NULL) {
+        ALOG_ERROR(L2_LEARNING_ID, "calloc() failed");
+        FREE(mac_cache);
+        return -1;
+    }
+
+    pending = (pending_t *)CALLOC(NUM_PENDING_ENTRIES, sizeof(pending_t));
+    if (pending == NULL) {
+        ALOG_ERROR(L2_LEARNING_ID, "calloc() failed");
+        FREE(host_loc);
+        FREE(mac_cache);
+        return -1;
+    }
+
+    cpu_place_memory(mac_cache, NUM_MAC_ENTRIES * sizeof(mac_entry_t));
+    cpu_place_memory(host_loc, NUM_MAC_ENTRIES * sizeof(host_t));
+    cpu_place_memory(pending, NUM_PENDING_ENTRIES * sizeof(pending_t));
+
     int i;
     for (i=0; i<NUM_MAC_ENTRIES; i++) {
         pthread_spin_init(&mac_lock[i], PTHREAD_PROCESS_PRIVATE);
+        pthread_spin_init(&host_loc_lock[i], PTHREAD_PROCESS_PRIVATE);
     }
 
+    for (i=0; i<NUM_PENDING_ENTRIES; i++) {
+        pthread_spin_init(&pending_lock[i], PTHREAD_PROCESS_PRIVATE);
+    }
+
+    ALOG_INFO(L2_LEARNING_ID, "Forwarding mode: %s", l2_mode_str[l2_mode]);
+
     activate();
 
     return 0;
@@ -264,8 +628,15 @@ int l2_learning_cleanup(int *activated)
     int i;
     for (i=0; i<NUM_MAC_ENTRIES; i++) {
         pthread_spin_destroy(&mac_lock[i]);
+        pthread_spin_destroy(&host_loc_lock[i]);
     }
 
+    for (i=0; i<NUM_PENDING_ENTRIES; i++) {
+        pthread_spin_destroy(&pending_lock[i]);
+    }
+
+    FREE(pending);
+    FREE(host_loc);
     FREE(mac_cache);
 
     return 0;
@@ -458,6 +829,26 @@ static int show_entry_ip(cli_t *cli, const char *ipaddr)
     return 0;
 }
 
+/**
+ * \brief Function to print the pending flow setups
+ * \param cli The pointer of the Barista CLI
+ */
+static int show_pending(cli_t *cli)
+{
+    uint64_t now = pending_now();
+    int i, cnt = 0;
+
+    for (i=0; i<NUM_PENDING_ENTRIES; i++) {
+        if (pending[i].dpid != 0 && pending[i].expire >= now)
+            cnt++;
+    }
+
+    cli_print(cli, "Pending flow setups: %d", cnt);
+    cli_print(cli, "Coalesced packet-ins: %lu", num_coalesced);
+
+    return 0;
+}
+
 /**
  * \brief The CLI function
  * \param cli The pointer of the Barista CLI
@@ -470,6 +861,20 @@ int l2_learning_cli(cli_t *cli, char **args)
             list_all_entries(cli);
             return 0;
         }
+    } else if (args[0] != NULL && strcmp(args[0], "mode") == 0) {
+        if (args[1] == NULL) {
+            cli_print(cli, "Forwarding mode: %s", l2_mode_str[l2_mode]);
+            return 0;
+        } else if (args[2] == NULL) {
+            int i;
+            for (i=L2_MODE_EXACT; i<=L2_MODE_PATH; i++) {
+                if (strcmp(args[1], l2_mode_str[i]) == 0) {
+                    l2_mode = i;
+                    cli_print(cli, "Changed the forwarding mode to %s", l2_mode_str[i]);
+                    return 0;
+                }
+            }
+        }
     } else if (args[0] != NULL && strcmp(args[0], "show") == 0) {
         if (args[1] != NULL && strcmp(args[1], "switch") == 0 && args[2] != NULL && args[3] == NULL) {
             show_entry_switch(cli, args[2]);
@@ -480,6 +885,9 @@ int l2_learning_cli(cli_t *cli, char **args)
         } else if (args[1] != NULL && strcmp(args[1], "ip") == 0 && args[2] != NULL && args[3] == NULL) {
             show_entry_ip(cli, args[2]);
             return 0;
+        } else if (args[1] != NULL && strcmp(args[1], "pending") == 0 && args[2] == NULL) {
+            show_pending(cli);
+            return 0;
         }
     }
 
@@ -488,6 +896,8 @@ int l2_learning_cli(cli_t *cli, char **args)
     cli_print(cli, "  l2_learning show switch [DPID]");
     cli_print(cli, "  l2_learning show mac [MAC address]");
     cli_print(cli, "  l2_learning show ip [IP address]");
+    cli_print(cli, "  l2_learning show pending");
+    cli_print(cli, "  l2_learning mode [exact|mac|path]");
 
     return 0;
 }
@@ -529,6 +939,8 @@ int l2_learning_handler(const app_event_t *av, app_event_out_t *av_out)
                     break;
                 }
             }
+
+            pending_flush(port->dpid);
         }
         break;
     case AV_DP_PORT_DELETED:
@@ -552,6 +964,33 @@ int l2_learning_handler(const app_event_t *av, app_event_out_t *av_out)
                     break;
                 }
             }
+
+            pending_flush(port->dpid);
+        }
+        break;
+    case AV_HOST_ADDED:
+        PRINT_EV("AV_HOST_ADDED\n");
+        {
+            const host_t *host = av->host;
+
+            uint32_t key = host_loc_key(host->mac);
+
+            pthread_spin_lock(&host_loc_lock[key]);
+            host_loc[key] = *host;
+            pthread_spin_unlock(&host_loc_lock[key]);
+        }
+        break;
+    case AV_HOST_DELETED:
+        PRINT_EV("AV_HOST_DELETED\n");
+        {
+            const host_t *host = av->host;
+
+            uint32_t key = host_loc_key(host->mac);
+
+            pthread_spin_lock(&host_loc_lock[key]);
+            if (host_loc[key].mac == host->mac)
+                memset(&host_loc[key], 0, sizeof(host_t));
+            pthread_spin_unlock(&host_loc_lock[key]);
         }
         break;
     case AV_SW_CONNECTED:
@@ -574,6 +1013,8 @@ int l2_learning_handler(const app_event_t *av, app_event_out_t *av_out)
                     pthread_spin_unlock(&mac_lock[i]);
                 }
             }
+
+            pending_flush(sw->dpid);
         }
         break;
     case AV_SW_DISCONNECTED:
@@ -596,6 +1037,8 @@ int l2_learning_handler(const app_event_t *av, app_event_out_t *av_out)
                     pthread_spin_unlock(&mac_lock[i]);
                 }
             }
+
+            pending_flush(sw->dpid);
         }
         break;
     default:
@@ -115,6 +115,12 @@ int apphdlr_handler(const event_t *ev, event_out_t *ev_out)
             av_dp_port_deleted(APPINT_ID, ev->port);
         }
         break;
+    case EV_DP_FLOWS_INSTALLED:
+        PRINT_EV("EV_DP_FLOWS_INSTALLED\n");
+        {
+            av_dp_flows_installed(APPINT_ID, ev->batch);
+        }
+        break;
 
     // internal events (notification)
 
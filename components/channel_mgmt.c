@@ -22,6 +22,36 @@
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to store and notify the traffic statistics of the last period (periodic task)
+ * \param arg NULL
+ * \return 0 (every __CHANNEL_MGMT_MONITOR_TIME)
+ */
+static int channel_mgmt_monitor(void *arg)
+{
+    traffic_t tr;
+
+    pthread_spin_lock(&tr_lock);
+
+    memmove(&tr, &traffic, sizeof(traffic_t));
+    memset(&traffic, 0, sizeof(traffic_t));
+
+    pthread_spin_unlock(&tr_lock);
+
+    char values[__CONF_STR_LEN];
+    sprintf(values, "%lu, %lu, %lu, %lu", tr.in_pkt_cnt, tr.in_byte_cnt, tr.out_pkt_cnt, tr.out_byte_cnt);
+
+    if (insert_data(&channel_mgmt_info, "channel_mgmt", "IN_PKT_CNT, IN_BYTE_CNT, OUT_PKT_CNT, OUT_BYTE_CNT", values)) {
+        LOG_ERROR(CHANNEL_MGMT_ID, "insert_data() failed");
+    }
+
+    ev_tr_update_stats(CHANNEL_MGMT_ID, &tr);
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief The main function
  * \param activated The activation flag of this component
@@ -45,30 +75,10 @@ int channel_mgmt_main(int *activated, int argc, char **argv)
 
     activate();
 
-    while (*activated) {
-        traffic_t tr;
-
-        pthread_spin_lock(&tr_lock);
-
-        memmove(&tr, &traffic, sizeof(traffic_t));
-        memset(&traffic, 0, sizeof(traffic_t));
-
-        pthread_spin_unlock(&tr_lock);
-
-        char values[__CONF_STR_LEN];
-        sprintf(values, "%lu, %lu, %lu, %lu", tr.in_pkt_cnt, tr.in_byte_cnt, tr.out_pkt_cnt, tr.out_byte_cnt);
-
-        if (insert_data(&channel_mgmt_info, "channel_mgmt", "IN_PKT_CNT, IN_BYTE_CNT, OUT_PKT_CNT, OUT_BYTE_CNT", values)) {
-            LOG_ERROR(CHANNEL_MGMT_ID, "insert_data() failed");
-        }
-
-        ev_tr_update_stats(CHANNEL_MGMT_ID, &tr);
-
-        int i;
-        for (i=0; i<__CHANNEL_MGMT_MONITOR_TIME; i++) {
-            if (*activated == FALSE) break;
-            else waitsec(1, 0);
-        }
+    tr_task = timer_task_add("channel_mgmt", __CHANNEL_MGMT_MONITOR_TIME * 1000, 0, channel_mgmt_monitor, NULL);
+    if (tr_task == NULL) {
+        LOG_ERROR(CHANNEL_MGMT_ID, "timer_task_add() failed");
+        return -1;
     }
 
     return 0;
@@ -84,6 +94,9 @@ int channel_mgmt_cleanup(int *activated)
 
     deactivate();
 
+    timer_task_cancel(tr_task);
+    tr_task = NULL;
+
     pthread_spin_destroy(&tr_lock);
 
     return 0;
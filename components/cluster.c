@@ -91,6 +91,119 @@ static int insert_event_data(const event_t *ev)
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to push local events and pop the events of other instances (periodic task)
+ * \param arg NULL
+ * \return 0 (every __CLUSTER_UPDATE_TIME)
+ */
+static int cluster_update(void *arg)
+{
+    // push data
+
+    pthread_spin_lock(&cluster_lock);
+
+    flush_events_in_queue();
+
+    pthread_spin_unlock(&cluster_lock);
+
+    // pop data
+
+    char conditions[__CONF_STR_LEN];
+    sprintf(conditions, "ID > %lu", event_num);
+
+    char query[__CONF_STR_LEN];
+    sprintf(query, "select ID, EV_ID, EV_TYPE, DATA from cluster_events where ID > %lu and INSTANCE != '%s'", event_num, hostname);
+
+    if (execute_query(&cluster_db, query)) return 0;
+
+    query_result_t *result = get_query_result(&cluster_db);
+    query_row_t row;
+
+    while ((row = fetch_query_row(result)) != NULL) {
+        event_num = strtoull(row[0], NULL, 0);
+
+        uint32_t id = strtoul(row[1], NULL, 0);
+        uint32_t type = strtoul(row[2], NULL, 0);
+
+        char data[__CONF_LONG_STR_LEN] = {0};
+        base64_decode_w_buffer(row[3], data);
+
+        switch (type) {
+        case EV_SW_CONNECTED:
+            {
+                switch_t *sw = (switch_t *)data;
+                sw->remote = TRUE;
+                ev_sw_connected(id, sw);
+            }
+            break;
+        case EV_SW_DISCONNECTED:
+            {
+                switch_t *sw = (switch_t *)data;
+                sw->remote = TRUE;
+                ev_sw_disconnected(id, sw);
+            }
+            break;
+        case EV_HOST_ADDED:
+            {
+                host_t *host = (host_t *)data;
+                host->remote = TRUE;
+                ev_host_added(id, host);
+            }
+            break;
+        case EV_HOST_DELETED:
+            {
+                host_t *host = (host_t *)data;
+                host->remote = TRUE;
+                ev_host_deleted(id, host);
+            }
+            break;
+        case EV_LINK_ADDED:
+            {
+                port_t *link = (port_t *)data;
+                link->remote = TRUE;
+                ev_link_added(id, link);
+            }
+            break;
+        case EV_LINK_DELETED:
+            {
+                port_t *link = (port_t *)data;
+                link->remote = TRUE;
+                ev_link_deleted(id, link);
+            }
+            break;
+        case EV_FLOW_ADDED:
+            {
+                flow_t *flow = (flow_t *)data;
+                flow->remote = TRUE;
+                ev_flow_added(id, flow);
+            }
+            break;
+        case EV_FLOW_MODIFIED:
+            {
+                flow_t *flow = (flow_t *)data;
+                flow->remote = TRUE;
+                ev_flow_modified(id, flow);
+            }
+            break;
+        case EV_FLOW_DELETED:
+            {
+                flow_t *flow = (flow_t *)data;
+                flow->remote = TRUE;
+                ev_flow_deleted(id, flow);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    release_query_result(result);
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief The main function
  * \param activated The activation flag of this component
@@ -120,8 +233,6 @@ int cluster_main(int *activated, int argc, char **argv)
 
     pthread_spin_init(&cluster_lock, PTHREAD_PROCESS_PRIVATE);
 
-    database_t cluster_db;
-
     if (init_database(&cluster_info, &cluster_db)) {
         LOG_ERROR(CLUSTER_ID, "Failed to connect a cluster database");
         destroy_database(&cluster_db);
@@ -129,119 +240,12 @@ int cluster_main(int *activated, int argc, char **argv)
 
     activate();
 
-    while (*activated) {
-        // push data
-
-        pthread_spin_lock(&cluster_lock);
-
-        flush_events_in_queue();
-
-        pthread_spin_unlock(&cluster_lock);
-
-        // pop data
-
-        char conditions[__CONF_STR_LEN];
-        sprintf(conditions, "ID > %lu", event_num);
-
-        char query[__CONF_STR_LEN];
-        sprintf(query, "select ID, EV_ID, EV_TYPE, DATA from cluster_events where ID > %lu and INSTANCE != '%s'", event_num, hostname);
-
-        if (execute_query(&cluster_db, query)) continue;
-
-        query_result_t *result = get_query_result(&cluster_db);
-        query_row_t row;
-
-        while ((row = fetch_query_row(result)) != NULL) {
-            if (*activated == FALSE) break;
-
-            event_num = strtoull(row[0], NULL, 0);
-
-            uint32_t id = strtoul(row[1], NULL, 0);
-            uint32_t type = strtoul(row[2], NULL, 0);
-
-            char data[__CONF_LONG_STR_LEN] = {0};
-            base64_decode_w_buffer(row[3], data);
-
-            switch (type) {
-            case EV_SW_CONNECTED:
-                {
-                    switch_t *sw = (switch_t *)data;
-                    sw->remote = TRUE;
-                    ev_sw_connected(id, sw);
-                }
-                break;
-            case EV_SW_DISCONNECTED:
-                {
-                    switch_t *sw = (switch_t *)data;
-                    sw->remote = TRUE;
-                    ev_sw_disconnected(id, sw);
-                }
-                break;
-            case EV_HOST_ADDED:
-                {
-                    host_t *host = (host_t *)data;
-                    host->remote = TRUE;
-                    ev_host_added(id, host);
-                }
-                break;
-            case EV_HOST_DELETED:
-                {
-                    host_t *host = (host_t *)data;
-                    host->remote = TRUE;
-                    ev_host_deleted(id, host);
-                }
-                break;
-            case EV_LINK_ADDED:
-                {
-                    port_t *link = (port_t *)data;
-                    link->remote = TRUE;
-                    ev_link_added(id, link);
-                }
-                break;
-            case EV_LINK_DELETED:
-                {
-                    port_t *link = (port_t *)data;
-                    link->remote = TRUE;
-                    ev_link_deleted(id, link);
-                }
-                break;
-            case EV_FLOW_ADDED:
-                {
-                    flow_t *flow = (flow_t *)data;
-                    flow->remote = TRUE;
-                    ev_flow_added(id, flow);
-                }
-                break;
-            case EV_FLOW_MODIFIED:
-                {
-                    flow_t *flow = (flow_t *)data;
-                    flow->remote = TRUE;
-                    ev_flow_modified(id, flow);
-                }
-                break;
-            case EV_FLOW_DELETED:
-                {
-                    flow_t *flow = (flow_t *)data;
-                    flow->remote = TRUE;
-                    ev_flow_deleted(id, flow);
-                }
-                break;
-            default:
-                break;
-            }
-        }
-
-        release_query_result(result);
-
-        int i;
-        for (i=0; i<__CLUSTER_UPDATE_TIME; i++) {
-            if (*activated == FALSE) break;
-            else waitsec(1, 0);
-        }
+    cluster_task = timer_task_add("cluster", __CLUSTER_UPDATE_TIME * 1000, 0, cluster_update, NULL);
+    if (cluster_task == NULL) {
+        LOG_ERROR(CLUSTER_ID, "timer_task_add() failed");
+        return -1;
     }
 
-    destroy_database(&cluster_db);
-
     return 0;
 }
 
@@ -255,6 +259,11 @@ int cluster_cleanup(int *activated)
 
     deactivate();
 
+    timer_task_cancel(cluster_task);
+    cluster_task = NULL;
+
+    destroy_database(&cluster_db);
+
     pthread_spin_lock(&cluster_lock);
 
     flush_events_in_queue();
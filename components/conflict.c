@@ -26,17 +26,18 @@
 /**
  * \brief Function to check any conflicts between a new flow and existing flows
  * \param rule New flow
+ * \return TRIE_NO_CONFLICT, TRIE_OVERLAP or TRIE_SHADOW
  */
 static int flow_rule_conflict(const flow_t *rule)
 {
     flow_t list[__CONFLICT_MATCH_LIST_SIZE];
 
     int curr = 1;
-    int conflict = FALSE;
+    int conflict = TRIE_NO_CONFLICT;
     int forward = FALSE;
     int num_actions = rule->num_actions;
 
-    memmove(&list[curr++], &rule, sizeof(flow_t));
+    memmove(&list[curr++], rule, sizeof(flow_t));
 
     int i, j;
     for (i=0; i<num_actions; i++) {
@@ -44,6 +45,8 @@ static int flow_rule_conflict(const flow_t *rule)
 
         if (type == ACTION_OUTPUT) {
             forward = TRUE;
+        } else if (curr + 2 * (i + 1) > __CONFLICT_MATCH_LIST_SIZE) {
+            continue; // no more room for candidates
         } else if (type == ACTION_SET_VLAN_VID) {
             for (j=0; j<(2 * (i + 1)); j++, curr++) {
                 memmove(&list[curr], &list[curr/2], sizeof(flow_t));
@@ -101,36 +104,117 @@ static int flow_rule_conflict(const flow_t *rule)
         }
     }
 
+    rule_table_t *rule_tbl = &rule_table[RULE_KEY(rule)];
+
+    pthread_rwlock_rdlock(&rule_tbl->lock);
+
     for (i=(curr/2); i<curr; i++) {
-        rule_table_t *rule_tbl = &rule_table[RULE_KEY(rule)];
-        flow_t *target = &list[i];
+        conflict = trie_conflict(rule_tbl->trie, &list[i], forward);
+        if (conflict) break;
+    }
 
-        pthread_rwlock_rdlock(&rule_tbl->lock);
+    pthread_rwlock_unlock(&rule_tbl->lock);
 
-        flow_t *curr = rule_tbl->head;
-        while (curr != NULL) {
-            if (FLOW_COMPARE(curr, target)) {
-                int target_forward = FALSE;
+    return conflict;
+}
 
-                for (j=0; j<curr->num_actions; j++) {
-                    if (curr->action[j].type == ACTION_OUTPUT)
-                        target_forward = TRUE;
-                }
+/////////////////////////////////////////////////////////////////////
 
-                if (forward != target_forward) {
-                    conflict = TRUE;
-                }
+/**
+ * \brief Function to get the elapsed time in microseconds
+ * \param start Start time
+ * \param end End time
+ */
+static double elapsed_usec(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000000.0 + (end->tv_nsec - start->tv_nsec) / 1000.0;
+}
 
-                break;
-            }
+/**
+ * \brief Function to measure the insertion and conflict check costs of a rule trie
+ * \param cli The pointer of the Barista CLI
+ * \param num The number of synthetic rules
+ */
+static int conflict_bench(cli_t *cli, int num)
+{
+    flow_t *rules = (flow_t *)CALLOC(num, sizeof(flow_t));
+    if (rules == NULL) {
+        cli_print(cli, "Failed to allocate %d rules", num);
+        return -1;
+    }
 
-            curr = curr->next;
+    int i;
+    for (i=0; i<num; i++) {
+        flow_t *flow = &rules[i];
+
+        flow->dpid = (i % 64) + 1;
+        flow->port = (i % 48) + 1;
+
+        flow->meta.priority = DEFAULT_PRIORITY + (i % 4);
+
+        flow->match.proto = PROTO_IPV4 | PROTO_TCP;
+        flow->match.src_ip = 0x0a000000 + i;
+        flow->match.dst_ip = 0x0a800000 + ((i * 7) & 0x7fffff);
+        flow->match.src_port = 1024 + (i % 50000);
+        flow->match.dst_port = 80 + (i % 16);
+
+        // every tenth rule is a wildcard rule (in_port, /24 source, any source port)
+        if ((i % 10) == 0)
+            flow->match.wildcards = FLWD_IN_PORT | FLWD_SRC_PORT | (8 << FLWD_SRC_IP_SHIFT);
+
+        flow->num_actions = 1;
+        flow->action[0].type = ACTION_OUTPUT;
+        flow->action[0].port = flow->port;
+    }
+
+    trie_node_t *root = NULL;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i=0; i<num; i++) {
+        if (trie_insert(&root, &rules[i])) {
+            cli_print(cli, "Failed to insert rule #%d", i);
+            break;
         }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    int inserted = i;
+    double insert_time = elapsed_usec(&start, &end);
 
-        pthread_rwlock_unlock(&rule_tbl->lock);
+    int overlap = 0, shadow = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i=0; i<inserted; i++) {
+        flow_t drop = rules[i];
+
+        drop.num_actions = 0;
+        drop.match.wildcards = 0;
+        drop.match.src_ip ^= 0x1;
+
+        int ret = trie_conflict(root, &drop, FALSE);
+        if (ret == TRIE_OVERLAP) overlap++;
+        else if (ret == TRIE_SHADOW) shadow++;
     }
 
-    return conflict;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double check_time = elapsed_usec(&start, &end);
+
+    cli_print(cli, "< Rule Trie Benchmark >");
+    cli_print(cli, "  Insert: %d rules in %.3f ms (%.3f us/rule)",
+              inserted, insert_time / 1000.0, (inserted) ? insert_time / inserted : 0.0);
+    cli_print(cli, "  Check: %d rules in %.3f ms (%.3f us/rule)",
+              inserted, check_time / 1000.0, (inserted) ? check_time / inserted : 0.0);
+    cli_print(cli, "  Conflicts: %d overlapped, %d shadowed", overlap, shadow);
+
+    trie_destroy(root);
+    FREE(rules);
+
+    return 0;
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -186,6 +270,9 @@ int conflict_cleanup(int *activated)
             FREE(tmp);
         }
 
+        trie_destroy(rule_table[i].trie);
+        rule_table[i].trie = NULL;
+
         pthread_rwlock_unlock(&rule_table[i].lock);
         pthread_rwlock_destroy(&rule_table[i].lock);
     }
@@ -204,7 +291,18 @@ int conflict_cleanup(int *activated)
  */
 int conflict_cli(cli_t *cli, char **args)
 {
-    cli_print(cli, "No CLI support");
+    if (args[0] != NULL && strcmp(args[0], "bench") == 0) {
+        if (args[1] == NULL) {
+            conflict_bench(cli, __CONFLICT_BENCH_RULES);
+            return 0;
+        } else if (args[2] == NULL && atoi(args[1]) > 0) {
+            conflict_bench(cli, atoi(args[1]));
+            return 0;
+        }
+    }
+
+    cli_print(cli, "< Available Commands >");
+    cli_print(cli, "  conflict bench [# of rules]");
 
     return 0;
 }
@@ -222,12 +320,48 @@ int conflict_handler(const event_t *ev, event_out_t *ev_out)
         {
             const flow_t *rule = ev->flow;
 
-            if (flow_rule_conflict(rule)) {
+            int conflict = flow_rule_conflict(rule);
+            if (conflict == TRIE_SHADOW) {
+                LOG_WARN(CONFLICT_ID, "Block - a new flow rule is shadowed by an existing flow rule");
+                return -1;
+            } else if (conflict == TRIE_OVERLAP) {
                 LOG_WARN(CONFLICT_ID, "Block - a new flow rule is conflict to existing flow rules");
                 return -1;
             }
         }
         break;
+    case EV_DP_INSERT_FLOWS:
+        PRINT_EV("EV_DP_INSERT_FLOWS\n");
+        {
+            const flows_t *flows = ev->flows;
+
+            // a batch is installed entirely or not at all
+            int i;
+            for (i=0; i<flows->num_flows; i++) {
+                int conflict = flow_rule_conflict(&flows->flow[i]);
+                if (conflict == TRIE_SHADOW) {
+                    LOG_WARN(CONFLICT_ID, "Block - flow rule %d of a batch is shadowed by an existing flow rule", i);
+                } else if (conflict == TRIE_OVERLAP) {
+                    LOG_WARN(CONFLICT_ID, "Block - flow rule %d of a batch is conflict to existing flow rules", i);
+                } else {
+                    continue;
+                }
+
+                // the requester waits for the result of the batch
+                flow_batch_t result = {0};
+
+                result.dpid = flows->dpid;
+                result.batch_id = flows->batch_id;
+                result.num_flows = flows->num_flows;
+                result.first_error = i;
+                result.status = BATCH_BLOCKED;
+
+                ev_dp_flows_installed(CONFLICT_ID, &result);
+
+                return -1;
+            }
+        }
+        break;
     case EV_DP_MODIFY_FLOW:
         PRINT_EV("EV_DP_MODIFY_FLOW\n");
         {
@@ -252,6 +386,9 @@ int conflict_handler(const event_t *ev, event_out_t *ev_out)
 
             memmove(new, flow, sizeof(flow_t));
 
+            new->prev = NULL;
+            new->next = NULL;
+
             pthread_rwlock_wrlock(&rule_tbl->lock);
 
             if (rule_tbl->head == NULL) {
@@ -263,6 +400,9 @@ int conflict_handler(const event_t *ev, event_out_t *ev_out)
                 rule_tbl->tail = new;
             }
 
+            if (trie_insert(&rule_tbl->trie, new))
+                LOG_ERROR(CONFLICT_ID, "trie_insert() failed");
+
             num_rules++;
 
             pthread_rwlock_unlock(&rule_tbl->lock);
@@ -275,28 +415,9 @@ int conflict_handler(const event_t *ev, event_out_t *ev_out)
 
             rule_table_t *rule_tbl = &rule_table[RULE_KEY(flow)];
 
-            rule_table_t tmp_list = {0};
-
             pthread_rwlock_wrlock(&rule_tbl->lock);
 
-            flow_t *curr = rule_tbl->head;
-            while (curr != NULL) {
-                if (FLOW_COMPARE(curr, flow)) {
-                    if (tmp_list.head == NULL) {
-                        tmp_list.head = curr;
-                        tmp_list.tail = curr;
-                        curr->r_next = NULL;
-                    } else {
-                        tmp_list.tail->r_next = curr;
-                        tmp_list.tail = curr;
-                        curr->r_next = NULL;
-                    }
-                }
-
-                curr = curr->next;
-            }
-
-            curr = tmp_list.head;
+            flow_t *curr = trie_delete(rule_tbl->trie, flow);
             while (curr != NULL) {
                 flow_t *tmp = curr;
 
@@ -32,6 +32,13 @@ int dit_main(int *activated, int argc, char **argv)
 {
     LOG_INFO(DIT_ID, "Init - Internal message integrity");
 
+    if (crc32c_hw_enabled())
+        LOG_INFO(DIT_ID, "Checksum - CRC32C (SSE4.2)");
+    else
+        LOG_INFO(DIT_ID, "Checksum - CRC32C (software)");
+
+    ev_checksum_enabled = TRUE;
+
     activate();
 
     return 0;
@@ -45,6 +52,8 @@ int dit_cleanup(int *activated)
 {
     LOG_INFO(DIT_ID, "Clean up - Internal message integrity");
 
+    ev_checksum_enabled = FALSE;
+
     deactivate();
 
     return 0;
@@ -57,7 +66,15 @@ int dit_cleanup(int *activated)
  */
 int dit_cli(cli_t *cli, char **args)
 {
-    cli_print(cli, "No CLI support");
+    if (args[0] != NULL && strcmp(args[0], "show") == 0 && args[1] == NULL) {
+        cli_print(cli, "< Internal Message Integrity >");
+        cli_print(cli, "  Checksum: CRC32C (%s)", (crc32c_hw_enabled()) ? "SSE4.2" : "software");
+        cli_print(cli, "  Computed at raise time: %s", (ev_checksum_enabled) ? "yes" : "no");
+        return 0;
+    }
+
+    cli_print(cli, "< Available Commands >");
+    cli_print(cli, "  dit show");
 
     return 0;
 }
@@ -69,7 +86,7 @@ int dit_cli(cli_t *cli, char **args)
  */
 int dit_handler(const event_t *ev, event_out_t *ev_out)
 {
-    uint32_t checksum = hash_func((uint32_t *)ev->data, ev->length / sizeof(uint32_t));
+    uint32_t checksum = crc32c_func(ev->data, ev->length);
 
     if (ev_out->checksum == 0) {
         ev_out->checksum = checksum;
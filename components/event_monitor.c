@@ -25,8 +25,43 @@
 /* \brief The flag to enable API monitoring */
 int API_monitor_enabled;
 
-/* \brief The file descriptor for logging */
-FILE *ev_fp;
+/** \brief The flag whether API monitoring is requested by the environment */
+static int API_monitor_env;
+
+/** \brief The trace file to record events */
+static trace_t ev_trace;
+
+/** \brief The flag to record events */
+static volatile int ev_tracing;
+
+/** \brief The number of handlers writing into the trace */
+static volatile int ev_tracing_writers;
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The trace file to replay */
+static trace_t ev_replay_trace;
+
+/** \brief The replay thread */
+static pthread_t ev_replay_thread;
+
+/** \brief The flag to keep replaying */
+static volatile int ev_replaying;
+
+/** \brief The flag whether the replay thread is running */
+static volatile int ev_replay_active;
+
+/** \brief The speed-up factor of a replay */
+static double ev_replay_speed;
+
+/** \brief The number of replayed events */
+static uint64_t ev_replayed;
+
+/** \brief The number of skipped events */
+static uint64_t ev_skipped;
+
+/** \brief The number of skipped events per event type */
+static uint64_t ev_skipped_types[__MAX_EVENTS];
 
 /////////////////////////////////////////////////////////////////////
 
@@ -37,6 +72,197 @@ const char core_event_string[__MAX_EVENTS][__CONF_WORD_LEN] = {
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to start recording events
+ * \param file The path of a trace file
+ * \param payload_len The maximum payload captured in a record
+ */
+static int ev_trace_start(const char *file, int payload_len)
+{
+    if (ev_tracing) return -1;
+
+    if (trace_create(&ev_trace, file, __TRACE_NUM_RECORDS, payload_len))
+        return -1;
+
+    API_monitor_enabled = TRUE;
+    ev_tracing = TRUE;
+
+    return 0;
+}
+
+/**
+ * \brief Function to stop recording events
+ */
+static int ev_trace_stop(void)
+{
+    if (!ev_tracing) return -1;
+
+    ev_tracing = FALSE;
+
+    // wait for the handlers that are still writing records
+    while (ev_tracing_writers)
+        waitsec(0, 1000);
+
+    trace_close(&ev_trace);
+
+    API_monitor_enabled = API_monitor_env;
+
+    return 0;
+}
+
+/**
+ * \brief Function to raise a recorded event
+ * \param rec Trace record
+ */
+static int ev_replay_rec(const trace_rec_t *rec)
+{
+    // only the events whose payloads are fully captured
+    if (rec->captured != rec->length || ev_raise_data(rec->id, rec->type, rec->length, rec->payload) < 0) {
+        if (rec->type < __MAX_EVENTS)
+            ev_skipped_types[rec->type]++;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * \brief The replay thread
+ * \param null NULL
+ */
+static void *ev_replay_main(void *null)
+{
+    trace_replay(&ev_replay_trace, ev_replay_speed, &ev_replaying, ev_replay_rec, &ev_replayed, &ev_skipped);
+
+    LOG_INFO(EV_MONITOR_ID, "Replayed %lu events (%lu skipped) from %s", ev_replayed, ev_skipped, ev_replay_trace.path);
+
+    int i;
+    for (i=0; i<__MAX_EVENTS; i++) {
+        if (ev_skipped_types[i])
+            LOG_WARN(EV_MONITOR_ID, "Skipped %lu events of %s (truncated or not raised)", ev_skipped_types[i], core_event_string[i]);
+    }
+
+    trace_close(&ev_replay_trace);
+
+    ev_replaying = FALSE;
+    ev_replay_active = FALSE;
+
+    return NULL;
+}
+
+/**
+ * \brief Function to replay a trace file
+ * \param cli The pointer of the Barista CLI
+ * \param file The path of a trace file
+ * \param speed Speed-up factor (1: original speed, 0: as fast as possible)
+ */
+static int ev_replay_start(cli_t *cli, const char *file, double speed)
+{
+    if (ev_replay_active) {
+        cli_print(cli, "Another trace is being replayed");
+        return -1;
+    }
+
+    if (ev_tracing && strcmp(file, ev_trace.path) == 0) {
+        cli_print(cli, "%s is being recorded", file);
+        return -1;
+    }
+
+    if (trace_open(&ev_replay_trace, file)) {
+        cli_print(cli, "Failed to open %s", file);
+        return -1;
+    }
+
+    ev_replay_speed = speed;
+    ev_replayed = 0;
+    ev_skipped = 0;
+    memset(ev_skipped_types, 0, sizeof(ev_skipped_types));
+    ev_replaying = TRUE;
+    ev_replay_active = TRUE;
+
+    if (pthread_create(&ev_replay_thread, NULL, ev_replay_main, NULL) < 0) {
+        PERROR("pthread_create");
+        ev_replaying = FALSE;
+        ev_replay_active = FALSE;
+        trace_close(&ev_replay_trace);
+        return -1;
+    }
+
+    pthread_detach(ev_replay_thread);
+
+    cli_print(cli, "Replaying %lu events from %s", trace_count(&ev_replay_trace), file);
+
+    return 0;
+}
+
+/**
+ * \brief Function to print recorded events
+ * \param cli The pointer of the Barista CLI
+ * \param file The path of a trace file
+ * \param num The number of the latest events to print
+ */
+static int ev_trace_dump(cli_t *cli, const char *file, int num)
+{
+    trace_t trace = {0};
+
+    if (trace_open(&trace, file)) {
+        cli_print(cli, "Failed to open %s", file);
+        return -1;
+    }
+
+    uint64_t count = trace_count(&trace);
+    uint64_t i = (num > 0 && count > num) ? count - num : 0;
+
+    for (; i<count; i++) {
+        const trace_rec_t *rec = trace_get(&trace, i);
+        if (rec == NULL) continue;
+
+        int64_t diff = rec->recorded - rec->raised;
+
+        cli_print(cli, "%u\t%u\t%s\t%ld.%09ld\t%ld.%09ld\t%ld.%09ld\t%u\t%08x",
+                  rec->id, rec->type, (rec->type < __MAX_EVENTS) ? core_event_string[rec->type] : "-",
+                  rec->raised / 1000000000, rec->raised % 1000000000,
+                  rec->recorded / 1000000000, rec->recorded % 1000000000,
+                  diff / 1000000000, diff % 1000000000, rec->length, rec->digest);
+    }
+
+    trace_close(&trace);
+
+    return 0;
+}
+
+/**
+ * \brief Function to print the status of the recorder and the replayer
+ * \param cli The pointer of the Barista CLI
+ */
+static int ev_trace_show(cli_t *cli)
+{
+    if (ev_tracing) {
+        cli_print(cli, "Recording: %s", ev_trace.path);
+        cli_print(cli, "  Records: %lu (ring of %u records, %u bytes each)",
+                  ev_trace.hdr->next, ev_trace.hdr->num_recs, ev_trace.hdr->rec_size);
+        cli_print(cli, "  Captured payload: up to %u bytes", ev_trace.hdr->payload_len);
+    } else {
+        cli_print(cli, "Recording: off");
+    }
+
+    if (ev_replay_active)
+        cli_print(cli, "Replaying: %s (%lu replayed, %lu skipped)", ev_replay_trace.path, ev_replayed, ev_skipped);
+    else
+        cli_print(cli, "Replaying: off");
+
+    // the counts of the last replay stay until the next one starts
+    int i;
+    for (i=0; i<__MAX_EVENTS; i++) {
+        if (ev_skipped_types[i])
+            cli_print(cli, "  Skipped %s: %lu", core_event_string[i], ev_skipped_types[i]);
+    }
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief The main function
  * \param activated The activation flag of this component
@@ -48,13 +274,14 @@ int event_monitor_main(int *activated, int argc, char **argv)
     LOG_INFO(EV_MONITOR_ID, "Init - Core event monitor");
 
     const char *API_monitor = getenv("API_monitor");
-    if (API_monitor != NULL && strcmp(API_monitor, "API_monitor") == 0)
+    if (API_monitor != NULL && strcmp(API_monitor, "API_monitor") == 0) {
+        API_monitor_env = TRUE;
         API_monitor_enabled = TRUE;
 
-    ev_fp = fopen("log/event.log", "a");
-    if (ev_fp == NULL) {
-        LOG_ERROR(EV_MONITOR_ID, "Failed to open log/event.log");
-        return -1;
+        if (ev_trace_start(__EV_TRACE_FILE, __TRACE_PAYLOAD_LEN)) {
+            LOG_ERROR(EV_MONITOR_ID, "Failed to create %s", __EV_TRACE_FILE);
+            return -1;
+        }
     }
 
     activate();
@@ -72,8 +299,11 @@ int event_monitor_cleanup(int *activated)
 
     deactivate();
 
-    if (ev_fp != NULL)
-        fclose(ev_fp);
+    ev_replaying = FALSE;
+    while (ev_replay_active)
+        waitsec(0, 1000);
+
+    ev_trace_stop();
 
     return 0;
 }
@@ -85,7 +315,54 @@ int event_monitor_cleanup(int *activated)
  */
 int event_monitor_cli(cli_t *cli, char **args)
 {
-    cli_print(cli, "No CLI support");
+    if (args[0] != NULL && strcmp(args[0], "trace") == 0 && args[1] != NULL) {
+        if (strcmp(args[1], "start") == 0) {
+            const char *file = (args[2] != NULL) ? args[2] : __EV_TRACE_FILE;
+            int payload_len = (args[2] != NULL && args[3] != NULL) ? atoi(args[3]) : __TRACE_PAYLOAD_LEN;
+
+            if (ev_trace_start(file, payload_len))
+                cli_print(cli, "Failed to start recording events into %s", file);
+            else
+                cli_print(cli, "Started recording events into %s", file);
+
+            return 0;
+        } else if (strcmp(args[1], "stop") == 0 && args[2] == NULL) {
+            if (ev_trace_stop())
+                cli_print(cli, "No events are being recorded");
+            else
+                cli_print(cli, "Stopped recording events");
+
+            return 0;
+        } else if (strcmp(args[1], "show") == 0 && args[2] == NULL) {
+            ev_trace_show(cli);
+            return 0;
+        } else if (strcmp(args[1], "dump") == 0) {
+            const char *file = (args[2] != NULL) ? args[2] : __EV_TRACE_FILE;
+            int num = (args[2] != NULL && args[3] != NULL) ? atoi(args[3]) : 20;
+
+            ev_trace_dump(cli, file, num);
+            return 0;
+        }
+    } else if (args[0] != NULL && strcmp(args[0], "replay") == 0) {
+        if (args[1] != NULL && strcmp(args[1], "stop") == 0 && args[2] == NULL) {
+            ev_replaying = FALSE;
+            cli_print(cli, "Stopped replaying events");
+            return 0;
+        } else if (args[1] != NULL) {
+            double speed = (args[2] != NULL) ? atof(args[2]) : 1.0;
+
+            ev_replay_start(cli, args[1], speed);
+            return 0;
+        }
+    }
+
+    cli_print(cli, "< Available Commands >");
+    cli_print(cli, "  event_monitor trace start [file] [payload bytes]");
+    cli_print(cli, "  event_monitor trace stop");
+    cli_print(cli, "  event_monitor trace show");
+    cli_print(cli, "  event_monitor trace dump [file] [# of events]");
+    cli_print(cli, "  event_monitor replay [file] [speed-up (0: no delay)]");
+    cli_print(cli, "  event_monitor replay stop");
 
     return 0;
 }
@@ -97,22 +374,17 @@ int event_monitor_cli(cli_t *cli, char **args)
  */
 int event_monitor_handler(const event_t *ev, event_out_t *ev_out)
 {
-    if (API_monitor_enabled) {
-        struct timespec curr_time, time_diff;
-        clock_gettime(CLOCK_REALTIME, &curr_time);
-
-        time_diff.tv_sec = curr_time.tv_sec - ev->time.tv_sec;
-        time_diff.tv_nsec = curr_time.tv_nsec - ev->time.tv_nsec;
-
-        char message[__CONF_STR_LEN];
-        sprintf(message, "%u\t%u\t%s\t%lld.%.9ld\t%lld.%9ld\t%lld.%ld\n",
-            ev->id, ev->type, core_event_string[ev->type],
-            (long long)ev->time.tv_sec, ev->time.tv_nsec,
-            (long long)curr_time.tv_sec, curr_time.tv_nsec,
-            (long long)time_diff.tv_sec, time_diff.tv_nsec);
-
-        fputs(message, ev_fp);
-        fflush(ev_fp);
+    if (ev_tracing) {
+        __sync_fetch_and_add(&ev_tracing_writers, 1);
+
+        if (ev_tracing) {
+            if (ev->type == EV_OFP_MSG_IN || ev->type == EV_OFP_MSG_OUT)
+                trace_record(&ev_trace, ev->id, ev->type, &ev->time, ev->msg->data, ev->msg->length, ev->msg->fd);
+            else
+                trace_record(&ev_trace, ev->id, ev->type, &ev->time, ev->data, ev->length, 0);
+        }
+
+        __sync_fetch_and_sub(&ev_tracing_writers, 1);
     }
 
     return 0;
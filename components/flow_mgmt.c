@@ -244,8 +244,11 @@ static int update_flow(flow_table_t *list, const flow_t *flow)
     flow_t *curr = list->head;
     while (curr != NULL) {
         if (FLOW_COMPARE(curr, flow)) {
-            curr->stat.pkt_count += flow->stat.pkt_count;
-            curr->stat.byte_count += flow->stat.byte_count;
+            // the counters in stats replies are cumulative
+            curr->stat.duration_sec = flow->stat.duration_sec;
+            curr->stat.duration_nsec = flow->stat.duration_nsec;
+            curr->stat.pkt_count = flow->stat.pkt_count;
+            curr->stat.byte_count = flow->stat.byte_count;
             break;
         }
 
@@ -257,84 +260,156 @@ static int update_flow(flow_table_t *list, const flow_t *flow)
     return 0;
 }
 
+/**
+ * \brief Function to update the flows of a switch at once
+ * \param list Flow table mapped to a datapath ID
+ * \param flows The flow stats of the switch
+ */
+static int update_flows(flow_table_t *list, const flows_t *flows)
+{
+    pthread_spin_lock(&list->lock);
+
+    // switches mostly report flows in the order of insertion,
+    // so each search resumes right after the previous match
+    flow_t *cursor = list->head;
+
+    int i;
+    for (i=0; i<flows->num_flows; i++) {
+        const flow_t *flow = &flows->flow[i];
+
+        flow_t *curr = cursor;
+        while (curr != NULL) {
+            if (FLOW_COMPARE(curr, flow)) break;
+
+            curr = (curr->next != NULL) ? curr->next : list->head;
+            if (curr == cursor) curr = NULL;
+        }
+
+        if (curr == NULL) continue;
+
+        curr->stat.duration_sec = flow->stat.duration_sec;
+        curr->stat.duration_nsec = flow->stat.duration_nsec;
+        curr->stat.pkt_count = flow->stat.pkt_count;
+        curr->stat.byte_count = flow->stat.byte_count;
+
+        cursor = (curr->next != NULL) ? curr->next : list->head;
+    }
+
+    pthread_spin_unlock(&list->lock);
+
+    return 0;
+}
+
 /////////////////////////////////////////////////////////////////////
 
-/** \brief The running flag for flow management */
-int timeout_thread_on;
+/** \brief The periodic task to delete expired flows */
+static timer_task_t *timeout_task;
 
 /**
- * \brief Function to find and delete expired flows
- * \return NULL
+ * \brief Function to add a datapath ID to a list if it is not in the list yet
+ * \param dpids Datapath IDs
+ * \param num The number of datapath IDs in the list
+ * \param dpid Datapath ID
+ * \return The number of datapath IDs in the list
  */
-void *timeout_thread(void *arg)
+static int add_dpid(uint64_t *dpids, int num, uint64_t dpid)
 {
-    while (timeout_thread_on) {
-        time_t current_time = time(NULL);
-
-        int i;
-        for (i=0; i<__MAX_NUM_SWITCHES; i++) {
-            flow_table_t tmp_list = {0};
-
-            pthread_spin_lock(&flow_table[i].lock);
-
-            flow_t *curr = flow_table[i].head;
-            while (curr != NULL) {
-                if ((current_time - curr->insert_time) > curr->meta.hard_timeout + 2) {
-                    flow_t *tmp = curr;
-
-                    curr = curr->next;
-
-                    if (tmp->prev != NULL && tmp->next != NULL) {
-                        tmp->prev->next = tmp->next;
-                        tmp->next->prev = tmp->prev;
-                    } else if (tmp->prev == NULL && tmp->next != NULL) {
-                        flow_table[i].head = tmp->next;
-                        tmp->next->prev = NULL;
-                    } else if (tmp->prev != NULL && tmp->next == NULL) {
-                        flow_table[i].tail = tmp->prev;
-                        tmp->prev->next = NULL;
-                    } else if (tmp->prev == NULL && tmp->next == NULL) {
-                        flow_table[i].head = NULL;
-                        flow_table[i].tail = NULL;
-                    }
-
-                    if (tmp_list.head == NULL) {
-                        tmp_list.head = tmp;
-                        tmp_list.tail = tmp;
-                        tmp->prev = NULL;
-                        tmp->next = NULL;
-                    } else {
-                        tmp_list.tail->next = tmp;
-                        tmp->prev = tmp_list.tail;
-                        tmp_list.tail = tmp;
-                        tmp->next = NULL;
-                    }
-                } else {
-                    ev_dp_request_flow_stats(FLOW_MGMT_ID, curr);
+    int i;
+    for (i=0; i<num; i++) {
+        if (dpids[i] == dpid)
+            return num;
+    }
 
-                    curr = curr->next;
-                }
-            }
+    if (num < __MAX_NUM_SWITCHES)
+        dpids[num++] = dpid;
+
+    return num;
+}
 
-            pthread_spin_unlock(&flow_table[i].lock);
+/**
+ * \brief Function to find and delete expired flows and to request the stats of the others (periodic task)
+ * \param arg NULL
+ * \return 0 (every FLOW_MGMT_UPDATE_TIME)
+ */
+static int flow_mgmt_timeout(void *arg)
+{
+    time_t current_time = time(NULL);
+
+    // the switches that have live flows
+    uint64_t dpids[__MAX_NUM_SWITCHES];
+    int num_dpids = 0;
+
+    int i;
+    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+        flow_table_t tmp_list = {0};
+
+        pthread_spin_lock(&flow_table[i].lock);
 
-            curr = tmp_list.head;
-            while (curr != NULL) {
+        flow_t *curr = flow_table[i].head;
+        while (curr != NULL) {
+            if ((current_time - curr->insert_time) > curr->meta.hard_timeout + 2) {
                 flow_t *tmp = curr;
 
                 curr = curr->next;
 
-                if (tmp->remote == FALSE)
-                    ev_flow_deleted(FLOW_MGMT_ID, tmp);
+                if (tmp->prev != NULL && tmp->next != NULL) {
+                    tmp->prev->next = tmp->next;
+                    tmp->next->prev = tmp->prev;
+                } else if (tmp->prev == NULL && tmp->next != NULL) {
+                    flow_table[i].head = tmp->next;
+                    tmp->next->prev = NULL;
+                } else if (tmp->prev != NULL && tmp->next == NULL) {
+                    flow_table[i].tail = tmp->prev;
+                    tmp->prev->next = NULL;
+                } else if (tmp->prev == NULL && tmp->next == NULL) {
+                    flow_table[i].head = NULL;
+                    flow_table[i].tail = NULL;
+                }
+
+                if (tmp_list.head == NULL) {
+                    tmp_list.head = tmp;
+                    tmp_list.tail = tmp;
+                    tmp->prev = NULL;
+                    tmp->next = NULL;
+                } else {
+                    tmp_list.tail->next = tmp;
+                    tmp->prev = tmp_list.tail;
+                    tmp_list.tail = tmp;
+                    tmp->next = NULL;
+                }
+            } else {
+                num_dpids = add_dpid(dpids, num_dpids, curr->dpid);
 
-                flow_enqueue(tmp);
+                curr = curr->next;
             }
         }
 
-        waitsec(FLOW_MGMT_UPDATE_TIME, 0);
+        pthread_spin_unlock(&flow_table[i].lock);
+
+        curr = tmp_list.head;
+        while (curr != NULL) {
+            flow_t *tmp = curr;
+
+            curr = curr->next;
+
+            if (tmp->remote == FALSE)
+                ev_flow_deleted(FLOW_MGMT_ID, tmp);
+
+            flow_enqueue(tmp);
+        }
     }
 
-    return NULL;
+    // one request for all flows of a switch, whose reply updates them in one pass (EV_DP_MULTI_FLOW_STATS)
+    for (i=0; i<num_dpids; i++) {
+        flow_t flow = {0};
+
+        flow.dpid = dpids[i];
+        flow.pkt_info.wildcards = FLWD_ALL;
+
+        ev_dp_request_flow_stats(FLOW_MGMT_ID, &flow);
+    }
+
+    return 0;
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -353,14 +428,14 @@ int flow_mgmt_main(int *activated, int argc, char **argv)
     if (CBENCH != NULL && strcmp(CBENCH, "CBENCH") == 0)
         cbench_enabled = TRUE;
 
-    timeout_thread_on = TRUE;
-
     flow_table = (flow_table_t *)CALLOC(__MAX_NUM_SWITCHES, sizeof(flow_table_t));
     if (flow_table == NULL) {
         LOG_ERROR(FLOW_MGMT_ID, "calloc() failed");
         return -1;
     }
 
+    cpu_place_memory(flow_table, __MAX_NUM_SWITCHES * sizeof(flow_table_t));
+
     int i;
     for (i=0; i<__MAX_NUM_SWITCHES; i++) {
         pthread_spin_init(&flow_table[i].lock, PTHREAD_PROCESS_PRIVATE);
@@ -368,13 +443,13 @@ int flow_mgmt_main(int *activated, int argc, char **argv)
 
     flow_q_init();
 
-    pthread_t thread;
-    if (pthread_create(&thread, NULL, timeout_thread, NULL) < 0) {
-        LOG_ERROR(FLOW_MGMT_ID, "pthread_create() failed");
-    }
-
     activate();
 
+    timeout_task = timer_task_add("flow_mgmt", FLOW_MGMT_UPDATE_TIME * 1000, 0, flow_mgmt_timeout, NULL);
+    if (timeout_task == NULL) {
+        LOG_ERROR(FLOW_MGMT_ID, "timer_task_add() failed");
+    }
+
     return 0;
 }
 
@@ -388,9 +463,8 @@ int flow_mgmt_cleanup(int *activated)
 
     deactivate();
 
-    timeout_thread_on = FALSE;
-
-    waitsec(1, 0);
+    timer_task_cancel(timeout_task);
+    timeout_task = NULL;
 
     int i;
     for (i=0; i<__MAX_NUM_SWITCHES; i++) {
@@ -501,6 +575,20 @@ int flow_mgmt_handler(const event_t *ev, event_out_t *ev_out)
             modify_flow(flow_tbl, ev->flow);
         }
         break;
+    case EV_DP_INSERT_FLOWS:
+        PRINT_EV("EV_DP_INSERT_FLOWS\n");
+        {
+            const flows_t *flows = ev->flows;
+
+            int i;
+            for (i=0; i<flows->num_flows; i++) {
+                const flow_t *flow = &flows->flow[i];
+
+                flow_table_t *flow_tbl = &flow_table[FLOW_KEY(flow)];
+                add_flow(flow_tbl, flow);
+            }
+        }
+        break;
     case EV_DP_DELETE_FLOW:
         PRINT_EV("EV_DP_DELETE_FLOW\n");
         {
@@ -537,6 +625,15 @@ int flow_mgmt_handler(const event_t *ev, event_out_t *ev_out)
             update_flow(flow_tbl, ev->flow);
         }
         break;
+    case EV_DP_MULTI_FLOW_STATS:
+        PRINT_EV("EV_DP_MULTI_FLOW_STATS\n");
+        {
+            const flows_t *flows = ev->flows;
+
+            flow_table_t *flow_tbl = &flow_table[FLOW_KEY(flows)];
+            update_flows(flow_tbl, ev->flows);
+        }
+        break;
     case EV_SW_CONNECTED:
         PRINT_EV("EV_SW_CONNECTED\n");
         {
@@ -25,6 +25,12 @@
 /* The flag to enable the CBENCH mode */
 int cbench_enabled;
 
+/** \brief The number of ARP requests answered by host_mgmt */
+static uint64_t arp_replied;
+
+/** \brief The number of ARP requests for unknown IP addresses */
+static uint64_t arp_missed;
+
 /////////////////////////////////////////////////////////////////////
 
 int get_host_entry(host_t *entry)
@@ -69,6 +75,131 @@ int insert_host_entry(host_t *entry)
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to get the slot of an IP address in the IP index
+ * \param ip IP address
+ */
+static uint32_t ip_index_key(uint32_t ip)
+{
+    host_key_t hkey = {0};
+
+    hkey.ip = ip;
+
+    return hash_func((uint32_t *)&hkey, 4) % NUM_HOST_ENTRIES;
+}
+
+/**
+ * \brief Function to update the IP index with a host
+ * \param host Host
+ */
+static int index_host(const host_t *host)
+{
+    if (host->ip == 0) return -1;
+
+    uint32_t key = ip_index_key(host->ip);
+
+    pthread_spin_lock(&host_ip_lock[key]);
+
+    host_ip_index[key].dpid = host->dpid;
+    host_ip_index[key].port = host->port;
+    host_ip_index[key].ip = host->ip;
+    host_ip_index[key].mac = host->mac;
+
+    pthread_spin_unlock(&host_ip_lock[key]);
+
+    return 0;
+}
+
+/**
+ * \brief Function to remove a host from the IP index
+ * \param ip IP address
+ * \param mac MAC address
+ */
+static int unindex_host(uint32_t ip, uint64_t mac)
+{
+    uint32_t key = ip_index_key(ip);
+
+    pthread_spin_lock(&host_ip_lock[key]);
+
+    if (host_ip_index[key].ip == ip && host_ip_index[key].mac == mac)
+        memset(&host_ip_index[key], 0, sizeof(host_t));
+
+    pthread_spin_unlock(&host_ip_lock[key]);
+
+    return 0;
+}
+
+/**
+ * \brief Function to answer an ARP request with the MAC address in the IP index
+ * \param pktin PACKET_IN message
+ * \return 1 if answered, 0 otherwise
+ */
+static int reply_arp(const pktin_t *pktin)
+{
+    const pkt_info_t *info = &pktin->pkt_info;
+
+    // untagged ARP requests only (gratuitous ARPs are left to the data plane)
+    if (!(info->proto & PROTO_ARP) || (info->proto & PROTO_VLAN)) return 0;
+    else if (info->opcode != ARP_REQUEST || info->dst_ip == 0 || info->dst_ip == info->src_ip) return 0;
+    else if (pktin->total_len < sizeof(arp_pkt_t)) return 0;
+
+    uint32_t key = ip_index_key(info->dst_ip);
+
+    pthread_spin_lock(&host_ip_lock[key]);
+
+    if (host_ip_index[key].ip != info->dst_ip) {
+        pthread_spin_unlock(&host_ip_lock[key]);
+        __sync_fetch_and_add(&arp_missed, 1);
+        return 0;
+    }
+
+    uint64_t mac = host_ip_index[key].mac;
+
+    pthread_spin_unlock(&host_ip_lock[key]);
+
+    arp_pkt_t req, arp;
+
+    memmove(&req, pktin->data, sizeof(arp_pkt_t));
+
+    memmove(arp.dst_mac, req.src_mac, ETH_ALEN);
+    int2mac(mac, arp.src_mac);
+    arp.ether_type = htons(ETHERTYPE_ARP);
+
+    arp.hrd = req.hrd;
+    arp.pro = req.pro;
+    arp.hln = req.hln;
+    arp.pln = req.pln;
+    arp.op = htons(ARP_REPLY);
+
+    memmove(arp.sha, arp.src_mac, ETH_ALEN);
+    memmove(arp.spa, req.tpa, 4);
+    memmove(arp.tha, req.sha, ETH_ALEN);
+    memmove(arp.tpa, req.spa, 4);
+
+    pktout_t out = {0};
+
+    out.dpid = pktin->dpid;
+    out.port = pktin->port;
+
+    out.xid = pktin->xid;
+    out.buffer_id = -1;
+
+    out.num_actions = 1;
+    out.action[0].type = ACTION_OUTPUT;
+    out.action[0].port = PORT_IN_PORT;
+
+    out.total_len = sizeof(arp_pkt_t);
+    memmove(out.data, &arp, sizeof(arp_pkt_t));
+
+    ev_dp_send_packet(HOST_MGMT_ID, &out);
+
+    __sync_fetch_and_add(&arp_replied, 1);
+
+    return 1;
+}
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief Function to add a new host
  * \param pktin PACKET_IN message
@@ -104,6 +235,7 @@ static int add_new_host(const pktin_t *pktin)
             pthread_spin_unlock(&host_lock[key]);
 
             insert_host_entry(&host_cache[key]);
+            index_host(&host_cache[key]);
 
             ev_host_added(HOST_MGMT_ID, &host_cache[key]);
 
@@ -122,6 +254,8 @@ static int add_new_host(const pktin_t *pktin)
 
         pthread_spin_unlock(&host_lock[key]);
 
+        index_host(&host_cache[key]);
+
         return 0;
     } else if (host_cache[key].ip != hkey.ip && host_cache[key].mac == hkey.mac) {
         pthread_spin_unlock(&host_lock[key]);
@@ -147,8 +281,13 @@ static int add_new_host(const pktin_t *pktin)
         return -1;
     }
 
+    host_t host = host_cache[key];
+
     pthread_spin_unlock(&host_lock[key]);
 
+    // the entry in the IP index may have been replaced by a colliding host
+    index_host(&host);
+
     return 0;
 }
 
@@ -181,9 +320,17 @@ int host_mgmt_main(int *activated, int argc, char **argv)
         return -1;
     }
 
+    host_ip_index = (host_t *)CALLOC(NUM_HOST_ENTRIES, sizeof(host_t));
+    if (host_ip_index == NULL) {
+        LOG_ERROR(HOST_MGMT_ID, "calloc() failed");
+        FREE(host_cache);
+        return -1;
+    }
+
     int i;
     for (i=0; i<NUM_HOST_ENTRIES; i++) {
         pthread_spin_init(&host_lock[i], PTHREAD_PROCESS_PRIVATE);
+        pthread_spin_init(&host_ip_lock[i], PTHREAD_PROCESS_PRIVATE);
     }
 
     activate();
@@ -204,8 +351,10 @@ int host_mgmt_cleanup(int *activated)
     int i;
     for (i=0; i<NUM_HOST_ENTRIES; i++) {
         pthread_spin_destroy(&host_lock[i]);
+        pthread_spin_destroy(&host_ip_lock[i]);
     }
 
+    FREE(host_ip_index);
     FREE(host_cache);
 
     return 0;
@@ -417,6 +566,10 @@ int host_mgmt_cli(cli_t *cli, char **args)
         } else if (args[1] != NULL && strcmp(args[1], "mac") == 0 && args[2] != NULL && args[3] == NULL) {
             host_showup_mac(cli, args[2]);
             return 0;
+        } else if (args[1] != NULL && strcmp(args[1], "arp") == 0 && args[2] == NULL) {
+            cli_print(cli, "< Proxy ARP >");
+            cli_print(cli, "  Replied: %lu, Unknown targets: %lu", arp_replied, arp_missed);
+            return 0;
         }
     }
 
@@ -425,6 +578,7 @@ int host_mgmt_cli(cli_t *cli, char **args)
     cli_print(cli, "  host_mgmt show switch [DPID]");
     cli_print(cli, "  host_mgmt show ip [IP address]");
     cli_print(cli, "  host_mgmt show mac [MAC address]");
+    cli_print(cli, "  host_mgmt show arp");
 
     return 0;
 }
@@ -444,6 +598,9 @@ int host_mgmt_handler(const event_t *ev, event_out_t *ev_out)
 
             if (add_new_host(pktin))
                 return -1;
+
+            if (!cbench_enabled && reply_arp(pktin))
+                return -1; // cut off the event chain
         }
         break;
     case EV_DP_PORT_DELETED:
@@ -472,6 +629,8 @@ int host_mgmt_handler(const event_t *ev, event_out_t *ev_out)
 
                 ev_host_deleted(HOST_MGMT_ID, &out);
 
+                unindex_host(out.ip, out.mac);
+
                 uint8_t macaddr[6];
                 int2mac(out.mac, macaddr);
 
@@ -523,6 +682,8 @@ int host_mgmt_handler(const event_t *ev, event_out_t *ev_out)
 
                 ev_host_deleted(HOST_MGMT_ID, &out);
 
+                unindex_host(out.ip, out.mac);
+
                 uint8_t macaddr[6];
                 int2mac(out.mac, macaddr);
 
@@ -554,6 +715,8 @@ int host_mgmt_handler(const event_t *ev, event_out_t *ev_out)
 
             if (host->remote == FALSE) break;
 
+            index_host(host);
+
             uint8_t macaddr[6];
             int2mac(host->mac, macaddr);
 
@@ -570,6 +733,8 @@ int host_mgmt_handler(const event_t *ev, event_out_t *ev_out)
 
             if (host->remote == FALSE) break;
 
+            unindex_host(host->ip, host->mac);
+
             uint8_t macaddr[6];
             int2mac(host->mac, macaddr);
 
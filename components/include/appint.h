@@ -99,9 +99,28 @@ int appint_handler(const app_event_t *av, app_event_out_t *av_out)
             ev_dp_delete_flow(APPHDLR_ID, av->flow);
         }
         break;
+    case AV_DP_INSERT_FLOWS:
+        PRINT_EV("AV_DP_INSERT_FLOWS\n");
+        {
+            ev_dp_insert_flows(APPHDLR_ID, av->flows);
+        }
+        break;
 
     // request-response events
 
+    case AV_RT_GET_ROUTE:
+        PRINT_EV("AV_RT_GET_ROUTE\n");
+        {
+            ev_rt_get_route(APPHDLR_ID, av_out->route_data);
+        }
+        break;
+    case AV_RT_GET_TREE:
+        PRINT_EV("AV_RT_GET_TREE\n");
+        {
+            ev_rt_get_tree(APPHDLR_ID, av_out->tree_data);
+        }
+        break;
+
     // log events
 
     case AV_LOG_DEBUG:
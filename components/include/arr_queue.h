@@ -19,6 +19,8 @@ typedef struct _rule_table_t {
     flow_t *head; /**< The head pointer */
     flow_t *tail; /**< The tail pointer */
 
+    struct _trie_node_t *trie; /**< The rule trie for conflict checks */
+
     pthread_rwlock_t lock; /**< The lock for management */
 } rule_table_t;
 
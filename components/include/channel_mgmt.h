@@ -11,6 +11,7 @@
 
 #include "common.h"
 #include "event.h"
+#include "timer_task.h"
 #include "database.h"
 
 /////////////////////////////////////////////////////////////////////
@@ -26,6 +27,9 @@ traffic_t traffic;
 /** \brief Lock to update statistics */
 pthread_spinlock_t tr_lock;
 
+/** \brief The periodic task to summarize statistics */
+timer_task_t *tr_task;
+
 /////////////////////////////////////////////////////////////////////
 
 /** \brief The monitoring time (second) per traffic statistics */
@@ -11,6 +11,7 @@
 
 #include "common.h"
 #include "event.h"
+#include "timer_task.h"
 #include "database.h"
 #include "base64.h"
 
@@ -44,6 +45,12 @@ cluster_event_t *cluster_events;
 /** \brief The lock for event update */
 pthread_spinlock_t cluster_lock;
 
+/** \brief The database connection to exchange events */
+database_t cluster_db;
+
+/** \brief The periodic task to exchange events */
+timer_task_t *cluster_task;
+
 /////////////////////////////////////////////////////////////////////
 
 /** \brief The batch size of events */
@@ -52,6 +52,11 @@ DECLARE_HANDLER_FUNC(topo_mgmt_handler);
 DECLARE_CLEANUP_FUNC(topo_mgmt_cleanup);
 DECLARE_CLI_FUNC(topo_mgmt_cli);
 
+DECLARE_MAIN_FUNC(route_mgmt_main);
+DECLARE_HANDLER_FUNC(route_mgmt_handler);
+DECLARE_CLEANUP_FUNC(route_mgmt_cleanup);
+DECLARE_CLI_FUNC(route_mgmt_cli);
+
 DECLARE_MAIN_FUNC(flow_mgmt_main);
 DECLARE_HANDLER_FUNC(flow_mgmt_handler);
 DECLARE_CLEANUP_FUNC(flow_mgmt_cleanup);
@@ -116,6 +121,7 @@ struct _compnt_func_t {
     {"switch_mgmt", switch_mgmt_main, switch_mgmt_handler, switch_mgmt_cleanup, switch_mgmt_cli},
     {"host_mgmt", host_mgmt_main, host_mgmt_handler, host_mgmt_cleanup, host_mgmt_cli},
     {"topo_mgmt", topo_mgmt_main, topo_mgmt_handler, topo_mgmt_cleanup, topo_mgmt_cli},
+    {"route_mgmt", route_mgmt_main, route_mgmt_handler, route_mgmt_cleanup, route_mgmt_cli},
     {"flow_mgmt", flow_mgmt_main, flow_mgmt_handler, flow_mgmt_cleanup, flow_mgmt_cli},
     {"stat_mgmt", stat_mgmt_main, stat_mgmt_handler, stat_mgmt_cleanup, stat_mgmt_cli},
     {"channel_mgmt", channel_mgmt_main, channel_mgmt_handler, channel_mgmt_cleanup, channel_mgmt_cli},
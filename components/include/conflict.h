@@ -16,6 +16,7 @@
 /////////////////////////////////////////////////////////////////////
 
 #include "arr_queue.h"
+#include "rule_trie.h"
 
 /////////////////////////////////////////////////////////////////////
 
@@ -28,6 +29,9 @@ rule_table_t *rule_table;
 /** \brief The size of a match list */
 #define __CONFLICT_MATCH_LIST_SIZE 20
 
+/** \brief The default number of rules for the benchmark */
+#define __CONFLICT_BENCH_RULES 100000
+
 /////////////////////////////////////////////////////////////////////
 
 /** \brief Key for table lookup */
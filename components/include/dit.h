@@ -11,4 +11,4 @@
 
 #include "common.h"
 #include "event.h"
-#include "hash.h"
+#include "crc32c.h"
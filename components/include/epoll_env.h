@@ -14,6 +14,8 @@
 #include <sys/epoll.h>
 #include <sys/socket.h>
 
+#include "cpu_affinity.h"
+
 /////////////////////////////////////////////////////////////////////
 
 /** \brief The running flag to keep listening connections */
@@ -70,6 +72,7 @@ static void push_back(int v)
     size++;
 }
 
+#ifndef __RUN_TO_COMPLETION
 /**
  * \brief Function to pop a socket from a network socket queue
  * \return Network socket
@@ -95,6 +98,7 @@ static int get_qsize(void)
 {
     return size;
 }
+#endif /* !__RUN_TO_COMPLETION */
 
 /////////////////////////////////////////////////////////////////////
 
@@ -166,6 +170,7 @@ static int link_epoll(int epol, int fd, int flags)
     return 0;
 }
 
+#ifndef __RUN_TO_COMPLETION
 /**
  * \brief Function to add a used socket into an epoll
  * \param epol Epoll
@@ -183,6 +188,7 @@ static int relink_epoll(int epol, int fd, int flags)
 
     return 0;
 }
+#endif /* !__RUN_TO_COMPLETION */
 
 /////////////////////////////////////////////////////////////////////
 
@@ -210,6 +216,7 @@ static void recv_cb_register(recv_cb_t cb)
     recv_cb = cb;
 }
 
+#ifndef __RUN_TO_COMPLETION
 /**
  * \brief Function to receive raw messages from network sockets
  * \return NULL
@@ -283,6 +290,103 @@ FETCH_ONE_FD:
 
     return NULL;
 }
+#endif /* !__RUN_TO_COMPLETION */
+
+#ifdef __RUN_TO_COMPLETION
+
+/** \brief The number of reads from a socket before the other sockets of its worker are served */
+#define RTC_READ_BUDGET 16
+
+/** \brief The epolls of the workers (a socket belongs to the worker of its epoll) */
+int worker_epoll[__NUM_WORKERS];
+
+/**
+ * \brief Function to get the worker that owns a socket
+ * \param fd Network socket
+ * \return The index of the worker
+ */
+static int owner_of(int fd)
+{
+    return fd % __NUM_WORKERS;
+}
+
+/**
+ * \brief Function to serve the sockets owned by a worker from reading messages to writing replies
+ * \param arg The index of the worker
+ * \return NULL
+ */
+static void *do_owned_tasks(void *arg)
+{
+    int id = (int)(intptr_t)arg;
+    int nums = 0;
+
+    struct epoll_event owned[MAXEVENTS];
+    uint8_t rx_buf[BUFFER_SIZE];
+
+    while (listening) {
+        nums = epoll_wait(worker_epoll[id], owned, MAXEVENTS, 100);
+
+        if (listening == FALSE) break;
+
+        int i;
+        for (i=0; i<nums; i++) {
+            int wsock = owned[i].data.fd;
+            int bytes, done = 0;
+
+            // the events raised by the messages run in this thread, so no other worker touches the switch
+            int reads;
+            for (reads=0; reads<RTC_READ_BUDGET; reads++) {
+                bytes = read(wsock, rx_buf, BUFFER_SIZE);
+                if (bytes < 0) {
+                    if (errno != EAGAIN) {
+                        done = 1;
+                    }
+                    break;
+                } else if (bytes == 0) {
+                    done = 1;
+                    break;
+                }
+
+                if (recv_cb(wsock, rx_buf, bytes) == -1) {
+                    done = 1;
+                    break;
+                }
+
+                // drained (level-triggered, so the rest is reported again)
+                if (bytes < BUFFER_SIZE) break;
+            }
+
+            if (done) {
+                // closed connection (close() also removes the socket from the epoll)
+                closed_connection(wsock);
+                close(wsock);
+            }
+        }
+
+        if (nums < 0 && errno != EINTR)
+            break;
+    }
+
+    if (nums < 0)
+        PERROR("epoll_wait");
+
+    return NULL;
+}
+
+#endif /* __RUN_TO_COMPLETION */
+
+/**
+ * \brief Function to hand a new socket over to the workers
+ * \param fd Network socket
+ */
+static int assign_socket(int fd)
+{
+#ifdef __RUN_TO_COMPLETION
+    return link_epoll(worker_epoll[owner_of(fd)], fd, EPOLLIN);
+#else
+    return link_epoll(epoll, fd, EPOLLIN | EPOLLET | EPOLLONESHOT);
+#endif
+}
 
 /**
  * \brief Function to initialize network socket workers
@@ -299,9 +403,29 @@ static void init_workers(void)
 
     int i;
     for (i=0; i<__NUM_WORKERS; i++) {
+#ifdef __RUN_TO_COMPLETION
+        if ((worker_epoll[i] = epoll_create1(0)) < 0) {
+            PERROR("epoll_create1");
+            continue;
+        }
+
+        if (pthread_create(&thread, NULL, &do_owned_tasks, (void *)(intptr_t)i) < 0) {
+#else
         if (pthread_create(&thread, NULL, &do_tasks, NULL) < 0) {
+#endif
             PERROR("pthread_create");
+            continue;
         }
+
+        char name[__THREAD_NAME_LEN];
+        snprintf(name, __THREAD_NAME_LEN, "conn-worker%d", i);
+
+#ifdef __PIN_WORKERS
+        // spread the workers over the CPUs given to the conn component
+        cpu_pin_nth(thread, name, i);
+#else
+        pthread_setname_np(thread, name);
+#endif
     }
 }
 
@@ -421,7 +545,7 @@ static void *socket_listen(void *arg)
                         break;
                     }
 
-                    if (link_epoll(epoll, csock, EPOLLIN | EPOLLET | EPOLLONESHOT) < 0) {
+                    if (assign_socket(csock) < 0) {
                         // closed connection
                         closed_connection(csock);
                         close(csock);
@@ -482,6 +606,11 @@ static int destroy_epoll_env(void)
 
     int i;
     for (i=0; i<__NUM_WORKERS; i++) {
+#ifdef __RUN_TO_COMPLETION
+        if (worker_epoll[i] >= 0)
+            close(worker_epoll[i]);
+#endif
+
         pthread_mutex_lock(&queue_mutex);
         push_back(0);
         pthread_mutex_unlock(&queue_mutex);
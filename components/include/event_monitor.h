@@ -11,3 +11,11 @@
 
 #include "common.h"
 #include "event.h"
+#include "trace.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The default trace file of core events */
+#define __EV_TRACE_FILE "log/event.trace"
+
+/////////////////////////////////////////////////////////////////////
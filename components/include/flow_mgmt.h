@@ -11,6 +11,8 @@
 
 #include "common.h"
 #include "event.h"
+#include "timer_task.h"
+#include "cpu_affinity.h"
 
 /////////////////////////////////////////////////////////////////////
 
@@ -37,4 +37,36 @@ host_t *host_cache;
 /** \brief The locks for host entries */
 pthread_spinlock_t host_lock[NUM_HOST_ENTRIES];
 
+/** \brief The index of recently added hosts by IP address (direct-mapped) */
+host_t *host_ip_index;
+
+/** \brief The locks for the IP index */
+pthread_spinlock_t host_ip_lock[NUM_HOST_ENTRIES];
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief ARP request */
+#define ARP_REQUEST 1
+
+/** \brief ARP reply */
+#define ARP_REPLY 2
+
+/** \brief The structure of an ARP packet (Ethernet and IPv4) */
+typedef struct _arp_pkt_t {
+    uint8_t dst_mac[ETH_ALEN]; /**< Destination MAC address */
+    uint8_t src_mac[ETH_ALEN]; /**< Source MAC address */
+    uint16_t ether_type; /**< Ethernet type */
+
+    uint16_t hrd; /**< Hardware type */
+    uint16_t pro; /**< Protocol type */
+    uint8_t hln; /**< Hardware address length */
+    uint8_t pln; /**< Protocol address length */
+    uint16_t op; /**< Opcode */
+
+    uint8_t sha[ETH_ALEN]; /**< Sender hardware address */
+    uint8_t spa[4]; /**< Sender protocol address */
+    uint8_t tha[ETH_ALEN]; /**< Target hardware address */
+    uint8_t tpa[4]; /**< Target protocol address */
+} __attribute__((packed)) arp_pkt_t;
+
 /////////////////////////////////////////////////////////////////////
@@ -12,31 +12,62 @@
 #include "common.h"
 #include "event.h"
 #include "database.h"
+#include "log_ring.h"
 
 /////////////////////////////////////////////////////////////////////
 
 /** \brief The database information for logging */
 db_info_t log_info;
 
+/** \brief The database connector kept open by the log writer */
+database_t log_db;
+
+/** \brief The flag whether the log database is connected */
+int log_db_ready;
+
 /////////////////////////////////////////////////////////////////////
 
-/** \brief The number of log messages */
+/** \brief The number of log messages waiting for the database */
 int num_msgs;
 
-/** \brief Log message queue */
+/** \brief Log message queue (escaped values for the database) */
 char **msgs;
 
-/** \brief The lock for log update */
-pthread_spinlock_t log_lock;
+/** \brief The file descriptor of the log file */
+int log_fd;
+
+/** \brief The buffer of log messages waiting for the log file */
+char *log_buf;
+
+/** \brief The used bytes in the log file buffer */
+int log_buf_len;
+
+/** \brief The number of written log messages */
+uint64_t num_written;
+
+/** \brief The lock for the log writer (never taken by log producers) */
+pthread_mutex_t log_lock;
 
 /////////////////////////////////////////////////////////////////////
 
 /** \brief The batch size of log messages */
 #define __LOG_BATCH_SIZE 1024
 
-/** \brief The update time (second) to a file and a database */
+/** \brief The update time (second) to a database */
 #define __LOG_UPDATE_TIME 1
 
+/** \brief The interval (second) to reconnect a log database */
+#define __LOG_RECONNECT_TIME 30
+
+/** \brief The maximum time (millisecond) that a log message waits in a log ring */
+#define __LOG_FLUSH_TIME 100
+
+/** \brief The size of the log file buffer */
+#define __LOG_FILE_BUF_SIZE (64 * 1024)
+
+/** \brief The size of an escaped log message */
+#define __LOG_ESCAPED_LEN (__CONF_STR_LEN * 2 + __CONF_SHORT_LEN)
+
 /** \brief The default log file */
 #define __DEFAULT_LOG_FILE "log/message.log"
 
@@ -18,6 +18,135 @@
 
 /////////////////////////////////////////////////////////////////////
 
+/** \brief The first transaction ID generated by the engine (apart from the ones of switch_mgmt) */
+#define OFP10_XID_BASE 0x80000000
+
+/** \brief The datapath ID of a connection slot being filled */
+#define OFP10_CONN_RESERVED ((uint64_t)-1)
+
+/** \brief The datapath ID of a connection slot whose switch is disconnected */
+#define OFP10_CONN_DELETED ((uint64_t)-2)
+
+/** \brief The default flow-control window (unconfirmed FLOW_MODs per switch) */
+#define __OFP10_FLOW_WINDOW 1024
+
+/** \brief The maximum number of flows queued for a switch (beyond its window) */
+#define __OFP10_MAX_QUEUED_FLOWS 65536
+
+/** \brief The maximum number of unanswered barriers per switch (power of 2) */
+#define __OFP10_MAX_BARRIERS 64
+
+/** \brief The size of the buffer to encode back-to-back FLOW_MODs (msg_t.length) */
+#define __OFP10_BATCH_BUF_SIZE 65535
+
+/** \brief The interval between echo probes to a switch (sec) */
+#define __OFP10_ECHO_INTERVAL 5
+
+/** \brief The number of unanswered echo probes in a row to disconnect a switch */
+#define __OFP10_ECHO_MISSES 3
+
+/** \brief The tick of the keepalive timer wheel (ms) */
+#define __OFP10_WHEEL_TICK 100
+
+/** \brief The number of slots in the keepalive timer wheel */
+#define __OFP10_WHEEL_SLOTS 128
+
+#if __OFP10_ECHO_INTERVAL * 1000 / __OFP10_WHEEL_TICK >= __OFP10_WHEEL_SLOTS
+#error "the keepalive timer wheel is shorter than the echo interval"
+#endif
+
+/** \brief The number of entries in the index from sockets to connections (power of 2) */
+#define __OFP10_FD_CACHE 256
+
+/** \brief The number of buckets in RTT histograms (bucket i: [2^i, 2^(i+1)) us) */
+#define __OFP10_RTT_BUCKETS 20
+
+/** \brief The structure of a bulk flow install */
+typedef struct _ofp10_batch_t {
+    flow_batch_t result; /**< The result to report */
+
+    flow_t *flow; /**< Flows (copied from the request) */
+    uint32_t sent; /**< The number of sent FLOW_MODs */
+    uint32_t acked; /**< The number of FLOW_MODs confirmed by barriers */
+
+    struct _ofp10_batch_t *next; /**< The next batch of the switch */
+} ofp10_batch_t;
+
+/** \brief The structure of a barrier waiting for its reply */
+typedef struct _ofp10_barrier_t {
+    ofp10_batch_t *batch; /**< The batch of the FLOW_MODs */
+    uint32_t first_xid; /**< The transaction ID of the first FLOW_MOD */
+    uint32_t xid; /**< The transaction ID of the barrier (first_xid + # of FLOW_MODs) */
+    uint32_t first_idx; /**< The index of the first FLOW_MOD in the batch */
+} ofp10_barrier_t;
+
+/** \brief The structure of a switch connection kept by the engine */
+typedef struct _ofp10_conn_t {
+    uint64_t dpid; /**< Datapath ID (0: never used) */
+    uint32_t fd; /**< Network socket */
+    volatile uint32_t xid; /**< The next transaction ID */
+
+    pthread_mutex_t lock; /**< The lock for the batches below */
+
+    ofp10_batch_t *head; /**< The oldest unconfirmed batch */
+    ofp10_batch_t *tail; /**< The latest batch */
+    ofp10_batch_t *pending; /**< The first batch that has unsent flows */
+    uint32_t queued; /**< The number of unsent flows */
+
+    uint32_t inflight; /**< The number of unconfirmed FLOW_MODs */
+    uint32_t window; /**< Flow-control window (the maximum of inflight) */
+
+    ofp10_barrier_t barrier[__OFP10_MAX_BARRIERS]; /**< Unanswered barriers (ring) */
+    uint32_t b_head; /**< The oldest unanswered barrier */
+    uint32_t b_tail; /**< The next barrier */
+
+    uint64_t num_batches; /**< The number of completed batches */
+    uint64_t num_errors; /**< The number of rejected FLOW_MODs in batches */
+
+    uint32_t wheel_next; /**< The next connection in the same wheel slot (index + 1, 0: none) */
+    int scheduled; /**< The flag whether the connection is in the timer wheel */
+
+    uint64_t echo_sent; /**< The time when the unanswered echo probe was sent (ns, 0: none) */
+    uint32_t echo_missed; /**< The number of unanswered echo probes in a row */
+
+    uint64_t rtt_count; /**< The number of measured RTTs */
+    uint64_t rtt_sum; /**< The sum of RTTs (ns) */
+    uint64_t rtt_min; /**< The minimum RTT (ns) */
+    uint64_t rtt_max; /**< The maximum RTT (ns) */
+    uint64_t rtt_hist[__OFP10_RTT_BUCKETS]; /**< RTT histogram */
+} ofp10_conn_t;
+
+/** \brief Switch connections (indexed by datapath IDs) */
+ofp10_conn_t *ofp10_conn;
+
+/** \brief The default number of messages for the encoder benchmark */
+#define __OFP10_BENCH_MSGS 1000000
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The initial number of entries in a stats reassembly buffer */
+#define __OFP10_STATS_INIT_ENTRIES 64
+
+/** \brief The structure of a multipart stats reply being reassembled */
+typedef struct _stats_buf_t {
+    uint32_t fd; /**< The socket of the switch (0: unused) */
+    uint32_t xid; /**< The transaction ID of the reply */
+    uint16_t type; /**< The stats type (OFPST_FLOW or OFPST_PORT) */
+
+    flows_t flows; /**< Collected flow stats */
+    uint32_t max_flows; /**< The capacity of flows.flow */
+
+    ports_t ports; /**< Collected port stats */
+    uint32_t max_ports; /**< The capacity of ports.port */
+
+    pthread_spinlock_t lock; /**< The lock for the buffer */
+} stats_buf_t;
+
+/** \brief Stats reassembly buffers (one per switch in progress) */
+stats_buf_t *stats_buf;
+
+/////////////////////////////////////////////////////////////////////
+
 /** \brief The structure of Ethernet header with VLAN fields */
 struct ether_vlan_header {
     uint8_t ether_dhost[ETH_ALEN];
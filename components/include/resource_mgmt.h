@@ -11,7 +11,51 @@
 
 #include "common.h"
 #include "event.h"
+#include "timer_task.h"
 #include "database.h"
+#include "component.h"
+
+#include <dirent.h>
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The monitoring time (second) per resource usage */
+#define __RESOURCE_MGMT_MONITOR_TIME 1
+
+/** \brief The number of samples kept in memory */
+#define __RESOURCE_MGMT_HISTORY 3600
+
+/** \brief The number of samples averaged into a database row */
+#define __RESOURCE_MGMT_DB_SAMPLES 60
+
+/** \brief The maximum number of threads to track */
+#define __RESOURCE_MGMT_MAX_THREADS 256
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The structure of a resource sample */
+typedef struct _rs_sample_t {
+    time_t time; /**< Sampled time */
+    double cpu; /**< CPU usage (%, normalized by the number of cores) */
+    double mem; /**< Memory usage (%) */
+    uint64_t rss; /**< Resident set size (KB) */
+    uint64_t vcsw; /**< Voluntary context switches during the period */
+    uint64_t nvcsw; /**< Involuntary context switches during the period */
+    int num_threads; /**< The number of threads */
+} rs_sample_t;
+
+/** \brief The structure of per-thread resource usage */
+typedef struct _rs_thread_t {
+    pid_t tid; /**< Thread ID */
+    char comm[__CONF_SHORT_LEN + 1]; /**< Thread name */
+    uint64_t ticks; /**< CPU time (clock ticks) */
+    uint64_t vcsw; /**< Voluntary context switches */
+    uint64_t nvcsw; /**< Involuntary context switches */
+    double cpu; /**< CPU usage during the last period (%, of one core) */
+    uint64_t d_vcsw; /**< Voluntary context switches during the last period */
+    uint64_t d_nvcsw; /**< Involuntary context switches during the last period */
+    int alive; /**< The flag to check exited threads */
+} rs_thread_t;
 
 /////////////////////////////////////////////////////////////////////
 
@@ -20,15 +64,25 @@ db_info_t resource_mgmt_info;
 
 /////////////////////////////////////////////////////////////////////
 
-/** \brief Resource usage */
-resource_t resource;
+/** \brief The time series of resource samples */
+rs_sample_t *rs_history;
 
-/** \brief Command to get CPU and memory usages */
-char cmd[] = "top -b -n 1 | grep `pgrep -x barista` | awk '{print $9 \" \" $10}' 2> /dev/null | tail -n 1";
+/** \brief The number of samples taken so far */
+uint64_t rs_num_samples;
 
-/////////////////////////////////////////////////////////////////////
+/** \brief Per-thread resource usages */
+rs_thread_t rs_threads[__RESOURCE_MGMT_MAX_THREADS];
 
-/** \brief The monitoring time (second) per resource usage */
-#define __RESOURCE_MGMT_MONITOR_TIME 1
+/** \brief The number of tracked threads */
+int rs_num_threads;
+
+/** \brief The cost of the last sample (usec) */
+uint64_t rs_sample_cost;
+
+/** \brief The lock for the resource samples */
+pthread_spinlock_t rs_lock;
+
+/** \brief The periodic task to sample resource usages */
+timer_task_t *rs_task;
 
 /////////////////////////////////////////////////////////////////////
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#pragma once
+
+#include "common.h"
+#include "event.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The datapath ID of a node slot whose switch is gone */
+#define ROUTE_NODE_DELETED ((uint64_t)-1)
+
+#if __MAX_NUM_PORTS > 64
+#error "route_mgmt keeps the ports of a switch in a 64-bit map"
+#endif
+
+/** \brief Function to get the bit of a port in a port map */
+#define PORT_BIT(p) (1ULL << ((p) - 1))
+
+/** \brief The structure of a routing snapshot (read without locks) */
+typedef struct _route_snap_t {
+    volatile int readers; /**< The number of readers using this snapshot */
+
+    uint64_t dpid[__MAX_NUM_SWITCHES]; /**< Datapath IDs of nodes (0: never used) */
+
+    uint16_t num_nbrs[__MAX_NUM_SWITCHES]; /**< The number of neighbors of nodes */
+    uint16_t nbr[__MAX_NUM_SWITCHES][__MAX_NUM_PORTS]; /**< Neighbors of nodes */
+
+    uint16_t port[__MAX_NUM_SWITCHES][__MAX_NUM_SWITCHES]; /**< Output ports toward neighbors (0: no link) */
+    uint16_t dist[__MAX_NUM_SWITCHES][__MAX_NUM_SWITCHES]; /**< All-pairs hop counts */
+
+    uint64_t ports[__MAX_NUM_SWITCHES]; /**< The port maps of nodes */
+    uint64_t blocked[__MAX_NUM_SWITCHES]; /**< The port maps of the links off the broadcast tree */
+    uint16_t root[__MAX_NUM_SWITCHES]; /**< The roots of the broadcast trees (node index + 1) */
+    uint16_t parent[__MAX_NUM_SWITCHES]; /**< The parents in the broadcast trees (node index + 1, 0: root) */
+
+    uint64_t version; /**< The number of applied updates */
+} route_snap_t;
+
+/** \brief Routing snapshots (the published one and the one being updated) */
+route_snap_t *route_snap;
+
+/** \brief The published routing snapshot */
+route_snap_t *route_curr;
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The structure of the links kept by the writer */
+typedef struct _route_links_t {
+    uint16_t peer[__MAX_NUM_PORTS+1]; /**< The neighbor node of each port (node index + 1, 0: no link) */
+} route_links_t;
+
+/** \brief The links of nodes (indexed by node indexes) */
+route_links_t *route_links;
+
+/** \brief The lock for the writer */
+pthread_mutex_t route_lock;
+
+/////////////////////////////////////////////////////////////////////
+
@@ -0,0 +1,448 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Hyeonseong Jo <hsjjo@kaist.ac.kr>
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+// inside of 'conflict.c'
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The match dimensions indexed by a rule trie (in order) */
+enum {
+    TRIE_DPID,
+    TRIE_IN_PORT,
+    TRIE_VLAN,
+    TRIE_SRC_MAC,
+    TRIE_DST_MAC,
+    TRIE_PROTO,
+    TRIE_SRC_IP,
+    TRIE_DST_IP,
+    TRIE_SRC_PORT,
+    TRIE_DST_PORT,
+    TRIE_NUM_FIELDS,
+};
+
+/** \brief The bit width of each match dimension */
+static const int trie_bits[TRIE_NUM_FIELDS] = {64, 16, 16, 48, 48, 16, 32, 32, 16, 16};
+
+/** \brief The initial number of edges (or rules) kept in a node */
+#define TRIE_INIT_SIZE 4
+
+/** \brief The results of a conflict check */
+enum {
+    TRIE_NO_CONFLICT,
+    TRIE_OVERLAP, /**< Partially overlapped with a rule that has a different decision */
+    TRIE_SHADOW, /**< Fully covered by a higher-priority rule that has a different decision */
+};
+
+/** \brief The key of a flow rule (prefix per dimension) */
+typedef struct _trie_key_t {
+    uint64_t value[TRIE_NUM_FIELDS]; /**< Prefix values (right-aligned) */
+    uint8_t plen[TRIE_NUM_FIELDS]; /**< Prefix lengths (0 = wildcard) */
+} trie_key_t;
+
+/** \brief The structure of an edge between two trie levels */
+typedef struct _trie_edge_t {
+    uint64_t value; /**< Prefix value */
+    uint8_t plen; /**< Prefix length */
+    struct _trie_node_t *child; /**< The node of the next dimension */
+} trie_edge_t;
+
+/** \brief The structure of a trie node */
+typedef struct _trie_node_t {
+    uint64_t lens; /**< The bitmap of the prefix lengths of edges (< 64) */
+
+    int num_edges; /**< The number of edges */
+    int max_edges; /**< The size of the edge array */
+    trie_edge_t *edge; /**< Edges sorted by (value, plen) */
+
+    int num_rules; /**< The number of rules (leaf only) */
+    int max_rules; /**< The size of the rule array (leaf only) */
+    flow_t **rule; /**< Rules whose matches end here (leaf only) */
+} trie_node_t;
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to get the network mask of a prefix
+ * \param bits The bit width of a dimension
+ * \param plen Prefix length
+ * \return Mask
+ */
+static inline uint64_t trie_mask(int bits, int plen)
+{
+    if (plen == 0) return 0;
+    return (~0ULL >> (64 - plen)) << (bits - plen);
+}
+
+/**
+ * \brief Function to convert the match fields of a flow to a trie key
+ * \param flow Flow
+ * \param key Trie key
+ */
+static void trie_get_key(const flow_t *flow, trie_key_t *key)
+{
+    const pkt_info_t *info = &flow->match;
+    uint32_t wildcards = info->wildcards;
+
+    int src_ip_bits = MIN(32, (wildcards & FLWD_SRC_IP_MASK) >> FLWD_SRC_IP_SHIFT);
+    int dst_ip_bits = MIN(32, (wildcards & FLWD_DST_IP_MASK) >> FLWD_DST_IP_SHIFT);
+
+    key->value[TRIE_DPID] = flow->dpid;
+    key->plen[TRIE_DPID] = 64;
+
+    key->value[TRIE_IN_PORT] = flow->port;
+    key->plen[TRIE_IN_PORT] = (wildcards & FLWD_IN_PORT) ? 0 : 16;
+
+    key->value[TRIE_VLAN] = info->vlan_id;
+    key->plen[TRIE_VLAN] = (wildcards & FLWD_VLAN) ? 0 : 16;
+
+    key->value[TRIE_SRC_MAC] = mac2int(info->src_mac);
+    key->plen[TRIE_SRC_MAC] = (wildcards & FLWD_SRC_MAC) ? 0 : 48;
+
+    key->value[TRIE_DST_MAC] = mac2int(info->dst_mac);
+    key->plen[TRIE_DST_MAC] = (wildcards & FLWD_DST_MAC) ? 0 : 48;
+
+    key->value[TRIE_PROTO] = info->proto;
+    key->plen[TRIE_PROTO] = (wildcards & FLWD_ETH_TYPE) ? 0 : 16;
+
+    key->value[TRIE_SRC_IP] = info->src_ip;
+    key->plen[TRIE_SRC_IP] = 32 - src_ip_bits;
+
+    key->value[TRIE_DST_IP] = info->dst_ip;
+    key->plen[TRIE_DST_IP] = 32 - dst_ip_bits;
+
+    key->value[TRIE_SRC_PORT] = info->src_port;
+    key->plen[TRIE_SRC_PORT] = (wildcards & FLWD_SRC_PORT) ? 0 : 16;
+
+    key->value[TRIE_DST_PORT] = info->dst_port;
+    key->plen[TRIE_DST_PORT] = (wildcards & FLWD_DST_PORT) ? 0 : 16;
+
+    int i;
+    for (i=0; i<TRIE_NUM_FIELDS; i++)
+        key->value[i] &= trie_mask(trie_bits[i], key->plen[i]);
+}
+
+/**
+ * \brief Function to find the first edge not less than (value, plen)
+ * \param node Trie node
+ * \param value Prefix value
+ * \param plen Prefix length
+ * \return The index of the edge
+ */
+static int trie_lower_bound(const trie_node_t *node, uint64_t value, uint8_t plen)
+{
+    int lo = 0, hi = node->num_edges;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const trie_edge_t *e = &node->edge[mid];
+
+        if (e->value < value || (e->value == value && e->plen < plen))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/**
+ * \brief Function to get the child node of (value, plen)
+ * \param node Trie node
+ * \param value Prefix value
+ * \param plen Prefix length
+ * \param create The flag to create a new child if there is no child
+ * \return Child node
+ */
+static trie_node_t *trie_child(trie_node_t *node, uint64_t value, uint8_t plen, int create)
+{
+    int idx = trie_lower_bound(node, value, plen);
+
+    if (idx < node->num_edges && node->edge[idx].value == value && node->edge[idx].plen == plen)
+        return node->edge[idx].child;
+    else if (!create)
+        return NULL;
+
+    if (node->num_edges == node->max_edges) {
+        int size = (node->max_edges) ? node->max_edges * 2 : TRIE_INIT_SIZE;
+        trie_edge_t *edge = (trie_edge_t *)REALLOC(node->edge, sizeof(trie_edge_t) * size);
+        if (edge == NULL) {
+            PERROR("realloc");
+            return NULL;
+        }
+
+        node->edge = edge;
+        node->max_edges = size;
+    }
+
+    trie_node_t *child = (trie_node_t *)CALLOC(1, sizeof(trie_node_t));
+    if (child == NULL) {
+        PERROR("calloc");
+        return NULL;
+    }
+
+    memmove(&node->edge[idx+1], &node->edge[idx], sizeof(trie_edge_t) * (node->num_edges - idx));
+
+    node->edge[idx].value = value;
+    node->edge[idx].plen = plen;
+    node->edge[idx].child = child;
+
+    node->num_edges++;
+
+    if (plen < 64)
+        node->lens |= (1ULL << plen);
+
+    return child;
+}
+
+/**
+ * \brief Function to remove the edge of (value, plen) if its child is empty
+ * \param node Trie node
+ * \param value Prefix value
+ * \param plen Prefix length
+ */
+static void trie_prune(trie_node_t *node, uint64_t value, uint8_t plen)
+{
+    int idx = trie_lower_bound(node, value, plen);
+
+    if (idx == node->num_edges || node->edge[idx].value != value || node->edge[idx].plen != plen)
+        return;
+
+    trie_node_t *child = node->edge[idx].child;
+    if (child->num_edges || child->num_rules)
+        return;
+
+    FREE(child->edge);
+    FREE(child->rule);
+    FREE(child);
+
+    node->num_edges--;
+    memmove(&node->edge[idx], &node->edge[idx+1], sizeof(trie_edge_t) * (node->num_edges - idx));
+
+    if (plen < 64) {
+        int i;
+        for (i=0; i<node->num_edges; i++) {
+            if (node->edge[i].plen == plen)
+                return;
+        }
+
+        node->lens &= ~(1ULL << plen);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to insert a rule into a rule trie
+ * \param root The root pointer of a rule trie
+ * \param flow Rule
+ */
+static int trie_insert(trie_node_t **root, flow_t *flow)
+{
+    trie_key_t key;
+    trie_get_key(flow, &key);
+
+    if (*root == NULL) {
+        *root = (trie_node_t *)CALLOC(1, sizeof(trie_node_t));
+        if (*root == NULL) {
+            PERROR("calloc");
+            return -1;
+        }
+    }
+
+    trie_node_t *node = *root;
+
+    int i;
+    for (i=0; i<TRIE_NUM_FIELDS; i++) {
+        node = trie_child(node, key.value[i], key.plen[i], TRUE);
+        if (node == NULL) return -1;
+    }
+
+    if (node->num_rules == node->max_rules) {
+        int size = (node->max_rules) ? node->max_rules * 2 : TRIE_INIT_SIZE;
+        flow_t **rule = (flow_t **)REALLOC(node->rule, sizeof(flow_t *) * size);
+        if (rule == NULL) {
+            PERROR("realloc");
+            return -1;
+        }
+
+        node->rule = rule;
+        node->max_rules = size;
+    }
+
+    node->rule[node->num_rules++] = flow;
+
+    return 0;
+}
+
+/**
+ * \brief Function to detach the rules matched with a flow from a rule trie
+ * \param root The root of a rule trie
+ * \param flow Flow to delete
+ * \return The list of the detached rules (linked by r_next)
+ */
+static flow_t *trie_delete(trie_node_t *root, const flow_t *flow)
+{
+    if (root == NULL) return NULL;
+
+    trie_key_t key;
+    trie_get_key(flow, &key);
+
+    trie_node_t *path[TRIE_NUM_FIELDS + 1];
+    path[0] = root;
+
+    int i;
+    for (i=0; i<TRIE_NUM_FIELDS; i++) {
+        path[i+1] = trie_child(path[i], key.value[i], key.plen[i], FALSE);
+        if (path[i+1] == NULL) return NULL;
+    }
+
+    trie_node_t *leaf = path[TRIE_NUM_FIELDS];
+    flow_t *head = NULL;
+
+    int j = 0;
+    for (i=0; i<leaf->num_rules; i++) {
+        flow_t *rule = leaf->rule[i];
+
+        if (FLOW_COMPARE(rule, flow)) {
+            rule->r_next = head;
+            head = rule;
+        } else {
+            leaf->rule[j++] = rule;
+        }
+    }
+
+    leaf->num_rules = j;
+
+    for (i=TRIE_NUM_FIELDS-1; i>=0; i--)
+        trie_prune(path[i], key.value[i], key.plen[i]);
+
+    return head;
+}
+
+/**
+ * \brief Function to release all nodes in a rule trie (rules are not released)
+ * \param node Trie node
+ */
+static void trie_destroy(trie_node_t *node)
+{
+    if (node == NULL) return;
+
+    int i;
+    for (i=0; i<node->num_edges; i++)
+        trie_destroy(node->edge[i].child);
+
+    FREE(node->edge);
+    FREE(node->rule);
+    FREE(node);
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to check whether a rule forwards packets
+ * \param flow Rule
+ */
+static inline int trie_forward(const flow_t *flow)
+{
+    int i;
+    for (i=0; i<flow->num_actions; i++) {
+        if (flow->action[i].type == ACTION_OUTPUT)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ * \brief Function to find a rule that overlaps a flow with a different decision
+ * \param node Trie node
+ * \param depth Current dimension
+ * \param key The trie key of a flow
+ * \param covers The flag that all previous dimensions of visited rules cover the flow
+ * \param forward The decision of a flow
+ * \param priority The priority of a flow
+ * \return TRIE_NO_CONFLICT, TRIE_OVERLAP or TRIE_SHADOW
+ */
+static int trie_search(const trie_node_t *node, int depth, const trie_key_t *key, int covers, int forward, int priority)
+{
+    if (depth == TRIE_NUM_FIELDS) {
+        int i;
+        for (i=0; i<node->num_rules; i++) {
+            const flow_t *rule = node->rule[i];
+
+            if (trie_forward(rule) == forward) continue;
+
+            int rule_priority = (rule->meta.priority) ? rule->meta.priority : DEFAULT_PRIORITY;
+
+            if (covers && rule_priority >= priority)
+                return TRIE_SHADOW;
+            else
+                return TRIE_OVERLAP;
+        }
+
+        return TRIE_NO_CONFLICT;
+    }
+
+    int bits = trie_bits[depth];
+    uint64_t value = key->value[depth];
+    uint8_t plen = key->plen[depth];
+
+    int ret;
+
+    // less specific prefixes (covering the flow in this dimension)
+    uint64_t lens = node->lens;
+    while (lens) {
+        int len = __builtin_ctzll(lens);
+        lens &= lens - 1;
+
+        if (len >= plen) break;
+
+        const trie_node_t *child = trie_child((trie_node_t *)node, value & trie_mask(bits, len), len, FALSE);
+        if (child && (ret = trie_search(child, depth+1, key, covers, forward, priority)))
+            return ret;
+    }
+
+    // the same or more specific prefixes (within the range of the flow's prefix)
+    uint64_t last = value | (~trie_mask(bits, plen) & ((bits == 64) ? ~0ULL : ((1ULL << bits) - 1)));
+
+    int i;
+    for (i=trie_lower_bound(node, value, plen); i<node->num_edges; i++) {
+        const trie_edge_t *e = &node->edge[i];
+
+        if (e->value > last) break;
+        if (e->plen < plen) continue;
+
+        if ((ret = trie_search(e->child, depth+1, key, covers && (e->plen == plen), forward, priority)))
+            return ret;
+    }
+
+    return TRIE_NO_CONFLICT;
+}
+
+/**
+ * \brief Function to check a flow against all rules in a rule trie
+ * \param root The root of a rule trie
+ * \param flow Flow
+ * \param forward The decision of the flow
+ * \return TRIE_NO_CONFLICT, TRIE_OVERLAP or TRIE_SHADOW
+ */
+static int trie_conflict(const trie_node_t *root, const flow_t *flow, int forward)
+{
+    if (root == NULL) return TRIE_NO_CONFLICT;
+
+    trie_key_t key;
+    trie_get_key(flow, &key);
+
+    int priority = (flow->meta.priority) ? flow->meta.priority : DEFAULT_PRIORITY;
+
+    return trie_search(root, 0, &key, TRUE, forward, priority);
+}
+
+/////////////////////////////////////////////////////////////////////
@@ -11,6 +11,7 @@
 
 #include "common.h"
 #include "event.h"
+#include "timer_task.h"
 
 /////////////////////////////////////////////////////////////////////
 
@@ -20,6 +21,9 @@ uint64_t *switch_list;
 /** \brief Lock for list updates */
 pthread_rwlock_t stat_lock;
 
+/** \brief The periodic task to request statistics */
+timer_task_t *stat_task;
+
 /////////////////////////////////////////////////////////////////////
 
 /** \brief The request time (second) for statistics collection */
@@ -12,6 +12,7 @@
 #include "common.h"
 #include "event.h"
 #include "database.h"
+#include "cpu_affinity.h"
 
 /////////////////////////////////////////////////////////////////////
 
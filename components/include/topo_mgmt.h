@@ -12,6 +12,7 @@
 
 #include "common.h"
 #include "event.h"
+#include "timer_task.h"
 #include "database.h"
 #include "lldp.h"
 
@@ -27,6 +28,7 @@ typedef struct _topo_t {
     uint64_t dpid; /**< Datapath ID */
     uint32_t remote; /**< Remote switch */
     port_t link[__MAX_NUM_PORTS]; /**< Links */
+    time_t seen[__MAX_NUM_PORTS]; /**< The last time when LLDP packets were received over links */
 } topo_t;
 
 /** \brief Network topology */
@@ -40,4 +42,30 @@ pthread_spinlock_t topo_lock[__MAX_NUM_SWITCHES];
 /** \brief Link discovery period */
 #define __TOPO_MGMT_REQUEST_TIME 10
 
+/** \brief The number of missed LLDP packets to age out a link */
+#define __TOPO_MGMT_MISSED_PROBES 3
+
+/** \brief Link timeout */
+#define __TOPO_MGMT_LINK_TIMEOUT (__TOPO_MGMT_REQUEST_TIME * __TOPO_MGMT_MISSED_PROBES)
+
+/** \brief The minimum time (ms) between two bursts of LLDP packets */
+#define __TOPO_MGMT_PACE 10
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The length of a LLDP packet */
+#define LLDP_PKT_LEN 46
+
+/** \brief The offset of the source MAC address in a LLDP packet */
+#define LLDP_SRC_MAC_OFFSET 6
+
+/** \brief The offset of the chassis ID (MAC address) in a LLDP packet */
+#define LLDP_CHASSIS_ID_OFFSET 17
+
+/** \brief The offset of the port ID in a LLDP packet */
+#define LLDP_PORT_ID_OFFSET 26
+
+/** \brief The offset of the datapath ID in a LLDP packet */
+#define LLDP_DPID_OFFSET 36
+
 /////////////////////////////////////////////////////////////////////
@@ -23,81 +23,156 @@
 /////////////////////////////////////////////////////////////////////
 
 /**
- * \brief Function to push a log message into a log queue
- * \param msg Log message
+ * \brief Function to write the buffered messages into the log file
  */
-static int push_msg_into_queue(char *msg)
+static int log_write_file(void)
 {
-    pthread_spin_lock(&log_lock);
+    int off = 0;
 
-    if (num_msgs >= __LOG_BATCH_SIZE-1) {
-        FILE *fp = fopen(__DEFAULT_LOG_FILE, "a");
-        if (fp != NULL) {
-            int i;
-            for (i=0; i<num_msgs; i++) {
-                fputs(msgs[i], fp);
-                fputs("\n", fp);
+    while (off < log_buf_len) {
+        ssize_t len = write(log_fd, log_buf + off, log_buf_len - off);
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        off += len;
+    }
 
-                char values[__CONF_STR_LEN];
-                sprintf(values, "'%s'", msgs[i]);
+    int ret = (off < log_buf_len) ? -1 : 0;
 
-                if (insert_data(&log_info, "logs", "MESSAGE", values)) {
-                    LOG_ERROR(LOG_ID, "insert_data() failed");
-                }
+    log_buf_len = 0;
 
-                memset(msgs[i], 0, __CONF_STR_LEN);
-            }
+    return ret;
+}
 
+/**
+ * \brief Function to write the queued messages into the database as a single query
+ */
+static int log_write_db(void)
+{
+    static time_t last_try;
+
+    if (!log_db_ready) {
+        time_t now = time(NULL);
+        if (now - last_try < __LOG_RECONNECT_TIME) {
             num_msgs = 0;
+            return -1;
+        }
 
-            fclose(fp);
-        } else {
-            pthread_spin_unlock(&log_lock);
+        last_try = now;
 
+        if (init_database(&log_info, &log_db)) {
+            num_msgs = 0;
             return -1;
         }
+
+        log_db_ready = TRUE;
     }
 
-    snprintf(msgs[num_msgs++], __CONF_STR_LEN-1, "%s", msg);
+    if (insert_multi_data(&log_db, "logs", "MESSAGE", msgs, num_msgs)) {
+        destroy_database(&log_db);
+        log_db_ready = FALSE;
 
-    pthread_spin_unlock(&log_lock);
+        LOG_ERROR(LOG_ID, "insert_multi_data() failed");
+    }
+
+    num_msgs = 0;
 
     return 0;
 }
 
 /**
- * \brief Function to directly push a message into a log file
- * \param msg Log message
+ * \brief Function to format a log record and queue it to the file and the database
+ * \param rec Log record
  */
-static int push_msgs_into_file(char *msg)
+static int log_write_rec(const log_rec_t *rec)
 {
-    pthread_spin_lock(&log_lock);
+    static time_t last_sec;
+    static char now[__CONF_SHORT_LEN * 2];
 
-    FILE *fp = fopen(__DEFAULT_LOG_FILE, "a");
-    if (fp != NULL) {
-        int i;
-        for (i=0; i<num_msgs; i++) {
-            fputs(msgs[i], fp);
-            fputs("\n", fp);
+    char msg[__CONF_STR_LEN - 64], out[__CONF_STR_LEN];
 
-            char values[__CONF_STR_LEN];
-            sprintf(values, "'%s'", msgs[i]);
+    if (rec->time.tv_sec != last_sec) {
+        struct tm tm_info;
+        localtime_r(&rec->time.tv_sec, &tm_info);
+        strftime(now, sizeof(now), "%Y:%m:%d %H:%M:%S", &tm_info);
+        last_sec = rec->time.tv_sec;
+    }
 
-            if (insert_data(&log_info, "logs", "MESSAGE", values)) {
-                LOG_ERROR(LOG_ID, "insert_data() failed");
-            }
+    log_ring_format(rec, msg, sizeof(msg));
 
-            memset(msgs[i], 0, __CONF_STR_LEN);
-        }
+    switch (rec->type) {
+    case EV_LOG_DEBUG:
+        snprintf(out, __CONF_STR_LEN-1, "%s <DEBUG> (%010u) %s", now, rec->id, msg);
+#ifdef __ENABLE_DEBUG
+        PRINTF("%s\n", out);
+#endif /* __ENABLE_DEBUG */
+        break;
+    case EV_LOG_INFO:
+        snprintf(out, __CONF_STR_LEN-1, "%s <INFO> (%010u) %s", now, rec->id, msg);
+        PRINTF("%s\n", out);
+        break;
+    case EV_LOG_WARN:
+        snprintf(out, __CONF_STR_LEN-1, "%s <WARN> (%010u) %s", now, rec->id, msg);
+        PRINTF(ANSI_COLOR_MAGENTA "%s" ANSI_COLOR_RESET "\n", out);
+        break;
+    case EV_LOG_ERROR:
+        snprintf(out, __CONF_STR_LEN-1, "%s <ERROR> (%010u) %s", now, rec->id, msg);
+        PRINTF(ANSI_COLOR_MAGENTA "%s" ANSI_COLOR_RESET "\n", out);
+        break;
+    case EV_LOG_FATAL:
+        snprintf(out, __CONF_STR_LEN-1, "%s <FATAL> (%010u) %s", now, rec->id, msg);
+        PRINTF(ANSI_COLOR_RED "%s" ANSI_COLOR_RESET "\n", out);
+        break;
+    default:
+        return -1;
+    }
+
+    int len = strlen(out);
+
+    if (log_buf_len + len + 1 > __LOG_FILE_BUF_SIZE)
+        log_write_file();
+
+    memcpy(log_buf + log_buf_len, out, len);
+    log_buf[log_buf_len + len] = '\n';
+    log_buf_len += len + 1;
 
-        fputs(msg, fp);
+    if (log_db_ready) {
+        msgs[num_msgs][0] = '\'';
+        int elen = escape_string(&log_db, msgs[num_msgs] + 1, out, len);
+        msgs[num_msgs][elen + 1] = '\'';
+        msgs[num_msgs][elen + 2] = '\0';
 
-        num_msgs = 0;
+        num_msgs++;
 
-        fclose(fp);
+        if (num_msgs >= __LOG_BATCH_SIZE)
+            log_write_db();
     }
 
-    pthread_spin_unlock(&log_lock);
+    num_written++;
+
+    ev_log_update_msgs(LOG_ID, out);
+
+    return 0;
+}
+
+/**
+ * \brief Function to drain the log rings into the log file and the database
+ * \param db The flag to write the queued messages into the database
+ */
+static int log_flush(int db)
+{
+    pthread_mutex_lock(&log_lock);
+
+    log_ring_drain(log_write_rec);
+
+    if (log_buf_len)
+        log_write_file();
+
+    if (db && (num_msgs || !log_db_ready))
+        log_write_db();
+
+    pthread_mutex_unlock(&log_lock);
 
     return 0;
 }
@@ -127,7 +202,7 @@ int log_main(int *activated, int argc, char **argv)
 
     int i;
     for (i=0; i<__LOG_BATCH_SIZE; i++) {
-        char *m = (char *)MALLOC(sizeof(char) * __CONF_STR_LEN);
+        char *m = (char *)MALLOC(sizeof(char) * __LOG_ESCAPED_LEN);
         if (m == NULL) {
             PERROR("malloc");
             return -1;
@@ -135,10 +210,17 @@ int log_main(int *activated, int argc, char **argv)
 
         msgs[i] = m;
 
-        memset(msgs[i], 0, __CONF_STR_LEN);
+        memset(msgs[i], 0, __LOG_ESCAPED_LEN);
+    }
+
+    log_buf_len = 0;
+    log_buf = (char *)MALLOC(__LOG_FILE_BUF_SIZE);
+    if (log_buf == NULL) {
+        PERROR("malloc");
+        return -1;
     }
 
-    pthread_spin_init(&log_lock, PTHREAD_PROCESS_PRIVATE);
+    pthread_mutex_init(&log_lock, NULL);
 
     time_t start_time;
     start_time = time(NULL);
@@ -148,54 +230,39 @@ int log_main(int *activated, int argc, char **argv)
     sprintf(start_time_string, "== %04d-%02d-%02d %02d:%02d:%02d ==\n",
             t->tm_year + 1900, t->tm_mon + 1, t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec);
 
-    FILE *fp = fopen(__DEFAULT_LOG_FILE, "a");
-    if (fp != NULL) {
-        fputs(start_time_string, fp);
-        fclose(fp);
-    } else {
+    log_fd = open(__DEFAULT_LOG_FILE, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (log_fd < 0) {
         PRINTF("%s does not exist\n", __DEFAULT_LOG_FILE);
         return -1;
     }
 
-    activate();
-
-    LOG_INFO(LOG_ID, "Init - Logging mechanism");
-
-    while (*activated) {
-        pthread_spin_lock(&log_lock);
-
-        if (num_msgs) {
-            FILE *fp = fopen(__DEFAULT_LOG_FILE, "a");
-            if (fp != NULL) {
-                for (i=0; i<num_msgs; i++) {
-                    fputs(msgs[i], fp);
-                    fputs("\n", fp);
+    if (write(log_fd, start_time_string, strlen(start_time_string)) < 0) {
+        PERROR("write");
+    }
 
-                    char values[__CONF_STR_LEN];
-                    sprintf(values, "'%s'", msgs[i]);
+    log_db_ready = FALSE;
+    if (init_database(&log_info, &log_db) == 0)
+        log_db_ready = TRUE;
 
-                    if (insert_data(&log_info, "logs", "MESSAGE", values)) {
-                        LOG_ERROR(LOG_ID, "insert_data() failed");
-                    }
+    num_written = 0;
 
-                    memset(msgs[i], 0, __CONF_STR_LEN);
-                }
+    log_ring_enabled = TRUE;
 
-                num_msgs = 0;
+    activate();
 
-                fclose(fp);
-            } else {
-                pthread_spin_unlock(&log_lock);
+    LOG_INFO(LOG_ID, "Init - Logging mechanism");
 
-                continue;
-            }
-        }
+    time_t last_update = time(NULL);
 
-        pthread_spin_unlock(&log_lock);
+    while (*activated) {
+        log_ring_wait(__LOG_FLUSH_TIME);
 
-        for (i=0; i<__LOG_UPDATE_TIME; i++) {
-            if (*activated == FALSE) break;
-            else waitsec(1, 0);
+        time_t now = time(NULL);
+        if (now - last_update >= __LOG_UPDATE_TIME) {
+            log_flush(TRUE);
+            last_update = now;
+        } else {
+            log_flush(FALSE);
         }
     }
 
@@ -212,30 +279,21 @@ int log_cleanup(int *activated)
 
     deactivate();
 
-    pthread_spin_lock(&log_lock);
+    log_ring_enabled = FALSE;
 
-    if (num_msgs) {
-        FILE *fp = fopen(__DEFAULT_LOG_FILE, "a");
-        if (fp != NULL) {
-            int i;
-            for (i=0; i<num_msgs; i++) {
-                fputs(msgs[i], fp);
-                fputs("\n", fp);
+    log_flush(TRUE);
 
-                char values[__CONF_STR_LEN];
-                sprintf(values, "'%s'", msgs[i]);
+    pthread_mutex_lock(&log_lock);
 
-                if (insert_data(&log_info, "logs", "MESSAGE", values)) {
-                    LOG_ERROR(LOG_ID, "insert_data() failed");
-                }
-            }
+    close(log_fd);
 
-            fclose(fp);
-        }
+    if (log_db_ready) {
+        destroy_database(&log_db);
+        log_db_ready = FALSE;
     }
 
-    pthread_spin_unlock(&log_lock);
-    pthread_spin_destroy(&log_lock);
+    pthread_mutex_unlock(&log_lock);
+    pthread_mutex_destroy(&log_lock);
 
     int i;
     for (i=0; i<__LOG_BATCH_SIZE; i++) {
@@ -243,6 +301,7 @@ int log_cleanup(int *activated)
     }
 
     FREE(msgs);
+    FREE(log_buf);
 
     return 0;
 }
@@ -287,6 +346,27 @@ static int log_print_messages(cli_t *cli, char *num_lines)
     return 0;
 }
 
+/**
+ * \brief Function to print the statistics of the log rings
+ * \param cli The pointer of the Barista CLI
+ */
+static int log_print_stats(cli_t *cli)
+{
+    int num_rings;
+    uint64_t pushed, dropped;
+
+    log_ring_stats(&num_rings, &pushed, &dropped);
+
+    cli_print(cli, "< Log Statistics >");
+    cli_print(cli, "  Log rings: %d", num_rings);
+    cli_print(cli, "  Pushed messages: %lu", pushed);
+    cli_print(cli, "  Dropped messages: %lu", dropped);
+    cli_print(cli, "  Written messages: %lu", num_written);
+    cli_print(cli, "  Database: %s", (log_db_ready) ? "connected" : "disconnected");
+
+    return 0;
+}
+
 /**
  * \brief The CLI function
  * \param cli The pointer of the Barista CLI
@@ -294,13 +374,17 @@ static int log_print_messages(cli_t *cli, char *num_lines)
  */
 int log_cli(cli_t *cli, char **args)
 {
-    if (args[0] != NULL && args[1] == NULL) {
+    if (args[0] != NULL && strcmp(args[0], "stats") == 0 && args[1] == NULL) {
+        log_print_stats(cli);
+        return 0;
+    } else if (args[0] != NULL && args[1] == NULL) {
         log_print_messages(cli, args[0]);
         return 0;
     }
 
     cli_print(cli, "< Available Commands >");
     cli_print(cli, "  log [N line(s)]");
+    cli_print(cli, "  log stats");
 
     return 0;
 }
@@ -312,60 +396,37 @@ int log_cli(cli_t *cli, char **args)
  */
 int log_handler(const event_t *ev, event_out_t *ev_out)
 {
-    time_t timer;
-    struct tm *tm_info;
-    char now[__CONF_WORD_LEN], out[__CONF_STR_LEN];
-
-    time(&timer);
-    tm_info = localtime(&timer);
-    strftime(now, __CONF_WORD_LEN, "%Y:%m:%d %H:%M:%S", tm_info);
-
+    // messages from ev_log_*() go into the log rings directly,
+    // so only already-formatted messages (e.g., external ones) arrive here
     switch (ev->type) {
     case EV_LOG_DEBUG:
         PRINT_EV("EV_LOG_DEBUG\n");
         {
-            snprintf(out, __CONF_STR_LEN-1, "%s <DEBUG> (%010u) %s", now, ev->id, ev->log);
-#ifdef __ENABLE_DEBUG
-            PRINTF("%s <DEBUG> (%010u) %s\n", now, ev->id, ev->log);
-#endif /* __ENABLE_DEBUG */
-            push_msg_into_queue(out);
-            ev_log_update_msgs(LOG_ID, out);
+            log_ring_push_text(ev->id, ev->type, FALSE, ev->log);
         }
         break;
     case EV_LOG_INFO:
         PRINT_EV("EV_LOG_INFO\n");
         {
-            snprintf(out, __CONF_STR_LEN-1, "%s <INFO> (%010u) %s", now, ev->id, ev->log);
-            PRINTF("%s <INFO> (%010u) %s\n", now, ev->id, ev->log);
-            push_msg_into_queue(out);
-            ev_log_update_msgs(LOG_ID, out);
+            log_ring_push_text(ev->id, ev->type, FALSE, ev->log);
         }
         break;
     case EV_LOG_WARN:
         PRINT_EV("EV_LOG_WARN\n");
         {
-            snprintf(out, __CONF_STR_LEN-1, "%s <WARN> (%010u) %s", now, ev->id, ev->log);
-            PRINTF(ANSI_COLOR_MAGENTA "%s <WARN> (%010u) %s" ANSI_COLOR_RESET "\n", now, ev->id, ev->log);
-            push_msgs_into_file(out);
-            ev_log_update_msgs(LOG_ID, out);
+            log_ring_push_text(ev->id, ev->type, TRUE, ev->log);
         }
         break;
     case EV_LOG_ERROR:
         PRINT_EV("EV_LOG_ERROR\n");
         {
-            snprintf(out, __CONF_STR_LEN-1, "%s <ERROR> (%010u) %s", now, ev->id, ev->log);
-            PRINTF(ANSI_COLOR_MAGENTA "%s <ERROR> (%010u) %s" ANSI_COLOR_RESET "\n", now, ev->id, ev->log);
-            push_msgs_into_file(out);
-            ev_log_update_msgs(LOG_ID, out);
+            log_ring_push_text(ev->id, ev->type, TRUE, ev->log);
         }
         break;
     case EV_LOG_FATAL:
         PRINT_EV("EV_LOG_FATAL\n");
         {
-            snprintf(out, __CONF_STR_LEN-1, "%s <FATAL> (%010u) %s", now, ev->id, ev->log);
-            PRINTF(ANSI_COLOR_RED "%s <FATAL> (%010u) %s" ANSI_COLOR_RESET "\n", now, ev->id, ev->log);
-            push_msgs_into_file(out);
-            ev_log_update_msgs(LOG_ID, out);
+            log_ring_push_text(ev->id, ev->type, TRUE, ev->log);
         }
         break;
     default:
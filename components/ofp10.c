@@ -20,10 +20,298 @@
 /** \brief OpenFlow engine ID */
 #define OFP_ID 2846342287
 
+/** \brief The flow-control window given to newly connected switches */
+static uint32_t flow_window = __OFP10_FLOW_WINDOW;
+
+/** \brief The keepalive timer wheel (the first connection of each slot, index + 1) */
+static uint32_t wheel[__OFP10_WHEEL_SLOTS];
+
+/** \brief The current slot of the timer wheel */
+static uint32_t wheel_curr;
+
+/** \brief The lock for the timer wheel */
+static pthread_mutex_t wheel_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief The keepalive thread */
+static pthread_t keepalive_thread;
+
+/** \brief The flag to keep the keepalive thread running */
+static volatile int keepalive_on;
+
+/** \brief The index from sockets to connections ((fd << 32) | (index + 1), checked against the connection on use) */
+static uint64_t fd_index[__OFP10_FD_CACHE];
+
+/** \brief The number of ticks between echo probes */
+#define ECHO_TICKS (__OFP10_ECHO_INTERVAL * 1000 / __OFP10_WHEEL_TICK)
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to find the connection of a switch
+ * \param dpid Datapath ID
+ * \return Switch connection (NULL if it is unknown)
+ */
+static ofp10_conn_t *conn_lookup(uint64_t dpid)
+{
+    if (dpid == 0) return NULL;
+
+    int idx = dpid % __MAX_NUM_SWITCHES;
+    do {
+        uint64_t curr = __atomic_load_n(&ofp10_conn[idx].dpid, __ATOMIC_ACQUIRE);
+
+        if (curr == dpid)
+            return &ofp10_conn[idx];
+        else if (curr == 0) // never used
+            break;
+
+        idx = (idx + 1) % __MAX_NUM_SWITCHES;
+    } while (idx != dpid % __MAX_NUM_SWITCHES);
+
+    return NULL;
+}
+
+/**
+ * \brief Function to find the connection of a switch using its socket
+ * \param fd Network socket
+ * \return Switch connection (NULL if it is unknown)
+ */
+static ofp10_conn_t *conn_lookup_fd(uint32_t fd)
+{
+    uint64_t *slot = &fd_index[fd & (__OFP10_FD_CACHE - 1)];
+    uint64_t entry = __atomic_load_n(slot, __ATOMIC_RELAXED);
+
+    // a socket keeps its connection until it is closed, so the last hit is usually still valid
+    if ((entry >> 32) == fd && (uint32_t)entry != 0 && (uint32_t)entry <= __MAX_NUM_SWITCHES) {
+        ofp10_conn_t *conn = &ofp10_conn[(uint32_t)entry - 1];
+        uint64_t curr = __atomic_load_n(&conn->dpid, __ATOMIC_ACQUIRE);
+
+        if (curr != 0 && curr != OFP10_CONN_RESERVED && curr != OFP10_CONN_DELETED && conn->fd == fd)
+            return conn;
+    }
+
+    int i;
+    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+        uint64_t curr = __atomic_load_n(&ofp10_conn[i].dpid, __ATOMIC_ACQUIRE);
+
+        if (curr == 0 || curr == OFP10_CONN_RESERVED || curr == OFP10_CONN_DELETED)
+            continue;
+        else if (ofp10_conn[i].fd == fd) {
+            __atomic_store_n(slot, ((uint64_t)fd << 32) | (i + 1), __ATOMIC_RELAXED);
+
+            return &ofp10_conn[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief Function to detach all batches of a switch (with the lock of the connection)
+ * \param conn Switch connection
+ * \return The list of the detached batches (marked as aborted)
+ */
+static ofp10_batch_t *batch_reset(ofp10_conn_t *conn)
+{
+    ofp10_batch_t *list = conn->head;
+
+    ofp10_batch_t *batch;
+    for (batch = list; batch != NULL; batch = batch->next)
+        batch->result.status = BATCH_ABORTED;
+
+    conn->head = conn->tail = conn->pending = NULL;
+    conn->queued = 0;
+    conn->inflight = 0;
+    conn->b_head = conn->b_tail = 0;
+
+    return list;
+}
+
+/**
+ * \brief Function to report the results of batches and release them (without any lock)
+ * \param list The list of batches
+ */
+static int batch_report(ofp10_batch_t *list)
+{
+    while (list != NULL) {
+        ofp10_batch_t *batch = list;
+        list = list->next;
+
+        ev_dp_flows_installed(OFP_ID, &batch->result);
+
+        FREE(batch->flow);
+        FREE(batch);
+    }
+
+    return 0;
+}
+
+/**
+ * \brief Function to put a connection into the timer wheel (with the lock of the wheel)
+ * \param conn Switch connection
+ * \param ticks The number of ticks from now
+ */
+static void wheel_insert(ofp10_conn_t *conn, uint32_t ticks)
+{
+    uint32_t slot = (wheel_curr + ticks) % __OFP10_WHEEL_SLOTS;
+
+    conn->wheel_next = wheel[slot];
+    conn->scheduled = TRUE;
+
+    wheel[slot] = (conn - ofp10_conn) + 1;
+}
+
+/**
+ * \brief Function to start probing a switch unless it is already in the timer wheel
+ * \param conn Switch connection
+ * \param dpid Datapath ID
+ */
+static void wheel_schedule(ofp10_conn_t *conn, uint64_t dpid)
+{
+    pthread_mutex_lock(&wheel_lock);
+
+    // spread the first probes of the switches connected together
+    if (conn->scheduled == FALSE)
+        wheel_insert(conn, 1 + dpid % ECHO_TICKS);
+
+    pthread_mutex_unlock(&wheel_lock);
+}
+
+/**
+ * \brief Function to keep the connection of a switch
+ * \param dpid Datapath ID
+ * \param fd Network socket
+ */
+static int conn_add(uint64_t dpid, uint32_t fd)
+{
+    // reconnected
+    ofp10_conn_t *conn = conn_lookup(dpid);
+    if (conn != NULL) {
+        pthread_mutex_lock(&conn->lock);
+
+        // the barriers on the previous socket will never be answered
+        ofp10_batch_t *aborted = (conn->fd != fd) ? batch_reset(conn) : NULL;
+        conn->fd = fd;
+
+        conn->echo_sent = 0;
+        conn->echo_missed = 0;
+
+        pthread_mutex_unlock(&conn->lock);
+
+        batch_report(aborted);
+
+        wheel_schedule(conn, dpid);
+
+        return 0;
+    }
+
+    int idx = dpid % __MAX_NUM_SWITCHES;
+    do {
+        conn = &ofp10_conn[idx];
+
+        uint64_t curr = conn->dpid;
+
+        if ((curr == 0 || curr == OFP10_CONN_DELETED) &&
+            __sync_bool_compare_and_swap(&conn->dpid, curr, OFP10_CONN_RESERVED)) {
+            conn->fd = fd;
+            conn->xid = OFP10_XID_BASE;
+            conn->window = flow_window;
+
+            conn->echo_sent = 0;
+            conn->echo_missed = 0;
+
+            conn->rtt_count = 0;
+            conn->rtt_sum = 0;
+            conn->rtt_min = 0;
+            conn->rtt_max = 0;
+            memset(conn->rtt_hist, 0, sizeof(conn->rtt_hist));
+
+            __atomic_store_n(&conn->dpid, dpid, __ATOMIC_RELEASE);
+
+            wheel_schedule(conn, dpid);
+
+            return 0;
+        }
+
+        idx = (idx + 1) % __MAX_NUM_SWITCHES;
+    } while (idx != dpid % __MAX_NUM_SWITCHES);
+
+    return -1;
+}
+
+/**
+ * \brief Function to forget the connection of a switch
+ * \param dpid Datapath ID
+ */
+static int conn_del(uint64_t dpid)
+{
+    ofp10_conn_t *conn = conn_lookup(dpid);
+    if (conn == NULL) return -1;
+
+    pthread_mutex_lock(&conn->lock);
+
+    ofp10_batch_t *aborted = batch_reset(conn);
+
+    // keep the slot marked so that lookups continue probing
+    __atomic_store_n(&conn->dpid, OFP10_CONN_DELETED, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&conn->lock);
+
+    batch_report(aborted);
+
+    return 0;
+}
+
+/**
+ * \brief Function to account an error against the batch that sent the failed FLOW_MOD
+ * \param fd Network socket
+ * \param xid The transaction ID of the failed message
+ * \param type Error type
+ * \param code Error code
+ * \return 0 if the message belongs to a batch, otherwise -1
+ */
+static int batch_error(uint32_t fd, uint32_t xid, uint16_t type, uint16_t code)
+{
+    ofp10_conn_t *conn = conn_lookup_fd(fd);
+    if (conn == NULL) return -1;
+
+    int ret = -1;
+
+    pthread_mutex_lock(&conn->lock);
+
+    uint32_t b;
+    for (b = conn->b_head; b != conn->b_tail; b++) {
+        ofp10_barrier_t *barrier = &conn->barrier[b % __OFP10_MAX_BARRIERS];
+
+        if (xid - barrier->first_xid >= barrier->xid - barrier->first_xid)
+            continue;
+
+        flow_batch_t *result = &barrier->batch->result;
+
+        if (result->num_errors++ == 0) {
+            result->first_error = barrier->first_idx + (xid - barrier->first_xid);
+            result->err_type = type;
+            result->err_code = code;
+        }
+
+        conn->num_errors++;
+
+        ret = 0;
+        break;
+    }
+
+    pthread_mutex_unlock(&conn->lock);
+
+    return ret;
+}
+
 /////////////////////////////////////////////////////////////////////
 
 static uint32_t get_xid(uint64_t dpid)
 {
+    ofp10_conn_t *conn = conn_lookup(dpid);
+    if (conn != NULL)
+        return __sync_fetch_and_add(&conn->xid, 1);
+
     switch_t sw = {0};
     sw.dpid = dpid;
     ev_sw_get_xid(OFP_ID, &sw);
@@ -40,6 +328,16 @@ static uint32_t get_xid_w_fd(uint32_t fd)
 
 static uint64_t get_dpid(uint32_t fd)
 {
+#ifdef __RUN_TO_COMPLETION
+    // the engine keeps the connections of the switches it talks to
+    ofp10_conn_t *conn = conn_lookup_fd(fd);
+    if (conn != NULL) {
+        uint64_t dpid = __atomic_load_n(&conn->dpid, __ATOMIC_ACQUIRE);
+        if (dpid != 0 && dpid != OFP10_CONN_RESERVED && dpid != OFP10_CONN_DELETED)
+            return dpid;
+    }
+#endif /* __RUN_TO_COMPLETION */
+
     switch_t sw = {0};
     sw.conn.fd = fd;
     ev_sw_get_dpid(OFP_ID, &sw);
@@ -48,6 +346,10 @@ static uint64_t get_dpid(uint32_t fd)
 
 static uint32_t get_fd(uint64_t dpid)
 {
+    ofp10_conn_t *conn = conn_lookup(dpid);
+    if (conn != NULL)
+        return conn->fd;
+
     switch_t sw = {0};
     sw.dpid = dpid;
     ev_sw_get_fd(OFP_ID, &sw);
@@ -90,6 +392,8 @@ static int ofp10_error(const msg_t *msg)
 {
     struct ofp_error_msg *err = (struct ofp_error_msg *)msg->data;
 
+    batch_error(msg->fd, ntohl(err->header.xid), ntohs(err->type), ntohs(err->code));
+
     switch (ntohs(err->type)) {
     case OFPET_HELLO_FAILED:
         switch (ntohs(err->code)) {
@@ -239,6 +543,175 @@ static int ofp10_echo_reply(const msg_t *msg)
     return 0;
 }
 
+/**
+ * \brief Function to get the current time for echo probes
+ * \return Monotonic time (ns)
+ */
+static uint64_t echo_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * \brief Function to generate ECHO_REQUEST messages (carrying their sending time)
+ * \param conn Switch connection
+ * \param fd Network socket
+ * \param now Current time
+ */
+static int ofp10_echo_request(ofp10_conn_t *conn, uint32_t fd, uint64_t now)
+{
+    msg_t out;
+    uint8_t pkt[sizeof(struct ofp_header) + sizeof(uint64_t)] = {0};
+
+    out.fd = fd;
+    out.length = sizeof(pkt);
+    out.data = pkt;
+
+    struct ofp_header *of_output = (struct ofp_header *)pkt;
+
+    of_output->version = OFP_VERSION;
+    of_output->type = OFPT_ECHO_REQUEST;
+    of_output->length = htons(sizeof(pkt));
+    of_output->xid = htonl(__sync_fetch_and_add(&conn->xid, 1));
+
+    // switches send the payload back as it is
+    memcpy(pkt + sizeof(struct ofp_header), &now, sizeof(uint64_t));
+
+    ev_ofp_msg_out(OFP_ID, &out);
+
+    return 0;
+}
+
+/**
+ * \brief Function to measure the RTT of a switch using ECHO_REPLY messages
+ * \param msg ECHO_REPLY message
+ */
+static int ofp10_echo_rtt(const msg_t *msg)
+{
+    // not a reply to the probes of the engine
+    if (msg->length != sizeof(struct ofp_header) + sizeof(uint64_t))
+        return -1;
+
+    ofp10_conn_t *conn = conn_lookup_fd(msg->fd);
+    if (conn == NULL) return -1;
+
+    uint64_t sent, now = echo_now();
+    memcpy(&sent, msg->data + sizeof(struct ofp_header), sizeof(uint64_t));
+
+    if (sent == 0 || sent > now)
+        return -1;
+
+    uint64_t rtt = now - sent;
+    uint64_t usec = rtt / 1000;
+
+    int bucket = (usec > 1) ? 63 - __builtin_clzll(usec) : 0;
+    if (bucket >= __OFP10_RTT_BUCKETS)
+        bucket = __OFP10_RTT_BUCKETS - 1;
+
+    pthread_mutex_lock(&conn->lock);
+
+    // any reply proves that the switch is alive
+    conn->echo_sent = 0;
+    conn->echo_missed = 0;
+
+    if (conn->rtt_count == 0 || rtt < conn->rtt_min)
+        conn->rtt_min = rtt;
+    if (rtt > conn->rtt_max)
+        conn->rtt_max = rtt;
+
+    conn->rtt_count++;
+    conn->rtt_sum += rtt;
+    conn->rtt_hist[bucket]++;
+
+    pthread_mutex_unlock(&conn->lock);
+
+    return 0;
+}
+
+/**
+ * \brief Function to probe the switches in the current slot of the timer wheel
+ */
+static int ofp10_keepalive(void)
+{
+    pthread_mutex_lock(&wheel_lock);
+
+    uint32_t next = wheel[wheel_curr];
+
+    wheel[wheel_curr] = 0;
+    wheel_curr = (wheel_curr + 1) % __OFP10_WHEEL_SLOTS;
+
+    pthread_mutex_unlock(&wheel_lock);
+
+    uint64_t now = echo_now();
+
+    while (next) {
+        ofp10_conn_t *conn = &ofp10_conn[next - 1];
+        next = conn->wheel_next;
+
+        pthread_mutex_lock(&wheel_lock);
+
+        // the switch is gone (a new switch in the slot schedules itself)
+        uint64_t dpid = __atomic_load_n(&conn->dpid, __ATOMIC_ACQUIRE);
+        if (dpid == 0 || dpid == OFP10_CONN_RESERVED || dpid == OFP10_CONN_DELETED) {
+            conn->scheduled = FALSE;
+            pthread_mutex_unlock(&wheel_lock);
+            continue;
+        }
+
+        pthread_mutex_unlock(&wheel_lock);
+
+        pthread_mutex_lock(&conn->lock);
+
+        int dead = (conn->echo_sent != 0 && ++conn->echo_missed >= __OFP10_ECHO_MISSES);
+
+        if (dead) {
+            conn->echo_sent = 0;
+            conn->echo_missed = 0;
+        } else {
+            conn->echo_sent = now;
+        }
+
+        uint32_t fd = conn->fd;
+
+        pthread_mutex_unlock(&conn->lock);
+
+        if (dead) {
+            LOG_WARN(OFP_ID, "No echo replies from %lu in %d probes, disconnecting (FD=%u)", dpid, __OFP10_ECHO_MISSES, fd);
+
+            // the packet I/O engine sees the closed socket and raises EV_SW_EXPIRED_CONN
+            shutdown(fd, SHUT_RDWR);
+        } else {
+            ofp10_echo_request(conn, fd, now);
+        }
+
+        pthread_mutex_lock(&wheel_lock);
+        wheel_insert(conn, ECHO_TICKS);
+        pthread_mutex_unlock(&wheel_lock);
+    }
+
+    return 0;
+}
+
+/**
+ * \brief The keepalive thread (turning the timer wheel)
+ * \param null NULL
+ */
+static void *ofp10_keepalive_main(void *null)
+{
+    while (keepalive_on) {
+        waitsec(0, __OFP10_WHEEL_TICK * 1000000);
+
+        if (keepalive_on == FALSE) break;
+
+        ofp10_keepalive();
+    }
+
+    return NULL;
+}
+
 /**
  * \brief Function to generate FEATURES_REQUEST messages
  * \param msg OF message
@@ -282,6 +755,9 @@ static int ofp10_features_reply(const msg_t *msg)
 
     ev_sw_established_conn(OFP_ID, &sw);
 
+    if (conn_add(sw.dpid, msg->fd))
+        LOG_WARN(OFP_ID, "No room to keep the connection of %lu", sw.dpid);
+
     int num_ports = (ntohs(reply->header.length) - sizeof(struct ofp_switch_features)) / sizeof(struct ofp_phy_port);
     struct ofp_phy_port *ports = reply->ports;
 
@@ -571,102 +1047,311 @@ static int ofp10_port_status(const msg_t *msg)
 }
 
 /**
- * \brief Function to process STATS_REPLY messages
- * \param msg STATS_REPLY message
+ * \brief Function to get the stats buffer of a switch (locked)
+ * \param fd The socket of a switch
+ * \return Stats buffer (NULL if all buffers are in use)
  */
-static int ofp10_stats_reply(const msg_t *msg)
+static stats_buf_t *stats_buf_get(uint32_t fd)
 {
-    struct ofp_stats_reply *reply = (struct ofp_stats_reply *)msg->data;
-
-    switch (ntohs(reply->type)) {
-    case OFPST_DESC: // only for sw_mgmt
-        {
-            struct ofp_desc_stats *desc = (struct ofp_desc_stats *)reply->body;
+    int idx = fd % __MAX_NUM_SWITCHES;
 
-            switch_t sw = {0};
+    // the buffer of a switch is only claimed and released by the thread handling its socket
+    int i;
+    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+        stats_buf_t *buf = &stats_buf[(idx + i) % __MAX_NUM_SWITCHES];
+        if (buf->fd == fd) {
+            pthread_spin_lock(&buf->lock);
+            return buf;
+        }
+    }
 
-            sw.dpid = get_dpid(msg->fd);
+    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+        stats_buf_t *buf = &stats_buf[(idx + i) % __MAX_NUM_SWITCHES];
 
-            strncpy(sw.desc.mfr_desc, desc->mfr_desc, 256);
-            strncpy(sw.desc.hw_desc, desc->hw_desc, 256);
-            strncpy(sw.desc.sw_desc, desc->sw_desc, 256);
-            strncpy(sw.desc.serial_num, desc->serial_num, 32);
-            strncpy(sw.desc.dp_desc, desc->dp_desc, 256);
+        // skip the buffers being filled by others
+        if (pthread_spin_trylock(&buf->lock)) continue;
 
-            ev_sw_update_desc(OFP_ID, &sw);
+        if (buf->fd == 0) {
+            buf->fd = fd;
+            buf->flows.num_flows = 0;
+            buf->ports.num_ports = 0;
+            return buf;
         }
-        break;
-    case OFPST_FLOW:
-        {
-            struct ofp_flow_stats *stats = (struct ofp_flow_stats *)reply->body;
 
-            flow_t flow = {0};
+        pthread_spin_unlock(&buf->lock);
+    }
 
-            flow.dpid = get_dpid(msg->fd);
-            flow.port = ntohs(stats->match.in_port);
+    return NULL;
+}
 
-            flow.meta.cookie = ntohll(stats->cookie);
-            flow.meta.idle_timeout = ntohs(stats->idle_timeout);
-            flow.meta.hard_timeout = ntohs(stats->hard_timeout);
-            flow.meta.priority = ntohs(stats->priority);
+/**
+ * \brief Function to release a stats buffer
+ * \param buf Stats buffer
+ * \param done The flag whether the reply is completed
+ */
+static void stats_buf_put(stats_buf_t *buf, int done)
+{
+    if (done) {
+        buf->fd = 0;
+        buf->flows.num_flows = 0;
+        buf->ports.num_ports = 0;
+    }
 
-            ofp10_get_match_fields(&flow.pkt_info, &stats->match);
+    pthread_spin_unlock(&buf->lock);
+}
 
-            flow.stat.duration_sec = ntohl(stats->duration_sec);
-            flow.stat.duration_nsec = ntohl(stats->duration_nsec);
+/**
+ * \brief Function to make room for more entries in a stats buffer
+ * \param entry The current entries
+ * \param max The capacity of the entries
+ * \param num The number of entries required
+ * \param size The size of an entry
+ * \return The (re)allocated entries (NULL if it fails)
+ */
+static void *stats_buf_reserve(void *entry, uint32_t *max, uint32_t num, size_t size)
+{
+    if (num <= *max) return entry;
 
-            flow.stat.pkt_count = ntohll(stats->packet_count);
-            flow.stat.byte_count = ntohll(stats->byte_count);
+    uint32_t new_max = (*max) ? *max : __OFP10_STATS_INIT_ENTRIES;
+    while (new_max < num) new_max *= 2;
 
-            ev_dp_flow_stats(OFP_ID, &flow);
-        }
-        break;
-    case OFPST_AGGREGATE:
-        {
-            struct ofp_aggregate_stats_reply *stats = (struct ofp_aggregate_stats_reply *)reply->body;
+    void *new_entry = MALLOC(new_max * size);
+    if (new_entry == NULL) return NULL;
 
-            flow_t flow = {0};
+    if (entry != NULL) {
+        memcpy(new_entry, entry, *max * size);
+        FREE(entry);
+    }
 
-            flow.dpid = get_dpid(msg->fd);
+    *max = new_max;
 
-            flow.stat.pkt_count = ntohll(stats->packet_count);
-            flow.stat.byte_count = ntohll(stats->byte_count);
-            flow.stat.flow_count = ntohl(stats->flow_count);
+    return new_entry;
+}
 
-            ev_dp_aggregate_stats(OFP_ID, &flow);
-        }
-        break;
-    case OFPST_TABLE:
-        {
-            // no implementation
+/**
+ * \brief Function to collect the flow entries of a FLOW stats reply
+ * \param buf Stats buffer
+ * \param body The body of the reply
+ * \param size The size of the body
+ */
+static int ofp10_collect_flow_stats(stats_buf_t *buf, uint8_t *body, int size)
+{
+    flows_t *flows = &buf->flows;
+
+    // entries have variable lengths (with actions), so this is the upper bound
+    int entries = size / sizeof(struct ofp_flow_stats);
+
+    flow_t *flow = stats_buf_reserve(flows->flow, &buf->max_flows, flows->num_flows + entries, sizeof(flow_t));
+    if (flow == NULL) {
+        LOG_ERROR(OFP_ID, "malloc() failed");
+        return -1;
+    }
+
+    flows->flow = flow;
+
+    int offset = 0;
+    while (offset + sizeof(struct ofp_flow_stats) <= size) {
+        struct ofp_flow_stats *stats = (struct ofp_flow_stats *)(body + offset);
+
+        int len = ntohs(stats->length);
+        if (len < sizeof(struct ofp_flow_stats) || offset + len > size) {
+            LOG_WARN(OFP_ID, "Malformed flow stats (dpid=%lu, length=%d)", flows->dpid, len);
+            break;
         }
-        break;
-    case OFPST_PORT:
+
+        flow = &flows->flow[flows->num_flows++];
+        memset(flow, 0, sizeof(flow_t));
+
+        flow->dpid = flows->dpid;
+        flow->port = ntohs(stats->match.in_port);
+
+        flow->meta.cookie = ntohll(stats->cookie);
+        flow->meta.idle_timeout = ntohs(stats->idle_timeout);
+        flow->meta.hard_timeout = ntohs(stats->hard_timeout);
+        flow->meta.priority = ntohs(stats->priority);
+
+        ofp10_get_match_fields(&flow->pkt_info, &stats->match);
+
+        flow->stat.duration_sec = ntohl(stats->duration_sec);
+        flow->stat.duration_nsec = ntohl(stats->duration_nsec);
+
+        flow->stat.pkt_count = ntohll(stats->packet_count);
+        flow->stat.byte_count = ntohll(stats->byte_count);
+
+        offset += len;
+    }
+
+    return 0;
+}
+
+/**
+ * \brief Function to collect the port entries of a PORT stats reply
+ * \param buf Stats buffer
+ * \param body The body of the reply
+ * \param size The size of the body
+ */
+static int ofp10_collect_port_stats(stats_buf_t *buf, uint8_t *body, int size)
+{
+    ports_t *ports = &buf->ports;
+
+    struct ofp_port_stats *stats = (struct ofp_port_stats *)body;
+    int entries = size / sizeof(struct ofp_port_stats);
+
+    port_t *port = stats_buf_reserve(ports->port, &buf->max_ports, ports->num_ports + entries, sizeof(port_t));
+    if (port == NULL) {
+        LOG_ERROR(OFP_ID, "malloc() failed");
+        return -1;
+    }
+
+    ports->port = port;
+
+    int i;
+    for (i=0; i<entries; i++) {
+        if (ntohs(stats[i].port_no) > __MAX_NUM_PORTS) continue;
+
+        port = &ports->port[ports->num_ports++];
+        memset(port, 0, sizeof(port_t));
+
+        port->dpid = ports->dpid;
+        port->port = ntohs(stats[i].port_no);
+
+        port->stat.rx_packets = ntohll(stats[i].rx_packets);
+        port->stat.rx_bytes = ntohll(stats[i].rx_bytes);
+        port->stat.tx_packets = ntohll(stats[i].tx_packets);
+        port->stat.tx_bytes = ntohll(stats[i].tx_bytes);
+    }
+
+    return 0;
+}
+
+/**
+ * \brief Function to reassemble FLOW and PORT stats replies
+ *        and raise a single batched event when the last part arrives
+ * \param msg STATS_REPLY message
+ */
+static int ofp10_multi_stats_reply(const msg_t *msg)
+{
+    struct ofp_stats_reply *reply = (struct ofp_stats_reply *)msg->data;
+
+    uint16_t type = ntohs(reply->type);
+    uint32_t xid = ntohl(reply->header.xid);
+    int size = ntohs(reply->header.length) - sizeof(struct ofp_stats_reply);
+
+    if (size < 0) return -1;
+
+    // the lookup raises an event, so it is done before the buffer is locked
+    uint64_t dpid = get_dpid(msg->fd);
+
+    stats_buf_t *buf = stats_buf_get(msg->fd);
+    if (buf == NULL) {
+        LOG_WARN(OFP_ID, "No buffer to reassemble stats replies (fd=%u)", msg->fd);
+        return -1;
+    }
+
+    if (buf->flows.num_flows || buf->ports.num_ports) {
+        // the previous reply has never been completed
+        if (buf->xid != xid || buf->type != type) {
+            LOG_WARN(OFP_ID, "Dropped an incomplete stats reply (fd=%u, xid=%u)", msg->fd, buf->xid);
+
+            buf->flows.num_flows = 0;
+            buf->ports.num_ports = 0;
+        }
+    }
+
+    if (buf->flows.num_flows == 0 && buf->ports.num_ports == 0) {
+        buf->xid = xid;
+        buf->type = type;
+
+        buf->flows.dpid = buf->ports.dpid = dpid;
+    }
+
+    if (type == OFPST_FLOW)
+        ofp10_collect_flow_stats(buf, reply->body, size);
+    else
+        ofp10_collect_port_stats(buf, reply->body, size);
+
+    if (ntohs(reply->flags) & OFPSF_REPLY_MORE) {
+        stats_buf_put(buf, FALSE);
+        return 0;
+    }
+
+    // the completed entries leave the buffer, so the event chain runs without the lock
+    flows_t flows = buf->flows;
+    ports_t ports = buf->ports;
+
+    if (type == OFPST_FLOW) {
+        buf->flows.flow = NULL;
+        buf->max_flows = 0;
+    } else {
+        buf->ports.port = NULL;
+        buf->max_ports = 0;
+    }
+
+    stats_buf_put(buf, TRUE);
+
+    if (type == OFPST_FLOW) {
+        ev_dp_multi_flow_stats(OFP_ID, &flows);
+        FREE(flows.flow);
+    } else {
+        ev_dp_multi_port_stats(OFP_ID, &ports);
+        FREE(ports.port);
+    }
+
+    return 0;
+}
+
+/**
+ * \brief Function to process STATS_REPLY messages
+ * \param msg STATS_REPLY message
+ */
+static int ofp10_stats_reply(const msg_t *msg)
+{
+    struct ofp_stats_reply *reply = (struct ofp_stats_reply *)msg->data;
+
+    switch (ntohs(reply->type)) {
+    case OFPST_DESC: // only for sw_mgmt
         {
-            struct ofp_port_stats *stats = (struct ofp_port_stats *)reply->body;
+            struct ofp_desc_stats *desc = (struct ofp_desc_stats *)reply->body;
 
-            int size = ntohs(reply->header.length) - sizeof(struct ofp_stats_reply);
-            int entries = size / sizeof(struct ofp_port_stats);
-            uint64_t dpid = get_dpid(msg->fd);
+            switch_t sw = {0};
 
-            int i;
-            for (i=0; i<entries; i++) {
-                if (ntohs(stats[i].port_no) > __MAX_NUM_PORTS) continue;
+            sw.dpid = get_dpid(msg->fd);
 
-                port_t port = {0};
+            strncpy(sw.desc.mfr_desc, desc->mfr_desc, 256);
+            strncpy(sw.desc.hw_desc, desc->hw_desc, 256);
+            strncpy(sw.desc.sw_desc, desc->sw_desc, 256);
+            strncpy(sw.desc.serial_num, desc->serial_num, 32);
+            strncpy(sw.desc.dp_desc, desc->dp_desc, 256);
 
-                port.dpid = dpid;
-                port.port = ntohs(stats[i].port_no);
+            ev_sw_update_desc(OFP_ID, &sw);
+        }
+        break;
+    case OFPST_FLOW:
+        ofp10_multi_stats_reply(msg);
+        break;
+    case OFPST_AGGREGATE:
+        {
+            struct ofp_aggregate_stats_reply *stats = (struct ofp_aggregate_stats_reply *)reply->body;
 
-                port.stat.rx_packets = ntohll(stats[i].rx_packets);
-                port.stat.rx_bytes = ntohll(stats[i].rx_bytes);
-                port.stat.tx_packets = ntohll(stats[i].tx_packets);
-                port.stat.tx_bytes = ntohll(stats[i].tx_bytes);
+            flow_t flow = {0};
 
-                ev_dp_port_stats(OFP_ID, &port);
-            }
+            flow.dpid = get_dpid(msg->fd);
+
+            flow.stat.pkt_count = ntohll(stats->packet_count);
+            flow.stat.byte_count = ntohll(stats->byte_count);
+            flow.stat.flow_count = ntohl(stats->flow_count);
+
+            ev_dp_aggregate_stats(OFP_ID, &flow);
         }
         break;
+    case OFPST_TABLE:
+        {
+            // no implementation
+        }
+        break;
+    case OFPST_PORT:
+        ofp10_multi_stats_reply(msg);
+        break;
     case OFPST_QUEUE:
         {
             // no implementation
@@ -681,6 +1366,68 @@ static int ofp10_stats_reply(const msg_t *msg)
 
 /////////////////////////////////////////////////////////////////////
 
+/** \brief Pre-encoded actions (indexed by action types, only values are filled later) */
+static uint8_t action_tmpl[ACTION_VENDOR+1][16];
+
+/** \brief The lengths of pre-encoded actions (0: nothing to encode) */
+static uint16_t action_len[ACTION_VENDOR+1];
+
+/** \brief Pre-encoded FLOW_MOD header */
+static struct ofp_flow_mod flow_mod_tmpl;
+
+/** \brief Pre-encoded PACKET_OUT header */
+static struct ofp_packet_out packet_out_tmpl;
+
+/**
+ * \brief Function to add a pre-encoded action
+ * \param type Action type
+ * \param ofp_type OpenFlow action type
+ * \param len The length of the action
+ */
+static void ofp10_add_action_tmpl(int type, uint16_t ofp_type, uint16_t len)
+{
+    struct ofp_action_header *act = (struct ofp_action_header *)action_tmpl[type];
+
+    memset(act, 0, sizeof(action_tmpl[type]));
+
+    act->type = htons(ofp_type);
+    act->len = htons(len);
+
+    action_len[type] = len;
+}
+
+/**
+ * \brief Function to pre-encode the static parts of outgoing messages
+ */
+static void ofp10_init_templates(void)
+{
+    ofp10_add_action_tmpl(ACTION_OUTPUT, OFPAT_OUTPUT, sizeof(struct ofp_action_output));
+    ofp10_add_action_tmpl(ACTION_SET_VLAN_VID, OFPAT_SET_VLAN_VID, sizeof(struct ofp_action_vlan_vid));
+    ofp10_add_action_tmpl(ACTION_SET_VLAN_PCP, OFPAT_SET_VLAN_PCP, sizeof(struct ofp_action_vlan_pcp));
+    ofp10_add_action_tmpl(ACTION_STRIP_VLAN, OFPAT_STRIP_VLAN, sizeof(struct ofp_action_header));
+    ofp10_add_action_tmpl(ACTION_SET_SRC_MAC, OFPAT_SET_DL_SRC, sizeof(struct ofp_action_dl_addr));
+    ofp10_add_action_tmpl(ACTION_SET_DST_MAC, OFPAT_SET_DL_DST, sizeof(struct ofp_action_dl_addr));
+    ofp10_add_action_tmpl(ACTION_SET_SRC_IP, OFPAT_SET_NW_SRC, sizeof(struct ofp_action_nw_addr));
+    ofp10_add_action_tmpl(ACTION_SET_DST_IP, OFPAT_SET_NW_DST, sizeof(struct ofp_action_nw_addr));
+    ofp10_add_action_tmpl(ACTION_SET_IP_TOS, OFPAT_SET_NW_TOS, sizeof(struct ofp_action_nw_tos));
+    ofp10_add_action_tmpl(ACTION_SET_SRC_PORT, OFPAT_SET_TP_SRC, sizeof(struct ofp_action_tp_port));
+    ofp10_add_action_tmpl(ACTION_SET_DST_PORT, OFPAT_SET_TP_DST, sizeof(struct ofp_action_tp_port));
+    ofp10_add_action_tmpl(ACTION_VENDOR, OFPAT_VENDOR, sizeof(struct ofp_action_vendor_header));
+
+    memset(&flow_mod_tmpl, 0, sizeof(struct ofp_flow_mod));
+
+    flow_mod_tmpl.header.version = OFP_VERSION;
+    flow_mod_tmpl.header.type = OFPT_FLOW_MOD;
+    flow_mod_tmpl.buffer_id = -1;
+    flow_mod_tmpl.out_port = htons(OFPP_NONE);
+
+    memset(&packet_out_tmpl, 0, sizeof(struct ofp_packet_out));
+
+    packet_out_tmpl.header.version = OFP_VERSION;
+    packet_out_tmpl.header.type = OFPT_PACKET_OUT;
+    packet_out_tmpl.buffer_id = -1;
+}
+
 /**
  * \brief Function to build a set of actions
  * \param num_actions The number of actions
@@ -694,147 +1441,48 @@ static int ofp10_build_actions(int num_actions, const action_t *action, uint8_t
 
     int i;
     for (i=0; i<num_actions; i++) {
-        switch (action[i].type) {
-        case ACTION_DROP:
-            {
-                // nothing to do
-            }
-            break;
-        case ACTION_OUTPUT:
-            {
-                struct ofp_action_output *output = (struct ofp_action_output *)(pkt + size);
+        int type = action[i].type;
 
-                output->type = htons(OFPAT_OUTPUT);
-                output->len = htons(sizeof(struct ofp_action_output));
-                output->port = htons(action[i].port);
-                output->max_len = 0;
+        if (type > ACTION_VENDOR || action_len[type] == 0)
+            continue;
 
-                size += sizeof(struct ofp_action_output);
-            }
+        // the type, the length, and paddings come from the template
+        uint8_t *act = pkt + size;
+        memcpy(act, action_tmpl[type], action_len[type]);
+
+        switch (type) {
+        case ACTION_OUTPUT:
+            ((struct ofp_action_output *)act)->port = htons(action[i].port);
             break;
         case ACTION_SET_VLAN_VID:
-            {
-                struct ofp_action_vlan_vid *vid = (struct ofp_action_vlan_vid *)(pkt + size);
-
-                vid->type = htons(OFPAT_SET_VLAN_VID);
-                vid->len = htons(sizeof(struct ofp_action_vlan_vid));
-                vid->vlan_vid = htons(action[i].vlan_id);
-
-                size += sizeof(struct ofp_action_vlan_vid);
-            }
+            ((struct ofp_action_vlan_vid *)act)->vlan_vid = htons(action[i].vlan_id);
             break;
         case ACTION_SET_VLAN_PCP:
-            {
-                struct ofp_action_vlan_pcp *pcp = (struct ofp_action_vlan_pcp *)(pkt + size);
-
-                pcp->type = htons(OFPAT_SET_VLAN_PCP);
-                pcp->len = htons(sizeof(struct ofp_action_vlan_pcp));
-                pcp->vlan_pcp = action[i].vlan_pcp;
-
-                size += sizeof(struct ofp_action_vlan_pcp);
-            }
-            break;
-        case ACTION_STRIP_VLAN:
-            {
-                struct ofp_action_header *act = (struct ofp_action_header *)(pkt + size);
-
-                act->type = htons(OFPAT_STRIP_VLAN);
-                act->len = htons(sizeof(struct ofp_action_header));
-
-                size += sizeof(struct ofp_action_header);
-            }
+            ((struct ofp_action_vlan_pcp *)act)->vlan_pcp = action[i].vlan_pcp;
             break;
         case ACTION_SET_SRC_MAC:
-            {
-                struct ofp_action_dl_addr *mac = (struct ofp_action_dl_addr *)(pkt + size);
-
-                mac->type = htons(OFPAT_SET_DL_SRC);
-                mac->len = htons(sizeof(struct ofp_action_dl_addr));
-                memmove(mac->dl_addr, action[i].mac_addr, ETH_ALEN);
-
-                size += sizeof(struct ofp_action_dl_addr);
-            }
-            break;
         case ACTION_SET_DST_MAC:
-            {
-                struct ofp_action_dl_addr *mac = (struct ofp_action_dl_addr *)(pkt + size);
-
-                mac->type = htons(OFPAT_SET_DL_DST);
-                mac->len = htons(sizeof(struct ofp_action_dl_addr));
-                memmove(mac->dl_addr, action[i].mac_addr, ETH_ALEN);
-
-                size += sizeof(struct ofp_action_dl_addr);
-            }
+            memmove(((struct ofp_action_dl_addr *)act)->dl_addr, action[i].mac_addr, ETH_ALEN);
             break;
         case ACTION_SET_SRC_IP:
-            {
-                struct ofp_action_nw_addr *ip = (struct ofp_action_nw_addr *)(pkt + size);
-
-                ip->type = htons(OFPAT_SET_NW_SRC);
-                ip->len = htons(sizeof(struct ofp_action_nw_addr));
-                ip->nw_addr = htonl(action[i].ip_addr);
-
-                size += sizeof(struct ofp_action_nw_addr);
-            }
-            break;
         case ACTION_SET_DST_IP:
-            {
-                struct ofp_action_nw_addr *ip = (struct ofp_action_nw_addr *)(pkt + size);
-
-                ip->type = htons(OFPAT_SET_NW_DST);
-                ip->len = htons(sizeof(struct ofp_action_nw_addr));
-                ip->nw_addr = htonl(action[i].ip_addr);
-
-                size += sizeof(struct ofp_action_nw_addr);
-            }
+            ((struct ofp_action_nw_addr *)act)->nw_addr = htonl(action[i].ip_addr);
             break;
         case ACTION_SET_IP_TOS:
-            {
-                struct ofp_action_nw_tos *tos = (struct ofp_action_nw_tos *)(pkt + size);
-
-                tos->type = htons(OFPAT_SET_NW_TOS);
-                tos->len = htons(sizeof(struct ofp_action_nw_tos));
-                tos->nw_tos = action[i].ip_tos;
-
-                size += sizeof(struct ofp_action_nw_tos);
-            }
+            ((struct ofp_action_nw_tos *)act)->nw_tos = action[i].ip_tos;
             break;
         case ACTION_SET_SRC_PORT:
-            {
-                struct ofp_action_tp_port *port = (struct ofp_action_tp_port *)(pkt + size);
-
-                port->type = htons(OFPAT_SET_TP_SRC);
-                port->len = htons(sizeof(struct ofp_action_tp_port));
-                port->tp_port = htons(action[i].port);
-
-                size += sizeof(struct ofp_action_tp_port);
-            }
-            break;
         case ACTION_SET_DST_PORT:
-            {
-                struct ofp_action_tp_port *port = (struct ofp_action_tp_port *)(pkt + size);
-
-                port->type = htons(OFPAT_SET_TP_DST);
-                port->len = htons(sizeof(struct ofp_action_tp_port));
-                port->tp_port = htons(action[i].port);
-
-                size += sizeof(struct ofp_action_tp_port);
-            }
+            ((struct ofp_action_tp_port *)act)->tp_port = htons(action[i].port);
             break;
         case ACTION_VENDOR:
-            {
-                struct ofp_action_vendor_header *vendor = (struct ofp_action_vendor_header *)(pkt + size);
-
-                vendor->type = htons(OFPAT_VENDOR);
-                vendor->len = htons(sizeof(struct ofp_action_vendor_header));
-                vendor->vendor = htonl(action[i].vendor);
-
-                size += sizeof(struct ofp_action_vendor_header);
-            }
+            ((struct ofp_action_vendor_header *)act)->vendor = htonl(action[i].vendor);
             break;
         default:
             break;
         }
+
+        size += action_len[type];
     }
 
     return size;
@@ -848,37 +1496,35 @@ static int ofp10_build_actions(int num_actions, const action_t *action, uint8_t
  */
 static int ofp10_packet_out(const pktout_t *pktout)
 {
-    msg_t msg;
-    uint8_t pkt[__MAX_MSG_SIZE] = {0};
+    if (pktout->port >= __MAX_NUM_PORTS && pktout->port < PORT_IN_PORT) {
+        LOG_WARN(OFP_ID, "Received ofp_packet_out with wrong port (%u)", pktout->port);
+        return -1;
+    }
 
-    struct ofp_packet_out *out = (struct ofp_packet_out *)pkt;
+    // every byte is written below, so the buffer is not cleared
+    uint8_t pkt[__MAX_MSG_SIZE];
 
-    int size = sizeof(struct ofp_packet_out);
+    struct ofp_packet_out *out = (struct ofp_packet_out *)pkt;
+    memcpy(out, &packet_out_tmpl, sizeof(struct ofp_packet_out));
 
-    out->header.version = OFP_VERSION;
-    out->header.type = OFPT_PACKET_OUT;
+    ofp10_conn_t *conn = conn_lookup(pktout->dpid);
 
     if (pktout->xid)
         out->header.xid = htonl(pktout->xid);
+    else if (conn != NULL)
+        out->header.xid = htonl(__sync_fetch_and_add(&conn->xid, 1));
     else
         out->header.xid = htonl(get_xid(pktout->dpid));
 
     if (pktout->buffer_id)
         out->buffer_id = htonl(pktout->buffer_id);
-    else
-        out->buffer_id = -1;
 
-    if (pktout->port < __MAX_NUM_PORTS || pktout->port >= PORT_IN_PORT)
-        out->in_port = htons(pktout->port);
-    else {
-        LOG_WARN(OFP_ID, "Received ofp_packet_out with wrong port (%u)", pktout->port);
-        return -1;
-    }
+    out->in_port = htons(pktout->port);
 
     int actions_len = ofp10_build_actions(pktout->num_actions, pktout->action, pkt + sizeof(struct ofp_packet_out));
     out->actions_len = htons(actions_len);
 
-    size += actions_len;
+    int size = sizeof(struct ofp_packet_out) + actions_len;
 
     if (pktout->buffer_id == (uint32_t)-1 && pktout->total_len > 0) {
         memmove(pkt + size, pktout->data, MIN(pktout->total_len, __MAX_PKT_SIZE));
@@ -887,7 +1533,9 @@ static int ofp10_packet_out(const pktout_t *pktout)
 
     out->header.length = htons(size);
 
-    msg.fd = get_fd(pktout->dpid);
+    msg_t msg;
+
+    msg.fd = (conn != NULL) ? conn->fd : get_fd(pktout->dpid);
     msg.length = size;
     msg.data = pkt;
 
@@ -953,33 +1601,24 @@ static int ofp10_set_match_fields(uint32_t in_port, const pkt_info_t *info, stru
 /////////////////////////////////////////////////////////////////////
 
 /**
- * \brief Function to process FLOW_MOD messages
+ * \brief Function to encode a FLOW_MOD message
  * \param flow FLOW message
  * \param command Command
+ * \param xid Transaction ID
+ * \param pkt The buffer to encode the message in (not need to be cleared)
+ * \return The size of the message
  */
-static int ofp10_flow_mod(const flow_t *flow, int command)
+static int ofp10_encode_flow_mod(const flow_t *flow, int command, uint32_t xid, uint8_t *pkt)
 {
-    msg_t msg;
-    uint8_t pkt[__MAX_MSG_SIZE] = {0};
-
     struct ofp_flow_mod *mod = (struct ofp_flow_mod *)pkt;
+    memcpy(mod, &flow_mod_tmpl, sizeof(struct ofp_flow_mod));
 
-    int size = sizeof(struct ofp_flow_mod);
-
-    mod->header.version = OFP_VERSION;
-    mod->header.type = OFPT_FLOW_MOD;
-
-    if (flow->info.xid)
-        mod->header.xid = htonl(flow->info.xid);
-    else
-        mod->header.xid = htonl(get_xid(flow->dpid));
+    mod->header.xid = htonl(xid);
 
     if (flow->info.buffer_id)
         mod->buffer_id = htonl(flow->info.buffer_id);
-    else
-        mod->buffer_id = -1;
 
-    mod->cookie = htonl(flow->meta.cookie);
+    mod->cookie = htonll(flow->meta.cookie);
 
     if (command == FLOW_ADD)
         mod->command = htons(OFPFC_ADD);
@@ -996,19 +1635,42 @@ static int ofp10_flow_mod(const flow_t *flow, int command)
     else
         mod->priority = htons(flow->meta.priority);
 
-    mod->out_port = htons(OFPP_NONE);
     mod->flags = htons(flow->meta.flags | FLFG_SEND_REMOVED);
 
     ofp10_set_match_fields(flow->port, &flow->pkt_info, &mod->match);
 
     int actions_len = ofp10_build_actions(flow->num_actions, flow->action, pkt + sizeof(struct ofp_flow_mod));
 
-    size += actions_len;
+    int size = sizeof(struct ofp_flow_mod) + actions_len;
 
     mod->header.length = htons(size);
 
-    msg.fd = get_fd(flow->dpid);
-    msg.length = size;
+    return size;
+}
+
+/**
+ * \brief Function to process FLOW_MOD messages
+ * \param flow FLOW message
+ * \param command Command
+ */
+static int ofp10_flow_mod(const flow_t *flow, int command)
+{
+    uint8_t pkt[__MAX_MSG_SIZE];
+
+    ofp10_conn_t *conn = conn_lookup(flow->dpid);
+
+    uint32_t xid;
+    if (flow->info.xid)
+        xid = flow->info.xid;
+    else if (conn != NULL)
+        xid = __sync_fetch_and_add(&conn->xid, 1);
+    else
+        xid = get_xid(flow->dpid);
+
+    msg_t msg;
+
+    msg.fd = (conn != NULL) ? conn->fd : get_fd(flow->dpid);
+    msg.length = ofp10_encode_flow_mod(flow, command, xid, pkt);
     msg.data = pkt;
 
     ev_ofp_msg_out(OFP_ID, &msg);
@@ -1016,6 +1678,459 @@ static int ofp10_flow_mod(const flow_t *flow, int command)
     return 0;
 }
 
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The maximum size of a FLOW_MOD message */
+#define OFP10_MAX_FLOW_MOD_LEN (sizeof(struct ofp_flow_mod) + __MAX_NUM_ACTIONS * sizeof(action_tmpl[0]))
+
+/**
+ * \brief Function to write encoded messages to a switch
+ * \param fd Network socket
+ * \param buf Messages
+ * \param len The total length of the messages
+ */
+static int batch_write(uint32_t fd, uint8_t *buf, int len)
+{
+    msg_t msg;
+
+    msg.fd = fd;
+    msg.length = len;
+    msg.data = buf;
+
+    ev_ofp_msg_out(OFP_ID, &msg);
+
+    return 0;
+}
+
+/**
+ * \brief Function to send the unsent flows of a switch as far as its window allows (with the lock of the connection)
+ * \param conn Switch connection
+ * \param buf The buffer to encode messages in (__OFP10_BATCH_BUF_SIZE)
+ */
+static int batch_send(ofp10_conn_t *conn, uint8_t *buf)
+{
+    while (conn->pending != NULL && conn->inflight < conn->window &&
+           conn->b_tail - conn->b_head < __OFP10_MAX_BARRIERS) {
+        ofp10_batch_t *batch = conn->pending;
+
+        uint32_t num = batch->result.num_flows - batch->sent;
+        if (num > conn->window - conn->inflight)
+            num = conn->window - conn->inflight;
+
+        // the FLOW_MODs and their barrier take consecutive xids
+        uint32_t xid = __sync_fetch_and_add(&conn->xid, num + 1);
+
+        ofp10_barrier_t *barrier = &conn->barrier[conn->b_tail % __OFP10_MAX_BARRIERS];
+
+        barrier->batch = batch;
+        barrier->first_xid = xid;
+        barrier->xid = xid + num;
+        barrier->first_idx = batch->sent;
+
+        int len = 0;
+
+        uint32_t i;
+        for (i=0; i<num; i++) {
+            if (len + OFP10_MAX_FLOW_MOD_LEN > __OFP10_BATCH_BUF_SIZE) {
+                batch_write(conn->fd, buf, len);
+                len = 0;
+            }
+
+            len += ofp10_encode_flow_mod(&batch->flow[batch->sent + i], FLOW_ADD, xid + i, buf + len);
+        }
+
+        if (len + sizeof(struct ofp_header) > __OFP10_BATCH_BUF_SIZE) {
+            batch_write(conn->fd, buf, len);
+            len = 0;
+        }
+
+        struct ofp_header *request = (struct ofp_header *)(buf + len);
+
+        request->version = OFP_VERSION;
+        request->type = OFPT_BARRIER_REQUEST;
+        request->length = htons(sizeof(struct ofp_header));
+        request->xid = htonl(barrier->xid);
+
+        len += sizeof(struct ofp_header);
+
+        batch_write(conn->fd, buf, len);
+
+        conn->b_tail++;
+
+        batch->sent += num;
+        conn->queued -= num;
+        conn->inflight += num;
+
+        if (batch->sent == batch->result.num_flows)
+            conn->pending = batch->next;
+    }
+
+    return 0;
+}
+
+/**
+ * \brief Function to install flows in bulk (FLOW_MODs followed by a BARRIER_REQUEST)
+ * \param flows The flows of a switch
+ */
+static int ofp10_insert_flows(const flows_t *flows)
+{
+    flow_batch_t result = {0};
+
+    result.dpid = flows->dpid;
+    result.batch_id = flows->batch_id;
+    result.num_flows = flows->num_flows;
+
+    if (flows->num_flows == 0) {
+        result.status = BATCH_DONE;
+        ev_dp_flows_installed(OFP_ID, &result);
+        return 0;
+    }
+
+    ofp10_conn_t *conn = conn_lookup(flows->dpid);
+    if (conn == NULL || flows->num_flows > __OFP10_MAX_QUEUED_FLOWS) {
+        result.status = BATCH_REJECTED;
+        ev_dp_flows_installed(OFP_ID, &result);
+        return -1;
+    }
+
+    ofp10_batch_t *batch = (ofp10_batch_t *)MALLOC(sizeof(ofp10_batch_t));
+    if (batch == NULL) {
+        LOG_ERROR(OFP_ID, "malloc() failed");
+        result.status = BATCH_FAILED;
+        ev_dp_flows_installed(OFP_ID, &result);
+        return -1;
+    }
+
+    batch->flow = (flow_t *)MALLOC(sizeof(flow_t) * flows->num_flows);
+    if (batch->flow == NULL) {
+        LOG_ERROR(OFP_ID, "malloc() failed");
+        FREE(batch);
+        result.status = BATCH_FAILED;
+        ev_dp_flows_installed(OFP_ID, &result);
+        return -1;
+    }
+
+    uint8_t *buf = (uint8_t *)MALLOC(__OFP10_BATCH_BUF_SIZE);
+    if (buf == NULL) {
+        LOG_ERROR(OFP_ID, "malloc() failed");
+        FREE(batch->flow);
+        FREE(batch);
+        result.status = BATCH_FAILED;
+        ev_dp_flows_installed(OFP_ID, &result);
+        return -1;
+    }
+
+    memcpy(batch->flow, flows->flow, sizeof(flow_t) * flows->num_flows);
+    memcpy(&batch->result, &result, sizeof(flow_batch_t));
+
+    batch->result.status = BATCH_DONE;
+    batch->sent = 0;
+    batch->acked = 0;
+    batch->next = NULL;
+
+    pthread_mutex_lock(&conn->lock);
+
+    // disconnected in the meantime, or too many flows are waiting for the window
+    if (conn->dpid != flows->dpid || conn->queued + flows->num_flows > __OFP10_MAX_QUEUED_FLOWS) {
+        pthread_mutex_unlock(&conn->lock);
+
+        FREE(buf);
+        FREE(batch->flow);
+        FREE(batch);
+
+        result.status = BATCH_REJECTED;
+        ev_dp_flows_installed(OFP_ID, &result);
+
+        return -1;
+    }
+
+    if (conn->tail == NULL)
+        conn->head = batch;
+    else
+        conn->tail->next = batch;
+    conn->tail = batch;
+
+    if (conn->pending == NULL)
+        conn->pending = batch;
+    conn->queued += flows->num_flows;
+
+    batch_send(conn, buf);
+
+    pthread_mutex_unlock(&conn->lock);
+
+    FREE(buf);
+
+    return 0;
+}
+
+/**
+ * \brief Function to handle BARRIER_REPLY messages
+ * \param msg BARRIER_REPLY message
+ */
+static int ofp10_barrier_reply(const msg_t *msg)
+{
+    struct ofp_header *ofph = (struct ofp_header *)msg->data;
+    uint32_t xid = ntohl(ofph->xid);
+
+    ofp10_conn_t *conn = conn_lookup_fd(msg->fd);
+    if (conn == NULL) return -1;
+
+    ofp10_batch_t *done = NULL, *last = NULL;
+
+    pthread_mutex_lock(&conn->lock);
+
+    // barriers are answered in order, so the earlier ones are also answered
+    uint32_t b;
+    for (b = conn->b_head; b != conn->b_tail; b++) {
+        if (conn->barrier[b % __OFP10_MAX_BARRIERS].xid == xid)
+            break;
+    }
+
+    if (b == conn->b_tail) { // not requested by batches
+        pthread_mutex_unlock(&conn->lock);
+        return 0;
+    }
+
+    for (; conn->b_head != b + 1; conn->b_head++) {
+        ofp10_barrier_t *barrier = &conn->barrier[conn->b_head % __OFP10_MAX_BARRIERS];
+        ofp10_batch_t *batch = barrier->batch;
+
+        uint32_t num = barrier->xid - barrier->first_xid;
+
+        batch->acked += num;
+        conn->inflight -= num;
+
+        if (batch->acked < batch->result.num_flows)
+            continue;
+
+        // batches are completed in order as well
+        conn->head = batch->next;
+        if (conn->tail == batch)
+            conn->tail = NULL;
+
+        batch->next = NULL;
+        if (last == NULL)
+            done = batch;
+        else
+            last->next = batch;
+        last = batch;
+
+        conn->num_batches++;
+    }
+
+    if (conn->pending != NULL) {
+        uint8_t *buf = (uint8_t *)MALLOC(__OFP10_BATCH_BUF_SIZE);
+        if (buf != NULL) {
+            batch_send(conn, buf);
+            FREE(buf);
+        } else {
+            LOG_ERROR(OFP_ID, "malloc() failed");
+        }
+    }
+
+    pthread_mutex_unlock(&conn->lock);
+
+    batch_report(done);
+
+    return 0;
+}
+
+/**
+ * \brief Function to measure the throughput of the FLOW_MOD encoder
+ * \param cli The pointer of the Barista CLI
+ * \param num The number of messages
+ */
+static int ofp10_bench(cli_t *cli, int num)
+{
+    ofp10_conn_t conn = {0};
+    conn.xid = OFP10_XID_BASE;
+
+    flow_t flow = {0};
+
+    flow.dpid = 1;
+    flow.meta.idle_timeout = 5;
+    flow.match.proto = PROTO_IPV4 | PROTO_TCP;
+    flow.match.dst_port = 80;
+    flow.num_actions = 1;
+    flow.action[0].type = ACTION_OUTPUT;
+
+    uint8_t pkt[__MAX_MSG_SIZE];
+    uint64_t bytes = 0;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int i;
+    for (i=0; i<num; i++) {
+        flow.port = (i % 48) + 1;
+        flow.match.src_ip = 0x0a000000 + i;
+        flow.action[0].port = ((i + 1) % 48) + 1;
+
+        bytes += ofp10_encode_flow_mod(&flow, FLOW_ADD, __sync_fetch_and_add(&conn.xid, 1), pkt);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double usec = (end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_nsec - start.tv_nsec) / 1000.0;
+
+    cli_print(cli, "< FLOW_MOD Encoder Benchmark >");
+    cli_print(cli, "  Encoded: %d messages (%lu bytes) in %.3f ms", num, bytes, usec / 1000.0);
+    cli_print(cli, "  Throughput: %.0f FLOW_MODs/sec (%.1f ns/message)",
+              (usec > 0) ? num / usec * 1000000.0 : 0.0, (num) ? usec * 1000.0 / num : 0.0);
+
+    return 0;
+}
+
+/**
+ * \brief Function to print the bulk flow installs of switches
+ * \param cli The pointer of the Barista CLI
+ */
+static int ofp10_batch_show(cli_t *cli)
+{
+    cli_print(cli, "< Bulk Flow Installs >");
+
+    int i, cnt = 0;
+    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+        ofp10_conn_t *conn = &ofp10_conn[i];
+
+        uint64_t dpid = __atomic_load_n(&conn->dpid, __ATOMIC_ACQUIRE);
+        if (dpid == 0 || dpid == OFP10_CONN_RESERVED || dpid == OFP10_CONN_DELETED)
+            continue;
+
+        pthread_mutex_lock(&conn->lock);
+
+        int num_batches = 0;
+        ofp10_batch_t *batch;
+        for (batch = conn->head; batch != NULL; batch = batch->next)
+            num_batches++;
+
+        cli_print(cli, "  Switch %lu: window %u, inflight %u, queued %u, batches %d (completed %lu, rejected flows %lu)",
+                  dpid, conn->window, conn->inflight, conn->queued, num_batches, conn->num_batches, conn->num_errors);
+
+        pthread_mutex_unlock(&conn->lock);
+
+        cnt++;
+    }
+
+    if (!cnt)
+        cli_print(cli, "  No connected switch");
+
+    return 0;
+}
+
+/**
+ * \brief Function to change the flow-control window of switches
+ * \param cli The pointer of the Barista CLI
+ * \param window The maximum number of unconfirmed FLOW_MODs per switch
+ */
+static int ofp10_set_window(cli_t *cli, int window)
+{
+    if (window <= 0) {
+        cli_print(cli, "Wrong window size");
+        return -1;
+    }
+
+    flow_window = window;
+
+    uint8_t *buf = (uint8_t *)MALLOC(__OFP10_BATCH_BUF_SIZE);
+    if (buf == NULL) {
+        LOG_ERROR(OFP_ID, "malloc() failed");
+        return -1;
+    }
+
+    int i;
+    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+        ofp10_conn_t *conn = &ofp10_conn[i];
+
+        pthread_mutex_lock(&conn->lock);
+
+        conn->window = window;
+
+        // a larger window lets the waiting flows go
+        batch_send(conn, buf);
+
+        pthread_mutex_unlock(&conn->lock);
+    }
+
+    FREE(buf);
+
+    cli_print(cli, "Set the flow-control window to %d FLOW_MODs", window);
+
+    return 0;
+}
+
+/**
+ * \brief Function to print the control-channel latencies of switches
+ * \param cli The pointer of the Barista CLI
+ */
+static int ofp10_echo_show(cli_t *cli)
+{
+    cli_print(cli, "< Control-Channel Latencies >");
+
+    int i, cnt = 0;
+    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+        ofp10_conn_t *conn = &ofp10_conn[i];
+
+        uint64_t dpid = __atomic_load_n(&conn->dpid, __ATOMIC_ACQUIRE);
+        if (dpid == 0 || dpid == OFP10_CONN_RESERVED || dpid == OFP10_CONN_DELETED)
+            continue;
+
+        pthread_mutex_lock(&conn->lock);
+
+        cli_print(cli, "  Switch %lu: %lu RTTs (min %.1f us, avg %.1f us, max %.1f us), missed %u",
+                  dpid, conn->rtt_count, conn->rtt_min / 1000.0,
+                  (conn->rtt_count) ? conn->rtt_sum / 1000.0 / conn->rtt_count : 0.0,
+                  conn->rtt_max / 1000.0, conn->echo_missed);
+
+        pthread_mutex_unlock(&conn->lock);
+
+        cnt++;
+    }
+
+    if (!cnt)
+        cli_print(cli, "  No connected switch");
+
+    return 0;
+}
+
+/**
+ * \brief Function to print the RTT histogram of a switch
+ * \param cli The pointer of the Barista CLI
+ * \param dpid_str Datapath ID
+ */
+static int ofp10_echo_hist(cli_t *cli, char *dpid_str)
+{
+    uint64_t dpid = strtoull(dpid_str, NULL, 0);
+
+    ofp10_conn_t *conn = conn_lookup(dpid);
+    if (conn == NULL) {
+        cli_print(cli, "No switch whose datapath ID is %lu", dpid);
+        return -1;
+    }
+
+    uint64_t hist[__OFP10_RTT_BUCKETS];
+
+    pthread_mutex_lock(&conn->lock);
+    memcpy(hist, conn->rtt_hist, sizeof(hist));
+    pthread_mutex_unlock(&conn->lock);
+
+    cli_print(cli, "< RTT Histogram of Switch %lu >", dpid);
+
+    int i;
+    for (i=0; i<__OFP10_RTT_BUCKETS; i++) {
+        if (hist[i] == 0) continue;
+
+        if (i == 0)
+            cli_print(cli, "  < 2 us: %lu", hist[i]);
+        else if (i == __OFP10_RTT_BUCKETS - 1)
+            cli_print(cli, "  >= %lu us: %lu", 1UL << i, hist[i]);
+        else
+            cli_print(cli, "  %lu - %lu us: %lu", 1UL << i, (1UL << (i + 1)) - 1, hist[i]);
+    }
+
+    return 0;
+}
+
 /**
  * \brief Function to generate STATS_REQUEST (desc) messages
  * \param fd Socket
@@ -1201,7 +2316,7 @@ static int ofp10_engine(const msg_t *msg)
         break;
     case OFPT_ECHO_REPLY:
         DEBUG("OFPT_ECHO_REPLY\n");
-        // nothing to do
+        ofp10_echo_rtt(msg);
         break;
     case OFPT_VENDOR:
         DEBUG("OFPT_VENDOR\n");
@@ -1266,7 +2381,7 @@ static int ofp10_engine(const msg_t *msg)
         break;
     case OFPT_BARRIER_REPLY:
         DEBUG("OFPT_BARRIER_REPLY\n");
-        // nothing to do
+        ofp10_barrier_reply(msg);
         break;
     case OFPT_QUEUE_GET_CONFIG_REQUEST:
         DEBUG("OFPT_QUEUE_GET_CONFIG_REQUEST\n");
@@ -1296,6 +2411,35 @@ int ofp10_main(int *activated, int argc, char **argv)
 {
     LOG_INFO(OFP_ID, "Init - OpenFlow 1.0 engine");
 
+    stats_buf = (stats_buf_t *)CALLOC(__MAX_NUM_SWITCHES, sizeof(stats_buf_t));
+    if (stats_buf == NULL) {
+        LOG_ERROR(OFP_ID, "calloc() failed");
+        return -1;
+    }
+
+    int i;
+    for (i=0; i<__MAX_NUM_SWITCHES; i++)
+        pthread_spin_init(&stats_buf[i].lock, PTHREAD_PROCESS_PRIVATE);
+
+    ofp10_conn = (ofp10_conn_t *)CALLOC(__MAX_NUM_SWITCHES, sizeof(ofp10_conn_t));
+    if (ofp10_conn == NULL) {
+        LOG_ERROR(OFP_ID, "calloc() failed");
+        return -1;
+    }
+
+    for (i=0; i<__MAX_NUM_SWITCHES; i++)
+        pthread_mutex_init(&ofp10_conn[i].lock, NULL);
+
+    ofp10_init_templates();
+
+    keepalive_on = TRUE;
+
+    if (pthread_create(&keepalive_thread, NULL, ofp10_keepalive_main, NULL) < 0) {
+        PERROR("pthread_create");
+        keepalive_on = FALSE;
+        return -1;
+    }
+
     activate();
 
     return 0;
@@ -1311,6 +2455,34 @@ int ofp10_cleanup(int *activated)
 
     deactivate();
 
+    if (keepalive_on) {
+        keepalive_on = FALSE;
+        pthread_join(keepalive_thread, NULL);
+    }
+
+    int i;
+    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+        pthread_spin_destroy(&stats_buf[i].lock);
+
+        FREE(stats_buf[i].flows.flow);
+        FREE(stats_buf[i].ports.port);
+
+        ofp10_batch_t *batch = ofp10_conn[i].head;
+        while (batch != NULL) {
+            ofp10_batch_t *next = batch->next;
+
+            FREE(batch->flow);
+            FREE(batch);
+
+            batch = next;
+        }
+
+        pthread_mutex_destroy(&ofp10_conn[i].lock);
+    }
+
+    FREE(stats_buf);
+    FREE(ofp10_conn);
+
     return 0;
 }
 
@@ -1321,6 +2493,37 @@ int ofp10_cleanup(int *activated)
  */
 int ofp10_cli(cli_t *cli, char **args)
 {
+    if (args[0] != NULL && strcmp(args[0], "bench") == 0) {
+        if (args[1] == NULL) {
+            ofp10_bench(cli, __OFP10_BENCH_MSGS);
+            return 0;
+        } else if (args[2] == NULL) {
+            ofp10_bench(cli, atoi(args[1]));
+            return 0;
+        }
+    } else if (args[0] != NULL && strcmp(args[0], "batch") == 0 && args[1] == NULL) {
+        ofp10_batch_show(cli);
+        return 0;
+    } else if (args[0] != NULL && strcmp(args[0], "window") == 0 && args[1] != NULL && args[2] == NULL) {
+        ofp10_set_window(cli, atoi(args[1]));
+        return 0;
+    } else if (args[0] != NULL && strcmp(args[0], "echo") == 0) {
+        if (args[1] == NULL) {
+            ofp10_echo_show(cli);
+            return 0;
+        } else if (args[2] == NULL) {
+            ofp10_echo_hist(cli, args[1]);
+            return 0;
+        }
+    }
+
+    cli_print(cli, "< Available Commands >");
+    cli_print(cli, "  ofp10 bench [# of messages]");
+    cli_print(cli, "  ofp10 batch");
+    cli_print(cli, "  ofp10 window [# of unconfirmed FLOW_MODs per switch]");
+    cli_print(cli, "  ofp10 echo");
+    cli_print(cli, "  ofp10 echo [datapath ID]");
+
     return 0;
 }
 
@@ -1367,6 +2570,13 @@ int ofp10_handler(const event_t *ev, event_out_t *ev_out)
             ofp10_flow_mod(flow, FLOW_DELETE);
         }
         break;
+    case EV_DP_INSERT_FLOWS:
+        PRINT_EV("EV_DP_INSERT_FLOWS\n");
+        {
+            const flows_t *flows = ev->flows;
+            ofp10_insert_flows(flows);
+        }
+        break;
     case EV_DP_REQUEST_FLOW_STATS:
         PRINT_EV("EV_DP_REQUEST_FLOW_STATS\n");
         {
@@ -1395,6 +2605,16 @@ int ofp10_handler(const event_t *ev, event_out_t *ev_out)
             ofp10_port_stats(port);
         }
         break;
+    case EV_SW_DISCONNECTED:
+        PRINT_EV("EV_SW_DISCONNECTED\n");
+        {
+            const switch_t *sw = ev->sw;
+
+            if (sw->remote == TRUE) break;
+
+            conn_del(sw->dpid);
+        }
+        break;
     default:
         break;
     }
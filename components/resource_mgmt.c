@@ -22,27 +22,295 @@
 
 /////////////////////////////////////////////////////////////////////
 
+/** \brief Clock ticks per second */
+static long clk_tck;
+
+/** \brief Page size (KB) */
+static long page_kb;
+
+/** \brief The number of online processors */
+static int num_procs;
+
+/** \brief Total memory (KB) */
+static uint64_t total_mem;
+
+/** \brief The sum of the usages not stored in the database yet */
+static resource_t rs_sum;
+
+/////////////////////////////////////////////////////////////////////
+
 /**
- * \brief Function to get CPU and memory usages
- * \param rs Structure to store CPU and memory usages
+ * \brief Function to read a file under /proc into a buffer
+ * \param path File path
+ * \param buf Buffer
+ * \param len The size of the buffer
+ * \return The number of read bytes
+ */
+static int rs_read(const char *path, char *buf, int len)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    int n = read(fd, buf, len - 1);
+    close(fd);
+
+    if (n < 0) return -1;
+
+    buf[n] = '\0';
+
+    return n;
+}
+
+/**
+ * \brief Function to parse a stat file (/proc/.../stat)
+ * \param buf The content of the stat file
+ * \param comm Thread name (output, can be NULL)
+ * \param ticks User + system time in clock ticks (output)
+ * \param rss Resident set size in pages (output, can be NULL)
+ */
+static int rs_parse_stat(char *buf, char *comm, uint64_t *ticks, uint64_t *rss)
+{
+    // the name can contain spaces and parentheses
+    char *l = strchr(buf, '(');
+    char *r = strrchr(buf, ')');
+    if (l == NULL || r == NULL || r < l) return -1;
+
+    if (comm) {
+        int len = MIN(r - l - 1, __CONF_SHORT_LEN);
+        memcpy(comm, l + 1, len);
+        comm[len] = '\0';
+    }
+
+    // fields after the name start from the 3rd one (state)
+    uint64_t utime = 0, stime = 0, pages = 0;
+    char *p = r + 2;
+
+    int field;
+    for (field=3; field<=24 && *p; field++) {
+        if (field == 14) utime = strtoull(p, NULL, 10);
+        else if (field == 15) stime = strtoull(p, NULL, 10);
+        else if (field == 24) pages = strtoull(p, NULL, 10);
+
+        p = strchr(p, ' ');
+        if (p == NULL) break;
+        p++;
+    }
+
+    *ticks = utime + stime;
+    if (rss) *rss = pages;
+
+    return 0;
+}
+
+/**
+ * \brief Function to parse the context switches in a status file (/proc/.../status)
+ * \param buf The content of the status file
+ * \param vcsw Voluntary context switches (output)
+ * \param nvcsw Involuntary context switches (output)
+ */
+static int rs_parse_status(const char *buf, uint64_t *vcsw, uint64_t *nvcsw)
+{
+    const char *v = strstr(buf, "\nvoluntary_ctxt_switches:");
+    const char *nv = strstr(buf, "\nnonvoluntary_ctxt_switches:");
+
+    *vcsw = (v) ? strtoull(v + 25, NULL, 10) : 0;
+    *nvcsw = (nv) ? strtoull(nv + 28, NULL, 10) : 0;
+
+    return 0;
+}
+
+/**
+ * \brief Function to read the usages of the threads of this process
+ * \param threads Thread usages (output, __RESOURCE_MGMT_MAX_THREADS entries)
+ * \return The number of threads
+ */
+static int read_threads(rs_thread_t *threads)
+{
+    DIR *dir = opendir("/proc/self/task");
+    if (dir == NULL) return -1;
+
+    char path[__CONF_WORD_LEN], buf[__CONF_LONG_STR_LEN];
+    int num = 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && num < __RESOURCE_MGMT_MAX_THREADS) {
+        if (!isdigit(entry->d_name[0])) continue;
+
+        rs_thread_t *th = &threads[num];
+        memset(th, 0, sizeof(rs_thread_t));
+
+        th->tid = atoi(entry->d_name);
+
+        sprintf(path, "/proc/self/task/%d/stat", th->tid);
+        if (rs_read(path, buf, sizeof(buf)) < 0) continue;
+        if (rs_parse_stat(buf, th->comm, &th->ticks, NULL)) continue;
+
+        sprintf(path, "/proc/self/task/%d/status", th->tid);
+        if (rs_read(path, buf, sizeof(buf)) < 0) continue;
+        rs_parse_status(buf, &th->vcsw, &th->nvcsw);
+
+        num++;
+    }
+
+    closedir(dir);
+
+    return num;
+}
+
+/**
+ * \brief Function to update the per-thread usages with new readings (under rs_lock)
+ * \param period Elapsed time since the last sample (second)
+ * \param threads Thread usages read from /proc
+ * \param num The number of threads
+ * \param sample Resource sample to accumulate context switches
  */
-static int monitor_resources(resource_t *rs)
+static int monitor_threads(double period, rs_thread_t *threads, int num, rs_sample_t *sample)
 {
-    resource_t rs_temp = {0.0, 0.0};
+    int i, k;
+    for (i=0; i<rs_num_threads; i++)
+        rs_threads[i].alive = FALSE;
+
+    for (k=0; k<num; k++) {
+        rs_thread_t *cur = &threads[k];
+
+        rs_thread_t *th = NULL;
+        for (i=0; i<rs_num_threads; i++) {
+            if (rs_threads[i].tid == cur->tid) {
+                th = &rs_threads[i];
+                break;
+            }
+        }
+
+        if (th == NULL) {
+            if (rs_num_threads >= __RESOURCE_MGMT_MAX_THREADS) continue;
 
-    FILE *pp = popen(cmd, "r");
-    if (pp != NULL) {
-        char temp[__CONF_WORD_LEN] = {0};
+            th = &rs_threads[rs_num_threads++];
+            memset(th, 0, sizeof(rs_thread_t));
 
-        if (fgets(temp, __CONF_WORD_LEN-1, pp) != NULL) {
-            sscanf(temp, "%lf %lf", &rs_temp.cpu, &rs_temp.mem);
+            th->tid = cur->tid;
+            th->cpu = 0.0;
+        } else if (period > 0) {
+            th->cpu = (cur->ticks - th->ticks) * 100.0 / clk_tck / period;
+            th->d_vcsw = cur->vcsw - th->vcsw;
+            th->d_nvcsw = cur->nvcsw - th->nvcsw;
+
+            sample->vcsw += th->d_vcsw;
+            sample->nvcsw += th->d_nvcsw;
         }
 
-        pclose(pp);
+        strcpy(th->comm, cur->comm);
+        th->ticks = cur->ticks;
+        th->vcsw = cur->vcsw;
+        th->nvcsw = cur->nvcsw;
+        th->alive = TRUE;
+
+        sample->num_threads++;
     }
 
-    rs->cpu += rs_temp.cpu;
-    rs->mem += rs_temp.mem;
+    // remove exited threads
+    int j = 0;
+    for (i=0; i<rs_num_threads; i++) {
+        if (!rs_threads[i].alive) continue;
+        if (i != j) rs_threads[j] = rs_threads[i];
+        j++;
+    }
+    rs_num_threads = j;
+
+    return 0;
+}
+
+/**
+ * \brief Function to get CPU and memory usages
+ * \param sample Structure to store CPU and memory usages
+ */
+static int monitor_resources(rs_sample_t *sample)
+{
+    static struct timespec last_time;
+    static uint64_t last_ticks;
+
+    struct timespec now, end;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    char buf[__CONF_LONG_STR_LEN];
+    uint64_t ticks, pages;
+
+    if (rs_read("/proc/self/stat", buf, sizeof(buf)) < 0)
+        return -1;
+    if (rs_parse_stat(buf, NULL, &ticks, &pages))
+        return -1;
+
+    double period = 0.0;
+    if (last_time.tv_sec)
+        period = (now.tv_sec - last_time.tv_sec) + (now.tv_nsec - last_time.tv_nsec) / 1e9;
+
+    memset(sample, 0, sizeof(rs_sample_t));
+
+    sample->time = time(NULL);
+    sample->rss = pages * page_kb;
+    sample->mem = (total_mem) ? sample->rss * 100.0 / total_mem : 0.0;
+
+    if (period > 0)
+        sample->cpu = (ticks - last_ticks) * 100.0 / clk_tck / period / num_procs;
+
+    // /proc is read without the lock, and only the readings are merged under it
+    static rs_thread_t threads[__RESOURCE_MGMT_MAX_THREADS];
+    int num = read_threads(threads);
+
+    pthread_spin_lock(&rs_lock);
+    if (num >= 0) monitor_threads(period, threads, num, sample);
+    pthread_spin_unlock(&rs_lock);
+
+    last_time = now;
+    last_ticks = ticks;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    rs_sample_cost = (end.tv_sec - now.tv_sec) * 1000000 + (end.tv_nsec - now.tv_nsec) / 1000;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to take a resource sample and notify it (periodic task)
+ * \param arg NULL
+ * \return 0 (every __RESOURCE_MGMT_MONITOR_TIME)
+ */
+static int resource_mgmt_monitor(void *arg)
+{
+    rs_sample_t sample;
+
+    if (monitor_resources(&sample)) {
+        LOG_ERROR(RSM_ID, "Failed to read /proc/self/stat");
+        return 0;
+    }
+
+    pthread_spin_lock(&rs_lock);
+    rs_history[rs_num_samples % __RESOURCE_MGMT_HISTORY] = sample;
+    rs_num_samples++;
+    pthread_spin_unlock(&rs_lock);
+
+    resource_t rs;
+
+    rs.cpu = sample.cpu;
+    rs.mem = sample.mem;
+
+    ev_rs_update_usage(RSM_ID, &rs);
+
+    // the database only keeps averages over longer periods
+    rs_sum.cpu += rs.cpu;
+    rs_sum.mem += rs.mem;
+
+    if (rs_num_samples % __RESOURCE_MGMT_DB_SAMPLES == 0) {
+        char values[__CONF_STR_LEN];
+        sprintf(values, "%lf, %lf", rs_sum.cpu / __RESOURCE_MGMT_DB_SAMPLES, rs_sum.mem / __RESOURCE_MGMT_DB_SAMPLES);
+
+        if (insert_data(&resource_mgmt_info, "resource_mgmt", "CPU, MEM", values)) {
+            LOG_ERROR(RSM_ID, "insert_data() failed");
+        }
+
+        memset(&rs_sum, 0, sizeof(resource_t));
+    }
 
     return 0;
 }
@@ -59,7 +327,13 @@ int resource_mgmt_main(int *activated, int argc, char **argv)
 {
     LOG_INFO(RSM_ID, "Init - Resource management");
 
-    int num_procs = get_nprocs();
+    num_procs = get_nprocs();
+    clk_tck = sysconf(_SC_CLK_TCK);
+    page_kb = sysconf(_SC_PAGESIZE) / 1024;
+
+    struct sysinfo info;
+    if (sysinfo(&info) == 0)
+        total_mem = (uint64_t)info.totalram * info.mem_unit / 1024;
 
     if (get_database_info(&resource_mgmt_info, "barista_mgmt")) {
         LOG_ERROR(RSM_ID, "Failed to get the information of a resource_mgmt database");
@@ -68,36 +342,30 @@ int resource_mgmt_main(int *activated, int argc, char **argv)
 
     reset_table(&resource_mgmt_info, "resource_mgmt", FALSE);
 
-    memset(&resource, 0, sizeof(resource_t));
-
-    activate();
-
-    while (*activated) {
-        int i;
-        for (i=0; i<__RESOURCE_MGMT_MONITOR_TIME; i++) {
-            if (*activated == FALSE) break;
-            else waitsec(1, 0);
-            monitor_resources(&resource);
-        }
-
-        resource_t rs;
+    rs_history = (rs_sample_t *)CALLOC(__RESOURCE_MGMT_HISTORY, sizeof(rs_sample_t));
+    if (rs_history == NULL) {
+        PERROR("calloc");
+        return -1;
+    }
 
-        rs.cpu = resource.cpu / num_procs;
-        rs.mem = resource.mem;
+    rs_num_samples = 0;
+    rs_num_threads = 0;
 
-        rs.cpu /= __RESOURCE_MGMT_MONITOR_TIME;
-        rs.mem /= __RESOURCE_MGMT_MONITOR_TIME;
+    pthread_spin_init(&rs_lock, PTHREAD_PROCESS_PRIVATE);
 
-        char values[__CONF_STR_LEN];
-        sprintf(values, "%lf, %lf", rs.cpu, rs.mem);
+    // the first sample only sets the baseline
+    rs_sample_t sample;
+    monitor_resources(&sample);
 
-        if (insert_data(&resource_mgmt_info, "resource_mgmt", "CPU, MEM", values)) {
-            LOG_ERROR(RSM_ID, "insert_data() failed");
-        }
+    memset(&rs_sum, 0, sizeof(resource_t));
 
-        ev_rs_update_usage(RSM_ID, &rs);
+    activate();
 
-        memset(&resource, 0, sizeof(resource_t));
+    rs_task = timer_task_add("resource_mgmt", __RESOURCE_MGMT_MONITOR_TIME * 1000,
+                             __RESOURCE_MGMT_MONITOR_TIME * 1000, resource_mgmt_monitor, NULL);
+    if (rs_task == NULL) {
+        LOG_ERROR(RSM_ID, "timer_task_add() failed");
+        return -1;
     }
 
     return 0;
@@ -113,6 +381,18 @@ int resource_mgmt_cleanup(int *activated)
 
     deactivate();
 
+    timer_task_cancel(rs_task);
+    rs_task = NULL;
+
+    pthread_spin_lock(&rs_lock);
+
+    FREE(rs_history);
+    rs_num_samples = 0;
+    rs_num_threads = 0;
+
+    pthread_spin_unlock(&rs_lock);
+    pthread_spin_destroy(&rs_lock);
+
     return 0;
 }
 
@@ -123,47 +403,118 @@ int resource_mgmt_cleanup(int *activated)
  */
 static int resource_stat_summary(cli_t *cli, char *seconds)
 {
-    database_t resource_mgmt_db;
-
-    int sec = atoi(seconds) / __RESOURCE_MGMT_MONITOR_TIME;
+    int num = atoi(seconds) / __RESOURCE_MGMT_MONITOR_TIME;
+    if (num <= 0) num = 1;
 
+    rs_sample_t sum = {0};
     int cnt = 0;
-    resource_t rs = {0.0, 0.0};
 
-    char query[__CONF_STR_LEN];
-    sprintf(query, "select CPU, MEM from resource_mgmt order by id desc limit %d", sec);
+    pthread_spin_lock(&rs_lock);
 
-    if (init_database(&resource_mgmt_info, &resource_mgmt_db)) {
-        cli_print(cli, "Failed to connect a resource_mgmt database");
-        destroy_database(&resource_mgmt_db);
-        return -1;
+    uint64_t avail = MIN(rs_num_samples, __RESOURCE_MGMT_HISTORY);
+    if (num > avail) num = avail;
+
+    int i;
+    for (i=0; i<num; i++) {
+        rs_sample_t *s = &rs_history[(rs_num_samples - 1 - i) % __RESOURCE_MGMT_HISTORY];
+
+        sum.cpu += s->cpu;
+        sum.mem += s->mem;
+        sum.rss += s->rss;
+        sum.vcsw += s->vcsw;
+        sum.nvcsw += s->nvcsw;
+
+        cnt++;
     }
 
-    if (execute_query(&resource_mgmt_db, query)) {
-        cli_print(cli, "Failed to read resource usages");
-        destroy_database(&resource_mgmt_db);
+    pthread_spin_unlock(&rs_lock);
+
+    if (cnt == 0) {
+        cli_print(cli, "No resource samples yet");
+        return 0;
+    }
+
+    cli_print(cli, "< Resource Usages for the last %d seconds >", cnt * __RESOURCE_MGMT_MONITOR_TIME);
+    cli_print(cli, "  CPU: %.2f %%, MEM: %.2f %% (RSS: %lu KB)", sum.cpu / cnt, sum.mem / cnt, sum.rss / cnt);
+    cli_print(cli, "  Context switches: %lu voluntary, %lu involuntary", sum.vcsw, sum.nvcsw);
+    cli_print(cli, "  Sampling cost: %lu usec", rs_sample_cost);
+
+    return 0;
+}
+
+/**
+ * \brief Function to print the per-thread resource usages
+ * \param cli The pointer of the Barista CLI
+ */
+static int resource_thread_summary(cli_t *cli)
+{
+    rs_thread_t *threads = (rs_thread_t *)MALLOC(sizeof(rs_thread_t) * __RESOURCE_MGMT_MAX_THREADS);
+    if (threads == NULL) {
+        PERROR("malloc");
         return -1;
     }
 
-    query_result_t *result = get_query_result(&resource_mgmt_db);
-    query_row_t row;
+    pthread_spin_lock(&rs_lock);
 
-    while ((row = fetch_query_row(result)) != NULL) {
-        rs.cpu += atof(row[0]);
-        rs.mem += atof(row[1]);
+    int num = rs_num_threads;
+    memcpy(threads, rs_threads, sizeof(rs_thread_t) * num);
 
-        cnt++;
+    pthread_spin_unlock(&rs_lock);
+
+    cli_print(cli, "< Thread Resource Usages (last %d seconds) >", __RESOURCE_MGMT_MONITOR_TIME);
+    cli_print(cli, "  %8s %-16s %-16s %8s %10s %10s", "TID", "Name", "Component", "CPU(%)", "VCSW", "NVCSW");
+
+    int i;
+    for (i=0; i<num; i++) {
+        rs_thread_t *th = &threads[i];
+        const char *owner = component_thread_owner(th->tid);
+
+        cli_print(cli, "  %8d %-16s %-16s %8.2f %10lu %10lu",
+                  th->tid, th->comm, (owner) ? owner : "-", th->cpu, th->d_vcsw, th->d_nvcsw);
+    }
+
+    FREE(threads);
+
+    return 0;
+}
+
+/**
+ * \brief Function to print the latest resource samples
+ * \param cli The pointer of the Barista CLI
+ * \param samples The number of samples
+ */
+static int resource_history(cli_t *cli, char *samples)
+{
+    int num = atoi(samples);
+
+    rs_sample_t *history = (rs_sample_t *)MALLOC(sizeof(rs_sample_t) * __RESOURCE_MGMT_HISTORY);
+    if (history == NULL) {
+        PERROR("malloc");
+        return -1;
     }
 
-    release_query_result(result);
+    pthread_spin_lock(&rs_lock);
+
+    uint64_t avail = MIN(rs_num_samples, __RESOURCE_MGMT_HISTORY);
+    if (num <= 0 || num > avail) num = avail;
+
+    // the oldest one first
+    int i;
+    for (i=0; i<num; i++)
+        history[i] = rs_history[(rs_num_samples - num + i) % __RESOURCE_MGMT_HISTORY];
 
-    destroy_database(&resource_mgmt_db);
+    pthread_spin_unlock(&rs_lock);
 
-    rs.cpu /= cnt;
-    rs.mem /= cnt;
+    cli_print(cli, "< Resource Samples >");
 
-    cli_print(cli, "< Resource Usages for the last %d seconds >", sec * __RESOURCE_MGMT_MONITOR_TIME);
-    cli_print(cli, "  CPU: %.2f %%, MEM: %.2f %%", rs.cpu, rs.mem);
+    for (i=0; i<num; i++) {
+        rs_sample_t *s = &history[i];
+
+        cli_print(cli, "  %ld: CPU %.2f %%, MEM %.2f %% (%lu KB), threads %d, csw %lu/%lu",
+                  (long)s->time, s->cpu, s->mem, s->rss, s->num_threads, s->vcsw, s->nvcsw);
+    }
+
+    FREE(history);
 
     return 0;
 }
@@ -178,10 +529,18 @@ int resource_mgmt_cli(cli_t *cli, char **args)
     if (args[0] != NULL && strcmp(args[0], "stat") == 0 && args[1] != NULL && args[2] == NULL) {
         resource_stat_summary(cli, args[1]);
         return 0;
+    } else if (args[0] != NULL && strcmp(args[0], "threads") == 0 && args[1] == NULL) {
+        resource_thread_summary(cli);
+        return 0;
+    } else if (args[0] != NULL && strcmp(args[0], "history") == 0 && args[1] != NULL && args[2] == NULL) {
+        resource_history(cli, args[1]);
+        return 0;
     }
 
     cli_print(cli, "< Available Commands >");
     cli_print(cli, "  resource_mgmt stat [N second(s)]");
+    cli_print(cli, "  resource_mgmt threads");
+    cli_print(cli, "  resource_mgmt history [N sample(s)]");
 
     return 0;
 }
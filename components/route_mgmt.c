@@ -0,0 +1,871 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \ingroup compnt
+ * @{
+ * \defgroup route_mgmt Route Management
+ * \brief (Management) shortest-path and multipath route computation
+ * @{
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#include "route_mgmt.h"
+
+/** \brief Route management ID */
+#define ROUTE_MGMT_ID 2184018526
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The number of incremental updates (no recomputation) */
+static uint64_t route_num_updates;
+
+/** \brief The number of recomputed destinations */
+static uint64_t route_num_recomputed;
+
+/** \brief The number of recomputed broadcast trees */
+static uint64_t route_num_trees;
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to get a routing snapshot for reading
+ * \return The published snapshot (release it with route_release)
+ */
+static route_snap_t *route_acquire(void)
+{
+    while (1) {
+        route_snap_t *snap = __atomic_load_n(&route_curr, __ATOMIC_SEQ_CST);
+
+        __sync_fetch_and_add(&snap->readers, 1);
+
+        // the writer may have replaced the snapshot in the meantime
+        if (snap == __atomic_load_n(&route_curr, __ATOMIC_SEQ_CST))
+            return snap;
+
+        __sync_fetch_and_sub(&snap->readers, 1);
+    }
+}
+
+/**
+ * \brief Function to release a routing snapshot
+ * \param snap Snapshot
+ */
+static void route_release(route_snap_t *snap)
+{
+    __sync_fetch_and_sub(&snap->readers, 1);
+}
+
+/**
+ * \brief Function to get a copy of the published snapshot to update (with route_lock)
+ * \return The snapshot to update (publish it with route_publish)
+ */
+static route_snap_t *route_begin(void)
+{
+    route_snap_t *curr = route_curr;
+    route_snap_t *next = (curr == &route_snap[0]) ? &route_snap[1] : &route_snap[0];
+
+    // wait for the readers of the previous snapshot
+    while (__atomic_load_n(&next->readers, __ATOMIC_SEQ_CST))
+        waitsec(0, 1000);
+
+    memcpy(&next->dpid, &curr->dpid, sizeof(route_snap_t) - offsetof(route_snap_t, dpid));
+
+    return next;
+}
+
+/**
+ * \brief Function to publish an updated snapshot (with route_lock)
+ * \param next The updated snapshot
+ */
+static void route_publish(route_snap_t *next)
+{
+    next->version++;
+
+    __atomic_store_n(&route_curr, next, __ATOMIC_SEQ_CST);
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to find a node in a snapshot
+ * \param snap Snapshot
+ * \param dpid Datapath ID
+ * \return The index of the node (-1: not found)
+ */
+static int node_find(const route_snap_t *snap, uint64_t dpid)
+{
+    if (dpid == 0 || dpid == ROUTE_NODE_DELETED) return -1;
+
+    int idx = dpid % __MAX_NUM_SWITCHES;
+    do {
+        if (snap->dpid[idx] == dpid) return idx;
+        else if (snap->dpid[idx] == 0) return -1;
+
+        idx = (idx + 1) % __MAX_NUM_SWITCHES;
+    } while (idx != dpid % __MAX_NUM_SWITCHES);
+
+    return -1;
+}
+
+/**
+ * \brief Function to find or add a node in a snapshot
+ * \param snap Snapshot
+ * \param dpid Datapath ID
+ * \return The index of the node (-1: no space)
+ */
+static int node_get(route_snap_t *snap, uint64_t dpid)
+{
+    int idx = node_find(snap, dpid);
+    if (idx >= 0 || dpid == 0 || dpid == ROUTE_NODE_DELETED) return idx;
+
+    idx = dpid % __MAX_NUM_SWITCHES;
+    do {
+        if (snap->dpid[idx] == 0 || snap->dpid[idx] == ROUTE_NODE_DELETED) {
+            snap->dpid[idx] = dpid;
+            snap->dist[idx][idx] = 0;
+
+            snap->ports[idx] = 0;
+            snap->blocked[idx] = 0;
+            snap->root[idx] = idx + 1;
+            snap->parent[idx] = 0;
+
+            return idx;
+        }
+
+        idx = (idx + 1) % __MAX_NUM_SWITCHES;
+    } while (idx != dpid % __MAX_NUM_SWITCHES);
+
+    return -1;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to recompute the distances toward a destination (reverse BFS)
+ * \param snap Snapshot
+ * \param d The index of the destination
+ */
+static void recompute_dst(route_snap_t *snap, int d)
+{
+    uint16_t queue[__MAX_NUM_SWITCHES];
+    int head = 0, tail = 0;
+
+    int x;
+    for (x=0; x<__MAX_NUM_SWITCHES; x++)
+        snap->dist[x][d] = ROUTE_UNREACHABLE;
+
+    snap->dist[d][d] = 0;
+    queue[tail++] = d;
+
+    while (head < tail) {
+        int y = queue[head++];
+
+        for (x=0; x<__MAX_NUM_SWITCHES; x++) {
+            if (snap->port[x][y] && snap->dist[x][d] == ROUTE_UNREACHABLE) {
+                snap->dist[x][d] = snap->dist[y][d] + 1;
+                queue[tail++] = x;
+            }
+        }
+    }
+
+    route_num_recomputed++;
+}
+
+/**
+ * \brief Function to add a link to a snapshot
+ * \param snap Snapshot
+ * \param u The index of the source node
+ * \param p The port of the source node
+ * \param v The index of the destination node
+ */
+static int link_add(route_snap_t *snap, int u, uint32_t p, int v)
+{
+    route_links_t *links = &route_links[u];
+
+    if (u == v) return 0;
+    else if (links->peer[p] == v + 1) return 0;
+    else if (links->peer[p]) return -1; // the port is still used by another link
+
+    links->peer[p] = v + 1;
+
+    snap->ports[u] |= PORT_BIT(p);
+
+    // parallel link
+    if (snap->port[u][v]) return 0;
+
+    snap->port[u][v] = p;
+    snap->nbr[u][snap->num_nbrs[u]++] = v;
+
+    // relax every pair through the new link (s -> u -> v -> d)
+    int s, d;
+    for (s=0; s<__MAX_NUM_SWITCHES; s++) {
+        uint32_t su = snap->dist[s][u];
+        if (su == ROUTE_UNREACHABLE) continue;
+
+        for (d=0; d<__MAX_NUM_SWITCHES; d++) {
+            uint32_t vd = snap->dist[v][d];
+            if (vd == ROUTE_UNREACHABLE) continue;
+
+            if (su + 1 + vd < snap->dist[s][d])
+                snap->dist[s][d] = su + 1 + vd;
+        }
+    }
+
+    route_num_updates++;
+
+    return 0;
+}
+
+/**
+ * \brief Function to delete a link from a snapshot
+ * \param snap Snapshot
+ * \param u The index of the source node
+ * \param p The port of the source node
+ * \param v The index of the destination node
+ */
+static int link_delete(route_snap_t *snap, int u, uint32_t p, int v)
+{
+    route_links_t *links = &route_links[u];
+
+    if (links->peer[p] != v + 1) return -1;
+
+    links->peer[p] = 0;
+
+    if (snap->port[u][v] != p) return 0;
+
+    // switch over to a parallel link if any
+    int q;
+    for (q=1; q<=__MAX_NUM_PORTS; q++) {
+        if (links->peer[q] == v + 1) {
+            snap->port[u][v] = q;
+            return 0;
+        }
+    }
+
+    snap->port[u][v] = 0;
+
+    int i;
+    for (i=0; i<snap->num_nbrs[u]; i++) {
+        if (snap->nbr[u][i] == v) {
+            snap->nbr[u][i] = snap->nbr[u][--snap->num_nbrs[u]];
+            break;
+        }
+    }
+
+    // only the destinations whose every shortest path from u used the link
+    int d;
+    for (d=0; d<__MAX_NUM_SWITCHES; d++) {
+        uint16_t ud = snap->dist[u][d];
+
+        if (ud == ROUTE_UNREACHABLE || snap->dist[v][d] + 1 != ud) continue;
+
+        int alive = FALSE;
+        for (i=0; i<snap->num_nbrs[u]; i++) {
+            if (snap->dist[snap->nbr[u][i]][d] + 1 == ud) {
+                alive = TRUE;
+                break;
+            }
+        }
+
+        if (!alive) recompute_dst(snap, d);
+    }
+
+    route_num_updates++;
+
+    return 0;
+}
+
+/**
+ * \brief Function to delete a node and its links from a snapshot
+ * \param snap Snapshot
+ * \param n The index of the node
+ */
+static int node_delete(route_snap_t *snap, int n)
+{
+    uint32_t p;
+    for (p=1; p<=__MAX_NUM_PORTS; p++) {
+        if (route_links[n].peer[p])
+            link_delete(snap, n, p, route_links[n].peer[p] - 1);
+    }
+
+    int x;
+    for (x=0; x<__MAX_NUM_SWITCHES; x++) {
+        if (snap->port[x][n] == 0) continue;
+
+        for (p=1; p<=__MAX_NUM_PORTS; p++) {
+            if (route_links[x].peer[p] == n + 1)
+                link_delete(snap, x, p, n);
+        }
+    }
+
+    for (x=0; x<__MAX_NUM_SWITCHES; x++) {
+        snap->dist[x][n] = ROUTE_UNREACHABLE;
+        snap->dist[n][x] = ROUTE_UNREACHABLE;
+    }
+
+    snap->dpid[n] = ROUTE_NODE_DELETED;
+
+    snap->ports[n] = 0;
+    snap->blocked[n] = 0;
+    snap->root[n] = 0;
+    snap->parent[n] = 0;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to block the links of a node that are off the broadcast tree
+ * \param snap Snapshot
+ * \param u The index of the node
+ */
+static void tree_block(route_snap_t *snap, int u)
+{
+    uint64_t blocked = 0;
+
+    uint32_t p;
+    for (p=1; p<=__MAX_NUM_PORTS; p++) {
+        if (route_links[u].peer[p] == 0) continue;
+
+        int v = route_links[u].peer[p] - 1;
+
+        // only one port per tree edge, and only if the link works in both directions
+        if (p == snap->port[u][v] && snap->port[v][u] &&
+            (snap->parent[u] == v + 1 || snap->parent[v] == u + 1))
+            continue;
+
+        blocked |= PORT_BIT(p);
+    }
+
+    snap->blocked[u] = blocked;
+}
+
+/**
+ * \brief Function to recompute the broadcast trees (BFS from the smallest datapath ID of each partition)
+ * \param snap Snapshot
+ */
+static void tree_compute(route_snap_t *snap)
+{
+    uint16_t queue[__MAX_NUM_SWITCHES];
+
+    memset(snap->root, 0, sizeof(snap->root));
+    memset(snap->parent, 0, sizeof(snap->parent));
+
+    while (1) {
+        int x, r = -1;
+        for (x=0; x<__MAX_NUM_SWITCHES; x++) {
+            if (snap->dpid[x] == 0 || snap->dpid[x] == ROUTE_NODE_DELETED || snap->root[x]) continue;
+            else if (r < 0 || snap->dpid[x] < snap->dpid[r]) r = x;
+        }
+
+        if (r < 0) break;
+
+        int head = 0, tail = 0;
+
+        snap->root[r] = r + 1;
+        queue[tail++] = r;
+
+        while (head < tail) {
+            int y = queue[head++];
+
+            for (x=0; x<__MAX_NUM_SWITCHES; x++) {
+                if (snap->root[x] || !snap->port[y][x] || !snap->port[x][y]) continue;
+
+                snap->root[x] = r + 1;
+                snap->parent[x] = y + 1;
+                queue[tail++] = x;
+            }
+        }
+    }
+
+    int u;
+    for (u=0; u<__MAX_NUM_SWITCHES; u++) {
+        if (snap->root[u]) tree_block(snap, u);
+    }
+
+    route_num_trees++;
+}
+
+/**
+ * \brief Function to update the broadcast trees after the links between two nodes changed
+ * \param snap Snapshot
+ * \param u The index of a node
+ * \param v The index of the other node
+ */
+static void tree_update(route_snap_t *snap, int u, int v)
+{
+    int linked = (snap->port[u][v] && snap->port[v][u]);
+    int tree_edge = (snap->parent[u] == v + 1 || snap->parent[v] == u + 1);
+
+    if (linked && !tree_edge && snap->root[u] != snap->root[v]) { // two trees are joined
+        tree_compute(snap);
+    } else if (!linked && tree_edge) { // a tree is split
+        tree_compute(snap);
+    } else { // only the ports of the two nodes
+        tree_block(snap, u);
+        tree_block(snap, v);
+    }
+}
+
+/**
+ * \brief Function to get the ports to flood a packet along the broadcast tree
+ * \param snap Snapshot
+ * \param tree Tree ports (dpid, in_port)
+ */
+static int tree_lookup(const route_snap_t *snap, tree_t *tree)
+{
+    tree->root = 0;
+    tree->num_ports = 0;
+
+    int u = node_find(snap, tree->dpid);
+    if (u < 0) return -1;
+
+    tree->root = snap->dpid[snap->root[u] - 1];
+
+    uint64_t ports = snap->ports[u] & ~snap->blocked[u];
+
+    if (tree->in_port && tree->in_port <= __MAX_NUM_PORTS)
+        ports &= ~PORT_BIT(tree->in_port);
+
+    while (ports) {
+        int bit = __builtin_ctzll(ports);
+
+        tree->port[tree->num_ports++] = bit + 1;
+
+        ports &= ports - 1;
+    }
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to fill a route using a snapshot
+ * \param snap Snapshot
+ * \param route Route (src, dst, hash)
+ */
+static int route_lookup(const route_snap_t *snap, route_t *route)
+{
+    route->dist = ROUTE_UNREACHABLE;
+    route->num_ports = 0;
+    route->num_hops = 0;
+
+    int s = node_find(snap, route->src);
+    int d = node_find(snap, route->dst);
+
+    if (s < 0 || d < 0) return -1;
+    else if (snap->dist[s][d] == ROUTE_UNREACHABLE) return -1;
+
+    route->dist = snap->dist[s][d];
+
+    int curr = s, k = 0;
+    while (curr != d && route->num_hops < __MAX_ROUTE_HOPS) {
+        uint16_t cand[__MAX_NUM_PORTS];
+        int i, cnt = 0;
+
+        // equal-cost next hops
+        for (i=0; i<snap->num_nbrs[curr]; i++) {
+            int w = snap->nbr[curr][i];
+            if (snap->dist[w][d] + 1 == snap->dist[curr][d])
+                cand[cnt++] = w;
+        }
+
+        if (cnt == 0) break;
+
+        if (curr == s) {
+            for (i=0; i<cnt && i<__MAX_ROUTE_PORTS; i++)
+                route->port[i] = snap->port[s][cand[i]];
+            route->num_ports = i;
+        }
+
+        int next = cand[(route->hash ^ (k++ * 2654435761u)) % cnt];
+
+        route->hop[route->num_hops].dpid = snap->dpid[curr];
+        route->hop[route->num_hops].port = snap->port[curr][next];
+        route->num_hops++;
+
+        curr = next;
+    }
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief The main function
+ * \param activated The activation flag of this component
+ * \param argc The number of arguments
+ * \param argv Arguments
+ */
+int route_mgmt_main(int *activated, int argc, char **argv)
+{
+    LOG_INFO(ROUTE_MGMT_ID, "Init - Route management");
+
+    route_snap = (route_snap_t *)CALLOC(2, sizeof(route_snap_t));
+    if (route_snap == NULL) {
+        LOG_ERROR(ROUTE_MGMT_ID, "calloc() failed");
+        return -1;
+    }
+
+    route_links = (route_links_t *)CALLOC(__MAX_NUM_SWITCHES, sizeof(route_links_t));
+    if (route_links == NULL) {
+        LOG_ERROR(ROUTE_MGMT_ID, "calloc() failed");
+        FREE(route_snap);
+        return -1;
+    }
+
+    memset(route_snap[0].dist, 0xff, sizeof(route_snap[0].dist));
+    route_curr = &route_snap[0];
+
+    route_num_updates = 0;
+    route_num_recomputed = 0;
+    route_num_trees = 0;
+
+    pthread_mutex_init(&route_lock, NULL);
+
+    activate();
+
+    return 0;
+}
+
+/**
+ * \brief The cleanup function
+ * \param activated The activation flag of this component
+ */
+int route_mgmt_cleanup(int *activated)
+{
+    LOG_INFO(ROUTE_MGMT_ID, "Clean up - Route management");
+
+    deactivate();
+
+    pthread_mutex_lock(&route_lock);
+
+    int i;
+    for (i=0; i<2; i++) {
+        while (route_snap[i].readers)
+            waitsec(0, 1000);
+    }
+
+    FREE(route_links);
+    FREE(route_snap);
+
+    pthread_mutex_unlock(&route_lock);
+    pthread_mutex_destroy(&route_lock);
+
+    return 0;
+}
+
+/**
+ * \brief Function to print the routing graph
+ * \param cli The pointer of the Barista CLI
+ */
+static int route_show(cli_t *cli)
+{
+    route_snap_t *snap = route_acquire();
+
+    int num_nodes = 0, num_links = 0;
+
+    cli_print(cli, "< Routing Graph (version %lu) >", snap->version);
+
+    int i, j;
+    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+        if (snap->dpid[i] == 0 || snap->dpid[i] == ROUTE_NODE_DELETED) continue;
+
+        num_nodes++;
+
+        for (j=0; j<snap->num_nbrs[i]; j++) {
+            int w = snap->nbr[i][j];
+
+            cli_print(cli, "  Link #%d: {(%lu, %u) -> %lu}", ++num_links, snap->dpid[i], snap->port[i][w], snap->dpid[w]);
+        }
+    }
+
+    cli_print(cli, "  Switches: %d, Links: %d", num_nodes, num_links);
+    cli_print(cli, "  Incremental updates: %lu, Recomputed destinations: %lu", route_num_updates, route_num_recomputed);
+    cli_print(cli, "  Recomputed broadcast trees: %lu", route_num_trees);
+
+    route_release(snap);
+
+    return 0;
+}
+
+/**
+ * \brief Function to print a route between two switches
+ * \param cli The pointer of the Barista CLI
+ * \param src Source datapath ID
+ * \param dst Destination datapath ID
+ * \param hash Flow hash
+ */
+static int route_path(cli_t *cli, const char *src, const char *dst, const char *hash)
+{
+    route_t route = {0};
+
+    route.src = strtoull(src, NULL, 0);
+    route.dst = strtoull(dst, NULL, 0);
+    route.hash = (hash != NULL) ? strtoul(hash, NULL, 0) : 0;
+
+    route_snap_t *snap = route_acquire();
+    route_lookup(snap, &route);
+    route_release(snap);
+
+    cli_print(cli, "< Route [%lu -> %lu] >", route.src, route.dst);
+
+    if (route.dist == ROUTE_UNREACHABLE) {
+        cli_print(cli, "  Unreachable");
+        return 0;
+    }
+
+    cli_print(cli, "  Distance: %u", route.dist);
+
+    char ports[__CONF_STR_LEN] = {0};
+    int i, len = 0;
+    for (i=0; i<route.num_ports; i++)
+        len += snprintf(ports + len, __CONF_STR_LEN - len, "%s%u", (i) ? ", " : "", route.port[i]);
+
+    cli_print(cli, "  Equal-cost ports: %s", (route.num_ports) ? ports : "-");
+
+    for (i=0; i<route.num_hops; i++)
+        cli_print(cli, "  Hop #%d: (%lu, %u)", i+1, route.hop[i].dpid, route.hop[i].port);
+
+    return 0;
+}
+
+/**
+ * \brief Function to print the broadcast trees
+ * \param cli The pointer of the Barista CLI
+ */
+static int route_tree(cli_t *cli)
+{
+    route_snap_t *snap = route_acquire();
+
+    cli_print(cli, "< Broadcast Trees >");
+
+    int i, cnt = 0;
+    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+        if (snap->dpid[i] == 0 || snap->dpid[i] == ROUTE_NODE_DELETED) continue;
+
+        char blocked[__CONF_STR_LEN] = {0};
+        int len = 0;
+
+        uint64_t ports = snap->blocked[i];
+        while (ports) {
+            len += snprintf(blocked + len, __CONF_STR_LEN - len, "%s%d", (len) ? ", " : "", __builtin_ctzll(ports) + 1);
+            ports &= ports - 1;
+        }
+
+        cli_print(cli, "  Switch #%d: %lu, root: %lu, parent: %lu, blocked ports: %s", ++cnt, snap->dpid[i],
+                  snap->dpid[snap->root[i] - 1], (snap->parent[i]) ? snap->dpid[snap->parent[i] - 1] : 0,
+                  (len) ? blocked : "-");
+    }
+
+    if (!cnt)
+        cli_print(cli, "  No switch");
+
+    route_release(snap);
+
+    return 0;
+}
+
+/**
+ * \brief The CLI function
+ * \param cli The pointer of the Barista CLI
+ * \param args Arguments
+ */
+int route_mgmt_cli(cli_t *cli, char **args)
+{
+    if (args[0] != NULL && strcmp(args[0], "show") == 0 && args[1] == NULL) {
+        route_show(cli);
+        return 0;
+    } else if (args[0] != NULL && strcmp(args[0], "path") == 0 && args[1] != NULL && args[2] != NULL) {
+        route_path(cli, args[1], args[2], args[3]);
+        return 0;
+    } else if (args[0] != NULL && strcmp(args[0], "tree") == 0 && args[1] == NULL) {
+        route_tree(cli);
+        return 0;
+    }
+
+    cli_print(cli, "< Available Commands >");
+    cli_print(cli, "  route_mgmt show");
+    cli_print(cli, "  route_mgmt path [source datapath ID] [destination datapath ID] [flow hash]");
+    cli_print(cli, "  route_mgmt tree");
+
+    return 0;
+}
+
+/**
+ * \brief The handler function
+ * \param ev Read-only event
+ * \param ev_out Read-write event (if this component has the write permission)
+ */
+int route_mgmt_handler(const event_t *ev, event_out_t *ev_out)
+{
+    switch (ev->type) {
+    case EV_RT_GET_ROUTE:
+        PRINT_EV("EV_RT_GET_ROUTE\n");
+        {
+            route_t *route = ev_out->route_data;
+
+            route_snap_t *snap = route_acquire();
+            route_lookup(snap, route);
+            route_release(snap);
+        }
+        break;
+    case EV_RT_GET_TREE:
+        PRINT_EV("EV_RT_GET_TREE\n");
+        {
+            tree_t *tree = ev_out->tree_data;
+
+            route_snap_t *snap = route_acquire();
+            tree_lookup(snap, tree);
+            route_release(snap);
+        }
+        break;
+    case EV_DP_PORT_ADDED:
+        PRINT_EV("EV_DP_PORT_ADDED\n");
+        {
+            const port_t *port = ev->port;
+
+            if (port->port == 0 || port->port > __MAX_NUM_PORTS) break;
+
+            pthread_mutex_lock(&route_lock);
+
+            int u = node_find(route_curr, port->dpid);
+            if (u >= 0 && (route_curr->ports[u] & PORT_BIT(port->port))) {
+                pthread_mutex_unlock(&route_lock);
+                break;
+            }
+
+            route_snap_t *snap = route_begin();
+
+            u = node_get(snap, port->dpid);
+            if (u >= 0) {
+                snap->ports[u] |= PORT_BIT(port->port);
+                route_publish(snap);
+            }
+
+            pthread_mutex_unlock(&route_lock);
+        }
+        break;
+    case EV_DP_PORT_DELETED:
+        PRINT_EV("EV_DP_PORT_DELETED\n");
+        {
+            const port_t *port = ev->port;
+
+            if (port->port == 0 || port->port > __MAX_NUM_PORTS) break;
+
+            pthread_mutex_lock(&route_lock);
+
+            int u = node_find(route_curr, port->dpid);
+            if (u < 0 || !(route_curr->ports[u] & PORT_BIT(port->port))) {
+                pthread_mutex_unlock(&route_lock);
+                break;
+            }
+
+            route_snap_t *snap = route_begin();
+
+            snap->ports[u] &= ~PORT_BIT(port->port);
+
+            route_publish(snap);
+
+            pthread_mutex_unlock(&route_lock);
+        }
+        break;
+    case EV_LINK_ADDED:
+        PRINT_EV("EV_LINK_ADDED\n");
+        {
+            const port_t *link = ev->port;
+
+            if (link->port == 0 || link->port > __MAX_NUM_PORTS) break;
+
+            pthread_mutex_lock(&route_lock);
+
+            route_snap_t *snap = route_begin();
+
+            int u = node_get(snap, link->dpid);
+            int v = node_get(snap, link->link.dpid);
+
+            if (u < 0 || v < 0) {
+                pthread_mutex_unlock(&route_lock);
+                LOG_WARN(ROUTE_MGMT_ID, "No space for switches (%lu, %lu)", link->dpid, link->link.dpid);
+                break;
+            }
+
+            link_add(snap, u, link->port, v);
+            tree_update(snap, u, v);
+
+            route_publish(snap);
+
+            pthread_mutex_unlock(&route_lock);
+        }
+        break;
+    case EV_LINK_DELETED:
+        PRINT_EV("EV_LINK_DELETED\n");
+        {
+            const port_t *link = ev->port;
+
+            if (link->port == 0 || link->port > __MAX_NUM_PORTS) break;
+
+            pthread_mutex_lock(&route_lock);
+
+            int u = node_find(route_curr, link->dpid);
+            int v = node_find(route_curr, link->link.dpid);
+
+            if (u < 0 || v < 0 || route_links[u].peer[link->port] != v + 1) {
+                pthread_mutex_unlock(&route_lock);
+                break;
+            }
+
+            route_snap_t *snap = route_begin();
+
+            link_delete(snap, u, link->port, v);
+            tree_update(snap, u, v);
+
+            route_publish(snap);
+
+            pthread_mutex_unlock(&route_lock);
+        }
+        break;
+    case EV_SW_DISCONNECTED:
+        PRINT_EV("EV_SW_DISCONNECTED\n");
+        {
+            const switch_t *sw = ev->sw;
+
+            pthread_mutex_lock(&route_lock);
+
+            int n = node_find(route_curr, sw->dpid);
+            if (n < 0) {
+                pthread_mutex_unlock(&route_lock);
+                break;
+            }
+
+            route_snap_t *snap = route_begin();
+
+            node_delete(snap, n);
+            tree_compute(snap);
+
+            route_publish(snap);
+
+            pthread_mutex_unlock(&route_lock);
+        }
+        break;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+/**
+ * @}
+ *
+ * @}
+ */
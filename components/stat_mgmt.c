@@ -55,6 +55,33 @@ static int port_stats_request(uint64_t dpid)
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to request the statistics of all switches (periodic task)
+ * \param arg NULL
+ * \return 0 (every __STAT_MGMT_REQUEST_TIME)
+ */
+static int stat_mgmt_request(void *arg)
+{
+    pthread_rwlock_rdlock(&stat_lock);
+
+    int i;
+    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+        if (switch_list[i]) {
+            // aggregate stats
+            aggregate_stats_request(switch_list[i]);
+
+            // port stats
+            port_stats_request(switch_list[i]);
+        }
+    }
+
+    pthread_rwlock_unlock(&stat_lock);
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief The main function
  * \param activated The activation flag of this component
@@ -75,26 +102,11 @@ int stat_mgmt_main(int *activated, int argc, char **argv)
 
     activate();
 
-    while (*activated) {
-        pthread_rwlock_rdlock(&stat_lock);
-
-        int i;
-        for (i=0; i<__MAX_NUM_SWITCHES; i++) {
-            if (switch_list[i]) {
-                // aggregate stats
-                aggregate_stats_request(switch_list[i]);
-
-                // port stats
-                port_stats_request(switch_list[i]);
-            }
-        }
-
-        pthread_rwlock_unlock(&stat_lock);
-
-        for (i=0; i<__STAT_MGMT_REQUEST_TIME; i++) {
-            if (*activated == FALSE) break;
-            else waitsec(1, 0);
-        }
+    // the requests are sent by the shared timer workers from now on
+    stat_task = timer_task_add("stat_mgmt", __STAT_MGMT_REQUEST_TIME * 1000, 0, stat_mgmt_request, NULL);
+    if (stat_task == NULL) {
+        LOG_ERROR(STAT_MGMT_ID, "timer_task_add() failed");
+        return -1;
     }
 
     return 0;
@@ -110,6 +122,9 @@ int stat_mgmt_cleanup(int *activated)
 
     deactivate();
 
+    timer_task_cancel(stat_task);
+    stat_task = NULL;
+
     pthread_rwlock_destroy(&stat_lock);
     FREE(switch_list);
 
@@ -45,6 +45,8 @@ int switch_mgmt_main(int *activated, int argc, char **argv)
         return -1;
     }
 
+    cpu_place_memory(switch_table, __MAX_NUM_SWITCHES * sizeof(switch_t));
+
     int i;
     for (i=0; i<__MAX_NUM_SWITCHES; i++) {
         pthread_spin_init(&sw_lock[i], PTHREAD_PROCESS_PRIVATE);
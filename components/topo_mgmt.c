@@ -23,21 +23,35 @@
 
 /////////////////////////////////////////////////////////////////////
 
+/** \brief The pre-built pktout message for LLDP packets */
+static pktout_t lldp_pktout;
+
+/** \brief The periodic task to discover links */
+static timer_task_t *topo_task;
+
+/** \brief The next port to probe in the current round (switch * __MAX_NUM_PORTS + port) */
+static int topo_cursor;
+
+/** \brief The number of LLDP packets sent in a burst in the current round */
+static int topo_burst;
+
+/** \brief The time (ms) between two bursts in the current round */
+static int topo_gap;
+
 /**
- * \brief Function to send a LLDP packet using a pktout message
- * \param port Port
+ * \brief Function to build the LLDP packet shared by all ports
+ * \param pktout The pktout message to fill (datapath IDs and ports are patched on sending)
  */
-static int send_lldp(port_t *port)
+static int build_lldp(pktout_t *pktout)
 {
-    pktout_t pktout = {0};
+    memset(pktout, 0, sizeof(pktout_t));
 
-    pktout.dpid = port->dpid;
-    pktout.port = -1;
+    pktout->port = -1;
 
-    pktout.xid = 0;
-    pktout.buffer_id = -1;
+    pktout->xid = 0;
+    pktout->buffer_id = -1;
 
-    pktout.total_len = 46;
+    pktout->total_len = LLDP_PKT_LEN;
 
     // LLDP
     lldp_chassis_id *chassis;  // mandatory
@@ -47,16 +61,9 @@ static int send_lldp(port_t *port)
     lldp_eol *eol;             // mandatory
 
     uint8_t multi[] = {0x01, 0x80, 0xc2, 0x00, 0x00, 0x0e};
-    uint8_t mac[ETH_ALEN] = { *((uint8_t *)&port->dpid + 5),
-                              *((uint8_t *)&port->dpid + 4),
-                              *((uint8_t *)&port->dpid + 3),
-                              *((uint8_t *)&port->dpid + 2),
-                              *((uint8_t *)&port->dpid + 1),
-                              *((uint8_t *)&port->dpid + 0) };
 
-    struct ether_header *eth_header = (struct ether_header *)pktout.data; // 14
+    struct ether_header *eth_header = (struct ether_header *)pktout->data; // 14
 
-    memmove(eth_header->ether_shost, mac, ETH_ALEN);
     memmove(eth_header->ether_dhost, multi, ETH_ALEN);
 
     eth_header->ether_type = htons(ETHERTYPE_LLDP); // 32
@@ -67,17 +74,12 @@ static int send_lldp(port_t *port)
     chassis->hdr.length = 7;
     chassis->subtype = LLDP_CHASSISID_SUBTYPE_MACADDR;
 
-    memmove(chassis->data, &port->info.hw_addr, ETH_ALEN);
-
     // lldp_port_id tlv
     portid = (lldp_port_id *)((uint8_t *)chassis + chassis->hdr.length + 2);
     portid->hdr.type = LLDP_TLVT_PORTID;
     portid->hdr.length = 5;
     portid->subtype = LLDP_PORTID_SUBTYPE_COMPONENT;
 
-    uint32_t port_data = htonl(port->port);
-    memmove(portid->data, &port_data, 4);
-
     // lldp_time_to_live tlv
     ttl = (lldp_ttl *)((uint8_t *)portid + portid->hdr.length + 2);
     ttl->hdr.type = LLDP_TLVT_TTL;
@@ -89,9 +91,6 @@ static int send_lldp(port_t *port)
     desc->hdr.type = LLDP_TLVT_SYSTEM_DESC;
     desc->hdr.length = 8;
 
-    uint64_t net_dpid = htonll(port->dpid);
-    memmove(desc->data, &net_dpid, 8);
-
     // lldp_end_of_lldpdu tlv
     eol = (lldp_eol *)((uint8_t *)desc + desc->hdr.length + 2);
     eol->hdr.type = LLDP_TLVT_EOL;
@@ -105,11 +104,35 @@ static int send_lldp(port_t *port)
     eol->hdr.raw = htons(eol->hdr.raw);
 
     // output
-    pktout.num_actions = 1;
-    pktout.action[0].type = ACTION_OUTPUT;
-    pktout.action[0].port = port->port;
+    pktout->num_actions = 1;
+    pktout->action[0].type = ACTION_OUTPUT;
+
+    return 0;
+}
+
+/**
+ * \brief Function to send a LLDP packet using the pre-built pktout message
+ * \param dpid Datapath ID
+ * \param port Port
+ * \param hw_addr The MAC address of the port
+ */
+static int send_lldp(uint64_t dpid, uint32_t port, const uint8_t *hw_addr)
+{
+    pktout_t *pktout = &lldp_pktout;
+
+    uint64_t net_dpid = htonll(dpid);
+    uint32_t net_port = htonl(port);
 
-    ev_dp_send_packet(TOPO_MGMT_ID, &pktout);
+    pktout->dpid = dpid;
+    pktout->action[0].port = port;
+
+    // the source MAC address is the lower 48 bits of the datapath ID
+    memmove(&pktout->data[LLDP_SRC_MAC_OFFSET], (uint8_t *)&net_dpid + 2, ETH_ALEN);
+    memmove(&pktout->data[LLDP_CHASSIS_ID_OFFSET], hw_addr, ETH_ALEN);
+    memmove(&pktout->data[LLDP_PORT_ID_OFFSET], &net_port, 4);
+    memmove(&pktout->data[LLDP_DPID_OFFSET], &net_dpid, 8);
+
+    ev_dp_send_packet(TOPO_MGMT_ID, pktout);
 
     return 0;
 }
@@ -139,6 +162,8 @@ static int insert_link(uint64_t src_dpid, uint16_t src_port, uint64_t dst_dpid,
                         link->dpid = dst_dpid;
                         link->port = dst_port;
 
+                        topo[idx].seen[i] = time(NULL);
+
                         pthread_spin_unlock(&topo_lock[idx]);
 
                         char values[__CONF_STR_LEN];
@@ -160,6 +185,8 @@ static int insert_link(uint64_t src_dpid, uint16_t src_port, uint64_t dst_dpid,
 
                         return 1;
                     } else if (link->dpid == dst_dpid && link->port == dst_port) {
+                        topo[idx].seen[i] = time(NULL);
+
                         pthread_spin_unlock(&topo_lock[idx]);
 
                         return 0;
@@ -187,6 +214,205 @@ static int insert_link(uint64_t src_dpid, uint16_t src_port, uint64_t dst_dpid,
     return 0;
 }
 
+/**
+ * \brief Function to delete the links that missed LLDP packets
+ * \param now Current time
+ */
+static int age_links(time_t now)
+{
+    int i;
+    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+        port_t expired[__MAX_NUM_PORTS];
+        int num_expired = 0;
+
+        if (topo[i].dpid == 0) continue;
+
+        pthread_spin_lock(&topo_lock[i]);
+
+        int j;
+        for (j=0; j<__MAX_NUM_PORTS; j++) {
+            port_t *pt = &topo[i].link[j];
+
+            if (pt->port == 0 || pt->link.port == 0) continue;
+            else if (now - topo[i].seen[j] < __TOPO_MGMT_LINK_TIMEOUT) continue;
+
+            port_t *out = &expired[num_expired++];
+
+            memset(out, 0, sizeof(port_t));
+
+            out->dpid = topo[i].dpid;
+            out->port = pt->port;
+            out->link.dpid = pt->link.dpid;
+            out->link.port = pt->link.port;
+
+            memset(&pt->link, 0, sizeof(port_link_t));
+        }
+
+        pthread_spin_unlock(&topo_lock[i]);
+
+        for (j=0; j<num_expired; j++) {
+            port_t *out = &expired[j];
+
+            LOG_INFO(TOPO_MGMT_ID, "Timed out a link {(%lu, %u) -> (%lu, %u)}",
+                     out->dpid, out->port, out->link.dpid, out->link.port);
+
+            ev_link_deleted(TOPO_MGMT_ID, out);
+
+            char conditions[__CONF_STR_LEN];
+            sprintf(conditions, "SRC_DPID = %lu and SRC_PORT = %u and DST_DPID = %lu and DST_PORT = %u",
+                    out->dpid, out->port, out->link.dpid, out->link.port);
+
+            if (delete_data(&topo_mgmt_info, "topo_mgmt", conditions)) {
+                LOG_ERROR(TOPO_MGMT_ID, "delete_data() failed");
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * \brief Function to update the statistics of the links of a switch
+ * \param idx The index of the switch in the topology
+ * \param port Port stats
+ * \param num The number of port stats
+ */
+static int update_port_stats(int idx, const port_t *port, int num)
+{
+    port_t link[__MAX_NUM_PORTS];
+    int num_links = 0;
+
+    pthread_spin_lock(&topo_lock[idx]);
+
+    uint64_t dpid = topo[idx].dpid;
+
+    int i, j;
+    for (i=0; i<__MAX_NUM_PORTS; i++) {
+        port_t *curr = &topo[idx].link[i];
+        port_stat_t *stat = &curr->stat;
+
+        if (curr->port == 0) continue;
+
+        for (j=0; j<num; j++) {
+            if (port[j].port != curr->port) continue;
+
+            stat->rx_packets = port[j].stat.rx_packets - stat->old_rx_packets;
+            stat->rx_bytes = port[j].stat.rx_bytes - stat->old_rx_bytes;
+            stat->tx_packets = port[j].stat.tx_packets - stat->old_tx_packets;
+            stat->tx_bytes = port[j].stat.tx_bytes - stat->old_tx_bytes;
+
+            stat->old_rx_packets = port[j].stat.rx_packets;
+            stat->old_rx_bytes = port[j].stat.rx_bytes;
+            stat->old_tx_packets = port[j].stat.tx_packets;
+            stat->old_tx_bytes = port[j].stat.tx_bytes;
+
+            // only links have their rows in the database
+            if (curr->link.dpid)
+                memcpy(&link[num_links++], curr, sizeof(port_t));
+
+            break;
+        }
+    }
+
+    pthread_spin_unlock(&topo_lock[idx]);
+
+    for (i=0; i<num_links; i++) {
+        port_stat_t *stat = &link[i].stat;
+
+        char changes[__CONF_STR_LEN];
+        sprintf(changes, "RX_PACKETS = %lu, RX_BYTES = %lu, TX_PACKETS = %lu, TX_BYTES = %lu",
+                stat->rx_packets, stat->rx_bytes, stat->tx_packets, stat->tx_bytes);
+
+        char conditions[__CONF_STR_LEN];
+        sprintf(conditions, "SRC_DPID = %lu and SRC_PORT = %u and DST_DPID = %lu and DST_PORT = %u",
+                dpid, link[i].port, link[i].link.dpid, link[i].link.port);
+
+        if (update_data(&topo_mgmt_info, "topo_mgmt", changes, conditions)) {
+            LOG_ERROR(TOPO_MGMT_ID, "update_data() failed");
+        }
+    }
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to send the next burst of LLDP packets (periodic task)
+ * \param arg NULL
+ * \return The time until the next burst (ms)
+ */
+static int topo_mgmt_discover(void *arg)
+{
+    const int total = __MAX_NUM_SWITCHES * __MAX_NUM_PORTS;
+
+    int i;
+
+    // a new round spreads LLDP packets evenly over the discovery period
+    if (topo_cursor == 0) {
+        int num_ports = 0;
+
+        for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+            if (topo[i].dpid == 0) continue;
+
+            int j;
+            for (j=0; j<__MAX_NUM_PORTS; j++) {
+                if (topo[i].link[j].port) num_ports++;
+            }
+        }
+
+        if (num_ports == 0) {
+            age_links(time(NULL));
+            return 0;
+        }
+
+        const int period = __TOPO_MGMT_REQUEST_TIME * 1000;
+
+        topo_burst = (num_ports * __TOPO_MGMT_PACE + period - 1) / period;
+        topo_gap = MAX((int)((uint64_t)period * topo_burst / num_ports), 1);
+    }
+
+    int sent = 0;
+    while (topo_cursor < total && sent < topo_burst) {
+        i = topo_cursor / __MAX_NUM_PORTS;
+        int j = topo_cursor % __MAX_NUM_PORTS;
+
+        if (topo[i].dpid == 0) {
+            topo_cursor = (i + 1) * __MAX_NUM_PORTS;
+            continue;
+        }
+
+        topo_cursor++;
+
+        uint64_t dpid = 0;
+        uint32_t port = 0;
+        uint8_t hw_addr[ETH_ALEN];
+
+        pthread_spin_lock(&topo_lock[i]);
+
+        if (topo[i].dpid && topo[i].link[j].port) {
+            dpid = topo[i].dpid;
+            port = topo[i].link[j].port;
+            memmove(hw_addr, topo[i].link[j].info.hw_addr, ETH_ALEN);
+        }
+
+        pthread_spin_unlock(&topo_lock[i]);
+
+        if (port == 0) continue;
+
+        send_lldp(dpid, port, hw_addr);
+        sent++;
+    }
+
+    // the round is over
+    if (topo_cursor >= total) {
+        topo_cursor = 0;
+        age_links(time(NULL));
+    }
+
+    return topo_gap;
+}
+
 /////////////////////////////////////////////////////////////////////
 
 /**
@@ -217,27 +443,16 @@ int topo_mgmt_main(int *activated, int argc, char **argv)
         pthread_spin_init(&topo_lock[i], PTHREAD_PROCESS_PRIVATE);
     }
 
+    build_lldp(&lldp_pktout);
+
     activate();
 
-    while (*activated) {
-        int i;
-        for (i=0; i<__MAX_NUM_SWITCHES; i++) {
-            if (topo[i].dpid) {
-                pthread_spin_lock(&topo_lock[i]);
-                int j;
-                for (j=0; j<__MAX_NUM_PORTS; j++) {
-                    if (topo[i].link[j].port) {
-                        send_lldp(&topo[i].link[j]);
-                    }
-                }
-                pthread_spin_unlock(&topo_lock[i]);
-            }
-        }
+    topo_cursor = 0;
 
-        for (i=0; i<__TOPO_MGMT_REQUEST_TIME; i++) {
-            if (*activated == FALSE) break;
-            else waitsec(1, 0);
-        }
+    topo_task = timer_task_add("topo_mgmt", __TOPO_MGMT_REQUEST_TIME * 1000, 0, topo_mgmt_discover, NULL);
+    if (topo_task == NULL) {
+        LOG_ERROR(TOPO_MGMT_ID, "timer_task_add() failed");
+        return -1;
     }
 
     return 0;
@@ -253,6 +468,9 @@ int topo_mgmt_cleanup(int *activated)
 
     deactivate();
 
+    timer_task_cancel(topo_task);
+    topo_task = NULL;
+
     int i;
     for (i=0; i<__MAX_NUM_SWITCHES; i++) {
         pthread_spin_destroy(&topo_lock[i]);
@@ -464,7 +682,7 @@ int topo_mgmt_handler(const event_t *ev, event_out_t *ev_out)
 
                         if (pt->port && pt->link.port) {
                             LOG_INFO(TOPO_MGMT_ID, "Deleted a link {(%lu, %u) -> (%lu, %u)}", 
-                                     topo[i].dpid, pt->port, pt->link.dpid, pt->link.port);
+                                     topo[idx].dpid, pt->port, pt->link.dpid, pt->link.port);
 
                             port_t out = {0};
 
@@ -475,7 +693,7 @@ int topo_mgmt_handler(const event_t *ev, event_out_t *ev_out)
 
                             ev_link_deleted(TOPO_MGMT_ID, &out);
 
-                            memset(link, 0, sizeof(port_t));
+                            memset(pt, 0, sizeof(port_t));
                         }
                     }
 
@@ -547,7 +765,7 @@ int topo_mgmt_handler(const event_t *ev, event_out_t *ev_out)
                     pthread_spin_lock(&topo_lock[idx]);
 
                     int i;
-                    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
+                    for (i=0; i<__MAX_NUM_PORTS; i++) {
                         port_link_t *link = &topo[idx].link[i].link;
 
                         if (topo[idx].link[i].port != port->port) continue;
@@ -598,46 +816,30 @@ int topo_mgmt_handler(const event_t *ev, event_out_t *ev_out)
             int idx = port->dpid % __MAX_NUM_SWITCHES;
             do {
                 if (topo[idx].dpid == port->dpid) {
-                    pthread_spin_lock(&topo_lock[idx]);
-
-                    int i;
-                    for (i=0; i<__MAX_NUM_SWITCHES; i++) {
-                        port_stat_t *stat = &topo[idx].link[i].stat;
-
-                        if (topo[idx].link[i].port != port->port) continue;
-
-                        stat->rx_packets = port->stat.rx_packets - stat->old_rx_packets;
-                        stat->rx_bytes = port->stat.rx_bytes - stat->old_rx_bytes;
-                        stat->tx_packets = port->stat.tx_packets - stat->old_tx_packets;
-                        stat->tx_bytes = port->stat.tx_bytes - stat->old_tx_bytes;
-
-                        stat->old_rx_packets = port->stat.rx_packets;
-                        stat->old_rx_bytes = port->stat.rx_bytes;
-                        stat->old_tx_packets = port->stat.tx_packets;
-                        stat->old_tx_bytes = port->stat.tx_bytes;
-
-                        char changes[__CONF_STR_LEN];
-                        sprintf(changes, "RX_PACKETS = %lu, RX_BYTES = %lu, TX_PACKETS = %lu, TX_BYTES = %lu",
-                                stat->rx_packets, stat->rx_bytes, stat->tx_packets, stat->tx_bytes);
-
-                        char conditions[__CONF_STR_LEN];
-                        sprintf(conditions, "SRC_DPID = %lu and SRC_PORT = %u and DST_DPID = %lu and DST_PORT = %u",
-                                port->dpid, port->port, topo[idx].link[i].link.dpid, topo[idx].link[i].link.port);
-
-                        if (update_data(&topo_mgmt_info, "topo_mgmt", changes, conditions)) {
-                            LOG_ERROR(TOPO_MGMT_ID, "update_data() failed");
-                        }
+                    update_port_stats(idx, port, 1);
+                    break;
+                }
 
-                        break;
-                    }
+                idx = (idx + 1) % __MAX_NUM_SWITCHES;
+            } while (idx != port->dpid % __MAX_NUM_SWITCHES);
+        }
+        break;
+    case EV_DP_MULTI_PORT_STATS:
+        PRINT_EV("EV_DP_MULTI_PORT_STATS\n");
+        {
+            const ports_t *ports = ev->ports;
 
-                    pthread_spin_unlock(&topo_lock[idx]);
+            if (ports->remote == TRUE) break;
 
+            int idx = ports->dpid % __MAX_NUM_SWITCHES;
+            do {
+                if (topo[idx].dpid == ports->dpid) {
+                    update_port_stats(idx, ports->port, ports->num_ports);
                     break;
                 }
 
                 idx = (idx + 1) % __MAX_NUM_SWITCHES;
-            } while (idx != port->port % __MAX_NUM_SWITCHES);
+            } while (idx != ports->dpid % __MAX_NUM_SWITCHES);
         }
         break;
     case EV_LINK_ADDED:
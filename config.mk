@@ -20,3 +20,6 @@ CONFIG= \
     __MAX_NUM_PORTS=64 \
     \
     #__ENABLE_DEBUG \
+    #__ENABLE_MEM_ACCOUNTING \
+    #__PIN_WORKERS \
+    #__RUN_TO_COMPLETION \
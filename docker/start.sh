@@ -14,6 +14,9 @@ elif [ "$1" == "--API-monitor" ]; then
 elif [ "$1" == "--cbench" ]; then
     export CBENCH=CBENCH
     docker-compose up
+elif [ "$1" == "--shm-ring" ]; then
+    export SHM_RING=SHM_RING
+    docker-compose up
 else
-    echo "Usage: $0 [ NONE | --API-monitor | --cbench ]"
+    echo "Usage: $0 [ NONE | --API-monitor | --cbench | --shm-ring ]"
 fi
@@ -17,6 +17,11 @@
 
 #include "event.h"
 #include "component.h"
+#include "crc32c.h"
+#include "log_ring.h"
+#include "shm_ring.h"
+#include "msg_batch.h"
+#include "epoch.h"
 
 /////////////////////////////////////////////////////////////////////
 
@@ -26,6 +31,9 @@ static ctx_t *ev_ctx;
 /** \brief The flag to enable API monitoring */
 int API_monitor_enabled;
 
+/** \brief The flag to compute event checksums at raise time */
+int ev_checksum_enabled;
+
 /////////////////////////////////////////////////////////////////////
 
 /** \brief MQ context to pull events */
@@ -40,10 +48,49 @@ void *ev_rep_ctx;
 /** \brief MQ socket to reply events */
 void *ev_rep_sock;
 
+/** \brief MQ socket to dispatch requests to workers */
+void *ev_worker_sock;
+
+/** \brief The shared-memory links replaced by reconnections (unmapped at the end) */
+static shm_link_t *ev_shm_retired;
+
+/** \brief The lock for shared-memory links */
+static pthread_mutex_t ev_shm_lock;
+
+/** \brief The lock for the credits of external components */
+static pthread_mutex_t ev_credit_lock;
+
+/** \brief The condition signaled when credits are returned */
+static pthread_cond_t ev_credit_cond;
+
+/** \brief MQ context for pipelined requests */
+static void *ev_async_ctx;
+
+/** \brief The flag to deliver the events raised by this thread synchronously */
+static __thread int ev_chain_sync;
+
+/** \brief The flag set in the async thread (which cannot wait for credits) */
+static __thread int ev_async_self;
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to get the configuration published to the event handler (in an epoch section)
+ * \return Component configuration (NULL: not loaded yet)
+ */
+static compnt_conf_t *ev_conf(void)
+{
+    return __atomic_load_n(&ev_ctx->compnt_conf, __ATOMIC_ACQUIRE);
+}
+
 /////////////////////////////////////////////////////////////////////
 
 /** \brief Switch related trigger function (non-const) */
 static int sw_rw_raise(uint32_t id, uint16_t type, uint16_t len, switch_t *data);
+/** \brief Route related trigger function (non-const) */
+static int route_rw_raise(uint32_t id, uint16_t type, uint16_t len, route_t *data);
+/** \brief Tree related trigger function (non-const) */
+static int tree_rw_raise(uint32_t id, uint16_t type, uint16_t len, tree_t *data);
 /** \brief Port related trigger function (non-const) */
 //static int port_rw_raise(uint32_t id, uint16_t type, uint16_t len, port_t *data);
 /** \brief Host related trigger function (non-const) */
@@ -71,12 +118,20 @@ static int flow_ev_raise(uint32_t id, uint16_t type, uint16_t len, const flow_t
 static int rs_ev_raise(uint32_t id, uint16_t type, uint16_t len, const resource_t *data);
 /** \brief Traffic related trigger function (const) */
 static int tr_ev_raise(uint32_t id, uint16_t type, uint16_t len, const traffic_t *data);
+/** \brief Port statistics related trigger function (const) */
+static int ports_ev_raise(uint32_t id, uint16_t type, uint16_t len, const ports_t *data);
+/** \brief Flow statistics related trigger function (const) */
+static int flows_ev_raise(uint32_t id, uint16_t type, uint16_t len, const flows_t *data);
+/** \brief Bulk flow install related trigger function (const) */
+static int batch_ev_raise(uint32_t id, uint16_t type, uint16_t len, const flow_batch_t *data);
 /** \brief Log related trigger function (const) */
 static int log_ev_raise(uint32_t id, uint16_t type, uint16_t len, const char *data);
 
 /////////////////////////////////////////////////////////////////////
 
 #include "event_msg_pack.h"
+#include "event_chain.h"
+#include "event_sched.h"
 
 // Upstream events //////////////////////////////////////////////////
 
@@ -100,6 +155,42 @@ void ev_dp_port_modified(uint32_t id, const port_t *data) { port_ev_raise(id, EV
 void ev_dp_port_deleted(uint32_t id, const port_t *data) { port_ev_raise(id, EV_DP_PORT_DELETED, sizeof(port_t), data); }
 /** \brief EV_DP_PORT_STATS */
 void ev_dp_port_stats(uint32_t id, const port_t *data) { port_ev_raise(id, EV_DP_PORT_STATS, sizeof(port_t), data); }
+/** \brief EV_DP_MULTI_FLOW_STATS (+ EV_DP_FLOW_STATS for each flow if there are its subscribers) */
+void ev_dp_multi_flow_stats(uint32_t id, const flows_t *data) {
+    flows_ev_raise(id, EV_DP_MULTI_FLOW_STATS, sizeof(flows_t), data);
+
+    epoch_enter();
+
+    compnt_conf_t *conf = ev_conf();
+    int listened = (conf != NULL && conf->ev_num[EV_DP_FLOW_STATS] > 0);
+
+    epoch_exit();
+
+    if (!listened) return;
+
+    int i;
+    for (i=0; i<data->num_flows; i++)
+        flow_ev_raise(id, EV_DP_FLOW_STATS, sizeof(flow_t), &data->flow[i]);
+}
+/** \brief EV_DP_MULTI_PORT_STATS (+ EV_DP_PORT_STATS for each port if there are its subscribers) */
+void ev_dp_multi_port_stats(uint32_t id, const ports_t *data) {
+    ports_ev_raise(id, EV_DP_MULTI_PORT_STATS, sizeof(ports_t), data);
+
+    epoch_enter();
+
+    compnt_conf_t *conf = ev_conf();
+    int listened = (conf != NULL && conf->ev_num[EV_DP_PORT_STATS] > 0);
+
+    epoch_exit();
+
+    if (!listened) return;
+
+    int i;
+    for (i=0; i<data->num_ports; i++)
+        port_ev_raise(id, EV_DP_PORT_STATS, sizeof(port_t), &data->port[i]);
+}
+/** \brief EV_DP_FLOWS_INSTALLED */
+void ev_dp_flows_installed(uint32_t id, const flow_batch_t *data) { batch_ev_raise(id, EV_DP_FLOWS_INSTALLED, sizeof(flow_batch_t), data); }
 
 // Downstream events ////////////////////////////////////////////////
 
@@ -113,6 +204,8 @@ void ev_dp_insert_flow(uint32_t id, const flow_t *data) { flow_ev_raise(id, EV_D
 void ev_dp_modify_flow(uint32_t id, const flow_t *data) { flow_ev_raise(id, EV_DP_MODIFY_FLOW, sizeof(flow_t), data); }
 /** \brief EV_DP_DELETE_FLOW */
 void ev_dp_delete_flow(uint32_t id, const flow_t *data) { flow_ev_raise(id, EV_DP_DELETE_FLOW, sizeof(flow_t), data); }
+/** \brief EV_DP_INSERT_FLOWS */
+void ev_dp_insert_flows(uint32_t id, const flows_t *data) { flows_ev_raise(id, EV_DP_INSERT_FLOWS, sizeof(flows_t), data); }
 /** \brief EV_DP_REQUEST_FLOW_STATS */
 void ev_dp_request_flow_stats(uint32_t id, const flow_t *data) { flow_ev_raise(id, EV_DP_REQUEST_FLOW_STATS, sizeof(flow_t), data); }
 /** \brief EV_DP_REQUEST_AGGREGATE_STATS */
@@ -130,6 +223,10 @@ void ev_sw_get_dpid(uint32_t id, switch_t *data) { sw_rw_raise(id, EV_SW_GET_DPI
 void ev_sw_get_fd(uint32_t id, switch_t *data) { sw_rw_raise(id, EV_SW_GET_FD, sizeof(switch_t), data); }
 /** \brief EV_SW_GET_XID (fd or dpid) */
 void ev_sw_get_xid(uint32_t id, switch_t *data) { sw_rw_raise(id, EV_SW_GET_XID, sizeof(switch_t), data); }
+/** \brief EV_RT_GET_ROUTE (src, dst, hash) */
+void ev_rt_get_route(uint32_t id, route_t *data) { route_rw_raise(id, EV_RT_GET_ROUTE, sizeof(route_t), data); }
+/** \brief EV_RT_GET_TREE (dpid, in_port) */
+void ev_rt_get_tree(uint32_t id, tree_t *data) { tree_rw_raise(id, EV_RT_GET_TREE, sizeof(tree_t), data); }
 
 // Internal events (notification) ///////////////////////////////////
 
@@ -168,60 +265,171 @@ void ev_log_update_msgs(uint32_t id, const char *data) { log_ev_raise(id, EV_LOG
 
 // Log events ///////////////////////////////////////////////////////
 
+/**
+ * \brief Function to push a log message into the log rings (or raise it if disabled)
+ * \param id Component ID
+ * \param type Log level
+ * \param format Format string
+ * \param ap Arguments
+ */
+static void ev_log_raise(uint32_t id, uint16_t type, char *format, va_list ap) {
+    if (log_ring_enabled) {
+        // formatted later by the log writer
+        log_ring_push(id, type, (type != EV_LOG_DEBUG && type != EV_LOG_INFO), format, ap);
+        return;
+    }
+
+    char log[__CONF_STR_LEN] = {0};
+    vsnprintf(log, __CONF_STR_LEN, format, ap);
+
+    log_ev_raise(id, type, strlen(log), log);
+}
+
 /** \brief EV_LOG_DEBUG */
 void ev_log_debug(uint32_t id, char *format, ...) {
-    char log[__CONF_STR_LEN] = {0};
     va_list ap;
 
     va_start(ap, format);
-    vsprintf(log, format, ap);
+    ev_log_raise(id, EV_LOG_DEBUG, format, ap);
     va_end(ap);
-
-    log_ev_raise(id, EV_LOG_DEBUG, strlen(log), log);
 }
 /** \brief EV_LOG_INFO */
 void ev_log_info(uint32_t id, char *format, ...) {
-    char log[__CONF_STR_LEN] = {0};
     va_list ap;
 
     va_start(ap, format);
-    vsprintf(log, format, ap);
+    ev_log_raise(id, EV_LOG_INFO, format, ap);
     va_end(ap);
-
-    log_ev_raise(id, EV_LOG_INFO, strlen(log), log);
 }
 /** \brief EV_LOG_WARN */
 void ev_log_warn(uint32_t id, char *format, ...) {
-    char log[__CONF_STR_LEN] = {0};
     va_list ap;
 
     va_start(ap, format);
-    vsprintf(log, format, ap);
+    ev_log_raise(id, EV_LOG_WARN, format, ap);
     va_end(ap);
-
-    log_ev_raise(id, EV_LOG_WARN, strlen(log), log);
 }
 /** \brief EV_LOG_ERROR */
 void ev_log_error(uint32_t id, char *format, ...) {
-    char log[__CONF_STR_LEN] = {0};
     va_list ap;
 
     va_start(ap, format);
-    vsprintf(log, format, ap);
+    ev_log_raise(id, EV_LOG_ERROR, format, ap);
     va_end(ap);
-
-    log_ev_raise(id, EV_LOG_ERROR, strlen(log), log);
 }
 /** \brief EV_LOG_FATAL */
 void ev_log_fatal(uint32_t id, char *format, ...) {
-    char log[__CONF_STR_LEN] = {0};
     va_list ap;
 
     va_start(ap, format);
-    vsprintf(log, format, ap);
+    ev_log_raise(id, EV_LOG_FATAL, format, ap);
     va_end(ap);
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to raise an event from its raw data (e.g., a recorded trace)
+ * \param id Trigger ID
+ * \param type Event type
+ * \param len Data length
+ * \param data Data
+ */
+int ev_raise_data(uint32_t id, uint16_t type, uint16_t len, const uint8_t *data)
+{
+    uint8_t buf[__MAX_MSG_SIZE+1] = {0};
+
+    if (len > __MAX_MSG_SIZE) return -1;
+
+    switch (type) {
+    // these events refer to live switch sockets or external buffers
+    case EV_OFP_MSG_IN:
+    case EV_OFP_MSG_OUT:
+    case EV_DP_MULTI_FLOW_STATS:
+    case EV_DP_MULTI_PORT_STATS:
+    case EV_DP_INSERT_FLOWS:
+    case EV_SW_NEW_CONN:
+    case EV_SW_ESTABLISHED_CONN:
+    case EV_SW_EXPIRED_CONN:
+        return -1;
+    case EV_DP_FLOW_EXPIRED:
+    case EV_DP_FLOW_DELETED:
+    case EV_DP_FLOW_STATS:
+    case EV_DP_AGGREGATE_STATS:
+    case EV_DP_INSERT_FLOW:
+    case EV_DP_MODIFY_FLOW:
+    case EV_DP_DELETE_FLOW:
+    case EV_DP_REQUEST_FLOW_STATS:
+    case EV_DP_REQUEST_AGGREGATE_STATS:
+    case EV_FLOW_ADDED:
+    case EV_FLOW_MODIFIED:
+    case EV_FLOW_DELETED:
+        if (len != sizeof(flow_t)) return -1;
+        memcpy(buf, data, len);
+        ((flow_t *)buf)->prev = NULL;
+        ((flow_t *)buf)->next = NULL;
+        break;
+    default:
+        if (type >= EV_NUM_EVENTS) return -1;
+        memcpy(buf, data, len);
+        break;
+    }
+
+    msg_t msg = {0};
+    msg.id = id;
+    msg.type = type;
+    msg.data = buf;
+
+    // the caller takes the result of the whole event chain
+    int sync = ev_chain_sync;
+    ev_chain_sync = TRUE;
+
+    int ret = process_events(&msg);
+
+    ev_chain_sync = sync;
 
-    log_ev_raise(id, EV_LOG_FATAL, strlen(log), log);
+    return ret;
+}
+
+/**
+ * \brief Function to apply the scheduling configuration of event classes (after publishing it)
+ * \param conf Component configuration
+ */
+int ev_sched_update(const compnt_conf_t *conf)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&ev_sched_lock);
+
+    int c, shared = FALSE;
+    for (c=0; c<EV_NUM_CLASSES; c++) {
+        ev_sched_queue_t *q = &ev_sched_queue[c];
+
+        q->conf = conf->ev_class[c];
+        q->credit = q->conf.weight;
+
+        // the chains queued before a class is switched back still need workers
+        if (q->conf.workers == 0 && (q->conf.mode == EV_SCHED_ASYNC || q->len > 0))
+            shared = TRUE;
+
+        while (ret == 0 && q->num_threads < q->conf.workers) {
+            ret = ev_sched_spawn(c, q->num_threads);
+            if (ret == 0) q->num_threads++;
+        }
+
+        pthread_cond_broadcast(&q->cond);
+    }
+
+    while (ret == 0 && shared && ev_sched_num_shared < __EV_SCHED_WORKERS) {
+        ret = ev_sched_spawn(EV_SCHED_SHARED, ev_sched_num_shared);
+        if (ret == 0) ev_sched_num_shared++;
+    }
+
+    pthread_cond_broadcast(&ev_sched_cond);
+
+    pthread_mutex_unlock(&ev_sched_lock);
+
+    return ret;
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -328,22 +536,74 @@ int init_event(ctx_t *ctx)
             return -1;
         }
 
-        // reply
+        // batches to external subscribers
+
+        if (pthread_create(&thread, NULL, &flush_events, NULL) < 0) {
+            PERROR("pthread_create");
+            return -1;
+        }
+
+        // reply (a router in front of a pool of workers)
+
+        pthread_mutex_init(&ev_shm_lock, NULL);
 
         ev_rep_ctx = zmq_ctx_new();
-        ev_rep_sock = zmq_socket(ev_rep_ctx, ZMQ_REP);
+        ev_rep_sock = zmq_socket(ev_rep_ctx, ZMQ_ROUTER);
 
         if (zmq_bind(ev_rep_sock, __EXT_COMP_REPLY_ADDR)) {
             PERROR("zmq_bind");
             return -1;
         }
 
-        zmq_setsockopt(ev_rep_sock, ZMQ_RCVTIMEO, &timeout, sizeof(int));
+        ev_worker_sock = zmq_socket(ev_rep_ctx, ZMQ_ROUTER);
+
+        if (zmq_bind(ev_worker_sock, __EXT_COMP_WORKER_ADDR)) {
+            PERROR("zmq_bind");
+            return -1;
+        }
+
+        if (pthread_create(&thread, NULL, &proxy_events, NULL) < 0) {
+            PERROR("pthread_create");
+            return -1;
+        }
+
+        int num_workers = MIN(MAX(get_nprocs(), 2), __EXT_MAX_REPLY_WORKERS);
+
+        int i;
+        for (i=0; i<num_workers; i++) {
+            if (pthread_create(&thread, NULL, &reply_events, NULL) < 0) {
+                PERROR("pthread_create");
+                return -1;
+            }
+        }
+
+        // pipelined requests to external components
+
+        pthread_mutex_init(&ev_credit_lock, NULL);
+        pthread_cond_init(&ev_credit_cond, NULL);
+        pthread_mutex_init(&ev_async_lock, NULL);
+
+        if (pipe(ev_async_pipe) < 0) {
+            PERROR("pipe");
+            return -1;
+        }
+
+        ev_async_ctx = zmq_ctx_new();
+        ev_async_on = TRUE;
 
-        if (pthread_create(&thread, NULL, &reply_events, NULL) < 0) {
+        if (pthread_create(&thread, NULL, &async_events, NULL) < 0) {
             PERROR("pthread_create");
             return -1;
         }
+
+        // scheduler workers (started once event classes are configured)
+
+        pthread_mutex_init(&ev_sched_lock, NULL);
+        pthread_cond_init(&ev_sched_cond, NULL);
+
+        int c;
+        for (c=0; c<EV_NUM_CLASSES; c++)
+            pthread_cond_init(&ev_sched_queue[c].cond, NULL);
     }
 
     DEBUG("event_handler is initialized\n");
@@ -361,11 +621,18 @@ int destroy_event(ctx_t *ctx)
 
     waitsec(1, 0);
 
+    ev_shm_detach_all();
+
     zmq_close(ev_pull_sock);
     zmq_close(ev_rep_sock);
+    zmq_close(ev_worker_sock);
 
     zmq_ctx_destroy(ev_pull_ctx);
     zmq_ctx_destroy(ev_rep_ctx);
+    zmq_ctx_destroy(ev_async_ctx);
+
+    close(ev_async_pipe[0]);
+    close(ev_async_pipe[1]);
 
     DEBUG("event_handler is destroyed\n");
 
@@ -420,6 +687,22 @@ int destroy_event(ctx_t *ctx)
 #undef FUNC_TYPE
 #undef FUNC_DATA
 
+#define FUNC_NAME route_rw_raise
+#define FUNC_TYPE route_t
+#define FUNC_DATA route_data
+#include "event_rw_raise.h"
+#undef FUNC_NAME
+#undef FUNC_TYPE
+#undef FUNC_DATA
+
+#define FUNC_NAME tree_rw_raise
+#define FUNC_TYPE tree_t
+#define FUNC_DATA tree_data
+#include "event_rw_raise.h"
+#undef FUNC_NAME
+#undef FUNC_TYPE
+#undef FUNC_DATA
+
 //#define FUNC_NAME port_rw_raise
 //#define FUNC_TYPE port_t
 //#define FUNC_DATA port_data
@@ -528,6 +811,30 @@ int destroy_event(ctx_t *ctx)
 #undef FUNC_TYPE
 #undef FUNC_DATA
 
+#define FUNC_NAME ports_ev_raise
+#define FUNC_TYPE ports_t
+#define FUNC_DATA ports
+#include "event_direct_raise.h"
+#undef FUNC_NAME
+#undef FUNC_TYPE
+#undef FUNC_DATA
+
+#define FUNC_NAME flows_ev_raise
+#define FUNC_TYPE flows_t
+#define FUNC_DATA flows
+#include "event_direct_raise.h"
+#undef FUNC_NAME
+#undef FUNC_TYPE
+#undef FUNC_DATA
+
+#define FUNC_NAME batch_ev_raise
+#define FUNC_TYPE flow_batch_t
+#define FUNC_DATA batch
+#include "event_direct_raise.h"
+#undef FUNC_NAME
+#undef FUNC_TYPE
+#undef FUNC_DATA
+
 #define FUNC_NAME log_ev_raise
 #define FUNC_TYPE char
 #define FUNC_DATA log
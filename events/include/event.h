@@ -32,6 +32,12 @@ typedef struct _event_t {
         const host_t     *host; /**< The pointer of a host */
         const flow_t     *flow; /**< The pointer of a flow */
 
+        const ports_t    *ports; /**< The pointer of port statistics */
+        const flows_t    *flows; /**< The pointer of flow statistics or flows to install */
+        const flow_batch_t *batch; /**< The pointer of the result of a bulk flow install */
+        const route_t    *route; /**< The pointer of a route */
+        const tree_t     *tree; /**< The pointer of broadcast tree ports */
+
         const pktin_t    *pktin; /**< The pointer of a pktin */
         const pktout_t   *pktout; /**< The pointer of a pktout */
 
@@ -59,10 +65,19 @@ typedef struct _event_out_t {
         port_t           *port_data; /**< The pointer of a port */
         host_t           *host_data; /**< The pointer of a host */
         flow_t           *flow_data; /**< The pointer of a flow */
+        route_t          *route_data; /**< The pointer of a route */
+        tree_t           *tree_data; /**< The pointer of broadcast tree ports */
 
         uint8_t          *data; /**< The pointer of data */
     };
 } event_out_t;
 
+/** \brief The flag to compute event checksums at raise time (set by dit) */
+extern int ev_checksum_enabled;
+
 int init_event(ctx_t *ctx);
 int destroy_event(ctx_t *ctx);
+
+int ev_raise_data(uint32_t id, uint16_t type, uint16_t len, const uint8_t *data);
+
+int ev_sched_update(const compnt_conf_t *conf);
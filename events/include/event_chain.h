@@ -0,0 +1,527 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief Function to concatenate two tokens after expanding them */
+#define EV_CONCAT_(a, b) a##b
+/** \brief Function to concatenate two tokens after expanding them */
+#define EV_CONCAT(a, b) EV_CONCAT_(a, b)
+
+/** \brief The result of delivering an event to a component */
+enum {
+    EV_HOP_NEXT, /**< Go on with the next component */
+    EV_HOP_STOP, /**< Stop the event chain */
+    EV_HOP_WAIT, /**< Wait for the reply of an external component */
+};
+
+/** \brief The position of an event chain at a component */
+enum {
+    EV_STAGE_MAIN, /**< Before the component itself */
+    EV_STAGE_CHECK, /**< Before the security (v2) component that checks the component */
+    EV_STAGE_DONE, /**< After both */
+};
+
+/** \brief The function pointer to check the operator-defined policies of a component */
+typedef int (* ev_odp_f)(odp_t *odp, const void *data);
+
+/** \brief The structure of an event in delivery along its event list */
+typedef struct _ev_chain_t {
+    event_out_t ev_out; /**< Event */
+
+    compnt_conf_t *conf; /**< The configuration that the chain walks */
+    compnt_t **ev_list; /**< The components to deliver the event to */
+    int ev_num; /**< The number of the components */
+    ev_odp_f odp; /**< The function to check operator-defined policies (NULL: none) */
+
+    int index; /**< The index of the current component */
+    int stage; /**< The position at the current component */
+    compnt_t *one_by_one; /**< The last activated security (v2) component */
+    int ret; /**< The return value of the last component */
+
+    compnt_t *compnt; /**< The component whose reply is awaited */
+    uint64_t seq; /**< The sequence number of the request */
+    struct timespec deadline; /**< The deadline of the request */
+
+    int detached; /**< The flag of a chain copied out of its raising thread */
+    struct _ev_chain_t *next; /**< The next chain in a queue */
+
+    uint8_t data[0]; /**< The copy of the event data (detached chains) */
+} ev_chain_t;
+
+/** \brief The structure of a pipelined connection to an external component */
+typedef struct _ev_peer_t {
+    char addr[__CONF_WORD_LEN]; /**< Request address */
+    void *sock; /**< MQ socket (DEALER) */
+} ev_peer_t;
+
+/** \brief The chains waiting to be sent by the async thread */
+static ev_chain_t *ev_async_head, *ev_async_tail;
+
+/** \brief The lock for the chains waiting to be sent */
+static pthread_mutex_t ev_async_lock;
+
+/** \brief The pipe to wake the async thread up */
+static int ev_async_pipe[2];
+
+/** \brief The flag whether the async thread is running */
+static int ev_async_on;
+
+/** \brief The chains waiting for replies (async thread only) */
+static ev_chain_t *ev_async_pending;
+
+/** \brief Pipelined connections (async thread only) */
+static ev_peer_t ev_async_peers[__MAX_COMPONENTS];
+
+/** \brief The number of pipelined connections (async thread only) */
+static int ev_async_num_peers;
+
+/** \brief The sequence number of the last request (async thread only) */
+static uint64_t ev_async_seq;
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to copy an event chain out of the stack of its raising thread
+ * \param ch Event chain
+ * \return The chain that can outlive the raising thread (NULL: out of memory)
+ */
+static ev_chain_t *ev_chain_detach(ev_chain_t *ch)
+{
+    if (ch->detached) return ch;
+
+    ev_chain_t *dc = (ev_chain_t *)MALLOC(sizeof(ev_chain_t) + ch->ev_out.length + 1);
+    if (dc == NULL) return NULL;
+
+    memcpy(dc, ch, sizeof(ev_chain_t));
+    memcpy(dc->data, ch->ev_out.data, ch->ev_out.length);
+    dc->data[ch->ev_out.length] = '\0';
+
+    dc->ev_out.data = dc->data;
+    dc->detached = TRUE;
+
+    // the configuration stays alive until the chain ends, even if it is replaced meanwhile
+    __atomic_add_fetch(&dc->conf->refs, 1, __ATOMIC_ACQ_REL);
+
+    return dc;
+}
+
+/**
+ * \brief Function to release an event chain that has ended
+ * \param ch Event chain (detached)
+ */
+static void ev_chain_free(ev_chain_t *ch)
+{
+    __atomic_sub_fetch(&ch->conf->refs, 1, __ATOMIC_ACQ_REL);
+
+    FREE(ch);
+}
+
+/**
+ * \brief Function to hand an event chain over to the async thread
+ * \param ch Event chain (detached)
+ */
+static void ev_chain_submit(ev_chain_t *ch)
+{
+    ch->next = NULL;
+
+    pthread_mutex_lock(&ev_async_lock);
+
+    int empty = (ev_async_head == NULL);
+
+    if (ev_async_tail) ev_async_tail->next = ch;
+    else ev_async_head = ch;
+    ev_async_tail = ch;
+
+    pthread_mutex_unlock(&ev_async_lock);
+
+    // the async thread takes every queued chain at once, so only the first one wakes it up
+    if (empty && !ev_async_self) {
+        char c = 0;
+        if (write(ev_async_pipe[1], &c, 1) < 0)
+            PERROR("write");
+    }
+}
+
+/**
+ * \brief Function to deliver the event of a chain to a component
+ * \param ch Event chain
+ * \param compnt Component
+ * \return EV_HOP_NEXT, EV_HOP_STOP, or EV_HOP_WAIT (the chain is not usable anymore)
+ */
+static int ev_chain_hop(ev_chain_t *ch, compnt_t *compnt)
+{
+    event_out_t *ev_out = &ch->ev_out;
+    event_t *ev = (event_t *)ev_out;
+
+    uint16_t type = ev_out->type;
+    int perm = compnt->in_perm[type];
+
+    compnt->num_events[type]++;
+
+    if (compnt->site == COMPNT_INTERNAL) { // internal site
+        MEM_OWNER_PUSH(compnt->name);
+        ch->ret = compnt->handler(ev, (perm & COMPNT_WRITE) ? ev_out : NULL);
+        MEM_OWNER_POP();
+    } else if (perm & (COMPNT_WRITE | COMPNT_EXECUTE)) { // external site (request)
+        // events with pointers and shared-memory rings stay synchronous
+        if (ev_async_on && !ev_chain_sync && compnt->shm == NULL && ev_shm_event(type)) {
+            if (ev_take_credit(compnt)) {
+                ch->ret = ev_missed_msg(compnt);
+            } else {
+                ev_chain_t *dc = ev_chain_detach(ch);
+                if (dc != NULL) {
+                    dc->compnt = compnt;
+                    ev_chain_submit(dc);
+                    return EV_HOP_WAIT;
+                }
+
+                ev_put_credit(compnt);
+
+                ch->ret = ev_send_msg(compnt, ev_out->id, type, ev_out->length, ev_out->data,
+                                      (perm & COMPNT_WRITE) ? ev_out->data : NULL);
+            }
+        } else {
+            ch->ret = ev_send_msg(compnt, ev_out->id, type, ev_out->length, ev_out->data,
+                                  (perm & COMPNT_WRITE) ? ev_out->data : NULL);
+        }
+    } else { // external site (notification)
+        ch->ret = ev_push_msg(compnt, ev_out->id, type, ev_out->length, ev_out->data);
+        return EV_HOP_NEXT;
+    }
+
+    return (ch->ret && perm & COMPNT_EXECUTE) ? EV_HOP_STOP : EV_HOP_NEXT;
+}
+
+/**
+ * \brief Function to deliver the event of a chain to the rest of its components
+ * \param ch Event chain
+ * \return EV_HOP_NEXT (delivered to all), EV_HOP_STOP, or EV_HOP_WAIT (the chain is not usable anymore)
+ */
+static int ev_chain_run(ev_chain_t *ch)
+{
+    uint16_t type = ch->ev_out.type;
+
+    for (; ch->index < ch->ev_num; ch->index++, ch->stage = EV_STAGE_MAIN) {
+        compnt_t *compnt = ch->ev_list[ch->index];
+        int res;
+
+        if (ch->stage == EV_STAGE_MAIN) {
+            if (!compnt) continue;
+            if (!compnt->activated) continue; // not activated yet
+
+            if (compnt->role == COMPNT_SECURITY_V2)
+                ch->one_by_one = compnt;
+
+            if (ch->odp && ch->odp(__atomic_load_n(&compnt->odp, __ATOMIC_ACQUIRE), ch->ev_out.data)) continue;
+
+            ch->stage = EV_STAGE_CHECK;
+
+            res = ev_chain_hop(ch, compnt);
+            if (res != EV_HOP_NEXT) return res;
+        }
+
+        if (ch->stage == EV_STAGE_CHECK) {
+            ch->stage = EV_STAGE_DONE;
+
+            if (ch->one_by_one != NULL && compnt != ch->one_by_one && compnt->in_perm[type] & COMPNT_WRITE) {
+                res = ev_chain_hop(ch, ch->one_by_one);
+                if (res != EV_HOP_NEXT) return res;
+            }
+        }
+    }
+
+    return EV_HOP_NEXT;
+}
+
+/**
+ * \brief Function to go on with an event chain after the reply of an external component
+ * \param ch Event chain (detached)
+ */
+static void ev_chain_resume(ev_chain_t *ch)
+{
+    compnt_t *compnt = ch->compnt;
+
+    ev_put_credit(compnt);
+
+    if (ch->ret && compnt->in_perm[ch->ev_out.type] & COMPNT_EXECUTE) {
+        ev_chain_free(ch);
+        return;
+    }
+
+    epoch_enter();
+
+    if (ev_chain_run(ch) != EV_HOP_WAIT)
+        ev_chain_free(ch);
+
+    epoch_exit();
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to get the pipelined connection to an external component
+ * \param c Component context
+ * \return MQ socket (NULL: no connection)
+ */
+static void *ev_async_peer(compnt_t *c)
+{
+    int i;
+    for (i=0; i<ev_async_num_peers; i++) {
+        if (strcmp(ev_async_peers[i].addr, c->req_addr) == 0)
+            return ev_async_peers[i].sock;
+    }
+
+    if (ev_async_num_peers == __MAX_COMPONENTS) return NULL;
+
+    void *sock = zmq_socket(ev_async_ctx, ZMQ_DEALER);
+
+    if (zmq_connect(sock, c->req_addr)) {
+        PERROR("zmq_connect");
+        zmq_close(sock);
+        return NULL;
+    }
+
+    int linger = 0;
+    zmq_setsockopt(sock, ZMQ_LINGER, &linger, sizeof(int));
+
+    ev_peer_t *peer = &ev_async_peers[ev_async_num_peers++];
+
+    strcpy(peer->addr, c->req_addr);
+    peer->sock = sock;
+
+    return sock;
+}
+
+/**
+ * \brief Function to send the request of an event chain without waiting for its reply
+ * \param ch Event chain
+ * \return 0 if the request is queued, -1 otherwise
+ */
+static int ev_async_send(ev_chain_t *ch)
+{
+    compnt_t *c = ch->compnt;
+
+    if (!c->activated) return -1;
+
+    void *sock = ev_async_peer(c);
+    if (sock == NULL) return -1;
+
+    char json[__MAX_EXT_MSG_SIZE] = {0};
+    int len = export_to_json(ch->ev_out.id, ch->ev_out.type, ch->ev_out.data, json, 0);
+
+    ch->seq = ++ev_async_seq;
+
+    // the REP socket of the component sends the frames before the empty one back as they are
+    if (zmq_send(sock, &ch->seq, sizeof(uint64_t), ZMQ_SNDMORE | ZMQ_DONTWAIT) < 0)
+        return -1;
+    zmq_send(sock, "", 0, ZMQ_SNDMORE);
+    zmq_send(sock, json, len, 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &ch->deadline);
+
+    ch->deadline.tv_sec += c->timeout / 1000;
+    ch->deadline.tv_nsec += (c->timeout % 1000) * 1000000;
+    if (ch->deadline.tv_nsec >= 1000000000) {
+        ch->deadline.tv_sec++;
+        ch->deadline.tv_nsec -= 1000000000;
+    }
+
+    return 0;
+}
+
+/**
+ * \brief Function to receive the replies of external components
+ * \param sock MQ socket
+ */
+static void ev_async_recv(void *sock)
+{
+    while (1) {
+        uint64_t seq = 0;
+        char json[__MAX_EXT_MSG_SIZE] = {0};
+
+        if (zmq_recv(sock, &seq, sizeof(uint64_t), ZMQ_DONTWAIT) < 0) break;
+        zmq_recv(sock, json, __MAX_EXT_MSG_SIZE, 0); // empty frame
+        zmq_recv(sock, json, __MAX_EXT_MSG_SIZE, 0);
+
+        ev_chain_t *prev = NULL, *ch = ev_async_pending;
+        while (ch != NULL && ch->seq != seq) {
+            prev = ch;
+            ch = ch->next;
+        }
+
+        // replies to requests past their deadlines are discarded
+        if (ch == NULL) continue;
+
+        if (prev) prev->next = ch->next;
+        else ev_async_pending = ch->next;
+
+        uint16_t type = ch->ev_out.type;
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+
+        msg_t msg = {0};
+        msg.data = data;
+        msg.ret = import_from_json(&msg.id, &msg.type, json, msg.data);
+
+        if (ch->compnt->in_perm[type] & COMPNT_WRITE && msg.id == ch->ev_out.id && msg.type == type)
+            memcpy(ch->ev_out.data, msg.data, ch->ev_out.length);
+
+        ch->ret = msg.ret;
+
+        ev_chain_resume(ch);
+    }
+}
+
+/**
+ * \brief Function to apply the policies of the requests past their deadlines
+ * \param now The current time
+ * \return The time until the next deadline (ms)
+ */
+static int ev_async_expire(struct timespec *now)
+{
+    int wait = 1000;
+
+    ev_chain_t *prev = NULL, *ch = ev_async_pending;
+    while (ch != NULL) {
+        int64_t left = (ch->deadline.tv_sec - now->tv_sec) * 1000 +
+                       (ch->deadline.tv_nsec - now->tv_nsec) / 1000000;
+
+        if (left > 0) {
+            if (left < wait) wait = left;
+
+            prev = ch;
+            ch = ch->next;
+
+            continue;
+        }
+
+        ev_chain_t *next = ch->next;
+
+        if (prev) prev->next = next;
+        else ev_async_pending = next;
+
+        __sync_fetch_and_add(&ch->compnt->num_timeouts, 1);
+        ch->ret = ev_missed_msg(ch->compnt);
+
+        ev_chain_resume(ch);
+
+        ch = next;
+    }
+
+    return wait;
+}
+
+/**
+ * \brief Function to pipeline the requests of event chains to external components
+ * \param null NULL
+ */
+static void *async_events(void *null)
+{
+    ev_async_self = TRUE;
+
+    zmq_pollitem_t items[__MAX_COMPONENTS + 1];
+
+    int wait = 1000;
+
+    while (ev_ctx->ev_on) {
+        items[0].socket = NULL;
+        items[0].fd = ev_async_pipe[0];
+        items[0].events = ZMQ_POLLIN;
+        items[0].revents = 0;
+
+        int i, num_items = 1;
+        for (i=0; i<ev_async_num_peers; i++) {
+            items[num_items].socket = ev_async_peers[i].sock;
+            items[num_items].fd = 0;
+            items[num_items].events = ZMQ_POLLIN;
+            items[num_items].revents = 0;
+            num_items++;
+        }
+
+        zmq_poll(items, num_items, wait);
+
+        if (items[0].revents & ZMQ_POLLIN) {
+            char buf[64];
+            if (read(ev_async_pipe[0], buf, sizeof(buf)) < 0)
+                PERROR("read");
+        }
+
+        for (i=1; i<num_items; i++) {
+            if (items[i].revents & ZMQ_POLLIN)
+                ev_async_recv(items[i].socket);
+        }
+
+        // send new requests (including the ones of the chains resumed above)
+        while (1) {
+            pthread_mutex_lock(&ev_async_lock);
+
+            ev_chain_t *ch = ev_async_head;
+            ev_async_head = ev_async_tail = NULL;
+
+            pthread_mutex_unlock(&ev_async_lock);
+
+            if (ch == NULL) break;
+
+            while (ch != NULL) {
+                ev_chain_t *next = ch->next;
+
+                if (ev_async_send(ch) == 0) {
+                    ch->next = ev_async_pending;
+                    ev_async_pending = ch;
+                } else {
+                    ch->ret = ev_missed_msg(ch->compnt);
+                    ev_chain_resume(ch);
+                }
+
+                ch = next;
+            }
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        wait = ev_async_expire(&now);
+    }
+
+    ev_async_on = FALSE;
+
+    // drop the chains left behind
+    pthread_mutex_lock(&ev_async_lock);
+
+    ev_chain_t *ch = ev_async_head;
+    ev_async_head = ev_async_tail = NULL;
+
+    pthread_mutex_unlock(&ev_async_lock);
+
+    while (ch != NULL) {
+        ev_chain_t *next = ch->next;
+        ev_put_credit(ch->compnt);
+        ev_chain_free(ch);
+        ch = next;
+    }
+
+    ch = ev_async_pending;
+    ev_async_pending = NULL;
+
+    while (ch != NULL) {
+        ev_chain_t *next = ch->next;
+        ev_put_credit(ch->compnt);
+        ev_chain_free(ch);
+        ch = next;
+    }
+
+    int i;
+    for (i=0; i<ev_async_num_peers; i++)
+        zmq_close(ev_async_peers[i].sock);
+    ev_async_num_peers = 0;
+
+    DEBUG("async_events() is terminated\n");
+
+    return NULL;
+}
@@ -7,111 +7,64 @@
  * \author Jaehyun Nam <namjh@kaist.ac.kr>
  */
 
-static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, const FUNC_TYPE *data)
+#ifdef ODP_FUNC
+/** \brief Function to check the operator-defined policies of a component for the event data of a chain */
+static int EV_CONCAT(FUNC_NAME, _odp)(odp_t *odp, const void *data)
 {
-    int ret = 0;
+    return ODP_FUNC(odp, (const FUNC_TYPE *)data);
+}
+#endif /* ODP_FUNC */
 
-    int ev_num = ev_ctx->ev_num[type];
-    compnt_t **ev_list = ev_ctx->ev_list[type];
+static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, const FUNC_TYPE *data)
+{
+    epoch_enter();
 
-    if (ev_list == NULL) return -1;
+    compnt_conf_t *conf = ev_conf();
 
     // outbound check:
     // investigate whether the given event type belongs to the component's outbound events
-    int i, j, pass = 0;
-    for (i=0; i<ev_ctx->num_compnts; i++) {
-        compnt_t *compnt = ev_ctx->compnt_list[i];
-        for (j=0; j<compnt->out_num; j++) {
-            if (compnt->out_list[j] == type) {
-                pass = 1;
-                break;
-            }
-        }
-        if (pass) break;
+    if (conf == NULL || !conf->out_ok[type]) {
+        epoch_exit();
+        return -1;
     }
-    if (!pass) return -1;
 
-    event_out_t ev_out;
-    event_t *ev = (event_t *)&ev_out;
+    ev_chain_t chain = {0};
+    event_t *ev = (event_t *)&chain.ev_out;
 
-    ev_out.id = id;
-    ev_out.type = type;
-    ev_out.length = len;
-    ev_out.checksum = 0;
+    chain.ev_out.id = id;
+    chain.ev_out.type = type;
+    chain.ev_out.length = len;
+    chain.ev_out.checksum = 0;
+
+    // computed once here, then only re-verified after components that can write
+    if (ev_checksum_enabled)
+        chain.ev_out.checksum = crc32c_func(data, len);
 
     if (API_monitor_enabled)
-        clock_gettime(CLOCK_REALTIME, &ev_out.time);
+        clock_gettime(CLOCK_REALTIME, &chain.ev_out.time);
 
     ev->FUNC_DATA = data;
 
     ev_ctx->num_events[type]++;
 
-    compnt_t *one_by_one = NULL;
-
-    for (i=0; i<ev_num; i++) {
-        compnt_t *compnt = ev_list[i];
-
-        if (!compnt) continue;
-        if (!compnt->activated) continue; // not activated yet
-
-        if (compnt->role == COMPNT_SECURITY_V2) {
-            if (compnt->activated) one_by_one = compnt;
-        }
+    chain.conf = conf;
+    chain.ev_list = conf->ev_list[type];
+    chain.ev_num = conf->ev_num[type];
 
 #ifdef ODP_FUNC
-        if (ODP_FUNC(compnt->odp, data)) continue;
+    chain.odp = EV_CONCAT(FUNC_NAME, _odp);
 #endif /* ODP_FUNC */
 
-        compnt->num_events[type]++;
-
-        if (compnt->in_perm[type] & COMPNT_WRITE) {
-            if (compnt->site == COMPNT_INTERNAL) { // internal site
-                ret = compnt->handler(ev, &ev_out);
-            } else { // external site
-                ret = ev_send_msg(compnt, id, type, len, data, ev_out.data);
-            }
-            if (ret && compnt->in_perm[type] & COMPNT_EXECUTE) break;
-        } else {
-            if (compnt->site == COMPNT_INTERNAL) { // internal site
-                ret = compnt->handler(ev, NULL);
-                if (ret && compnt->in_perm[type] & COMPNT_EXECUTE) break;
-            } else { // external site
-                if (compnt->in_perm[type] & COMPNT_EXECUTE) {
-                    ret = ev_send_msg(compnt, id, type, len, data, NULL);
-                    if (ret) break;
-                } else {
-                    ret = ev_push_msg(compnt, id, type, len, data);
-                }
-            }
-        }
-
-        if (one_by_one != NULL && compnt != one_by_one) {
-            compnt = one_by_one;
-
-            compnt->num_events[type]++;
-
-            if (compnt->in_perm[type] & COMPNT_WRITE) {
-                if (compnt->site == COMPNT_INTERNAL) { // internal site
-                    ret = compnt->handler(ev, &ev_out);
-                } else { // external site
-                    ret = ev_send_msg(compnt, id, type, len, data, ev_out.data);
-                }
-                if (ret && compnt->in_perm[type] & COMPNT_EXECUTE) break;
-            } else {
-                if (compnt->site == COMPNT_INTERNAL) { // internal site
-                    ret = compnt->handler(ev, NULL);
-                    if (ret && compnt->in_perm[type] & COMPNT_EXECUTE) break;
-                } else { // external site
-                    if (compnt->in_perm[type] & COMPNT_EXECUTE) {
-                        ret = ev_send_msg(compnt, id, type, len, data, NULL);
-                        if (ret) break;
-                    } else {
-                        ret = ev_push_msg(compnt, id, type, len, data);
-                    }
-                }
-            }
-        }
+    // events of a class scheduled apart are delivered by the workers of the class
+    if (ev_sched_defer(&chain) == 0) {
+        epoch_exit();
+        return 0;
     }
 
+    // the rest of the chain goes on in the async thread once a component is waited for
+    int ret = (ev_chain_run(&chain) == EV_HOP_WAIT) ? 0 : chain.ret;
+
+    epoch_exit();
+
     return ret;
 }
@@ -20,6 +20,9 @@ enum {
     EV_DP_PORT_MODIFIED,
     EV_DP_PORT_DELETED,
     EV_DP_PORT_STATS,
+    EV_DP_MULTI_FLOW_STATS,
+    EV_DP_MULTI_PORT_STATS,
+    EV_DP_FLOWS_INSTALLED,
     EV_ALL_UPSTREAM,
     // downstream
     EV_OFP_MSG_OUT,
@@ -27,6 +30,7 @@ enum {
     EV_DP_INSERT_FLOW,
     EV_DP_MODIFY_FLOW,
     EV_DP_DELETE_FLOW,
+    EV_DP_INSERT_FLOWS,
     EV_DP_REQUEST_FLOW_STATS,
     EV_DP_REQUEST_AGGREGATE_STATS,
     EV_DP_MODIFY_PORT,
@@ -36,6 +40,8 @@ enum {
     EV_SW_GET_DPID,
     EV_SW_GET_FD,
     EV_SW_GET_XID,
+    EV_RT_GET_ROUTE,
+    EV_RT_GET_TREE,
     EV_WRT_INTSTREAM,
     // internal (notification)
     EV_SW_NEW_CONN,
@@ -23,6 +23,9 @@ void ev_dp_port_added(uint32_t id, const port_t *data);
 void ev_dp_port_modified(uint32_t id, const port_t *data);
 void ev_dp_port_deleted(uint32_t id, const port_t *data);
 void ev_dp_port_stats(uint32_t id, const port_t *data);
+void ev_dp_multi_flow_stats(uint32_t id, const flows_t *data);
+void ev_dp_multi_port_stats(uint32_t id, const ports_t *data);
+void ev_dp_flows_installed(uint32_t id, const flow_batch_t *data);
 
 // downstream ///////////////////////////////////////////////////////
 
@@ -31,6 +34,7 @@ void ev_dp_send_packet(uint32_t id, const pktout_t *data);
 void ev_dp_insert_flow(uint32_t id, const flow_t *data);
 void ev_dp_modify_flow(uint32_t id, const flow_t *data);
 void ev_dp_delete_flow(uint32_t id, const flow_t *data);
+void ev_dp_insert_flows(uint32_t id, const flows_t *data);
 void ev_dp_request_flow_stats(uint32_t id, const flow_t *data);
 void ev_dp_request_aggregate_stats(uint32_t id, const flow_t *data);
 void ev_dp_modify_port(uint32_t id, const port_t *data);
@@ -41,6 +45,8 @@ void ev_dp_request_port_stats(uint32_t id, const port_t *data);
 void ev_sw_get_dpid(uint32_t id, switch_t *data);
 void ev_sw_get_fd(uint32_t id, switch_t *data);
 void ev_sw_get_xid(uint32_t id, switch_t *data);
+void ev_rt_get_route(uint32_t id, route_t *data);
+void ev_rt_get_tree(uint32_t id, tree_t *data);
 
 // internal (notification) //////////////////////////////////////////
 
@@ -21,11 +21,16 @@
 
 /////////////////////////////////////////////////////////////////////
 
+static int ev_shm_attach(compnt_t *c);
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief Function to activate an external component
  * \param msg Handshake message
+ * \param shm The flag whether shared-memory rings are attached (output)
  */
-static int activate_external_component(char *msg)
+static int activate_external_component(char *msg, int *shm)
 {
     json_t *json = NULL;
     json_error_t error;
@@ -46,31 +51,45 @@ static int activate_external_component(char *msg)
     if (json_is_string(j_name))
         strcpy(name, json_string_value(j_name));
 
+    int use_shm = json_is_true(json_object_get(json, "shm"));
+
     if (id == 0 || strlen(name) == 0) {
         json_decref(json);
         return -1;
     }
 
-    int i;
-    for (i=0; i<ev_ctx->num_compnts; i++) {
-        if (ev_ctx->compnt_list[i]->component_id == id) {
-            if (strcmp(ev_ctx->compnt_list[i]->name, name) == 0) {
-                compnt_t *compnt = ev_ctx->compnt_list[i];
+    epoch_enter();
+
+    compnt_conf_t *conf = ev_conf();
+
+    int i, num_compnts = (conf) ? conf->num_compnts : 0;
+    for (i=0; i<num_compnts; i++) {
+        compnt_t *compnt = conf->compnt_list[i];
+
+        if (compnt->component_id == id) {
+            if (strcmp(compnt->name, name) == 0) {
+                if (compnt->site == COMPNT_EXTERNAL) {
+                    if (use_shm)
+                        *shm = (ev_shm_attach(compnt) == 0);
 
-                if (compnt->site == COMPNT_EXTERNAL)
                     compnt->activated = TRUE;
+                }
+
+                epoch_exit();
 
                 json_decref(json);
 
                 return 0;
             } else {
                 LOG_WARN(0, "Blocked the connection of an unauthorized component");
-                LOG_WARN(0, " - Registered key: %u", ev_ctx->compnt_list[i]->component_id);
-                LOG_WARN(0, " - Registered configuration: %s", ev_ctx->compnt_list[i]->name);
+                LOG_WARN(0, " - Registered key: %u", compnt->component_id);
+                LOG_WARN(0, " - Registered configuration: %s", compnt->name);
                 LOG_WARN(0, " - Given key: %u", id);
                 LOG_WARN(0, " - Given configuration: %s", name);
                 LOG_WARN(0, " - Reason: The configuration of the given component is not matched with the registered one.");
 
+                epoch_exit();
+
                 json_decref(json);
 
                 return -1;
@@ -78,6 +97,8 @@ static int activate_external_component(char *msg)
         }
     }
 
+    epoch_exit();
+
     LOG_WARN(0, "Blocked the connection of an unauthorized component");
     LOG_WARN(0, " - Given key: %u", id);
     LOG_WARN(0, " - Given configuration: %s", name);
@@ -90,6 +111,80 @@ static int activate_external_component(char *msg)
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to check whether an event can be carried through shared-memory rings as it is
+ * \param type Event type
+ */
+static int ev_shm_event(uint16_t type)
+{
+    switch (type) {
+
+    // events pointing to other buffers
+    case EV_OFP_MSG_IN:
+    case EV_OFP_MSG_OUT:
+    case EV_DP_MULTI_FLOW_STATS:
+    case EV_DP_MULTI_PORT_STATS:
+    case EV_DP_INSERT_FLOWS:
+        return FALSE;
+
+    default:
+        return TRUE;
+    }
+}
+
+/**
+ * \brief Function to clear the pointers copied from the other side of shared-memory rings
+ * \param msg Events
+ */
+static void ev_shm_import(msg_t *msg)
+{
+    switch (msg->type) {
+    case EV_DP_FLOW_EXPIRED:
+    case EV_DP_FLOW_DELETED:
+    case EV_DP_FLOW_STATS:
+    case EV_DP_AGGREGATE_STATS:
+    case EV_DP_INSERT_FLOW:
+    case EV_DP_MODIFY_FLOW:
+    case EV_DP_DELETE_FLOW:
+    case EV_DP_REQUEST_FLOW_STATS:
+    case EV_DP_REQUEST_AGGREGATE_STATS:
+    case EV_FLOW_ADDED:
+    case EV_FLOW_MODIFIED:
+    case EV_FLOW_DELETED:
+        {
+            flow_t *flow = (flow_t *)msg->data;
+
+            flow->prev = NULL;
+            flow->next = NULL;
+            flow->r_next = NULL;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * \brief Function to get the batch of an external component (created on the first event)
+ * \param c Component context
+ */
+static msg_batch_t *ev_batch_get(compnt_t *c)
+{
+    msg_batch_t *batch = c->batch;
+    if (batch != NULL) return batch;
+
+    batch = msg_batch_create(c->batch_max, c->batch_usec);
+    if (batch == NULL) return NULL;
+
+    // another thread may have created one at the same time
+    if (!__sync_bool_compare_and_swap(&c->batch, NULL, batch)) {
+        msg_batch_destroy(batch);
+        batch = c->batch;
+    }
+
+    return batch;
+}
+
 /**
  * \brief Function to send events to an external component
  * \param c Component context
@@ -102,9 +197,19 @@ static int ev_push_msg(compnt_t *c, uint32_t id, uint16_t type, uint16_t size, c
 {
     if (!c->activated) return -1;
 
+    shm_link_t *link = c->shm;
+    if (link != NULL && ev_shm_event(type))
+        return shm_ring_push(&link->down, id, type, 0, 0, input, size);
+
     char json[__MAX_EXT_MSG_SIZE] = {0};
     int len = export_to_json(id, type, input, json, 0);
 
+    if (c->batch_max > 0) {
+        msg_batch_t *batch = ev_batch_get(c);
+        if (batch != NULL)
+            return msg_batch_add(batch, c->push_ctx, c->push_addr, json, len);
+    }
+
     void *push_sock = zmq_socket(c->push_ctx, ZMQ_PUSH);
 
     if (zmq_connect(push_sock, c->push_addr)) {
@@ -121,6 +226,82 @@ static int ev_push_msg(compnt_t *c, uint32_t id, uint16_t type, uint16_t size, c
     return 0;
 }
 
+/**
+ * \brief Function to get the result of a request that an external component could not take in time
+ * \param c Component context
+ * \return 0 to go on with the next component (pass), -1 to fail the request (drop)
+ */
+static int ev_missed_msg(compnt_t *c)
+{
+    if (c->on_timeout == COMPNT_FAIL_CLOSED)
+        return -1;
+
+    // skipped requests are reported at most once a second
+    time_t now = time(NULL);
+    time_t last = c->missed_warned;
+
+    if (now != last && __sync_bool_compare_and_swap(&c->missed_warned, last, now))
+        LOG_WARN(c->component_id, "%s skipped a request (missed deadlines: %lu, throttled: %lu)",
+                 c->name, c->num_timeouts, c->num_throttled);
+
+    return 0;
+}
+
+/**
+ * \brief Function to take a credit of an external component before sending a request
+ * \param c Component context
+ * \return 0 if a credit is taken, -1 if the component has none left until the deadline
+ */
+static int ev_take_credit(compnt_t *c)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&ev_credit_lock);
+
+    // the async thread returns credits itself, so it never waits for them
+    if (c->in_flight >= c->credits && !ev_async_self) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+
+        ts.tv_sec += c->timeout / 1000;
+        ts.tv_nsec += (c->timeout % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+
+        while (c->in_flight >= c->credits && c->activated) {
+            if (pthread_cond_timedwait(&ev_credit_cond, &ev_credit_lock, &ts))
+                break;
+        }
+    }
+
+    if (c->in_flight < c->credits) {
+        c->in_flight++;
+    } else {
+        c->num_throttled++;
+        ret = -1;
+    }
+
+    pthread_mutex_unlock(&ev_credit_lock);
+
+    return ret;
+}
+
+/**
+ * \brief Function to return a credit of an external component
+ * \param c Component context
+ */
+static void ev_put_credit(compnt_t *c)
+{
+    pthread_mutex_lock(&ev_credit_lock);
+
+    c->in_flight--;
+    pthread_cond_broadcast(&ev_credit_cond);
+
+    pthread_mutex_unlock(&ev_credit_lock);
+}
+
 /**
  * \brief Function to send events to an external component and receive its responses
  * \param c Component context
@@ -135,6 +316,34 @@ static int ev_send_msg(compnt_t *c, uint32_t id, uint16_t type, uint16_t size, c
 {
     if (!c->activated) return -1;
 
+    if (ev_take_credit(c))
+        return ev_missed_msg(c);
+
+    shm_link_t *link = c->shm;
+    if (link != NULL && ev_shm_event(type)) {
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+        shm_rec_t rec;
+
+        int ret = shm_chan_call(&link->down_call, id, type, input, size, &rec, data, __MAX_MSG_SIZE, c->timeout);
+
+        ev_put_credit(c);
+
+        if (ret) {
+            __sync_fetch_and_add(&c->num_timeouts, 1);
+            return ev_missed_msg(c);
+        }
+
+        msg_t msg = {0};
+        msg.type = type;
+        msg.data = data;
+        ev_shm_import(&msg);
+
+        if (c->in_perm[type] & COMPNT_WRITE && rec.id == id && rec.type == type)
+            memcpy(output, data, size);
+
+        return rec.ret;
+    }
+
     char json_in[__MAX_EXT_MSG_SIZE] = {0};
     int len = export_to_json(id, type, input, json_in, 0);
 
@@ -142,15 +351,27 @@ static int ev_send_msg(compnt_t *c, uint32_t id, uint16_t type, uint16_t size, c
 
     if (zmq_connect(req_sock, c->req_addr)) {
         PERROR("zmq_connect");
+        zmq_close(req_sock);
+        ev_put_credit(c);
         return -1;
     }
 
+    int linger = 0;
+    zmq_setsockopt(req_sock, ZMQ_LINGER, &linger, sizeof(int));
+    zmq_setsockopt(req_sock, ZMQ_RCVTIMEO, &c->timeout, sizeof(int));
+
     //printf("%s: %s\n", __FUNCTION__, json_in);
 
     zmq_send(req_sock, json_in, len, 0);
 
     char json_out[__MAX_EXT_MSG_SIZE] = {0};
-    zmq_recv(req_sock, json_out, __MAX_EXT_MSG_SIZE, 0);
+    if (zmq_recv(req_sock, json_out, __MAX_EXT_MSG_SIZE, 0) < 0) {
+        zmq_close(req_sock);
+        ev_put_credit(c);
+
+        __sync_fetch_and_add(&c->num_timeouts, 1);
+        return ev_missed_msg(c);
+    }
 
     uint8_t data[__MAX_MSG_SIZE] = {0};
 
@@ -162,6 +383,7 @@ static int ev_send_msg(compnt_t *c, uint32_t id, uint16_t type, uint16_t size, c
         memcpy(output, msg.data, size);
 
     zmq_close(req_sock);
+    ev_put_credit(c);
 
     return msg.ret;
 }
@@ -207,6 +429,9 @@ static int process_events(msg_t *msg)
     case EV_DP_PORT_STATS:
         ret = port_ev_raise(msg->id, EV_DP_PORT_STATS, sizeof(port_t), (const port_t *)msg->data);
         break;
+    case EV_DP_FLOWS_INSTALLED:
+        ret = batch_ev_raise(msg->id, EV_DP_FLOWS_INSTALLED, sizeof(flow_batch_t), (const flow_batch_t *)msg->data);
+        break;
 
     // downstream events
 
@@ -246,6 +471,12 @@ static int process_events(msg_t *msg)
     case EV_SW_GET_XID:
         ret = sw_rw_raise(msg->id, EV_SW_GET_XID, sizeof(switch_t), (switch_t *)msg->data);
         break;
+    case EV_RT_GET_ROUTE:
+        ret = route_rw_raise(msg->id, EV_RT_GET_ROUTE, sizeof(route_t), (route_t *)msg->data);
+        break;
+    case EV_RT_GET_TREE:
+        ret = tree_rw_raise(msg->id, EV_RT_GET_TREE, sizeof(tree_t), (tree_t *)msg->data);
+        break;
 
     // internal events (notification)
 
@@ -334,18 +565,28 @@ static void *pull_events(void *null)
         if (!ev_ctx->ev_on) break;
         else if (zmq_recv(ev_pull_sock, json, __MAX_EXT_MSG_SIZE, 0) < 0) continue;
 
-        //printf("%s: %s\n", __FUNCTION__, json);
+        // a batch comes as one multipart message with an event per frame
+        int more = TRUE;
+        while (more) {
+            //printf("%s: %s\n", __FUNCTION__, json);
 
-        uint8_t data[__MAX_MSG_SIZE] = {0};
+            uint8_t data[__MAX_MSG_SIZE] = {0};
 
-        msg_t msg = {0};
-        msg.data =data;
-        import_from_json(&msg.id, &msg.type, json, msg.data);
+            msg_t msg = {0};
+            msg.data = data;
+            import_from_json(&msg.id, &msg.type, json, msg.data);
 
-        if (msg.id == 0) continue;
-        else if (msg.type > EV_NUM_EVENTS) continue;
+            if (msg.id != 0 && msg.type < EV_NUM_EVENTS)
+                process_events(&msg);
 
-        process_events(&msg);
+            size_t more_size = sizeof(int);
+            if (zmq_getsockopt(ev_pull_sock, ZMQ_RCVMORE, &more, &more_size) || !more) break;
+
+            int len = zmq_recv(ev_pull_sock, json, __MAX_EXT_MSG_SIZE - 1, 0);
+            if (len < 0) break;
+
+            json[MIN(len, __MAX_EXT_MSG_SIZE - 1)] = '\0';
+        }
 
         if (!ev_ctx->ev_on) break;
     }
@@ -355,30 +596,247 @@ static void *pull_events(void *null)
     return NULL;
 }
 
+/**
+ * \brief Function to send the batches held longer than their time limits
+ * \param null NULL
+ */
+static void *flush_events(void *null)
+{
+    while (ev_ctx->ev_on) {
+        int wait = 999999; // us
+
+        epoch_enter();
+
+        compnt_conf_t *conf = ev_conf();
+
+        int i, num_compnts = (conf) ? conf->num_compnts : 0;
+        for (i=0; i<num_compnts; i++) {
+            compnt_t *c = conf->compnt_list[i];
+
+            if (c == NULL || c->batch == NULL) continue;
+            else if (!c->activated) continue;
+
+            int left = msg_batch_flush(c->batch, c->push_ctx, c->push_addr, FALSE);
+            if (left < 0) left = c->batch->usec;
+
+            if (left < wait) wait = left;
+        }
+
+        epoch_exit();
+
+        waitsec(0, wait * 1000);
+    }
+
+    DEBUG("flush_events() is terminated\n");
+
+    return NULL;
+}
+
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to relay all frames of a message from one socket to another
+ * \param from Source socket
+ * \param to Destination socket
+ */
+static void relay_events(void *from, void *to)
+{
+    int more = TRUE;
+
+    while (more) {
+        zmq_msg_t part;
+        zmq_msg_init(&part);
+
+        if (zmq_msg_recv(&part, from, 0) < 0) {
+            zmq_msg_close(&part);
+            break;
+        }
+
+        more = zmq_msg_more(&part);
+
+        zmq_msg_send(&part, to, (more) ? ZMQ_SNDMORE : 0);
+        zmq_msg_close(&part);
+    }
+}
+
+/** \brief The maximum number of frames in the routing envelope of a request */
+#define EV_MAX_ENVELOPE 8
+
+/**
+ * \brief Function to receive a request with its routing envelope (reply workers)
+ * \param sock Worker socket
+ * \param env The frames of the envelope (output, released by the reply)
+ * \param num_env The number of the frames (output)
+ * \param json The buffer for the request
+ * \param max The size of the buffer
+ * \return The length of the request, -1 if nothing is received
+ */
+static int recv_envelope(void *sock, zmq_msg_t *env, int *num_env, char *json, int max)
+{
+    *num_env = 0;
+
+    while (1) {
+        zmq_msg_t part;
+        zmq_msg_init(&part);
+
+        if (zmq_msg_recv(&part, sock, 0) < 0) {
+            zmq_msg_close(&part);
+            break;
+        }
+
+        if (!zmq_msg_more(&part)) {
+            int len = MIN(zmq_msg_size(&part), max - 1);
+            memcpy(json, zmq_msg_data(&part), len);
+            json[len] = '\0';
+
+            zmq_msg_close(&part);
+
+            return len;
+        }
+
+        // the frames beyond the limit are dropped, so the reply cannot be routed back
+        if (*num_env < EV_MAX_ENVELOPE) {
+            zmq_msg_init(&env[*num_env]);
+            zmq_msg_move(&env[(*num_env)++], &part);
+        }
+
+        zmq_msg_close(&part);
+    }
+
+    int i;
+    for (i=0; i<*num_env; i++)
+        zmq_msg_close(&env[i]);
+    *num_env = 0;
+
+    return -1;
+}
+
+/**
+ * \brief Function to send a reply with the routing envelope of its request (reply workers)
+ * \param sock Worker socket
+ * \param env The frames of the envelope (released)
+ * \param num_env The number of the frames
+ * \param json Reply
+ * \param len The length of the reply
+ */
+static int send_envelope(void *sock, zmq_msg_t *env, int num_env, const char *json, int len)
+{
+    int i;
+    for (i=0; i<num_env; i++) {
+        zmq_msg_send(&env[i], sock, ZMQ_SNDMORE);
+        zmq_msg_close(&env[i]);
+    }
+
+    return zmq_send(sock, json, len, 0);
+}
+
+/**
+ * \brief Function to dispatch requests to workers and return their replies to the requesters
+ * \param null NULL
+ */
+static void *proxy_events(void *null)
+{
+    // the routing IDs of idle workers (the least recently used first)
+    uint8_t idle[__EXT_MAX_REPLY_WORKERS][256];
+    size_t idle_len[__EXT_MAX_REPLY_WORKERS];
+    int num_idle = 0;
+
+    zmq_pollitem_t items[] = {
+        { ev_worker_sock, 0, ZMQ_POLLIN, 0 },
+        { ev_rep_sock, 0, ZMQ_POLLIN, 0 },
+    };
+
+    while (ev_ctx->ev_on) {
+        // requests are taken only when a worker is free, so none waits behind a slow request
+        items[1].revents = 0;
+        if (zmq_poll(items, (num_idle > 0) ? 2 : 1, 1000) <= 0) continue;
+
+        // [worker ID][empty][READY] or [worker ID][empty][envelope of the request][reply]
+        if (items[0].revents & ZMQ_POLLIN) {
+            uint8_t id[256];
+            int id_len = zmq_recv(ev_worker_sock, id, sizeof(id), 0);
+
+            zmq_msg_t part;
+            zmq_msg_init(&part);
+
+            if (id_len > 0 && id_len <= sizeof(id) && zmq_recv(ev_worker_sock, NULL, 0, 0) >= 0 &&
+                zmq_msg_recv(&part, ev_worker_sock, 0) >= 0) {
+                if (zmq_msg_more(&part)) {
+                    zmq_msg_send(&part, ev_rep_sock, ZMQ_SNDMORE);
+                    relay_events(ev_worker_sock, ev_rep_sock);
+                }
+
+                if (num_idle < __EXT_MAX_REPLY_WORKERS) {
+                    memcpy(idle[num_idle], id, id_len);
+                    idle_len[num_idle++] = id_len;
+                }
+            }
+
+            zmq_msg_close(&part);
+        }
+
+        // [envelope of the request][request] to the least recently used worker
+        if (num_idle > 0 && (items[1].revents & ZMQ_POLLIN)) {
+            zmq_send(ev_worker_sock, idle[0], idle_len[0], ZMQ_SNDMORE);
+            zmq_send(ev_worker_sock, NULL, 0, ZMQ_SNDMORE);
+            relay_events(ev_rep_sock, ev_worker_sock);
+
+            num_idle--;
+            memmove(idle[0], idle[1], sizeof(idle[0]) * num_idle);
+            memmove(&idle_len[0], &idle_len[1], sizeof(idle_len[0]) * num_idle);
+        }
+    }
+
+    DEBUG("proxy_events() is terminated\n");
+
+    return NULL;
+}
+
 /**
  * \brief Function to handle requests from components and reply them
  * \param null NULL
  */
 static void *reply_events(void *null)
 {
+    // the requesting component waits for the result of the whole event chain
+    ev_chain_sync = TRUE;
+
+    void *sock = zmq_socket(ev_rep_ctx, ZMQ_REQ);
+
+    if (zmq_connect(sock, __EXT_COMP_WORKER_ADDR)) {
+        PERROR("zmq_connect");
+        zmq_close(sock);
+        return NULL;
+    }
+
+    int timeout = 1000;
+    zmq_setsockopt(sock, ZMQ_RCVTIMEO, &timeout, sizeof(int));
+
+    // tell the router that this worker is free
+    zmq_send(sock, "READY", 5, 0);
+
     while (ev_ctx->ev_on) {
         char json[__MAX_EXT_MSG_SIZE] = {0};
 
+        // the routing envelope of a request, which goes back with its reply
+        zmq_msg_t env[EV_MAX_ENVELOPE];
+        int num_env = 0;
+
         if (!ev_ctx->ev_on) break;
-        else if (zmq_recv(ev_rep_sock, json, __MAX_EXT_MSG_SIZE, 0) < 0) continue;
+        else if (recv_envelope(sock, env, &num_env, json, __MAX_EXT_MSG_SIZE) < 0) continue;
 
         //printf("%s: %s\n", __FUNCTION__, json);
 
         // handshake with an external component
         if (json[0] == '#') {
-            if (activate_external_component(json + 1) == 0)
-                strcpy(json, "#{\"return\": 0}");
+            int shm = FALSE;
+
+            if (activate_external_component(json + 1, &shm) == 0)
+                strcpy(json, (shm) ? "#{\"return\": 0, \"shm\": 1}" : "#{\"return\": 0}");
             else
                 strcpy(json, "#{\"return\": -1}");
 
-            zmq_send(ev_rep_sock, json, strlen(json), 0);
+            send_envelope(sock, env, num_env, json, strlen(json));
 
             continue;
         }
@@ -386,24 +844,183 @@ static void *reply_events(void *null)
         uint8_t data[__MAX_MSG_SIZE] = {0};
 
         msg_t msg = {0};
-        msg.data =data;
+        msg.data = data;
         import_from_json(&msg.id, &msg.type, json, msg.data);
 
-        if (msg.id == 0) continue;
-        else if (msg.type > EV_NUM_EVENTS) continue;
+        // a REQ socket cannot take the next request before replying to this one
+        if (msg.id == 0 || msg.type >= EV_NUM_EVENTS) {
+            strcpy(json, "{\"return\": -1}");
+            send_envelope(sock, env, num_env, json, strlen(json));
+            continue;
+        }
 
         msg.ret = process_events(&msg);
         export_to_json(msg.id, msg.type, msg.data, json, msg.ret);
-        zmq_send(ev_rep_sock, json, strlen(json), 0);
+        send_envelope(sock, env, num_env, json, strlen(json));
 
         if (!ev_ctx->ev_on) break;
     }
 
+    zmq_close(sock);
+
     DEBUG("reply_events() is terminated\n");
 
     return NULL;
 }
 
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to receive events through shared-memory rings
+ * \param arg Shared-memory link
+ */
+static void *shm_pull_events(void *arg)
+{
+    shm_link_t *link = (shm_link_t *)arg;
+
+    while (ev_ctx->ev_on && link->active) {
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+        shm_rec_t rec;
+
+        if (shm_ring_pop(&link->up, &rec, data, __MAX_MSG_SIZE - 1, 1000) < 0) continue;
+
+        msg_t msg = {0};
+        msg.id = rec.id;
+        msg.type = rec.type;
+        msg.data = data;
+
+        // records carrying the pointers of the other side are never sent through the rings
+        if (msg.id == 0) continue;
+        else if (msg.type >= EV_NUM_EVENTS || !ev_shm_event(msg.type)) continue;
+
+        ev_shm_import(&msg);
+        process_events(&msg);
+    }
+
+    DEBUG("shm_pull_events() is terminated\n");
+
+    return NULL;
+}
+
+/**
+ * \brief Function to handle requests through shared-memory rings and reply them
+ * \param arg Shared-memory link
+ */
+static void *shm_reply_events(void *arg)
+{
+    shm_link_t *link = (shm_link_t *)arg;
+
+    ev_chain_sync = TRUE;
+
+    while (ev_ctx->ev_on && link->active) {
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+        shm_rec_t rec;
+
+        int len = shm_ring_pop(&link->up_call.req, &rec, data, __MAX_MSG_SIZE - 1, 1000);
+        if (len < 0) continue;
+
+        msg_t msg = {0};
+        msg.id = rec.id;
+        msg.type = rec.type;
+        msg.data = data;
+
+        // records carrying the pointers of the other side are never sent through the rings
+        if (msg.id == 0 || msg.type >= EV_NUM_EVENTS || !ev_shm_event(msg.type)) {
+            shm_chan_reply(&link->up_call, &rec, -1, NULL, 0);
+            continue;
+        }
+
+        ev_shm_import(&msg);
+
+        msg.ret = process_events(&msg);
+        shm_chan_reply(&link->up_call, &rec, msg.ret, msg.data, len);
+    }
+
+    DEBUG("shm_reply_events() is terminated\n");
+
+    return NULL;
+}
+
+/**
+ * \brief Function to attach the shared-memory rings created by an external component
+ * \param c Component context
+ */
+static int ev_shm_attach(compnt_t *c)
+{
+    shm_link_t *link = (shm_link_t *)MALLOC(sizeof(shm_link_t));
+    if (link == NULL) {
+        PERROR("malloc");
+        return -1;
+    }
+
+    char prefix[__CONF_WORD_LEN];
+    snprintf(prefix, __CONF_WORD_LEN, "%s.c.%u", __SHM_RING_PATH, c->component_id);
+
+    if (shm_link_open(link, prefix)) {
+        FREE(link);
+        return -1;
+    }
+
+    if (pthread_create(&link->thread[0], NULL, &shm_pull_events, link) < 0) {
+        PERROR("pthread_create");
+        shm_link_close(link, FALSE);
+        FREE(link);
+        return -1;
+    } else link->num_threads++;
+
+    if (pthread_create(&link->thread[1], NULL, &shm_reply_events, link) < 0) {
+        PERROR("pthread_create");
+        shm_link_close(link, FALSE);
+        FREE(link);
+        return -1;
+    } else link->num_threads++;
+
+    // the link of a restarted component may still be in use, so it is kept until the end
+    pthread_mutex_lock(&ev_shm_lock);
+
+    shm_link_t *old = c->shm;
+    if (old != NULL) {
+        old->active = FALSE;
+        old->next = ev_shm_retired;
+        ev_shm_retired = old;
+    }
+
+    __atomic_store_n(&c->shm, link, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&ev_shm_lock);
+
+    LOG_INFO(0, "Attached the shared-memory rings of %s", c->name);
+
+    return 0;
+}
+
+/**
+ * \brief Function to detach all shared-memory rings
+ */
+static void ev_shm_detach_all(void)
+{
+    int i;
+    for (i=0; i<ev_ctx->num_compnts; i++) {
+        compnt_t *c = ev_ctx->compnt_list[i];
+        shm_link_t *link = c->shm;
+
+        if (link == NULL) continue;
+
+        c->shm = NULL;
+
+        shm_link_close(link, FALSE);
+        FREE(link);
+    }
+
+    while (ev_shm_retired != NULL) {
+        shm_link_t *link = ev_shm_retired;
+        ev_shm_retired = link->next;
+
+        shm_link_close(link, FALSE);
+        FREE(link);
+    }
+}
+
 /**
  * @}
  *
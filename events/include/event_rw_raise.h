@@ -11,25 +11,19 @@ static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, FUNC_TYPE *data)
 {
     int ret = 0;
 
-    int ev_num = ev_ctx->ev_num[type];
-    compnt_t **ev_list = ev_ctx->ev_list[type];
+    epoch_enter();
 
-    if (ev_list == NULL) return -1;
+    compnt_conf_t *conf = ev_conf();
 
     // outbound check:
     // investigate whether the given event type belongs to the component's outbound events
-    int i, j, pass = 0;
-    for (i=0; i<ev_ctx->num_compnts; i++) {
-        compnt_t *compnt = ev_ctx->compnt_list[i];
-        for (j=0; j<compnt->out_num; j++) {
-            if (compnt->out_list[j] == type) {
-                pass = 1;
-                break;
-            }
-        }
-        if (pass) break;
+    if (conf == NULL || !conf->out_ok[type]) {
+        epoch_exit();
+        return -1;
     }
-    if (!pass) return -1;
+
+    int ev_num = conf->ev_num[type];
+    compnt_t **ev_list = conf->ev_list[type];
 
     // only for request-reponse events
     if (EV_ALL_DOWNSTREAM < type && type < EV_WRT_INTSTREAM) {
@@ -48,6 +42,7 @@ static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, FUNC_TYPE *data)
 
         ev_ctx->num_events[type]++;
 
+        int i;
         for (i=0; i<ev_num; i++) {
             compnt_t *compnt = ev_list[i];
 
@@ -57,7 +52,9 @@ static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, FUNC_TYPE *data)
             compnt->num_events[type]++;
 
             if (compnt->site == COMPNT_INTERNAL) { // internal site
+                MEM_OWNER_PUSH(compnt->name);
                 ret = compnt->handler(ev, &ev_out);
+                MEM_OWNER_POP();
             } else { // external site
                 ret = ev_send_msg(compnt, id, type, len, data, ev_out.data);
             }
@@ -66,5 +63,7 @@ static int FUNC_NAME(uint32_t id, uint16_t type, uint16_t len, FUNC_TYPE *data)
         }
     }
 
+    epoch_exit();
+
     return ret;
 }
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The worker class of the shared workers */
+#define EV_SCHED_SHARED EV_NUM_CLASSES
+
+/** \brief The structure of the queue of an event class */
+typedef struct _ev_sched_queue_t {
+    ev_chain_t *head; /**< The first queued chain */
+    ev_chain_t *tail; /**< The last queued chain */
+    int len; /**< The number of queued chains */
+
+    ev_class_conf_t conf; /**< The scheduling configuration in effect */
+    int credit; /**< The chains left to the class in the current round of the shared workers */
+
+    int num_threads; /**< The number of dedicated workers */
+    pthread_cond_t cond; /**< The condition signaled to the dedicated workers */
+} ev_sched_queue_t;
+
+/** \brief The short names of event classes (for thread names) */
+static const char *ev_sched_name[EV_NUM_CLASSES] = {"control", "pktin", "stats", "log", "mgmt"};
+
+/** \brief The queues of event classes */
+static ev_sched_queue_t ev_sched_queue[EV_NUM_CLASSES];
+
+/** \brief The lock for the queues and the workers */
+static pthread_mutex_t ev_sched_lock;
+
+/** \brief The condition signaled to the shared workers */
+static pthread_cond_t ev_sched_cond;
+
+/** \brief The class that the shared workers look at first */
+static int ev_sched_next;
+
+/** \brief The number of shared workers */
+static int ev_sched_num_shared;
+
+/** \brief The number of running workers (shared and dedicated) */
+static int ev_sched_running;
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to get the scheduling class of an event
+ * \param type Event type
+ * \return Event class
+ */
+static int ev_class_of(uint16_t type)
+{
+    switch (type) {
+    case EV_DP_RECEIVE_PACKET:
+        return EV_CLASS_PKTIN;
+
+    case EV_DP_FLOW_STATS:
+    case EV_DP_AGGREGATE_STATS:
+    case EV_DP_PORT_STATS:
+    case EV_DP_MULTI_FLOW_STATS:
+    case EV_DP_MULTI_PORT_STATS:
+    case EV_RS_UPDATE_USAGE:
+    case EV_TR_UPDATE_STATS:
+        return EV_CLASS_STATS;
+
+    case EV_LOG_UPDATE_MSGS:
+    case EV_LOG_DEBUG:
+    case EV_LOG_INFO:
+    case EV_LOG_WARN:
+    case EV_LOG_ERROR:
+    case EV_LOG_FATAL:
+        return EV_CLASS_LOG;
+
+    case EV_SW_CONNECTED:
+    case EV_SW_DISCONNECTED:
+    case EV_SW_UPDATE_DESC:
+    case EV_HOST_ADDED:
+    case EV_HOST_DELETED:
+    case EV_LINK_ADDED:
+    case EV_LINK_DELETED:
+    case EV_FLOW_ADDED:
+    case EV_FLOW_MODIFIED:
+    case EV_FLOW_DELETED:
+        return EV_CLASS_MGMT;
+
+    default: // OpenFlow messages, switch connections, datapath changes, and downstream requests
+        return EV_CLASS_CONTROL;
+    }
+}
+
+/**
+ * \brief Function to queue an event chain for the workers of its class
+ * \param ch Event chain (in the raising thread)
+ * \return 0 if the chain is queued or dropped, -1 if it has to be delivered in the raising thread
+ */
+static int ev_sched_defer(ev_chain_t *ch)
+{
+    uint16_t type = ch->ev_out.type;
+    int c = ev_class_of(type);
+
+    // requesters waiting for the whole chain and events with pointers stay synchronous
+    if (ch->conf->ev_class[c].mode != EV_SCHED_ASYNC || ev_chain_sync || !ev_shm_event(type))
+        return -1;
+
+    if (ch->ev_num == 0) return -1;
+
+    // only read-only chains are deferred, since the raiser expects the changes and the verdicts of the others
+    int i;
+    for (i=0; i<ch->ev_num; i++) {
+        compnt_t *compnt = ch->ev_list[i];
+        if (compnt != NULL && (compnt->in_perm[type] & (COMPNT_WRITE | COMPNT_EXECUTE)))
+            return -1;
+    }
+
+    ev_chain_t *dc = ev_chain_detach(ch);
+    if (dc == NULL) return -1;
+
+    dc->next = NULL;
+
+    ev_sched_queue_t *q = &ev_sched_queue[c];
+
+    pthread_mutex_lock(&ev_sched_lock);
+
+    // the queue has no room (or the workers are not started yet)
+    if (q->len >= q->conf.queue) {
+        int on_full = q->conf.on_full;
+
+        pthread_mutex_unlock(&ev_sched_lock);
+
+        ev_chain_free(dc);
+
+        return (on_full == EV_SCHED_DROP) ? 0 : -1;
+    }
+
+    if (q->tail) q->tail->next = dc;
+    else q->head = dc;
+    q->tail = dc;
+    q->len++;
+
+    if (q->conf.workers > 0) pthread_cond_signal(&q->cond);
+    else pthread_cond_signal(&ev_sched_cond);
+
+    pthread_mutex_unlock(&ev_sched_lock);
+
+    return 0;
+}
+
+/**
+ * \brief Function to take the first chain of a class (under ev_sched_lock)
+ * \param c Event class
+ * \return Event chain (detached)
+ */
+static ev_chain_t *ev_sched_take(int c)
+{
+    ev_sched_queue_t *q = &ev_sched_queue[c];
+    ev_chain_t *ch = q->head;
+
+    q->head = ch->next;
+    if (q->head == NULL) q->tail = NULL;
+    q->len--;
+
+    return ch;
+}
+
+/**
+ * \brief Function to pick the class that a shared worker serves next (under ev_sched_lock)
+ * Each waiting class gets as many chains as its weight in a round, so a burst in one class
+ * only delays the others by their weights.
+ * \return Event class (-1: nothing to deliver)
+ */
+static int ev_sched_pick(void)
+{
+    int round;
+    for (round=0; round<2; round++) {
+        int n;
+        for (n=0; n<EV_NUM_CLASSES; n++) {
+            int c = (ev_sched_next + n) % EV_NUM_CLASSES;
+            ev_sched_queue_t *q = &ev_sched_queue[c];
+
+            if (q->head == NULL || q->conf.workers > 0 || q->credit <= 0)
+                continue;
+
+            // the class keeps its turn until it uses up its share of the round
+            ev_sched_next = (--q->credit > 0) ? c : (c + 1) % EV_NUM_CLASSES;
+
+            return c;
+        }
+
+        // every waiting class used up its share, so a new round begins
+        for (n=0; n<EV_NUM_CLASSES; n++)
+            ev_sched_queue[n].credit = ev_sched_queue[n].conf.weight;
+    }
+
+    return -1;
+}
+
+/**
+ * \brief Function to deliver the queued events of event classes
+ * \param arg The class (EV_SCHED_SHARED: shared) and the index of the worker
+ */
+static void *sched_events(void *arg)
+{
+    int c = (int)((intptr_t)arg >> 16);
+    int idx = (int)((intptr_t)arg & 0xffff);
+
+    char name[16] = {0};
+    if (c == EV_SCHED_SHARED)
+        snprintf(name, sizeof(name), "ev-sched%d", idx);
+    else
+        snprintf(name, sizeof(name), "ev-%s%d", ev_sched_name[c], idx);
+    pthread_setname_np(pthread_self(), name);
+
+    pthread_mutex_lock(&ev_sched_lock);
+
+    while (ev_ctx->ev_on) {
+        int k = -1;
+
+        if (c == EV_SCHED_SHARED) {
+            k = ev_sched_pick();
+        } else {
+            ev_sched_queue_t *q = &ev_sched_queue[c];
+
+            // the workers beyond a reduced number leave from the last one
+            if (idx >= q->conf.workers && idx == q->num_threads - 1) {
+                q->num_threads--;
+                pthread_cond_broadcast(&q->cond);
+                break;
+            }
+
+            if (q->head != NULL && idx < q->conf.workers)
+                k = c;
+        }
+
+        if (k < 0) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec++;
+
+            pthread_cond_timedwait((c == EV_SCHED_SHARED) ? &ev_sched_cond : &ev_sched_queue[c].cond,
+                                   &ev_sched_lock, &ts);
+            continue;
+        }
+
+        ev_chain_t *ch = ev_sched_take(k);
+
+        pthread_mutex_unlock(&ev_sched_lock);
+
+        epoch_enter();
+
+        if (ev_chain_run(ch) != EV_HOP_WAIT)
+            ev_chain_free(ch);
+
+        epoch_exit();
+
+        pthread_mutex_lock(&ev_sched_lock);
+    }
+
+    // the last worker drops the chains left behind
+    if (--ev_sched_running == 0 && !ev_ctx->ev_on) {
+        int n;
+        for (n=0; n<EV_NUM_CLASSES; n++) {
+            while (ev_sched_queue[n].head != NULL)
+                ev_chain_free(ev_sched_take(n));
+        }
+    }
+
+    pthread_mutex_unlock(&ev_sched_lock);
+
+    DEBUG("sched_events() is terminated\n");
+
+    return NULL;
+}
+
+/**
+ * \brief Function to start a scheduler worker (under ev_sched_lock)
+ * \param c Event class (EV_SCHED_SHARED: shared)
+ * \param idx The index of the worker
+ */
+static int ev_sched_spawn(int c, int idx)
+{
+    pthread_t thread;
+
+    if (pthread_create(&thread, NULL, &sched_events, (void *)(intptr_t)((c << 16) | idx)) < 0) {
+        PERROR("pthread_create");
+        return -1;
+    }
+
+    pthread_detach(thread);
+
+    ev_sched_running++;
+
+    return 0;
+}
@@ -17,6 +17,9 @@
 "EV_DP_PORT_MODIFIED",
 "EV_DP_PORT_DELETED",
 "EV_DP_PORT_STATS",
+"EV_DP_MULTI_FLOW_STATS",
+"EV_DP_MULTI_PORT_STATS",
+"EV_DP_FLOWS_INSTALLED",
 "EV_ALL_UPSTREAM",
 // downstream
 "EV_OFP_MSG_OUT",
@@ -24,6 +27,7 @@
 "EV_DP_INSERT_FLOW",
 "EV_DP_MODIFY_FLOW",
 "EV_DP_DELETE_FLOW",
+"EV_DP_INSERT_FLOWS",
 "EV_DP_REQUEST_FLOW_STATS",
 "EV_DP_REQUEST_AGGREGATE_STATS",
 "EV_DP_MODIFY_PORT",
@@ -33,6 +37,8 @@
 "EV_SW_GET_DPID",
 "EV_SW_GET_FD",
 "EV_SW_GET_XID",
+"EV_RT_GET_ROUTE",
+"EV_RT_GET_TREE",
 "EV_WRT_INTSTREAM",
 // internal (notification)
 "EV_SW_NEW_CONN",
@@ -18,6 +18,7 @@
 #include "app_event.h"
 #include "application.h"
 #include "application_info.h"
+#include "shm_ring.h"
 
 /////////////////////////////////////////////////////////////////////
 
@@ -49,12 +50,19 @@ void *av_rep_ctx;
 /** \brief MQ socket to reply app events */
 void *av_rep_sock;
 
+/** \brief Shared-memory rings (used if the Barista NOS accepts them) */
+shm_link_t av_shm;
+
 /////////////////////////////////////////////////////////////////////
 
 #include "app_event_json.h"
 
 /////////////////////////////////////////////////////////////////////
 
+static int av_shm_start(void);
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief Function to have a handshake with the Barista NOS
  * \param id Application ID
@@ -63,7 +71,22 @@ void *av_rep_sock;
 static int handshake(uint32_t id, char *name)
 {
     char json_in[__MAX_EXT_MSG_SIZE] = {0};
-    sprintf(json_in, "#{\"id\": %u, \"name\": \"%s\"}", app.app_id, app.name);
+    char prefix[__CONF_WORD_LEN] = {0};
+    int shm = FALSE;
+
+    // offer shared-memory rings, falling back to ZeroMQ if they are not accepted
+    const char *SHM_RING = getenv("SHM_RING");
+    if (SHM_RING != NULL && strcmp(SHM_RING, "SHM_RING") == 0) {
+        snprintf(prefix, __CONF_WORD_LEN, "%s.a.%u", __SHM_RING_PATH, app.app_id);
+
+        if (shm_link_create(&av_shm, prefix, __SHM_RING_SIZE) == 0)
+            shm = TRUE;
+    }
+
+    if (shm)
+        sprintf(json_in, "#{\"id\": %u, \"name\": \"%s\", \"shm\": true}", app.app_id, app.name);
+    else
+        sprintf(json_in, "#{\"id\": %u, \"name\": \"%s\"}", app.app_id, app.name);
     int len = strlen(json_in);
 
     void *req_sock = zmq_socket(av_req_ctx, ZMQ_REQ);
@@ -78,11 +101,15 @@ static int handshake(uint32_t id, char *name)
     char json_out[__MAX_EXT_MSG_SIZE] = {0};
     zmq_recv(req_sock, json_out, __MAX_EXT_MSG_SIZE, 0);
 
-    if (strncmp(json_out, "#{\"return\": 0}", 14) != 0) {
+    if (strncmp(json_out, "#{\"return\": 0", 13) != 0) {
         PRINTF("Failed to make a handshake\n");
+        if (shm) shm_link_close(&av_shm, TRUE);
         zmq_close(req_sock);
         return -1;
+    } else if (shm && strstr(json_out, "\"shm\": 1") != NULL && av_shm_start() == 0) {
+        PRINTF("Connected to the Barista NOS (shared memory)\n");
     } else {
+        if (shm) shm_link_close(&av_shm, TRUE);
         PRINTF("Connected to the Barista NOS\n");
     }
 
@@ -93,6 +120,51 @@ static int handshake(uint32_t id, char *name)
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to check whether an app event can be carried through shared-memory rings as it is
+ * \param type Application event type
+ */
+static int av_shm_event(uint16_t type)
+{
+    switch (type) {
+
+    // events pointing to other buffers
+    case AV_DP_INSERT_FLOWS:
+        return FALSE;
+
+    default:
+        return TRUE;
+    }
+}
+
+/**
+ * \brief Function to clear the pointers copied from the other side of shared-memory rings
+ * \param msg Application events
+ */
+static void av_shm_import(msg_t *msg)
+{
+    switch (msg->type) {
+    case AV_DP_FLOW_EXPIRED:
+    case AV_DP_FLOW_DELETED:
+    case AV_DP_INSERT_FLOW:
+    case AV_DP_MODIFY_FLOW:
+    case AV_DP_DELETE_FLOW:
+    case AV_FLOW_ADDED:
+    case AV_FLOW_MODIFIED:
+    case AV_FLOW_DELETED:
+        {
+            flow_t *flow = (flow_t *)msg->data;
+
+            flow->prev = NULL;
+            flow->next = NULL;
+            flow->r_next = NULL;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
 /**
  * \brief Function to send app events to the Barista NOS
  * \param id Application ID
@@ -104,6 +176,10 @@ static int av_push_msg(uint32_t id, uint16_t type, uint16_t size, const void *in
 {
     if (!av_on) return -1;
 
+    shm_link_t *link = app.shm;
+    if (link != NULL && av_shm_event(type))
+        return shm_ring_push(&link->up, id, type, 0, 0, input, size);
+
     char json[__MAX_EXT_MSG_SIZE] = {0};
     int len = export_to_json(id, type, input, json, 0);
 
@@ -123,10 +199,8 @@ static int av_push_msg(uint32_t id, uint16_t type, uint16_t size, const void *in
     return 0;
 }
 
-#if 0
 /**
  * \brief Function to send app events to the Barista NOS and receive its responses
- * \param a Application context
  * \param id Application ID
  * \param type Application event type
  * \param size The size of the given data
@@ -138,6 +212,20 @@ static int av_send_msg(uint32_t id, uint16_t type, uint16_t size, const void *in
 {
     if (!av_on) return -1;
 
+    shm_link_t *link = app.shm;
+    if (link != NULL && av_shm_event(type)) {
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+        shm_rec_t rec;
+
+        if (shm_chan_call(&link->up_call, id, type, input, size, &rec, data, __MAX_MSG_SIZE, __SHM_RING_CALL_TIMEOUT))
+            return -1;
+
+        if (rec.id == id && rec.type == type)
+            memcpy(output, data, size);
+
+        return rec.ret;
+    }
+
     char json_in[__MAX_EXT_MSG_SIZE] = {0};
     int len = export_to_json(id, type, input, json_in, 0);
 
@@ -161,14 +249,14 @@ static int av_send_msg(uint32_t id, uint16_t type, uint16_t size, const void *in
     msg.data = data;
     msg.ret = import_from_json(&msg.id, &msg.type, json_out, msg.data);
 
-    if (app.in_perm[type] & APP_WRITE && msg.id == id && msg.type == type)
+    // the requester gets the response of the request
+    if (msg.id == id && msg.type == type)
         memcpy(output, msg.data, size);
 
     zmq_close(req_sock);
 
     return msg.ret;
 }
-#endif
 
 // Downstream events ////////////////////////////////////////////////
 
@@ -183,7 +271,10 @@ void av_dp_delete_flow(uint32_t id, const flow_t *data) { av_push_msg(id, AV_DP_
 
 // Internal events (request-response) ///////////////////////////////
 
-//
+/** \brief AV_RT_GET_ROUTE (src, dst, hash) */
+void av_rt_get_route(uint32_t id, route_t *data) { av_send_msg(id, AV_RT_GET_ROUTE, sizeof(route_t), data, data); }
+/** \brief AV_RT_GET_TREE (dpid, in_port) */
+void av_rt_get_tree(uint32_t id, tree_t *data) { av_send_msg(id, AV_RT_GET_TREE, sizeof(tree_t), data, data); }
 
 // Log events ///////////////////////////////////////////////////////
 
@@ -339,18 +430,28 @@ static void *pull_app_events(void *null)
         if (!av_on) break;
         else if (zmq_recv(av_pull_sock, json, __MAX_EXT_MSG_SIZE, 0) < 0) continue;
 
-        //printf("%s: %s\n", __FUNCTION__, json);
+        // a batch comes as one multipart message with an event per frame
+        int more = TRUE;
+        while (more) {
+            //printf("%s: %s\n", __FUNCTION__, json);
 
-        uint8_t data[__MAX_MSG_SIZE] = {0};
+            uint8_t data[__MAX_MSG_SIZE] = {0};
 
-        msg_t msg = {0};
-        msg.data = data;
-        import_from_json(&msg.id, &msg.type, json, msg.data);
+            msg_t msg = {0};
+            msg.data = data;
+            import_from_json(&msg.id, &msg.type, json, msg.data);
 
-        if (msg.id == 0) continue;
-        else if (msg.type > AV_NUM_EVENTS) continue;
+            if (msg.id != 0 && msg.type <= AV_NUM_EVENTS)
+                process_app_events(&msg);
 
-        process_app_events(&msg);
+            size_t more_size = sizeof(int);
+            if (zmq_getsockopt(av_pull_sock, ZMQ_RCVMORE, &more, &more_size) || !more) break;
+
+            int len = zmq_recv(av_pull_sock, json, __MAX_EXT_MSG_SIZE - 1, 0);
+            if (len < 0) break;
+
+            json[MIN(len, __MAX_EXT_MSG_SIZE - 1)] = '\0';
+        }
 
         if (!av_on) break;
     }
@@ -395,6 +496,93 @@ static void *reply_app_events(void *null)
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to receive app events from the Barista NOS through shared-memory rings
+ * \param arg Shared-memory link
+ */
+static void *shm_pull_app_events(void *arg)
+{
+    shm_link_t *link = (shm_link_t *)arg;
+
+    while (av_on && link->active) {
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+        shm_rec_t rec;
+
+        if (shm_ring_pop(&link->down, &rec, data, __MAX_MSG_SIZE - 1, 1000) < 0) continue;
+
+        msg_t msg = {0};
+        msg.id = rec.id;
+        msg.type = rec.type;
+        msg.data = data;
+
+        // records carrying the pointers of the other side are never sent through the rings
+        if (msg.id == 0) continue;
+        else if (msg.type >= AV_NUM_EVENTS || !av_shm_event(msg.type)) continue;
+
+        av_shm_import(&msg);
+        process_app_events(&msg);
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief Function to process requests from the Barista NOS through shared-memory rings and reply them
+ * \param arg Shared-memory link
+ */
+static void *shm_reply_app_events(void *arg)
+{
+    shm_link_t *link = (shm_link_t *)arg;
+
+    while (av_on && link->active) {
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+        shm_rec_t rec;
+
+        int len = shm_ring_pop(&link->down_call.req, &rec, data, __MAX_MSG_SIZE - 1, 1000);
+        if (len < 0) continue;
+
+        msg_t msg = {0};
+        msg.id = rec.id;
+        msg.type = rec.type;
+        msg.data = data;
+
+        // records carrying the pointers of the other side are never sent through the rings
+        if (msg.id == 0 || msg.type >= AV_NUM_EVENTS || !av_shm_event(msg.type)) {
+            shm_chan_reply(&link->down_call, &rec, -1, NULL, 0);
+            continue;
+        }
+
+        av_shm_import(&msg);
+
+        msg.ret = process_app_events(&msg);
+        shm_chan_reply(&link->down_call, &rec, msg.ret, msg.data, len);
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief Function to start the consumers of the shared-memory rings accepted by the Barista NOS
+ */
+static int av_shm_start(void)
+{
+    if (pthread_create(&av_shm.thread[0], NULL, &shm_pull_app_events, &av_shm) < 0) {
+        PERROR("pthread_create");
+        return -1;
+    } else av_shm.num_threads++;
+
+    if (pthread_create(&av_shm.thread[1], NULL, &shm_reply_app_events, &av_shm) < 0) {
+        PERROR("pthread_create");
+        return -1;
+    } else av_shm.num_threads++;
+
+    app.shm = &av_shm;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief Function to initialize the app event handler
  * \param ctx The context of the Barista NOS
@@ -464,6 +652,11 @@ int destroy_app_event(ctx_t *ctx)
 
     waitsec(1, 0);
 
+    if (app.shm != NULL) {
+        app.shm = NULL;
+        shm_link_close(&av_shm, TRUE);
+    }
+
     zmq_close(av_pull_sock);
     zmq_close(av_rep_sock);
 
@@ -18,6 +18,7 @@
 #include "event.h"
 #include "component.h"
 #include "component_info.h"
+#include "shm_ring.h"
 
 /////////////////////////////////////////////////////////////////////
 
@@ -49,12 +50,19 @@ void *ev_rep_ctx;
 /** \brief MQ socket to reply events */
 void *ev_rep_sock;
 
+/** \brief Shared-memory rings (used if the Barista NOS accepts them) */
+shm_link_t ev_shm;
+
 /////////////////////////////////////////////////////////////////////
 
 #include "event_json.h"
 
 /////////////////////////////////////////////////////////////////////
 
+static int ev_shm_start(void);
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief Function to have a handshake with the Barista NOS
  * \param id Component ID
@@ -63,7 +71,22 @@ void *ev_rep_sock;
 static int handshake(uint32_t id, char *name)
 {
     char json_in[__MAX_EXT_MSG_SIZE] = {0};
-    sprintf(json_in, "#{\"id\": %u, \"name\": \"%s\"}", compnt.component_id, compnt.name);
+    char prefix[__CONF_WORD_LEN] = {0};
+    int shm = FALSE;
+
+    // offer shared-memory rings, falling back to ZeroMQ if they are not accepted
+    const char *SHM_RING = getenv("SHM_RING");
+    if (SHM_RING != NULL && strcmp(SHM_RING, "SHM_RING") == 0) {
+        snprintf(prefix, __CONF_WORD_LEN, "%s.c.%u", __SHM_RING_PATH, compnt.component_id);
+
+        if (shm_link_create(&ev_shm, prefix, __SHM_RING_SIZE) == 0)
+            shm = TRUE;
+    }
+
+    if (shm)
+        sprintf(json_in, "#{\"id\": %u, \"name\": \"%s\", \"shm\": true}", compnt.component_id, compnt.name);
+    else
+        sprintf(json_in, "#{\"id\": %u, \"name\": \"%s\"}", compnt.component_id, compnt.name);
     int len = strlen(json_in);
 
     void *req_sock = zmq_socket(ev_req_ctx, ZMQ_REQ);
@@ -78,11 +101,15 @@ static int handshake(uint32_t id, char *name)
     char json_out[__MAX_EXT_MSG_SIZE] = {0};
     zmq_recv(req_sock, json_out, __MAX_EXT_MSG_SIZE, 0);
 
-    if (strncmp(json_out, "#{\"return\": 0}", 14) != 0) {
+    if (strncmp(json_out, "#{\"return\": 0", 13) != 0) {
         PRINTF("Failed to make a handshake\n");
+        if (shm) shm_link_close(&ev_shm, TRUE);
         zmq_close(req_sock);
         return -1;
+    } else if (shm && strstr(json_out, "\"shm\": 1") != NULL && ev_shm_start() == 0) {
+        PRINTF("Connected to the Barista NOS (shared memory)\n");
     } else {
+        if (shm) shm_link_close(&ev_shm, TRUE);
         PRINTF("Connected to the Barista NOS\n");
     }
 
@@ -93,6 +120,59 @@ static int handshake(uint32_t id, char *name)
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to check whether an event can be carried through shared-memory rings as it is
+ * \param type Event type
+ */
+static int ev_shm_event(uint16_t type)
+{
+    switch (type) {
+
+    // events pointing to other buffers
+    case EV_OFP_MSG_IN:
+    case EV_OFP_MSG_OUT:
+    case EV_DP_MULTI_FLOW_STATS:
+    case EV_DP_MULTI_PORT_STATS:
+    case EV_DP_INSERT_FLOWS:
+        return FALSE;
+
+    default:
+        return TRUE;
+    }
+}
+
+/**
+ * \brief Function to clear the pointers copied from the other side of shared-memory rings
+ * \param msg Events
+ */
+static void ev_shm_import(msg_t *msg)
+{
+    switch (msg->type) {
+    case EV_DP_FLOW_EXPIRED:
+    case EV_DP_FLOW_DELETED:
+    case EV_DP_FLOW_STATS:
+    case EV_DP_AGGREGATE_STATS:
+    case EV_DP_INSERT_FLOW:
+    case EV_DP_MODIFY_FLOW:
+    case EV_DP_DELETE_FLOW:
+    case EV_DP_REQUEST_FLOW_STATS:
+    case EV_DP_REQUEST_AGGREGATE_STATS:
+    case EV_FLOW_ADDED:
+    case EV_FLOW_MODIFIED:
+    case EV_FLOW_DELETED:
+        {
+            flow_t *flow = (flow_t *)msg->data;
+
+            flow->prev = NULL;
+            flow->next = NULL;
+            flow->r_next = NULL;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
 /**
  * \brief Function to send events to the Barista NOS
  * \param id Component ID
@@ -104,6 +184,10 @@ static int ev_push_msg(uint32_t id, uint16_t type, uint16_t size, const void *in
 {
     if (!ev_on) return -1;
 
+    shm_link_t *link = compnt.shm;
+    if (link != NULL && ev_shm_event(type))
+        return shm_ring_push(&link->up, id, type, 0, 0, input, size);
+
     char json[__MAX_EXT_MSG_SIZE] = {0};
     int len = export_to_json(id, type, input, json, 0);
 
@@ -136,6 +220,20 @@ static int ev_send_msg(uint32_t id, uint16_t type, uint16_t size, const void *in
 {
     if (!ev_on) return -1;
 
+    shm_link_t *link = compnt.shm;
+    if (link != NULL && ev_shm_event(type)) {
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+        shm_rec_t rec;
+
+        if (shm_chan_call(&link->up_call, id, type, input, size, &rec, data, __MAX_MSG_SIZE, __SHM_RING_CALL_TIMEOUT))
+            return -1;
+
+        if (compnt.in_perm[type] & COMPNT_WRITE && rec.id == id && rec.type == type)
+            memcpy(output, data, size);
+
+        return rec.ret;
+    }
+
     char json_in[__MAX_EXT_MSG_SIZE] = {0};
     int len = export_to_json(id, type, input, json_in, 0);
 
@@ -438,18 +536,28 @@ static void *pull_events(void *null)
         if (!ev_on) break;
         else if (zmq_recv(ev_pull_sock, json, __MAX_EXT_MSG_SIZE, 0) < 0) continue;
 
-        //printf("%s: %s\n", __FUNCTION__, json);
+        // a batch comes as one multipart message with an event per frame
+        int more = TRUE;
+        while (more) {
+            //printf("%s: %s\n", __FUNCTION__, json);
 
-        uint8_t data[__MAX_MSG_SIZE] = {0};
+            uint8_t data[__MAX_MSG_SIZE] = {0};
 
-        msg_t msg = {0};
-        msg.data = data;
-        import_from_json(&msg.id, &msg.type, json, msg.data);
+            msg_t msg = {0};
+            msg.data = data;
+            import_from_json(&msg.id, &msg.type, json, msg.data);
 
-        if (msg.id == 0) continue;
-        else if (msg.type > EV_NUM_EVENTS) continue;
+            if (msg.id != 0 && msg.type <= EV_NUM_EVENTS)
+                process_events(&msg);
 
-        process_events(&msg);
+            size_t more_size = sizeof(int);
+            if (zmq_getsockopt(ev_pull_sock, ZMQ_RCVMORE, &more, &more_size) || !more) break;
+
+            int len = zmq_recv(ev_pull_sock, json, __MAX_EXT_MSG_SIZE - 1, 0);
+            if (len < 0) break;
+
+            json[MIN(len, __MAX_EXT_MSG_SIZE - 1)] = '\0';
+        }
 
         if (!ev_on) break;
     }
@@ -494,6 +602,93 @@ static void *reply_events(void *null)
 
 /////////////////////////////////////////////////////////////////////
 
+/**
+ * \brief Function to receive events from the Barista NOS through shared-memory rings
+ * \param arg Shared-memory link
+ */
+static void *shm_pull_events(void *arg)
+{
+    shm_link_t *link = (shm_link_t *)arg;
+
+    while (ev_on && link->active) {
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+        shm_rec_t rec;
+
+        if (shm_ring_pop(&link->down, &rec, data, __MAX_MSG_SIZE - 1, 1000) < 0) continue;
+
+        msg_t msg = {0};
+        msg.id = rec.id;
+        msg.type = rec.type;
+        msg.data = data;
+
+        // records carrying the pointers of the other side are never sent through the rings
+        if (msg.id == 0) continue;
+        else if (msg.type >= EV_NUM_EVENTS || !ev_shm_event(msg.type)) continue;
+
+        ev_shm_import(&msg);
+        process_events(&msg);
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief Function to process requests from the Barista NOS through shared-memory rings and reply them
+ * \param arg Shared-memory link
+ */
+static void *shm_reply_events(void *arg)
+{
+    shm_link_t *link = (shm_link_t *)arg;
+
+    while (ev_on && link->active) {
+        uint8_t data[__MAX_MSG_SIZE] = {0};
+        shm_rec_t rec;
+
+        int len = shm_ring_pop(&link->down_call.req, &rec, data, __MAX_MSG_SIZE - 1, 1000);
+        if (len < 0) continue;
+
+        msg_t msg = {0};
+        msg.id = rec.id;
+        msg.type = rec.type;
+        msg.data = data;
+
+        // records carrying the pointers of the other side are never sent through the rings
+        if (msg.id == 0 || msg.type >= EV_NUM_EVENTS || !ev_shm_event(msg.type)) {
+            shm_chan_reply(&link->down_call, &rec, -1, NULL, 0);
+            continue;
+        }
+
+        ev_shm_import(&msg);
+
+        msg.ret = process_events(&msg);
+        shm_chan_reply(&link->down_call, &rec, msg.ret, msg.data, len);
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief Function to start the consumers of the shared-memory rings accepted by the Barista NOS
+ */
+static int ev_shm_start(void)
+{
+    if (pthread_create(&ev_shm.thread[0], NULL, &shm_pull_events, &ev_shm) < 0) {
+        PERROR("pthread_create");
+        return -1;
+    } else ev_shm.num_threads++;
+
+    if (pthread_create(&ev_shm.thread[1], NULL, &shm_reply_events, &ev_shm) < 0) {
+        PERROR("pthread_create");
+        return -1;
+    } else ev_shm.num_threads++;
+
+    compnt.shm = &ev_shm;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
 /**
  * \brief Function to initialize the event handler
  * \param ctx The context of the Barista NOS
@@ -563,6 +758,11 @@ int destroy_event(ctx_t *ctx)
 
     waitsec(1, 0);
 
+    if (compnt.shm != NULL) {
+        compnt.shm = NULL;
+        shm_link_close(&ev_shm, TRUE);
+    }
+
     zmq_close(ev_pull_sock);
     zmq_close(ev_rep_sock);
 
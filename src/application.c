@@ -18,6 +18,9 @@
 #include "application.h"
 #include "application_list.h"
 #include "app_event.h"
+#include "msg_batch.h"
+#include "cpu_affinity.h"
+#include "epoch.h"
 
 /////////////////////////////////////////////////////////////////////
 
@@ -254,6 +257,21 @@ static int application_print(cli_t *cli, app_t *app, int details)
 
     cli_bufprt(cli, buf);
 
+    if (app->site == APP_EXTERNAL && app->batch_max > 0)
+        cli_print(cli, "    Batch: %d events or %d us", app->batch_max,
+                  (app->batch_usec > 0) ? app->batch_usec : __MSG_BATCH_USEC);
+
+#ifdef __ENABLE_MEM_ACCOUNTING
+    if (app->site == APP_INTERNAL) {
+        mem_site_t *site = mem_acct_find(app->name);
+        if (site != NULL)
+            cli_print(cli, "    Memory: %ld bytes (peak: %ld bytes), %lu allocs, %lu frees",
+                      site->live, site->peak, site->num_allocs, site->num_frees);
+        else
+            cli_print(cli, "    Memory: no allocations");
+    }
+#endif /* __ENABLE_MEM_ACCOUNTING */
+
     if (app->status == APP_DISABLED)
         cli_print(cli, "    Status: disabled");
     else if (app->activated == TRUE)
@@ -398,7 +416,21 @@ static void *app_thread_main(void *app_id)
 
     FREE(app_id);
 
-    if (app->main(&app->activated, app->argc, app->argv) < 0) {
+    int ret;
+
+    if (app->type == APP_AUTO)
+        cpu_bind_thread(app->name, app->cpus);
+    else
+        cpu_set_placement(app->cpus);
+
+    MEM_OWNER_PUSH(app->name);
+    ret = app->main(&app->activated, app->argc, app->argv);
+    MEM_OWNER_POP();
+
+    if (app->type != APP_AUTO)
+        cpu_set_placement(NULL);
+
+    if (ret < 0) {
         app->activated = FALSE;
         return NULL;
     } else {
@@ -724,6 +756,22 @@ int application_stop(cli_t *cli)
     return 0;
 }
 
+/**
+ * \brief Function to replace the policies of an application once no app event checks the previous ones
+ * \param odp The policy list of an application
+ * \param odps New policy list
+ */
+static void odp_publish(odp_t **odp, odp_t *odps)
+{
+    odp_t *old = *odp;
+
+    __atomic_store_n(odp, odps, __ATOMIC_RELEASE);
+
+    epoch_synchronize();
+
+    FREE(old);
+}
+
 /**
  * \brief Function to add a policy to an application
  * \param cli CLI context
@@ -768,6 +816,22 @@ int application_add_policy(cli_t *cli, char *name, char *odp)
         token = strtok(NULL, ";");
     }
 
+    if (app->num_policies >= __MAX_POLICIES) {
+        cli_print(cli, "%s already has %d policies", app->name, __MAX_POLICIES);
+        return -1;
+    }
+
+    // app events keep checking the current policies until the new list is published
+    odp_t *odps = (odp_t *)MALLOC(sizeof(odp_t) * __MAX_POLICIES);
+    if (odps == NULL) {
+        PERROR("malloc");
+        return -1;
+    }
+
+    memcpy(odps, app->odp, sizeof(odp_t) * __MAX_POLICIES);
+
+    odp_t *policy = &odps[app->num_policies];
+
     for (i=0; i<cnt; i++) {
         if (strcmp(parm[i], "dpid") == 0) {
             int idx = 0;
@@ -775,9 +839,9 @@ int application_add_policy(cli_t *cli, char *name, char *odp)
 
             while (v != NULL) {
                 if (idx < __MAX_POLICY_ENTRIES) {
-                    app->odp[app->num_policies].flag |= ODP_DPID;
-                    app->odp[app->num_policies].dpid[idx] = atoi(v);
-                    cli_print(cli, "\tDPID: %lu", app->odp[app->num_policies].dpid[idx]);
+                    policy->flag |= ODP_DPID;
+                    policy->dpid[idx] = atoi(v);
+                    cli_print(cli, "\tDPID: %lu", policy->dpid[idx]);
                     idx++;
                 }
                 v = strtok(NULL, ",");
@@ -791,9 +855,9 @@ int application_add_policy(cli_t *cli, char *name, char *odp)
                     if (atoi(v) <= 0 || atoi(v) >= __MAX_NUM_PORTS) {
                         cli_print(cli, "\tPport: %s (wrong)", v);
                     } else {
-                        app->odp[app->num_policies].flag |= ODP_PORT;
-                        app->odp[app->num_policies].port[idx] = atoi(v);
-                        cli_print(cli, "\tPort: %u", app->odp[app->num_policies].port[idx]);
+                        policy->flag |= ODP_PORT;
+                        policy->port[idx] = atoi(v);
+                        cli_print(cli, "\tPort: %u", policy->port[idx]);
                         idx++;
                     }
                 }
@@ -806,32 +870,32 @@ int application_add_policy(cli_t *cli, char *name, char *odp)
             while (v != NULL) {
                 if (idx < __MAX_POLICY_ENTRIES) {
                     if (strcmp(v, "arp") == 0) {
-                        app->odp[app->num_policies].flag |= ODP_PROTO;
-                        app->odp[app->num_policies].proto |= PROTO_ARP;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_ARP;
                         cli_print(cli, "\tProtocol: ARP");
                     } else if (strcmp(v, "lldp") == 0) {
-                        app->odp[app->num_policies].flag |= ODP_PROTO;
-                        app->odp[app->num_policies].proto |= PROTO_LLDP;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_LLDP;
                         cli_print(cli, "\tProtocol: LLDP");
                     } else if (strcmp(v, "dhcp") == 0) {
-                        app->odp[app->num_policies].flag |= ODP_PROTO;
-                        app->odp[app->num_policies].proto |= PROTO_DHCP;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_DHCP;
                         cli_print(cli, "\tProtocol: DHCP");
                     } else if (strcmp(v, "tcp") == 0) {
-                        app->odp[app->num_policies].flag |= ODP_PROTO;
-                        app->odp[app->num_policies].proto |= PROTO_TCP;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_TCP;
                         cli_print(cli, "\tProtocol: TCP");
                     } else if (strcmp(v, "udp") == 0) {
-                        app->odp[app->num_policies].flag |= ODP_PROTO;
-                        app->odp[app->num_policies].proto |= PROTO_UDP;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_UDP;
                         cli_print(cli, "\tProtocol: UDP");
                     } else if (strcmp(v, "icmp") == 0) {
-                        app->odp[app->num_policies].flag |= ODP_PROTO;
-                        app->odp[app->num_policies].proto |= PROTO_ICMP;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_ICMP;
                         cli_print(cli, "\tProtocol: ICMP");
                     } else if (strcmp(v, "ipv4") == 0) {
-                        app->odp[app->num_policies].flag |= ODP_PROTO;
-                        app->odp[app->num_policies].proto |= PROTO_IPV4;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_IPV4;
                         cli_print(cli, "\tProtocol: IPv4");
                     } else {
                         cli_print(cli, "\tProtocol: %s (wrong)", v);
@@ -847,8 +911,8 @@ int application_add_policy(cli_t *cli, char *name, char *odp)
                 if (idx < __MAX_POLICY_ENTRIES) {
                     struct in_addr input;
                     if (inet_aton(v, &input)) {
-                        app->odp[app->num_policies].flag |= ODP_SRCIP;
-                        app->odp[app->num_policies].srcip[idx] = ip_addr_int(v);
+                        policy->flag |= ODP_SRCIP;
+                        policy->srcip[idx] = ip_addr_int(v);
                         cli_print(cli, "\tSource IP: %s", v);
                         idx++;
                     } else {
@@ -865,8 +929,8 @@ int application_add_policy(cli_t *cli, char *name, char *odp)
                 if (idx < __MAX_POLICY_ENTRIES) {
                     struct in_addr input;
                     if (inet_aton(v, &input)) {
-                        app->odp[app->num_policies].flag |= ODP_DSTIP;
-                        app->odp[app->num_policies].dstip[idx] = ip_addr_int(v);
+                        policy->flag |= ODP_DSTIP;
+                        policy->dstip[idx] = ip_addr_int(v);
                         cli_print(cli, "\tDestination IP: %s", v);
                         idx++;
                     } else {
@@ -885,8 +949,8 @@ int application_add_policy(cli_t *cli, char *name, char *odp)
                     if (port == 0 || port >= 65536) {
                         cli_print(cli, "\tSource port: %s (wrong)", v);
                     } else {
-                        app->odp[app->num_policies].flag |= ODP_SPORT;
-                        app->odp[app->num_policies].sport[idx] = port;
+                        policy->flag |= ODP_SPORT;
+                        policy->sport[idx] = port;
                         cli_print(cli, "\tSource port: %u", port);
                         idx++;
                     }
@@ -903,8 +967,8 @@ int application_add_policy(cli_t *cli, char *name, char *odp)
                     if (port == 0 || port >= 65536) {
                         cli_print(cli, "\tDestination port: %s (wrong)", v);
                     } else {
-                        app->odp[app->num_policies].flag |= ODP_DPORT;
-                        app->odp[app->num_policies].dport[idx] = port;
+                        policy->flag |= ODP_DPORT;
+                        policy->dport[idx] = port;
                         cli_print(cli, "\tDestination port: %u", port);
                         idx++;
                     }
@@ -916,6 +980,8 @@ int application_add_policy(cli_t *cli, char *name, char *odp)
         }
     }
 
+    odp_publish(&app->odp, odps);
+
     app->num_policies++;
 
     return 0;
@@ -957,13 +1023,23 @@ int application_del_policy(cli_t *cli, char *name, int idx)
         return -1;
     }
 
-    memset(&app->odp[idx-1], 0, sizeof(odp_t));
+    odp_t *odps = (odp_t *)MALLOC(sizeof(odp_t) * __MAX_POLICIES);
+    if (odps == NULL) {
+        PERROR("malloc");
+        return -1;
+    }
+
+    memcpy(odps, app->odp, sizeof(odp_t) * __MAX_POLICIES);
 
-    for (i=idx; i<__MAX_POLICY_ENTRIES; i++) {
-        memmove(&app->odp[i-1], &app->odp[i], sizeof(odp_t));
+    memset(&odps[idx-1], 0, sizeof(odp_t));
+
+    for (i=idx; i<__MAX_POLICIES; i++) {
+        memmove(&odps[i-1], &odps[i], sizeof(odp_t));
     }
 
-    memset(&app->odp[i-1], 0, sizeof(odp_t));
+    memset(&odps[i-1], 0, sizeof(odp_t));
+
+    odp_publish(&app->odp, odps);
 
     app->num_policies--;
 
@@ -1159,8 +1235,13 @@ static int clean_up_config(int num_apps, app_t **app_list, int *av_num, app_t **
     if (app_list != NULL) {
         int i;
         for (i=0; i<num_apps; i++) {
-            if (app_list[i] != NULL)
+            if (app_list[i] != NULL) {
+                if (app_list[i]->batch != NULL)
+                    msg_batch_destroy(app_list[i]->batch);
+                if (app_list[i]->odp != NULL)
+                    FREE(app_list[i]->odp);
                 FREE(app_list[i]);
+            }
         }
         FREE(app_list);
     }
@@ -1326,6 +1407,24 @@ int application_load(cli_t *cli, ctx_t *ctx)
             strcpy(req_addr, json_string_value(j_req_addr));
         }
 
+        char batch[__CONF_WORD_LEN] = {0};
+        json_t *j_batch = json_object_get(data, "batch");
+        if (json_is_string(j_batch)) {
+            strcpy(batch, json_string_value(j_batch));
+        }
+
+        char batch_usec[__CONF_WORD_LEN] = {0};
+        json_t *j_batch_usec = json_object_get(data, "batch_usec");
+        if (json_is_string(j_batch_usec)) {
+            strcpy(batch_usec, json_string_value(j_batch_usec));
+        }
+
+        char cpus[__CONF_WORD_LEN] = {0};
+        json_t *j_cpus = json_object_get(data, "cpus");
+        if (json_is_string(j_cpus)) {
+            strcpy(cpus, json_string_value(j_cpus));
+        }
+
         // find the index of an application to link the corresponding functions
         const int num_apps = sizeof(g_applications) / sizeof(app_func_t);
         int k;
@@ -1337,7 +1436,7 @@ int application_load(cli_t *cli, ctx_t *ctx)
         }
 
         // allocate a new application structure
-        app_t *app = calloc(1, sizeof(app_t));
+        app_t *app = CALLOC(1, sizeof(app_t));
         if (!app) {
             PERROR("calloc");
             clean_up_config(n_apps, app_list, av_num, av_list);
@@ -1431,6 +1530,15 @@ int application_load(cli_t *cli, ctx_t *ctx)
                  json_decref(json);
                  return -1;
             }
+
+            // set batched delivery for read-only events
+            app->batch_max = (strlen(batch) > 0) ? atoi(batch) : 0;
+            if (app->batch_max < 0)
+                app->batch_max = 0;
+            app->batch_usec = (strlen(batch_usec) > 0) ? atoi(batch_usec) : 0;
+            if (app->batch_max > 0)
+                cli_print(cli, "     Batch: %d events or %d us", app->batch_max,
+                          (app->batch_usec > 0) ? app->batch_usec : __MSG_BATCH_USEC);
         }
         
 	// set a role
@@ -1489,6 +1597,20 @@ int application_load(cli_t *cli, ctx_t *ctx)
         if (strlen(priority))
             cli_print(cli, "     Priority: %s", priority);
 
+        // set CPU placement
+        if (strlen(cpus) > 0) {
+            cpu_set_t set;
+            if (cpu_parse(cpus, &set) <= 0) {
+                cli_print(cli, "Wrong CPU list: %s", cpus);
+                FREE(app);
+                clean_up_config(n_apps, app_list, av_num, av_list);
+                json_decref(json);
+                return -1;
+            }
+            strcpy(app->cpus, cpus);
+            cli_print(cli, "     CPUs: %s", cpus);
+        }
+
         // set a status
         if (strlen(status) == 0) {
             app->status = APP_DISABLED;
@@ -1749,6 +1871,16 @@ int application_load(cli_t *cli, ctx_t *ctx)
             else cli_print(cli, "     Outbounds: %d events", app->out_num);
         }
 
+        // allocate an empty policy list
+        app->odp = (odp_t *)CALLOC(__MAX_POLICIES, sizeof(odp_t));
+        if (app->odp == NULL) {
+            PERROR("calloc");
+            FREE(app);
+            clean_up_config(n_apps, app_list, av_num, av_list);
+            json_decref(json);
+            return -1;
+        }
+
         app_list[n_apps] = app;
         n_apps++;
     }
@@ -1800,6 +1932,25 @@ int application_load(cli_t *cli, ctx_t *ctx)
         }
     }
 
+    // build the configuration to publish
+    app_conf_t *new_conf = (app_conf_t *)CALLOC(1, sizeof(app_conf_t));
+    if (new_conf == NULL) {
+        PERROR("calloc");
+        clean_up_config(n_apps, app_list, av_num, av_list);
+        return -1;
+    }
+
+    new_conf->num_apps = n_apps;
+    new_conf->app_list = app_list;
+    new_conf->av_num = av_num;
+    new_conf->av_list = av_list;
+
+    for (i=0; i<n_apps; i++) {
+        int j;
+        for (j=0; j<app_list[i]->out_num; j++)
+            new_conf->out_ok[app_list[i]->out_list[j]] = TRUE;
+    }
+
     app_ctx->app_on = FALSE;
 
     // back up previous pointers
@@ -1807,6 +1958,7 @@ int application_load(cli_t *cli, ctx_t *ctx)
     app_t **temp_app_list = app_ctx->app_list;
     int *temp_av_num = app_ctx->av_num;
     app_t ***temp_av_list = app_ctx->av_list;
+    app_conf_t *temp_conf = app_ctx->app_conf;
 
     // recover previous status and metadata
     for (i=0; i<n_apps; i++) {
@@ -1857,6 +2009,16 @@ int application_load(cli_t *cli, ctx_t *ctx)
     app_ctx->av_num = av_num;
     app_ctx->av_list = av_list;
 
+    new_conf->version = (temp_conf) ? temp_conf->version + 1 : 1;
+
+    // switch the app event handler over at once, then wait until no app event can see the previous configuration
+    __atomic_store_n(&app_ctx->app_conf, new_conf, __ATOMIC_RELEASE);
+
+    epoch_synchronize();
+
+    if (temp_conf)
+        FREE(temp_conf);
+
     // deallocate previous pointers
     clean_up_config(temp_num_apps, temp_app_list, temp_av_num, temp_av_list);
 
@@ -706,6 +706,35 @@ static int cli_log(struct cli_def *cli, UNUSED(const char *command), char *argv[
     return CLI_OK;
 }
 
+/**
+ * \brief Function to print the memory usage of components, applications, and core modules
+ * \param cli CLI context
+ * \param command Command
+ * \param argv Arguments
+ * \param argc The number of arguments
+ */
+static int cli_show_memory(struct cli_def *cli, UNUSED(const char *command), char *argv[], int argc)
+{
+#ifdef __ENABLE_MEM_ACCOUNTING
+    int i, num_sites = mem_acct_num_sites();
+
+    cli_print(cli, "<Memory Usage>");
+    cli_print(cli, "  %-24s %12s %12s %12s %10s", "Name", "Live", "Peak", "Allocs", "Allocs/s");
+
+    for (i=0; i<num_sites; i++) {
+        mem_site_t *site = mem_acct_site(i);
+
+        // the rate is computed from the previous report
+        cli_print(cli, "  %-24s %12ld %12ld %12lu %10.1f", site->name,
+                  site->live, site->peak, site->num_allocs, mem_acct_rate(site));
+    }
+#else /* !__ENABLE_MEM_ACCOUNTING */
+    cli_print(cli, "Memory accounting is disabled (build with __ENABLE_MEM_ACCOUNTING)");
+#endif /* !__ENABLE_MEM_ACCOUNTING */
+
+    return CLI_OK;
+}
+
 /**
  * \brief Function to terminate the Barista NOS
  * \param cli CLI context
@@ -892,6 +921,7 @@ int start_cli(ctx_t *ctx)
     cli_register_command(cli, c, "app_event", cli_show_app_event, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "[App_event Name], Show the applications mapped to an app event");
     cli_register_command(cli, c, "component", cli_show_component, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "[Component Name], Show the configuration of a component");
     cli_register_command(cli, c, "application", cli_show_application, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "[Application Name], Show the configuration of an application");
+    cli_register_command(cli, c, "memory", cli_show_memory, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "Show the memory usage of components, applications, and core modules");
 
     c = cli_register_command(cli, NULL, "list", NULL, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, NULL);
     cli_register_command(cli, c, "events", cli_list_events, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "List up all events for components");
@@ -18,6 +18,10 @@
 #include "component.h"
 #include "component_list.h"
 #include "event.h"
+#include "msg_batch.h"
+#include "cpu_affinity.h"
+#include "epoch.h"
+#include "timer_task.h"
 
 /////////////////////////////////////////////////////////////////////
 
@@ -51,6 +55,106 @@ static int event_type(const char *event)
     return EV_NUM_EVENTS;
 }
 
+/** \brief The class list to convert a class string to an event class */
+const char event_class_string[EV_NUM_CLASSES][__CONF_WORD_LEN] = {
+    "control", "packet_in", "stats", "log", "management"
+};
+
+/**
+ * \brief Function to load the scheduling configuration of an event class
+ * \param cli CLI context
+ * \param data The configuration of the class
+ * \param ev_class The scheduling configurations of event classes
+ */
+static int event_class_load(cli_t *cli, json_t *data, ev_class_conf_t *ev_class)
+{
+    char name[__CONF_WORD_LEN] = {0};
+    json_t *j_name = json_object_get(data, "class");
+    if (json_is_string(j_name)) {
+        strcpy(name, json_string_value(j_name));
+    }
+
+    char mode[__CONF_WORD_LEN] = {0};
+    json_t *j_mode = json_object_get(data, "mode");
+    if (json_is_string(j_mode)) {
+        strcpy(mode, json_string_value(j_mode));
+    }
+
+    char weight[__CONF_WORD_LEN] = {0};
+    json_t *j_weight = json_object_get(data, "weight");
+    if (json_is_string(j_weight)) {
+        strcpy(weight, json_string_value(j_weight));
+    }
+
+    char workers[__CONF_WORD_LEN] = {0};
+    json_t *j_workers = json_object_get(data, "workers");
+    if (json_is_string(j_workers)) {
+        strcpy(workers, json_string_value(j_workers));
+    }
+
+    char queue[__CONF_WORD_LEN] = {0};
+    json_t *j_queue = json_object_get(data, "queue");
+    if (json_is_string(j_queue)) {
+        strcpy(queue, json_string_value(j_queue));
+    }
+
+    char on_full[__CONF_WORD_LEN] = {0};
+    json_t *j_on_full = json_object_get(data, "on_full");
+    if (json_is_string(j_on_full)) {
+        strcpy(on_full, json_string_value(j_on_full));
+    }
+
+    int c;
+    for (c=0; c<EV_NUM_CLASSES; c++) {
+        if (strcmp(name, event_class_string[c]) == 0)
+            break;
+    }
+
+    if (c == EV_NUM_CLASSES) {
+        cli_print(cli, "Wrong event class: %s", name);
+        return -1;
+    }
+
+    ev_class_conf_t *conf = &ev_class[c];
+
+    conf->mode = (strcmp(mode, "async") == 0) ? EV_SCHED_ASYNC : EV_SCHED_SYNC;
+
+    conf->weight = (strlen(weight) > 0) ? atoi(weight) : 1;
+    if (conf->weight <= 0)
+        conf->weight = 1;
+
+    conf->workers = (strlen(workers) > 0) ? atoi(workers) : 0;
+    if (conf->workers < 0)
+        conf->workers = 0;
+    else if (conf->workers > __EV_SCHED_MAX_WORKERS)
+        conf->workers = __EV_SCHED_MAX_WORKERS;
+
+    conf->queue = (strlen(queue) > 0) ? atoi(queue) : 0;
+    if (conf->queue <= 0)
+        conf->queue = __EV_SCHED_QUEUE;
+
+    if (strcmp(on_full, "drop") == 0)
+        conf->on_full = EV_SCHED_DROP;
+    else // default: run
+        conf->on_full = EV_SCHED_RUN;
+
+    cli_print(cli, "Event class: %s", name);
+
+    if (conf->mode == EV_SCHED_SYNC) {
+        cli_print(cli, "     Mode: sync");
+    } else {
+        cli_print(cli, "     Mode: async");
+        if (conf->workers > 0)
+            cli_print(cli, "     Workers: %d", conf->workers);
+        else
+            cli_print(cli, "     Workers: shared (weight %d)", conf->weight);
+        cli_print(cli, "     Queue: %d events (%s)", conf->queue,
+                  (conf->on_full == EV_SCHED_DROP) ? "drop" : "run");
+    }
+
+    return 0;
+}
+
 /**
  * \brief Function to print components that listen to an event
  * \param cli CLI context
@@ -250,6 +354,26 @@ static int component_print(cli_t *cli, compnt_t *compnt, int details)
 
     cli_bufprt(cli, buf);
 
+    if (compnt->site == COMPNT_EXTERNAL) {
+        cli_print(cli, "    Requests: %d ms (%s), %d/%d credits in use",
+                  compnt->timeout, (compnt->on_timeout == COMPNT_FAIL_CLOSED) ? "drop" : "pass",
+                  compnt->in_flight, compnt->credits);
+        cli_print(cli, "    Missed deadlines: %lu, Throttled: %lu", compnt->num_timeouts, compnt->num_throttled);
+        if (compnt->batch_max > 0)
+            cli_print(cli, "    Batch: %d events or %d us", compnt->batch_max,
+                      (compnt->batch_usec > 0) ? compnt->batch_usec : __MSG_BATCH_USEC);
+    }
+#ifdef __ENABLE_MEM_ACCOUNTING
+    else {
+        mem_site_t *site = mem_acct_find(compnt->name);
+        if (site != NULL)
+            cli_print(cli, "    Memory: %ld bytes (peak: %ld bytes), %lu allocs, %lu frees",
+                      site->live, site->peak, site->num_allocs, site->num_frees);
+        else
+            cli_print(cli, "    Memory: no allocations");
+    }
+#endif /* __ENABLE_MEM_ACCOUNTING */
+
     if (compnt->status == COMPNT_DISABLED)
         cli_print(cli, "    Status: disabled");
     else if (compnt->activated == TRUE)
@@ -394,7 +518,26 @@ static void *thread_main(void *compnt_id)
 
     FREE(compnt_id);
 
-    if (compnt->main(&compnt->activated, compnt->argc, compnt->argv) < 0) {
+    int ret;
+
+    if (compnt->type == COMPNT_AUTO) {
+        compnt->tid = syscall(SYS_gettid);
+        cpu_bind_thread(compnt->name, compnt->cpus);
+    } else {
+        cpu_set_placement(compnt->cpus);
+    }
+
+    MEM_OWNER_PUSH(compnt->name);
+    ret = compnt->main(&compnt->activated, compnt->argc, compnt->argv);
+    MEM_OWNER_POP();
+
+    // the periodic work of an autonomous component may go on in timer workers, which report the component as their owner
+    if (compnt->type == COMPNT_AUTO)
+        compnt->tid = 0;
+    else
+        cpu_set_placement(NULL);
+
+    if (ret < 0) {
         compnt->activated = FALSE;
         return NULL;
     } else {
@@ -402,6 +545,37 @@ static void *thread_main(void *compnt_id)
     }
 }
 
+/**
+ * \brief Function to find the autonomous component running on a thread
+ * \param tid Thread ID (the main thread of a component or a timer worker)
+ * \return Component name (NULL if not found)
+ */
+const char *component_thread_owner(pid_t tid)
+{
+    if (compnt_ctx == NULL || tid == 0)
+        return NULL;
+
+    int i;
+    for (i=0; i<compnt_ctx->num_compnts; i++) {
+        compnt_t *compnt = compnt_ctx->compnt_list[i];
+        if (compnt->tid == tid && compnt->activated)
+            return compnt->name;
+    }
+
+    // the periodic work of components runs on the timer workers, named after their components
+    char name[__CONF_WORD_LEN] = {0};
+    if (timer_task_owner(tid, name) < 0)
+        return NULL;
+
+    for (i=0; i<compnt_ctx->num_compnts; i++) {
+        compnt_t *compnt = compnt_ctx->compnt_list[i];
+        if (strcmp(compnt->name, name) == 0 && compnt->activated)
+            return compnt->name;
+    }
+
+    return NULL;
+}
+
 /**
  * \brief Function to activate a component
  * \param cli CLI context
@@ -817,6 +991,22 @@ int component_stop(cli_t *cli)
     return 0;
 }
 
+/**
+ * \brief Function to replace the policies of a component once no event checks the previous ones
+ * \param odp The policy list of a component
+ * \param odps New policy list
+ */
+static void odp_publish(odp_t **odp, odp_t *odps)
+{
+    odp_t *old = *odp;
+
+    __atomic_store_n(odp, odps, __ATOMIC_RELEASE);
+
+    epoch_synchronize();
+
+    FREE(old);
+}
+
 /**
  * \brief Function to add a policy to a component
  * \param cli CLI context
@@ -862,6 +1052,22 @@ int component_add_policy(cli_t *cli, char *name, char *odp)
         token = strtok(NULL, ";");
     }
 
+    if (compnt->num_policies >= __MAX_POLICIES) {
+        cli_print(cli, "%s already has %d policies", compnt->name, __MAX_POLICIES);
+        return -1;
+    }
+
+    // events keep checking the current policies until the new list is published
+    odp_t *odps = (odp_t *)MALLOC(sizeof(odp_t) * __MAX_POLICIES);
+    if (odps == NULL) {
+        PERROR("malloc");
+        return -1;
+    }
+
+    memcpy(odps, compnt->odp, sizeof(odp_t) * __MAX_POLICIES);
+
+    odp_t *policy = &odps[compnt->num_policies];
+
     for (i=0; i<cnt; i++) {
         if (strcmp(parm[i], "dpid") == 0) {
             int idx = 0;
@@ -869,9 +1075,9 @@ int component_add_policy(cli_t *cli, char *name, char *odp)
 
             while (v != NULL) {
                 if (idx < __MAX_POLICY_ENTRIES) {
-                    compnt->odp[compnt->num_policies].flag |= ODP_DPID;
-                    compnt->odp[compnt->num_policies].dpid[idx] = atoi(v);
-                    cli_print(cli, "\tDPID: %lu", compnt->odp[compnt->num_policies].dpid[idx]);
+                    policy->flag |= ODP_DPID;
+                    policy->dpid[idx] = atoi(v);
+                    cli_print(cli, "\tDPID: %lu", policy->dpid[idx]);
                     idx++;
                 }
                 v = strtok(NULL, ",");
@@ -885,9 +1091,9 @@ int component_add_policy(cli_t *cli, char *name, char *odp)
                     if (atoi(v) <= 0 || atoi(v) >= __MAX_NUM_PORTS) {
                         cli_print(cli, "\tPort: %s (wrong)", v);
                     } else {
-                        compnt->odp[compnt->num_policies].flag |= ODP_PORT;
-                        compnt->odp[compnt->num_policies].port[idx] = atoi(v);
-                        cli_print(cli, "\tPort: %u", compnt->odp[compnt->num_policies].port[idx]);
+                        policy->flag |= ODP_PORT;
+                        policy->port[idx] = atoi(v);
+                        cli_print(cli, "\tPort: %u", policy->port[idx]);
                         idx++;
                     }
                 }
@@ -900,32 +1106,32 @@ int component_add_policy(cli_t *cli, char *name, char *odp)
             while (v != NULL) {
                 if (idx < __MAX_POLICY_ENTRIES) {
                     if (strcmp(v, "arp") == 0) {
-                        compnt->odp[compnt->num_policies].flag |= ODP_PROTO;
-                        compnt->odp[compnt->num_policies].proto |= PROTO_ARP;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_ARP;
                         cli_print(cli, "\tProtocol: ARP");
                     } else if (strcmp(v, "lldp") == 0) {
-                        compnt->odp[compnt->num_policies].flag |= ODP_PROTO;
-                        compnt->odp[compnt->num_policies].proto |= PROTO_LLDP;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_LLDP;
                         cli_print(cli, "\tProtocol: LLDP");
                     } else if (strcmp(v, "dhcp") == 0) {
-                        compnt->odp[compnt->num_policies].flag |= ODP_PROTO;
-                        compnt->odp[compnt->num_policies].proto |= PROTO_DHCP;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_DHCP;
                         cli_print(cli, "\tProtocol: DHCP");
                     } else if (strcmp(v, "tcp") == 0) {
-                        compnt->odp[compnt->num_policies].flag |= ODP_PROTO;
-                        compnt->odp[compnt->num_policies].proto |= PROTO_TCP;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_TCP;
                         cli_print(cli, "\tProtocol: TCP");
                     } else if (strcmp(v, "udp") == 0) {
-                        compnt->odp[compnt->num_policies].flag |= ODP_PROTO;
-                        compnt->odp[compnt->num_policies].proto |= PROTO_UDP;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_UDP;
                         cli_print(cli, "\tProtocol: UDP");
                     } else if (strcmp(v, "icmp") == 0) {
-                        compnt->odp[compnt->num_policies].flag |= ODP_PROTO;
-                        compnt->odp[compnt->num_policies].proto |= PROTO_ICMP;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_ICMP;
                         cli_print(cli, "\tProtocol: ICMP");
                     } else if (strcmp(v, "ipv4") == 0) {
-                        compnt->odp[compnt->num_policies].flag |= ODP_PROTO;
-                        compnt->odp[compnt->num_policies].proto |= PROTO_IPV4;
+                        policy->flag |= ODP_PROTO;
+                        policy->proto |= PROTO_IPV4;
                         cli_print(cli, "\tProtocol: IPv4");
                     } else {
                         cli_print(cli, "\tProtocol: %s (wrong)", v);
@@ -941,8 +1147,8 @@ int component_add_policy(cli_t *cli, char *name, char *odp)
                 if (idx < __MAX_POLICY_ENTRIES) {
                     struct in_addr input;
                     if (inet_aton(v, &input)) {
-                        compnt->odp[compnt->num_policies].flag |= ODP_SRCIP;
-                        compnt->odp[compnt->num_policies].srcip[idx] = ip_addr_int(v);
+                        policy->flag |= ODP_SRCIP;
+                        policy->srcip[idx] = ip_addr_int(v);
                         cli_print(cli, "\tSource IP: %s", v);
                         idx++;
                     } else {
@@ -959,8 +1165,8 @@ int component_add_policy(cli_t *cli, char *name, char *odp)
                 if (idx < __MAX_POLICY_ENTRIES) {
                     struct in_addr input;
                     if (inet_aton(v, &input)) {
-                        compnt->odp[compnt->num_policies].flag |= ODP_DSTIP;
-                        compnt->odp[compnt->num_policies].dstip[idx] = ip_addr_int(v);
+                        policy->flag |= ODP_DSTIP;
+                        policy->dstip[idx] = ip_addr_int(v);
                         cli_print(cli, "\tDestination IP: %s", v);
                         idx++;
                     } else {
@@ -979,8 +1185,8 @@ int component_add_policy(cli_t *cli, char *name, char *odp)
                     if (port == 0 || port >= 65536) {
                         cli_print(cli, "\tSource port: %s (wrong)", v);
                     } else {
-                        compnt->odp[compnt->num_policies].flag |= ODP_SPORT;
-                        compnt->odp[compnt->num_policies].sport[idx] = port;
+                        policy->flag |= ODP_SPORT;
+                        policy->sport[idx] = port;
                         cli_print(cli, "\tSource port: %u", port);
                         idx++;
                     }
@@ -997,8 +1203,8 @@ int component_add_policy(cli_t *cli, char *name, char *odp)
                     if (port == 0 || port >= 65536) {
                         cli_print(cli, "\tDestination port: %s (wrong)", v);
                     } else {
-                        compnt->odp[compnt->num_policies].flag |= ODP_DPORT;
-                        compnt->odp[compnt->num_policies].dport[idx] = port;
+                        policy->flag |= ODP_DPORT;
+                        policy->dport[idx] = port;
                         cli_print(cli, "\tDestination port: %u", port);
                         idx++;
                     }
@@ -1010,6 +1216,8 @@ int component_add_policy(cli_t *cli, char *name, char *odp)
         }
     }
 
+    odp_publish(&compnt->odp, odps);
+
     compnt->num_policies++;
 
     return 0;
@@ -1051,13 +1259,23 @@ int component_del_policy(cli_t *cli, char *name, int idx)
         return -1;
     }
 
-    memset(&compnt->odp[idx-1], 0, sizeof(odp_t));
+    odp_t *odps = (odp_t *)MALLOC(sizeof(odp_t) * __MAX_POLICIES);
+    if (odps == NULL) {
+        PERROR("malloc");
+        return -1;
+    }
 
-    for (i=idx; i<__MAX_POLICY_ENTRIES; i++) {
-        memmove(&compnt->odp[i-1], &compnt->odp[i], sizeof(odp_t));
+    memcpy(odps, compnt->odp, sizeof(odp_t) * __MAX_POLICIES);
+
+    memset(&odps[idx-1], 0, sizeof(odp_t));
+
+    for (i=idx; i<__MAX_POLICIES; i++) {
+        memmove(&odps[i-1], &odps[i], sizeof(odp_t));
     }
 
-    memset(&compnt->odp[i-1], 0, sizeof(odp_t));
+    memset(&odps[i-1], 0, sizeof(odp_t));
+
+    odp_publish(&compnt->odp, odps);
 
     compnt->num_policies--;
 
@@ -1254,8 +1472,13 @@ static int clean_up_config(int num_compnts, compnt_t **compnt_list, int *ev_num,
     if (compnt_list != NULL) {
         int i;
         for (i=0; i<num_compnts; i++) {
-            if (compnt_list[i] != NULL)
+            if (compnt_list[i] != NULL) {
+                if (compnt_list[i]->batch != NULL)
+                    msg_batch_destroy(compnt_list[i]->batch);
+                if (compnt_list[i]->odp != NULL)
+                    FREE(compnt_list[i]->odp);
                 FREE(compnt_list[i]);
+            }
         }
         FREE(compnt_list);
     }
@@ -1357,10 +1580,32 @@ int component_load(cli_t *cli, ctx_t *ctx)
         }
     }
 
+    // every event class is delivered in its raising thread unless configured otherwise
+    ev_class_conf_t ev_class[EV_NUM_CLASSES];
+
     int i;
+    for (i=0; i<EV_NUM_CLASSES; i++) {
+        ev_class[i].mode = EV_SCHED_SYNC;
+        ev_class[i].weight = 1;
+        ev_class[i].workers = 0;
+        ev_class[i].queue = __EV_SCHED_QUEUE;
+        ev_class[i].on_full = EV_SCHED_RUN;
+    }
+
     for (i=0; i<json_array_size(json); i++) {
         json_t *data = json_array_get(json, i);
 
+        // an entry with a class sets the scheduling of the events in the class
+        if (json_object_get(data, "class") != NULL) {
+            if (event_class_load(cli, data, ev_class)) {
+                clean_up_config(num_compnts, compnt_list, ev_num, ev_list);
+                json_decref(json);
+                return -1;
+            }
+
+            continue;
+        }
+
         char name[__CONF_WORD_LEN] = {0};
         json_t *j_name = json_object_get(data, "name");
         if (json_is_string(j_name)) {
@@ -1421,6 +1666,42 @@ int component_load(cli_t *cli, ctx_t *ctx)
             strcpy(req_addr, json_string_value(j_req_addr));
         }
 
+        char timeout[__CONF_WORD_LEN] = {0};
+        json_t *j_timeout = json_object_get(data, "timeout");
+        if (json_is_string(j_timeout)) {
+            strcpy(timeout, json_string_value(j_timeout));
+        }
+
+        char on_timeout[__CONF_WORD_LEN] = {0};
+        json_t *j_on_timeout = json_object_get(data, "on_timeout");
+        if (json_is_string(j_on_timeout)) {
+            strcpy(on_timeout, json_string_value(j_on_timeout));
+        }
+
+        char credits[__CONF_WORD_LEN] = {0};
+        json_t *j_credits = json_object_get(data, "credits");
+        if (json_is_string(j_credits)) {
+            strcpy(credits, json_string_value(j_credits));
+        }
+
+        char batch[__CONF_WORD_LEN] = {0};
+        json_t *j_batch = json_object_get(data, "batch");
+        if (json_is_string(j_batch)) {
+            strcpy(batch, json_string_value(j_batch));
+        }
+
+        char batch_usec[__CONF_WORD_LEN] = {0};
+        json_t *j_batch_usec = json_object_get(data, "batch_usec");
+        if (json_is_string(j_batch_usec)) {
+            strcpy(batch_usec, json_string_value(j_batch_usec));
+        }
+
+        char cpus[__CONF_WORD_LEN] = {0};
+        json_t *j_cpus = json_object_get(data, "cpus");
+        if (json_is_string(j_cpus)) {
+            strcpy(cpus, json_string_value(j_cpus));
+        }
+
         // find the index of a component to link the corresponding functions
         const int num_components = sizeof(g_components) / sizeof(compnt_func_t);
         int k;
@@ -1432,7 +1713,7 @@ int component_load(cli_t *cli, ctx_t *ctx)
         }
 
         // allocate a new component structure
-        compnt_t *compnt = calloc(1, sizeof(compnt_t));
+        compnt_t *compnt = CALLOC(1, sizeof(compnt_t));
         if (!compnt) {
              PERROR("calloc");
              clean_up_config(num_compnts, compnt_list, ev_num, ev_list);
@@ -1526,6 +1807,24 @@ int component_load(cli_t *cli, ctx_t *ctx)
                  json_decref(json);
                  return -1;
             }
+
+            // set the deadline and the credits of requests (the policy depends on the role and the permission)
+            compnt->timeout = (strlen(timeout) > 0) ? atoi(timeout) : 0;
+            if (compnt->timeout <= 0)
+                compnt->timeout = __EXT_REQ_TIMEOUT;
+
+            compnt->credits = (strlen(credits) > 0) ? atoi(credits) : 0;
+            if (compnt->credits <= 0)
+                compnt->credits = __EXT_REQ_CREDITS;
+
+            // set batched delivery for read-only events
+            compnt->batch_max = (strlen(batch) > 0) ? atoi(batch) : 0;
+            if (compnt->batch_max < 0)
+                compnt->batch_max = 0;
+            compnt->batch_usec = (strlen(batch_usec) > 0) ? atoi(batch_usec) : 0;
+            if (compnt->batch_max > 0)
+                cli_print(cli, "     Batch: %d events or %d us", compnt->batch_max,
+                          (compnt->batch_usec > 0) ? compnt->batch_usec : __MSG_BATCH_USEC);
         }
 
         // set a role
@@ -1564,6 +1863,29 @@ int component_load(cli_t *cli, ctx_t *ctx)
         if (compnt->perm == 0) compnt->perm |= COMPNT_READ;
         cli_print(cli, "     Permission: %s", perm);
 
+        // set the policy for requests that miss their deadlines (external only)
+        if (compnt->site == COMPNT_EXTERNAL) {
+            if (strcmp(on_timeout, "drop") == 0) {
+                compnt->on_timeout = COMPNT_FAIL_CLOSED;
+            } else if (strcmp(on_timeout, "pass") == 0) {
+                compnt->on_timeout = COMPNT_FAIL_OPEN;
+            } else if (strlen(on_timeout) > 0) {
+                cli_print(cli, "     Requests: wrong on_timeout (%s)", on_timeout);
+                FREE(compnt);
+                clean_up_config(num_compnts, compnt_list, ev_num, ev_list);
+                json_decref(json);
+                return -1;
+            } else if ((compnt->perm & COMPNT_EXECUTE) || compnt->role >= COMPNT_SECURITY) {
+                // a checker that can be overloaded must not be skipped by default
+                compnt->on_timeout = COMPNT_FAIL_CLOSED;
+            } else { // default: pass
+                compnt->on_timeout = COMPNT_FAIL_OPEN;
+            }
+
+            cli_print(cli, "     Requests: %d ms (%s), %d credits", compnt->timeout,
+                      (compnt->on_timeout == COMPNT_FAIL_CLOSED) ? "drop" : "pass", compnt->credits);
+        }
+
         // set priority
         if (strlen(priority) == 0)
             compnt->priority = 0;
@@ -1572,6 +1894,20 @@ int component_load(cli_t *cli, ctx_t *ctx)
         if (strlen(priority))
             cli_print(cli, "     Priority: %s", priority);
 
+        // set CPU placement
+        if (strlen(cpus) > 0) {
+            cpu_set_t set;
+            if (cpu_parse(cpus, &set) <= 0) {
+                cli_print(cli, "Wrong CPU list: %s", cpus);
+                FREE(compnt);
+                clean_up_config(num_compnts, compnt_list, ev_num, ev_list);
+                json_decref(json);
+                return -1;
+            }
+            strcpy(compnt->cpus, cpus);
+            cli_print(cli, "     CPUs: %s", cpus);
+        }
+
         // set a status
         if (strlen(status) == 0) {
             compnt->status = COMPNT_DISABLED;
@@ -1790,6 +2126,16 @@ int component_load(cli_t *cli, ctx_t *ctx)
             else cli_print(cli, "     Outbounds: %d events", compnt->out_num);
         }
 
+        // allocate an empty policy list
+        compnt->odp = (odp_t *)CALLOC(__MAX_POLICIES, sizeof(odp_t));
+        if (compnt->odp == NULL) {
+            PERROR("calloc");
+            FREE(compnt);
+            clean_up_config(num_compnts, compnt_list, ev_num, ev_list);
+            json_decref(json);
+            return -1;
+        }
+
         compnt_list[num_compnts] = compnt;
         num_compnts++;
     }
@@ -1841,6 +2187,27 @@ int component_load(cli_t *cli, ctx_t *ctx)
         }
     }
 
+    // build the configuration to publish
+    compnt_conf_t *new_conf = (compnt_conf_t *)CALLOC(1, sizeof(compnt_conf_t));
+    if (new_conf == NULL) {
+        PERROR("calloc");
+        clean_up_config(num_compnts, compnt_list, ev_num, ev_list);
+        return -1;
+    }
+
+    new_conf->num_compnts = num_compnts;
+    new_conf->compnt_list = compnt_list;
+    new_conf->ev_num = ev_num;
+    new_conf->ev_list = ev_list;
+
+    memcpy(new_conf->ev_class, ev_class, sizeof(ev_class));
+
+    for (i=0; i<num_compnts; i++) {
+        int j;
+        for (j=0; j<compnt_list[i]->out_num; j++)
+            new_conf->out_ok[compnt_list[i]->out_list[j]] = TRUE;
+    }
+
     compnt_ctx->compnt_on = FALSE;
 
     // back up previous pointers
@@ -1848,6 +2215,7 @@ int component_load(cli_t *cli, ctx_t *ctx)
     compnt_t **temp_compnt_list = compnt_ctx->compnt_list;
     int *temp_ev_num = compnt_ctx->ev_num;
     compnt_t ***temp_ev_list = compnt_ctx->ev_list;
+    compnt_conf_t *temp_conf = compnt_ctx->compnt_conf;
 
     // recover previous status and metadata
     for (i=0; i<num_compnts; i++) {
@@ -1898,6 +2266,26 @@ int component_load(cli_t *cli, ctx_t *ctx)
     compnt_ctx->ev_num = ev_num;
     compnt_ctx->ev_list = ev_list;
 
+    new_conf->version = (temp_conf) ? temp_conf->version + 1 : 1;
+
+    // switch the event handler over at once, then wait until no event can see the previous configuration
+    __atomic_store_n(&compnt_ctx->compnt_conf, new_conf, __ATOMIC_RELEASE);
+
+    epoch_synchronize();
+
+    // then the scheduler workers follow the event classes of the new one
+    if (ev_sched_update(new_conf)) {
+        cli_print(cli, "Failed to start the workers of event classes");
+    }
+
+    if (temp_conf) {
+        // the requests in flight to external components and the queued events finish their chains on the previous one
+        while (__atomic_load_n(&temp_conf->refs, __ATOMIC_ACQUIRE) > 0)
+            waitsec(0, 1000 * 1000);
+
+        FREE(temp_conf);
+    }
+
     // deallocate previous pointers
     clean_up_config(temp_num_compnts, temp_compnt_list, temp_ev_num, temp_ev_list);
 
@@ -74,6 +74,7 @@ struct _app_t {
     int perm; /**< Permission */
     int status; /**< Status */
     int priority; /**< Priority */
+    char cpus[__CONF_WORD_LEN]; /**< The CPUs to run on (e.g., "0-3,8", empty: anywhere) */
     int activated; /**< Activation */
 
     void *push_ctx; /**< Push context */
@@ -82,6 +83,12 @@ struct _app_t {
     void *req_ctx; /**< Request context */
     char req_addr[__CONF_WORD_LEN]; /**< Request address */
 
+    struct _shm_link_t *shm; /**< Shared-memory rings (NULL: ZeroMQ only) */
+
+    int batch_max; /**< The number of events to send in a batch (0: no batching) */
+    int batch_usec; /**< The time to hold a batch before sending it (us) */
+    struct _msg_batch_t *batch; /**< Events waiting to be sent (created on the first event) */
+
     app_main_f main; /**< The main function pointer */
     app_handler_f handler; /**< The handler function pointer */
     app_cleanup_f cleanup; /**< The cleanup function pointer */
@@ -95,11 +102,24 @@ struct _app_t {
     int out_list[__MAX_APP_EVENTS]; /**< Outbound app events */
 
     int num_policies; /**< The number of policies */
-    odp_t odp[__MAX_POLICIES]; /**< The list of operator-defined policies */
+    odp_t *odp; /**< The list of operator-defined policies (__MAX_POLICIES, replaced as a whole) */
 
     uint64_t num_app_events[__MAX_APP_EVENTS]; /**< The number of triggered times */
 };
 
+/** \brief The structure of the application configuration seen by the app event handler (immutable once published) */
+struct _app_conf_t {
+    uint64_t version; /**< The version of the configuration */
+
+    int num_apps; /**< The number of applications */
+    app_t **app_list; /**< Application list */
+
+    int *av_num; /**< The number of applications for each app event */
+    app_t ***av_list; /**< Application chains for each app event */
+
+    uint8_t out_ok[__MAX_APP_EVENTS]; /**< The flags whether any application raises each app event */
+};
+
 // function for the base framework
 int application_load(cli_t *, ctx_t *);
 int application_start(cli_t *);
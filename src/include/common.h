@@ -28,6 +28,7 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/sysinfo.h>
+#include <sys/syscall.h>
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -84,6 +85,30 @@
 /** \brief The default replying address for external app events */
 #define __EXT_APP_REPLY_ADDR "tcp://127.0.0.1:6002"
 
+/** \brief The internal address to hand requests from external components over to workers */
+#define __EXT_COMP_WORKER_ADDR "inproc://ext_comp_workers"
+
+/** \brief The internal address to hand requests from external applications over to workers */
+#define __EXT_APP_WORKER_ADDR "inproc://ext_app_workers"
+
+/** \brief The maximum number of workers to reply external requests (default: the number of cores) */
+#define __EXT_MAX_REPLY_WORKERS 16
+
+/** \brief The default deadline of a request to an external component (ms) */
+#define __EXT_REQ_TIMEOUT 1000
+
+/** \brief The default number of requests in flight to an external component */
+#define __EXT_REQ_CREDITS 64
+
+/** \brief The number of scheduler workers shared by the event classes without their own workers */
+#define __EV_SCHED_WORKERS 2
+
+/** \brief The maximum number of dedicated scheduler workers of an event class */
+#define __EV_SCHED_MAX_WORKERS 16
+
+/** \brief The default maximum number of queued events of an event class */
+#define __EV_SCHED_QUEUE 4096
+
 /** \brief The number of characters to be used to generate IDs */
 #define __HASHING_NAME_LENGTH 8
 
@@ -153,9 +178,36 @@
     waitsec(0, 1000); \
 }
 
+//#define __ENABLE_MEM_ACCOUNTING
+#ifdef __ENABLE_MEM_ACCOUNTING
+#include "mem_acct.h"
+
+/** \brief Functions to allocate a space (accounted to the current owner, or to the source file) */
+#define MALLOC(x) mem_alloc(x, 1, FALSE, __FILE__)
+#define CALLOC(x, y) mem_alloc(y, x, TRUE, __FILE__)
+#define REALLOC(x, y) mem_realloc(x, y, __FILE__)
+
+/** \brief Functions to account the allocations of the current thread to a component or an application */
+#define MEM_OWNER_PUSH(x) const char *mem_prev_owner = mem_acct_owner(x)
+#define MEM_OWNER_POP() mem_acct_owner(mem_prev_owner)
+
+/** \brief Function to release a space if the space is valid */
+#define FREE(x) \
+{ \
+    if (x) { \
+        mem_free(x); \
+        x = NULL; \
+    } \
+}
+#else /* !__ENABLE_MEM_ACCOUNTING */
 /** \brief Functions to allocate a space */
 #define MALLOC(x) malloc(x)
 #define CALLOC(x, y) calloc(x, y)
+#define REALLOC(x, y) realloc(x, y)
+
+/** \brief Functions to account the allocations of the current thread (nothing without accounting) */
+#define MEM_OWNER_PUSH(x)
+#define MEM_OWNER_POP()
 
 /** \brief Function to release a space if the space is valid */
 #define FREE(x) \
@@ -165,6 +217,7 @@
         x = NULL; \
     } \
 }
+#endif /* !__ENABLE_MEM_ACCOUNTING */
 
 /** \brief Functions to change the byte orders of 64-bit values */
 /* @{ */
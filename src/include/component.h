@@ -58,6 +58,43 @@ enum {
     COMPNT_EXECUTE = 1
 };
 
+/** \brief The policy for a request to an external component that misses its deadline */
+enum {
+    COMPNT_FAIL_OPEN, /**< Go on with the next component */
+    COMPNT_FAIL_CLOSED, /**< Stop the event chain */
+};
+
+/** \brief The scheduling class of an event */
+enum {
+    EV_CLASS_CONTROL, /**< Switch connections, datapath changes, and downstream requests */
+    EV_CLASS_PKTIN, /**< Packet-In messages */
+    EV_CLASS_STATS, /**< Flow, port, resource, and traffic statistics */
+    EV_CLASS_LOG, /**< Log messages */
+    EV_CLASS_MGMT, /**< Topology, host, and flow table changes */
+    EV_NUM_CLASSES,
+};
+
+/** \brief The delivery mode of an event class */
+enum {
+    EV_SCHED_SYNC, /**< Delivered in the raising thread */
+    EV_SCHED_ASYNC, /**< Queued and delivered by scheduler workers */
+};
+
+/** \brief The policy for an event whose class queue is full */
+enum {
+    EV_SCHED_RUN, /**< Deliver it in the raising thread */
+    EV_SCHED_DROP, /**< Drop it */
+};
+
+/** \brief The structure of the scheduling configuration of an event class */
+typedef struct _ev_class_conf_t {
+    int mode; /**< EV_SCHED_SYNC or EV_SCHED_ASYNC */
+    int weight; /**< The share of the shared workers */
+    int workers; /**< The number of dedicated workers (0: the shared workers) */
+    int queue; /**< The maximum number of queued events */
+    int on_full; /**< The policy for an event whose queue is full */
+} ev_class_conf_t;
+
 /** \brief The structure of a component */
 struct _compnt_t {
     int id; /**< Internal ID */
@@ -75,7 +112,9 @@ struct _compnt_t {
     int perm; /**< Permission */
     int status; /**< Status */
     int priority; /**< Priority */
+    char cpus[__CONF_WORD_LEN]; /**< The CPUs to run on (e.g., "0-3,8", empty: anywhere) */
     int activated; /**< Activation */
+    pid_t tid; /**< The thread ID of an autonomous component */
 
     void *push_ctx; /**< Push context */
     char push_addr[__CONF_WORD_LEN]; /**< Push address */
@@ -83,6 +122,21 @@ struct _compnt_t {
     void *req_ctx; /**< Request context */
     char req_addr[__CONF_WORD_LEN]; /**< Request address */
 
+    struct _shm_link_t *shm; /**< Shared-memory rings (NULL: ZeroMQ only) */
+
+    int timeout; /**< The deadline of a request (ms) */
+    int on_timeout; /**< The policy for a request that misses its deadline */
+    int credits; /**< The maximum number of requests in flight */
+    int in_flight; /**< The number of requests in flight (under ev_credit_lock) */
+
+    uint64_t num_timeouts; /**< The number of requests that missed their deadlines */
+    uint64_t num_throttled; /**< The number of requests refused for lack of credits */
+    time_t missed_warned; /**< The last time when a skipped request was reported */
+
+    int batch_max; /**< The number of events to send in a batch (0: no batching) */
+    int batch_usec; /**< The time to hold a batch before sending it (us) */
+    struct _msg_batch_t *batch; /**< Events waiting to be sent (created on the first event) */
+
     compnt_main_f main; /**< The main function pointer */
     compnt_handler_f handler; /**< The handler function pointer */
     compnt_cleanup_f cleanup; /**< The cleanup function pointer */
@@ -96,11 +150,28 @@ struct _compnt_t {
     int out_list[__MAX_EVENTS]; /**< Outbound events */
 
     int num_policies; /**< The number of policies */
-    odp_t odp[__MAX_POLICIES]; /**< The list of operator-defined policies */
+    odp_t *odp; /**< The list of operator-defined policies (__MAX_POLICIES, replaced as a whole) */
 
     uint64_t num_events[__MAX_EVENTS]; /**< The number of triggered times */
 };
 
+/** \brief The structure of the component configuration seen by the event handler (immutable once published) */
+struct _compnt_conf_t {
+    uint64_t version; /**< The version of the configuration */
+
+    int num_compnts; /**< The number of components */
+    compnt_t **compnt_list; /**< Component list */
+
+    int *ev_num; /**< The number of components for each event */
+    compnt_t ***ev_list; /**< Component chains for each event */
+
+    uint8_t out_ok[__MAX_EVENTS]; /**< The flags whether any component raises each event */
+
+    ev_class_conf_t ev_class[EV_NUM_CLASSES]; /**< The scheduling configuration of each event class */
+
+    int refs; /**< The number of detached event chains still walking this configuration */
+};
+
 // function for the base framework
 int component_load(cli_t *, ctx_t *);
 int component_start(cli_t *);
@@ -120,3 +191,6 @@ int component_show_policy(cli_t *, char *);
 int component_show(cli_t *, char *);
 int component_list(cli_t *);
 int component_cli(cli_t *, char **);
+
+// functions for components
+const char *component_thread_owner(pid_t);
@@ -30,6 +30,8 @@ struct _ctx_t {
     int *ev_num; /**< The number of events */
     compnt_t ***ev_list; /**< Component chains for each event */
 
+    compnt_conf_t *compnt_conf; /**< The configuration published to the event handler (the fields above: CLI only) */
+
     int num_events[__MAX_EVENTS]; /**< Counters for each event */
     meta_event_t meta_event[__MAX_META_EVENTS]; /**< Meta events */
 
@@ -46,6 +48,8 @@ struct _ctx_t {
     int *av_num; /**< The number of app events */
     app_t ***av_list; /**< Application chains for each app event */
 
+    app_conf_t *app_conf; /**< The configuration published to the app event handler (the fields above: CLI only) */
+
     int num_app_events[__MAX_APP_EVENTS]; /**< Counters for each app event */
     meta_event_t meta_app_event[__MAX_META_EVENTS]; /**< Meta app events */
 };
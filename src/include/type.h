@@ -17,6 +17,9 @@ typedef struct _ctx_t ctx_t;
 /** \brief The structure of a component */
 typedef struct _compnt_t compnt_t;
 
+/** \brief The structure of a published component configuration */
+typedef struct _compnt_conf_t compnt_conf_t;
+
 /** \brief The structure of component function pointers */
 typedef struct _compnt_func_t compnt_func_t;
 
@@ -29,6 +32,9 @@ typedef struct _event_out_t event_out_t;
 /** \brief The structure of an application */
 typedef struct _app_t app_t;
 
+/** \brief The structure of a published application configuration */
+typedef struct _app_conf_t app_conf_t;
+
 /** \brief The structure of application function pointers */
 typedef struct _app_func_t app_func_t;
 
@@ -189,6 +195,60 @@ typedef struct _port_t {
     port_stat_t stat; /**< Port statstics */
 } port_t;
 
+/** \brief The structure of the port statistics of a switch (all entries of a stats reply) */
+typedef struct _ports_t {
+    uint64_t dpid; /**< Datapath ID */
+    uint32_t remote; /**< Remote events */
+    uint32_t num_ports; /**< The number of ports */
+    port_t *port; /**< Ports */
+} ports_t;
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The maximum number of equal-cost next hops in a route */
+#define __MAX_ROUTE_PORTS 8
+
+/** \brief The maximum number of hops in a route */
+#define __MAX_ROUTE_HOPS 32
+
+/** \brief The distance of an unreachable switch */
+#define ROUTE_UNREACHABLE 0xffff
+
+/** \brief The structure of a hop in a route */
+typedef struct _route_hop_t {
+    uint64_t dpid; /**< Datapath ID */
+    uint32_t port; /**< Output port */
+} route_hop_t;
+
+/** \brief The structure of a route between two switches */
+typedef struct _route_t {
+    // request
+    uint64_t src; /**< Source datapath ID */
+    uint64_t dst; /**< Destination datapath ID */
+    uint32_t hash; /**< Flow hash to pick one of the equal-cost paths */
+
+    // response
+    uint16_t dist; /**< The number of hops (ROUTE_UNREACHABLE: no path) */
+
+    uint16_t num_ports; /**< The number of equal-cost next hops at the source */
+    uint32_t port[__MAX_ROUTE_PORTS]; /**< The output ports of the equal-cost next hops */
+
+    uint16_t num_hops; /**< The number of hops in the picked path */
+    route_hop_t hop[__MAX_ROUTE_HOPS]; /**< The picked path (the last hop is the one before dst) */
+} route_t;
+
+/** \brief The structure of the broadcast tree ports of a switch */
+typedef struct _tree_t {
+    // request
+    uint64_t dpid; /**< Datapath ID */
+    uint32_t in_port; /**< Input port (excluded from the ports to flood) */
+
+    // response
+    uint64_t root; /**< The root of the broadcast tree (0: unknown switch) */
+    uint16_t num_ports; /**< The number of ports to flood */
+    uint32_t port[__MAX_NUM_PORTS]; /**< Ports to flood (edge ports and tree ports) */
+} tree_t;
+
 /////////////////////////////////////////////////////////////////////
 
 /** \brief The structure of a host */
@@ -491,6 +551,39 @@ typedef struct _flow_t {
     };
 } flow_t;
 
+/** \brief The structure of the flows of a switch (all entries of a stats reply or a bulk flow install) */
+typedef struct _flows_t {
+    uint64_t dpid; /**< Datapath ID */
+    uint32_t remote; /**< Remote events */
+    uint32_t batch_id; /**< Batch ID given by the requester (bulk flow install) */
+    uint32_t num_flows; /**< The number of flows */
+    flow_t *flow; /**< Flows */
+} flows_t;
+
+/** \brief The results of a bulk flow install */
+enum batch_status {
+    BATCH_DONE,     /**< All flows are confirmed by barriers (some of them may be rejected) */
+    BATCH_REJECTED, /**< Not accepted (unknown switch or too many queued flows) */
+    BATCH_ABORTED,  /**< The switch is disconnected before confirming all flows */
+    BATCH_BLOCKED,  /**< Blocked by a security component (first_error: the index of the blocked flow) */
+    BATCH_FAILED,   /**< Not sent because of a local error (e.g., out of memory) */
+};
+
+/** \brief The structure of the result of a bulk flow install */
+typedef struct _flow_batch_t {
+    uint64_t dpid; /**< Datapath ID */
+    uint32_t remote; /**< Remote events */
+    uint32_t batch_id; /**< Batch ID given by the requester */
+
+    uint32_t num_flows; /**< The number of flows in the batch */
+    uint32_t num_errors; /**< The number of flows rejected by the switch */
+    uint32_t first_error; /**< The index of the first rejected flow */
+    uint16_t err_type; /**< The error type of the first rejected flow */
+    uint16_t err_code; /**< The error code of the first rejected flow */
+
+    uint8_t status; /**< Batch status */
+} flow_batch_t;
+
 /////////////////////////////////////////////////////////////////////
 
 /** \brief The structure of traffic usage */
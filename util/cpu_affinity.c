@@ -0,0 +1,231 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \ingroup util
+ * @{
+ *
+ * \defgroup cpu_affinity CPU Affinity
+ * \brief Functions to place threads on CPUs and memory on the NUMA nodes of those CPUs
+ * @{
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#include "cpu_affinity.h"
+
+#include <dirent.h>
+#include <linux/mempolicy.h>
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The CPUs configured for the calling thread (used to place its memory) */
+static __thread cpu_set_t cpu_placement;
+
+/** \brief The flag whether cpu_placement is set */
+static __thread int cpu_placement_set;
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to parse a CPU list (e.g., "0-3,8,10-11")
+ * \param cpus CPU list
+ * \param set CPU set (output)
+ * \return The number of CPUs in the list, -1 if the list is malformed
+ */
+int cpu_parse(const char *cpus, cpu_set_t *set)
+{
+    CPU_ZERO(set);
+
+    const char *p = cpus;
+    while (*p != '\0') {
+        char *end;
+
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) return -1;
+
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first || last >= CPU_SETSIZE) return -1;
+        }
+
+        long cpu;
+        for (cpu=first; cpu<=last; cpu++)
+            CPU_SET(cpu, set);
+
+        if (*end == ',') p = end + 1;
+        else if (*end == '\0') p = end;
+        else return -1;
+    }
+
+    return CPU_COUNT(set);
+}
+
+/**
+ * \brief Function to set the CPUs whose NUMA node takes the tables placed by the calling thread
+ * \param cpus CPU list (NULL or empty: the CPU that the calling thread runs on)
+ */
+int cpu_set_placement(const char *cpus)
+{
+    cpu_placement_set = FALSE;
+
+    if (cpus == NULL || cpus[0] == '\0')
+        return 0;
+
+    if (cpu_parse(cpus, &cpu_placement) <= 0)
+        return -1;
+
+    cpu_placement_set = TRUE;
+
+    return 0;
+}
+
+/**
+ * \brief Function to name the calling thread and pin it to CPUs
+ * \param name Thread name (NULL: keep the current name)
+ * \param cpus CPU list (NULL or empty: no pinning)
+ */
+int cpu_bind_thread(const char *name, const char *cpus)
+{
+    if (name != NULL) {
+        char tname[__THREAD_NAME_LEN] = {0};
+        strncpy(tname, name, __THREAD_NAME_LEN - 1);
+        pthread_setname_np(pthread_self(), tname);
+    }
+
+    if (cpus == NULL || cpus[0] == '\0') {
+        cpu_set_placement(NULL);
+        return 0;
+    } else if (cpu_set_placement(cpus)) {
+        return -1;
+    }
+
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_placement);
+    if (ret) {
+        errno = ret;
+        PERROR("pthread_setaffinity_np");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * \brief Function to name a thread and pin it to one of the CPUs of the calling thread
+ * \param thread Thread
+ * \param name Thread name
+ * \param nth The index of a CPU among the CPUs of the calling thread (wraps around)
+ */
+int cpu_pin_nth(pthread_t thread, const char *name, int nth)
+{
+    char tname[__THREAD_NAME_LEN] = {0};
+    strncpy(tname, name, __THREAD_NAME_LEN - 1);
+    pthread_setname_np(thread, tname);
+
+    cpu_set_t set;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &set))
+        return -1;
+
+    int num_cpus = CPU_COUNT(&set);
+    if (num_cpus == 0) return -1;
+
+    nth %= num_cpus;
+
+    int cpu;
+    for (cpu=0; cpu<CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &set)) continue;
+        if (nth-- > 0) continue;
+
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+
+        return pthread_setaffinity_np(thread, sizeof(cpu_set_t), &one) ? -1 : 0;
+    }
+
+    return -1;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to get the NUMA node of a CPU
+ * \param cpu CPU
+ * \return NUMA node, -1 if unknown
+ */
+static int cpu_to_node(int cpu)
+{
+    char path[__CONF_WORD_LEN];
+    sprintf(path, "/sys/devices/system/cpu/cpu%d", cpu);
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) return -1;
+
+    int node = -1;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, "node", 4) == 0 && isdigit(ent->d_name[4])) {
+            node = atoi(ent->d_name + 4);
+            break;
+        }
+    }
+
+    closedir(dir);
+
+    return node;
+}
+
+/**
+ * \brief Function to move a table to the NUMA node of the CPUs configured for the calling thread
+ * \param ptr Table
+ * \param size The size of the table
+ * \return 0 if the table is placed (or there is nothing to do), -1 otherwise
+ */
+int cpu_place_memory(void *ptr, size_t size)
+{
+    if (ptr == NULL) return -1;
+
+    // only the pages entirely within the table are moved
+    long page = sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)ptr + page - 1) & ~(page - 1);
+    uintptr_t end = ((uintptr_t)ptr + size) & ~(page - 1);
+
+    if (end <= start) return 0;
+
+    int cpu = -1;
+    if (cpu_placement_set) {
+        for (cpu=0; cpu<CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &cpu_placement)) break;
+        }
+    } else {
+        cpu = sched_getcpu();
+    }
+
+    int node = (cpu >= 0 && cpu < CPU_SETSIZE) ? cpu_to_node(cpu) : -1;
+    if (node < 0 || node >= 8 * (int)sizeof(unsigned long)) return 0; // no NUMA information
+
+    unsigned long mask = 1UL << node;
+
+    // the kernel takes the number of bits plus one
+    if (syscall(SYS_mbind, start, end - start, MPOL_PREFERRED, &mask, 8 * sizeof(unsigned long) + 1, MPOL_MF_MOVE) < 0) {
+        if (errno == ENOSYS) return 0; // a kernel without NUMA support
+
+        PERROR("mbind");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @}
+ *
+ * @}
+ */
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \ingroup util
+ * @{
+ *
+ * \defgroup crc32c CRC32C Function
+ * \brief Function to get a CRC32C (Castagnoli) checksum using SSE4.2 if available
+ * @{
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#include "crc32c.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#endif
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The reflected polynomial of CRC32C */
+#define CRC32C_POLY 0x82f63b78
+
+/** \brief The lookup table for the software CRC32C */
+static uint32_t crc32c_table[256];
+
+/** \brief The function pointer of the selected implementation */
+static uint32_t (*crc32c_impl)(uint32_t crc, const uint8_t *data, size_t length);
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to compute CRC32C in software (byte-wise table lookup)
+ * \param crc Initial value
+ * \param data Data
+ * \param length Data length
+ * \return Updated value
+ */
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t *data, size_t length)
+{
+    while (length--)
+        crc = crc32c_table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+
+    return crc;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * \brief Function to compute CRC32C using the SSE4.2 crc32 instruction
+ * \param crc Initial value
+ * \param data Data
+ * \param length Data length
+ * \return Updated value
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t *data, size_t length)
+{
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+
+    while (length >= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(uint64_t));
+
+        crc64 = _mm_crc32_u64(crc64, word);
+
+        data += sizeof(uint64_t);
+        length -= sizeof(uint64_t);
+    }
+
+    crc = (uint32_t)crc64;
+#endif
+
+    while (length >= sizeof(uint32_t)) {
+        uint32_t word;
+        memcpy(&word, data, sizeof(uint32_t));
+
+        crc = _mm_crc32_u32(crc, word);
+
+        data += sizeof(uint32_t);
+        length -= sizeof(uint32_t);
+    }
+
+    while (length--)
+        crc = _mm_crc32_u8(crc, *data++);
+
+    return crc;
+}
+#endif
+
+/**
+ * \brief Function to select the implementation based on CPUID
+ */
+static void crc32c_init(void)
+{
+    int i, j;
+    for (i=0; i<256; i++) {
+        uint32_t crc = i;
+        for (j=0; j<8; j++)
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : (crc >> 1);
+        crc32c_table[i] = crc;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        __atomic_store_n(&crc32c_impl, crc32c_hw, __ATOMIC_RELEASE);
+        return;
+    }
+#endif
+
+    // the table is filled before the selection is published
+    __atomic_store_n(&crc32c_impl, crc32c_sw, __ATOMIC_RELEASE);
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to generate a CRC32C checksum
+ * \param data Data to generate a checksum
+ * \param length Data length (bytes)
+ * \return Generated checksum
+ */
+uint32_t crc32c_func(const void *data, size_t length)
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+    uint32_t (*impl)(uint32_t, const uint8_t *, size_t) = __atomic_load_n(&crc32c_impl, __ATOMIC_ACQUIRE);
+    if (impl == NULL) {
+        pthread_once(&once, crc32c_init);
+        impl = __atomic_load_n(&crc32c_impl, __ATOMIC_ACQUIRE);
+    }
+
+    return ~impl(~0U, (const uint8_t *)data, length);
+}
+
+/**
+ * \brief Function to check whether the hardware CRC32C is used
+ * \return TRUE or FALSE
+ */
+int crc32c_hw_enabled(void)
+{
+    crc32c_func(NULL, 0);
+
+#if defined(__x86_64__) || defined(__i386__)
+    return (__atomic_load_n(&crc32c_impl, __ATOMIC_ACQUIRE) == crc32c_hw);
+#else
+    return FALSE;
+#endif
+}
+
+/**
+ * @}
+ *
+ * @}
+ */
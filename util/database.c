@@ -147,6 +147,48 @@ int insert_data(db_info_t *info, char *table, char *columns, char *values)
     return 0;
 }
 
+/**
+ * \brief Function to insert multiple rows in a table through an open connector
+ * \param db Database connector
+ * \param table Table
+ * \param columns Columns (A, B)
+ * \param values The list of values (A, B)
+ * \param num The number of rows
+ */
+int insert_multi_data(database_t *db, char *table, char *columns, char **values, int num)
+{
+    if (num <= 0) return 0;
+
+    size_t len = __CONF_STR_LEN;
+
+    int i;
+    for (i=0; i<num; i++) {
+        len += strlen(values[i]) + strlen(hostname) + 8;
+    }
+
+    char *query = (char *)MALLOC(len);
+    if (query == NULL) {
+        PERROR("malloc");
+        return -1;
+    }
+
+    int n = sprintf(query, "insert into %s (%s, INSTANCE) values ", table, columns);
+    for (i=0; i<num; i++) {
+        n += sprintf(query + n, "%s(%s, '%s')", (i) ? ", " : "", values[i], hostname);
+    }
+
+    if (mysql_query(db, query) != 0) {
+        PERROR("mysql_query");
+        PRINTF("Error %u (%s): %s\n", mysql_errno(db), mysql_sqlstate(db), mysql_error(db));
+        FREE(query);
+        return -1;
+    }
+
+    FREE(query);
+
+    return 0;
+}
+
 /**
  * \brief Function to update data in a table
  * \param info Database information
@@ -287,6 +329,19 @@ int destroy_database(database_t *db)
     return 0;
 }
 
+/**
+ * \brief Function to escape a string for a query
+ * \param db Database connector
+ * \param to Escaped string (at least 2 * length + 1 bytes)
+ * \param from Original string
+ * \param length The length of the original string
+ * \return The length of the escaped string
+ */
+int escape_string(database_t *db, char *to, const char *from, int length)
+{
+    return mysql_real_escape_string(db, to, from, length);
+}
+
 /**
  * \brief Function to execute a query
  * \param db Database connector
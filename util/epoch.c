@@ -0,0 +1,159 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \ingroup util
+ * @{
+ *
+ * \defgroup epoch Epoch-based Reclamation
+ * \brief Functions to free shared structures only after no reader can see them
+ * @{
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#include "epoch.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The global epoch (advanced by every synchronization) */
+static volatile uint64_t epoch_global = 1;
+
+/** \brief Reader slots */
+static epoch_slot_t epoch_slots[__EPOCH_MAX_THREADS];
+
+/** \brief The number of readers without their own slots (out of slots) */
+static volatile int epoch_overflow;
+
+/** \brief The key to release the slot of an exiting thread */
+static pthread_key_t epoch_key;
+
+/** \brief The flag to create the key only once */
+static pthread_once_t epoch_once = PTHREAD_ONCE_INIT;
+
+/** \brief The slot of this thread (NULL: not assigned yet) */
+static __thread epoch_slot_t *epoch_self;
+
+/** \brief The flag of a thread that could not get a slot */
+static __thread int epoch_no_slot;
+
+/** \brief The nesting level of read sections in this thread */
+static __thread int epoch_depth;
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to release the slot of an exiting thread
+ * \param slot Reader slot
+ */
+static void epoch_release(void *slot)
+{
+    epoch_slot_t *s = (epoch_slot_t *)slot;
+
+    __atomic_store_n(&s->epoch, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&s->used, FALSE, __ATOMIC_RELEASE);
+}
+
+/**
+ * \brief Function to create the key to release slots
+ */
+static void epoch_init_key(void)
+{
+    pthread_key_create(&epoch_key, epoch_release);
+}
+
+/**
+ * \brief Function to assign a reader slot to this thread
+ * \return Reader slot (NULL: out of slots)
+ */
+static epoch_slot_t *epoch_assign(void)
+{
+    pthread_once(&epoch_once, epoch_init_key);
+
+    int i;
+    for (i=0; i<__EPOCH_MAX_THREADS; i++) {
+        epoch_slot_t *s = &epoch_slots[i];
+
+        if (s->used == FALSE && __sync_bool_compare_and_swap(&s->used, FALSE, TRUE)) {
+            pthread_setspecific(epoch_key, s);
+            return s;
+        }
+    }
+
+    return NULL;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to enter a read section (nested sections are allowed)
+ */
+void epoch_enter(void)
+{
+    if (epoch_depth++ > 0) return;
+
+    if (epoch_self == NULL && epoch_no_slot == FALSE) {
+        epoch_self = epoch_assign();
+        if (epoch_self == NULL) epoch_no_slot = TRUE;
+    }
+
+    if (epoch_self) {
+        __atomic_store_n(&epoch_self->epoch, __atomic_load_n(&epoch_global, __ATOMIC_ACQUIRE), __ATOMIC_SEQ_CST);
+    } else {
+        __atomic_add_fetch(&epoch_overflow, 1, __ATOMIC_SEQ_CST);
+    }
+
+    // the pointers loaded from now on cannot be older than the announced epoch
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * \brief Function to leave a read section
+ */
+void epoch_exit(void)
+{
+    if (--epoch_depth > 0) return;
+
+    if (epoch_self) {
+        __atomic_store_n(&epoch_self->epoch, 0, __ATOMIC_RELEASE);
+    } else {
+        __atomic_sub_fetch(&epoch_overflow, 1, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * \brief Function to wait until every read section that could see the replaced pointers is over
+ * The caller publishes new pointers first, then calls this, and then frees the old ones.
+ * It must not be called in a read section.
+ */
+void epoch_synchronize(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    uint64_t target = __atomic_add_fetch(&epoch_global, 1, __ATOMIC_SEQ_CST);
+
+    int i;
+    for (i=0; i<__EPOCH_MAX_THREADS; i++) {
+        epoch_slot_t *s = &epoch_slots[i];
+
+        while (1) {
+            uint64_t e = __atomic_load_n(&s->epoch, __ATOMIC_ACQUIRE);
+            if (e == 0 || e >= target) break;
+
+            waitsec(0, 100 * 1000);
+        }
+    }
+
+    while (__atomic_load_n(&epoch_overflow, __ATOMIC_ACQUIRE) > 0)
+        waitsec(0, 100 * 1000);
+}
+
+/**
+ * @}
+ *
+ * @}
+ */
@@ -0,0 +1,29 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#pragma once
+
+#include "common.h"
+
+#include <sched.h>
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The maximum length of a thread name (including the null character) */
+#define __THREAD_NAME_LEN 16
+
+/////////////////////////////////////////////////////////////////////
+
+int cpu_parse(const char *cpus, cpu_set_t *set);
+
+int cpu_set_placement(const char *cpus);
+int cpu_bind_thread(const char *name, const char *cpus);
+int cpu_pin_nth(pthread_t thread, const char *name, int nth);
+
+int cpu_place_memory(void *ptr, size_t size);
@@ -0,0 +1,15 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#pragma once
+
+#include "common.h"
+
+uint32_t crc32c_func(const void *data, size_t length);
+int crc32c_hw_enabled(void);
@@ -27,12 +27,14 @@ int get_database_info(db_info_t *info, char *database);
 
 int reset_table(db_info_t *info, char *table, int all);
 int insert_data(db_info_t *info, char *table, char *columns, char *values);
+int insert_multi_data(database_t *db, char *table, char *columns, char **values, int num);
 int update_data(db_info_t *info, char *table, char *changes, char *conditions);
 int delete_data(db_info_t *info, char *table, char *conditions);
 int select_data(db_info_t *info, database_t *db, char *table, char *columns, char *conditions, int all);
 
 int init_database(db_info_t *info, database_t *db);
 int destroy_database(database_t *db);
+int escape_string(database_t *db, char *to, const char *from, int length);
 int execute_query(database_t *db, char *query);
 query_result_t *get_query_result(database_t *db);
 query_row_t fetch_query_row(query_result_t *result);
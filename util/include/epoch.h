@@ -0,0 +1,33 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#pragma once
+
+#include "common.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The maximum number of threads with their own reader slots */
+#define __EPOCH_MAX_THREADS 256
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The structure of the reader slot of a thread (on its own cache line) */
+typedef struct _epoch_slot_t {
+    volatile uint64_t epoch; /**< The epoch when the thread entered (0: outside read sections) */
+    volatile int used; /**< The flag whether a thread owns this slot */
+    uint8_t pad[52];
+} epoch_slot_t;
+
+/////////////////////////////////////////////////////////////////////
+
+void epoch_enter(void);
+void epoch_exit(void);
+
+void epoch_synchronize(void);
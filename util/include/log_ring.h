@@ -0,0 +1,69 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#pragma once
+
+#include "common.h"
+
+#include <semaphore.h>
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The number of records in a per-thread log ring (power of 2) */
+#define __LOG_RING_SIZE 512
+
+/** \brief The size of the argument area in a log record */
+#define __LOG_ARG_LEN (__CONF_STR_LEN - 32)
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The structure of a log record (arguments are kept in binary) */
+typedef struct _log_rec_t {
+    uint32_t id; /**< Component or application ID */
+    uint16_t type; /**< Log level (event type) */
+    uint16_t nargs; /**< The number of encoded arguments */
+    uint16_t len; /**< The used bytes in args */
+    uint16_t trunc; /**< The flag of truncated arguments */
+
+    struct timespec time; /**< The time when the record was pushed */
+
+    const char *format; /**< Format string (NULL if args hold plain text) */
+    char args[__LOG_ARG_LEN]; /**< Encoded arguments */
+} log_rec_t;
+
+/** \brief The structure of a per-thread log ring (single producer, single consumer) */
+typedef struct _log_ring_t {
+    volatile uint32_t head; /**< Written by the owner thread */
+    volatile uint32_t tail; /**< Written by the log writer */
+
+    volatile uint64_t pushed; /**< The number of pushed records */
+    volatile uint64_t dropped; /**< The number of records dropped due to a full ring */
+
+    volatile int owned; /**< The flag whether a live thread owns this ring */
+
+    struct _log_ring_t *next; /**< The next ring in the global list */
+
+    log_rec_t rec[__LOG_RING_SIZE]; /**< Records */
+} log_ring_t;
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The flag to push log messages into the log rings */
+extern int log_ring_enabled;
+
+/////////////////////////////////////////////////////////////////////
+
+int log_ring_push(uint32_t id, uint16_t type, int urgent, const char *format, va_list ap);
+int log_ring_push_text(uint32_t id, uint16_t type, int urgent, const char *text);
+
+int log_ring_drain(int (*func)(const log_rec_t *rec));
+int log_ring_wait(int msec);
+int log_ring_format(const log_rec_t *rec, char *out, int size);
+
+int log_ring_stats(int *num_rings, uint64_t *pushed, uint64_t *dropped);
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The maximum number of owners tracked (components, applications, and core modules) */
+#define __MEM_ACCT_MAX_SITES 128
+
+/** \brief The maximum length of the name of an owner */
+#define __MEM_ACCT_NAME_LEN 32
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The structure of the memory usage of an owner (a component, an application, or a core module) */
+typedef struct _mem_site_t {
+    char name[__MEM_ACCT_NAME_LEN]; /**< The name of a component or an application, or the base name of a core source file */
+
+    volatile int64_t live; /**< Live bytes */
+    volatile int64_t peak; /**< The high-water mark of live bytes */
+
+    volatile uint64_t num_allocs; /**< The number of allocations */
+    volatile uint64_t num_frees; /**< The number of releases */
+
+    uint64_t last_allocs; /**< The number of allocations at the last report */
+    struct timespec last_time; /**< The time of the last report */
+} mem_site_t;
+
+/////////////////////////////////////////////////////////////////////
+
+void *mem_alloc(size_t size, size_t num, int zero, const char *file);
+void *mem_realloc(void *ptr, size_t size, const char *file);
+void mem_free(void *ptr);
+
+const char *mem_acct_owner(const char *name);
+
+int mem_acct_num_sites(void);
+mem_site_t *mem_acct_site(int idx);
+mem_site_t *mem_acct_find(const char *name);
+double mem_acct_rate(mem_site_t *site);
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#pragma once
+
+#include "common.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The maximum number of events in a batch */
+#define __MSG_BATCH_MAX 256
+
+/** \brief The size of the buffer of a batch */
+#define __MSG_BATCH_SIZE (64 * 1024)
+
+/** \brief The default time to hold a batch before sending it (us) */
+#define __MSG_BATCH_USEC 1000
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The structure of events to be sent as one multipart message (a frame per event) */
+typedef struct _msg_batch_t {
+    pthread_mutex_t lock; /**< The lock for the producers */
+
+    int max; /**< The number of events to send a batch */
+    int usec; /**< The time to send a batch after its first event (us) */
+
+    int num; /**< The number of events in the batch */
+    int len; /**< The used bytes in the buffer */
+    struct timespec first; /**< The time when the first event was added */
+
+    uint32_t size[__MSG_BATCH_MAX]; /**< The sizes of events */
+    char data[__MSG_BATCH_SIZE]; /**< Events */
+} msg_batch_t;
+
+/////////////////////////////////////////////////////////////////////
+
+msg_batch_t *msg_batch_create(int max, int usec);
+int msg_batch_destroy(msg_batch_t *batch);
+
+int msg_batch_add(msg_batch_t *batch, void *ctx, const char *addr, const char *msg, int len);
+int msg_batch_flush(msg_batch_t *batch, void *ctx, const char *addr, int force);
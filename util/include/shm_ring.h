@@ -0,0 +1,116 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#pragma once
+
+#include "common.h"
+
+#include <sys/mman.h>
+#include <linux/futex.h>
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The magic string of a shared-memory ring */
+#define SHM_RING_MAGIC "BRING01"
+
+/** \brief The prefix of the ring files shared with external components and applications */
+#define __SHM_RING_PATH "/dev/shm/barista"
+
+/** \brief The default size of the data area of a ring (power of 2) */
+#define __SHM_RING_SIZE (1 << 20)
+
+/** \brief The time to wait for space in a full ring before dropping an event (ms) */
+#define __SHM_RING_FULL_WAIT 100
+
+/** \brief The default time to wait for the reply of a request (ms) */
+#define __SHM_RING_CALL_TIMEOUT 5000
+
+/** \brief The flag of a record that only fills the end of the data area */
+#define SHM_REC_PAD 0x1
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The header of a ring (the producer and the consumer on their own cache lines) */
+typedef struct _shm_ring_hdr_t {
+    char magic[8]; /**< SHM_RING_MAGIC */
+    uint32_t size; /**< The size of the data area */
+    uint32_t reserved;
+    uint8_t pad0[48];
+
+    volatile uint64_t head; /**< The number of bytes written by the producer */
+    uint8_t pad1[56];
+
+    volatile uint64_t tail; /**< The number of bytes read by the consumer */
+    volatile int32_t waiting; /**< The flag whether the consumer sleeps */
+    volatile int32_t wakeup; /**< The futex word to wake the consumer up */
+    uint8_t pad2[48];
+} shm_ring_hdr_t;
+
+/** \brief The structure of a record (followed by its data, 8-byte aligned) */
+typedef struct _shm_rec_t {
+    uint32_t len; /**< The length of the data */
+    uint32_t id; /**< Component or application ID */
+    uint16_t type; /**< Event type */
+    uint16_t flags; /**< SHM_REC_PAD */
+    int32_t ret; /**< Return value (replies) */
+    uint64_t seq; /**< Request sequence number (0: notification) */
+    uint8_t data[0]; /**< Data */
+} shm_rec_t;
+
+/** \brief The structure of a mapped ring */
+typedef struct _shm_ring_t {
+    int fd; /**< The file descriptor of the ring file */
+    size_t size; /**< The size of the mapping */
+    uint32_t data_size; /**< The size of the data area (checked when mapped, never read again from the peer) */
+    uint32_t mask; /**< data_size - 1 */
+    shm_ring_hdr_t *hdr; /**< The mapped header */
+    uint8_t *data; /**< The mapped data area */
+    pthread_mutex_t lock; /**< The lock for the producers in this process */
+    int stalled; /**< The flag set when the consumer stopped taking records */
+    char path[__CONF_WORD_LEN]; /**< The path of the ring file */
+} shm_ring_t;
+
+/** \brief The structure of a request-reply channel */
+typedef struct _shm_chan_t {
+    shm_ring_t req; /**< Requests */
+    shm_ring_t rep; /**< Replies */
+    pthread_mutex_t lock; /**< The lock for a request in flight */
+    uint64_t seq; /**< The sequence number of the last request */
+} shm_chan_t;
+
+/** \brief The structure of the rings between the Barista NOS and an external component or application */
+typedef struct _shm_link_t {
+    shm_ring_t down; /**< Notifications from the Barista NOS */
+    shm_chan_t down_call; /**< Requests from the Barista NOS */
+    shm_ring_t up; /**< Notifications to the Barista NOS */
+    shm_chan_t up_call; /**< Requests to the Barista NOS */
+
+    volatile int active; /**< The flag to keep the consumers running */
+    pthread_t thread[2]; /**< The consumers on this side */
+    int num_threads; /**< The number of the consumers */
+
+    struct _shm_link_t *next; /**< The next link retired by a reconnection */
+} shm_link_t;
+
+/////////////////////////////////////////////////////////////////////
+
+int shm_ring_create(shm_ring_t *ring, const char *path, uint32_t size);
+int shm_ring_open(shm_ring_t *ring, const char *path);
+int shm_ring_close(shm_ring_t *ring, int unlink_file);
+
+int shm_ring_push(shm_ring_t *ring, uint32_t id, uint16_t type, int ret, uint64_t seq, const void *data, uint32_t len);
+int shm_ring_pop(shm_ring_t *ring, shm_rec_t *rec, void *data, uint32_t max, int timeout);
+
+int shm_chan_call(shm_chan_t *chan, uint32_t id, uint16_t type, const void *input, uint32_t len,
+                  shm_rec_t *rec, void *output, uint32_t max, int timeout);
+int shm_chan_reply(shm_chan_t *chan, const shm_rec_t *req, int ret, const void *output, uint32_t len);
+
+int shm_link_create(shm_link_t *link, const char *prefix, uint32_t size);
+int shm_link_open(shm_link_t *link, const char *prefix);
+int shm_link_close(shm_link_t *link, int unlink_file);
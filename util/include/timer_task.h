@@ -0,0 +1,52 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#pragma once
+
+#include "common.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The number of workers that run periodic tasks */
+#define __TIMER_WORKERS 2
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The function pointer of a periodic task (return: ms until the next run, 0: the period, -1: stop) */
+typedef int (* timer_task_f)(void *arg);
+
+/** \brief The state of a periodic task */
+enum {
+    TIMER_QUEUED, /**< Waiting for its next run */
+    TIMER_RUNNING, /**< Running in a worker */
+    TIMER_STOPPED, /**< Stopped by itself (waiting to be cancelled) */
+    TIMER_CANCELLED, /**< Cancelled while running */
+};
+
+/** \brief The structure of a periodic task */
+typedef struct _timer_task_t {
+    char name[__CONF_WORD_LEN]; /**< Task name */
+
+    timer_task_f func; /**< The function to run */
+    void *arg; /**< The argument of the function */
+
+    int period; /**< The time between the end of a run and the next one (ms) */
+    uint64_t due; /**< The time of the next run (ms, monotonic) */
+
+    int state; /**< TIMER_QUEUED, TIMER_RUNNING, TIMER_STOPPED, or TIMER_CANCELLED */
+
+    struct _timer_task_t *next; /**< The next task in the order of due times */
+} timer_task_t;
+
+/////////////////////////////////////////////////////////////////////
+
+timer_task_t *timer_task_add(const char *name, int period, int delay, timer_task_f func, void *arg);
+int timer_task_cancel(timer_task_t *task);
+
+int timer_task_owner(pid_t tid, char *name);
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#pragma once
+
+#include "common.h"
+#include "crc32c.h"
+
+#include <sys/mman.h>
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The magic string of a trace file */
+#define TRACE_MAGIC "BTRACE1"
+
+/** \brief The default number of records in a trace file */
+#define __TRACE_NUM_RECORDS 65536
+
+/** \brief The default size of the payload captured in a record (the largest event, so that any event can be replayed) */
+#define __TRACE_PAYLOAD_LEN __MAX_MSG_SIZE
+
+/** \brief The maximum size of the payload captured in a record */
+#define __TRACE_MAX_PAYLOAD_LEN 4096
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The header of a trace file */
+typedef struct _trace_hdr_t {
+    char magic[8]; /**< TRACE_MAGIC */
+    uint32_t rec_size; /**< The size of a record */
+    uint32_t num_recs; /**< The number of records in the ring */
+    uint32_t payload_len; /**< The maximum captured payload */
+    uint32_t reserved;
+    volatile uint64_t next; /**< The sequence number of the next record */
+    uint8_t pad[32];
+} trace_hdr_t;
+
+/** \brief The structure of a trace record (followed by payload_len bytes) */
+typedef struct _trace_rec_t {
+    volatile uint64_t seq; /**< Sequence number + 1 (0 while being written) */
+    uint32_t id; /**< Trigger ID */
+    uint16_t type; /**< Event type */
+    uint16_t length; /**< The original length of the payload */
+    uint32_t digest; /**< CRC32C of the original payload */
+    uint32_t aux; /**< Extra information (e.g., the fd of a message) */
+    uint16_t captured; /**< The number of captured payload bytes */
+    uint16_t reserved[3];
+    int64_t raised; /**< The time when the event was raised (ns) */
+    int64_t recorded; /**< The time when the event was recorded (ns) */
+    uint8_t payload[0]; /**< Captured payload */
+} trace_rec_t;
+
+/** \brief The structure of a mapped trace file */
+typedef struct _trace_t {
+    int fd; /**< The file descriptor of the trace file */
+    size_t size; /**< The size of the mapping */
+    trace_hdr_t *hdr; /**< The mapped header */
+    uint8_t *recs; /**< The mapped records */
+    char path[__CONF_WORD_LEN]; /**< The path of the trace file */
+} trace_t;
+
+/////////////////////////////////////////////////////////////////////
+
+int trace_create(trace_t *trace, const char *path, uint32_t num_recs, uint32_t payload_len);
+int trace_open(trace_t *trace, const char *path);
+int trace_close(trace_t *trace);
+
+int trace_record(trace_t *trace, uint32_t id, uint16_t type, const struct timespec *raised,
+                 const void *data, uint16_t length, uint32_t aux);
+
+uint64_t trace_count(trace_t *trace);
+const trace_rec_t *trace_get(trace_t *trace, uint64_t idx);
+
+int trace_replay(trace_t *trace, double speed, volatile int *running,
+                 int (*func)(const trace_rec_t *rec), uint64_t *replayed, uint64_t *skipped);
@@ -0,0 +1,613 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \ingroup util
+ * @{
+ *
+ * \defgroup log_ring Log Ring
+ * \brief Per-thread lock-free rings for deferred log formatting
+ * @{
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#include "log_ring.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The flag to push log messages into the log rings */
+int log_ring_enabled;
+
+/** \brief The list of all log rings (append-only) */
+static log_ring_t *log_rings;
+
+/** \brief The log ring of the current thread */
+static __thread log_ring_t *my_ring;
+
+/** \brief The key to release a log ring when its owner thread exits */
+static pthread_key_t log_ring_key;
+
+/** \brief The once flag to initialize the log ring key and semaphore */
+static pthread_once_t log_ring_once = PTHREAD_ONCE_INIT;
+
+/** \brief The semaphore to wake up the log writer */
+static sem_t log_ring_sem;
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief Argument classes of a conversion specification */
+enum {
+    LR_NONE,
+    LR_INT,
+    LR_UINT,
+    LR_CHAR,
+    LR_DOUBLE,
+    LR_PTR,
+    LR_STR,
+    LR_SKIP,
+    LR_PCT,
+};
+
+/** \brief Length modifiers of a conversion specification */
+enum {
+    LM_NONE,
+    LM_HH,
+    LM_H,
+    LM_L,
+    LM_LL,
+    LM_J,
+    LM_Z,
+    LM_T,
+    LM_LD,
+};
+
+/** \brief The maximum length of a conversion specification */
+#define LR_SPEC_LEN 32
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to release the log ring of an exiting thread
+ * \param ring Log ring
+ */
+static void log_ring_release(void *ring)
+{
+    ((log_ring_t *)ring)->owned = FALSE;
+}
+
+/**
+ * \brief Function to initialize the log ring key and semaphore
+ */
+static void log_ring_init(void)
+{
+    pthread_key_create(&log_ring_key, log_ring_release);
+    sem_init(&log_ring_sem, 0, 0);
+}
+
+/**
+ * \brief Function to get the log ring of the current thread
+ * \return Log ring
+ */
+static log_ring_t *log_ring_get(void)
+{
+    if (my_ring) return my_ring;
+
+    pthread_once(&log_ring_once, log_ring_init);
+
+    // reuse a ring released by an exited thread; the writer keeps draining it
+    log_ring_t *ring;
+    for (ring = log_rings; ring; ring = ring->next) {
+        if (!ring->owned && __sync_bool_compare_and_swap(&ring->owned, FALSE, TRUE))
+            break;
+    }
+
+    if (ring == NULL) {
+        ring = (log_ring_t *)CALLOC(1, sizeof(log_ring_t));
+        if (ring == NULL)
+            return NULL;
+
+        ring->owned = TRUE;
+
+        do {
+            ring->next = log_rings;
+        } while (!__sync_bool_compare_and_swap(&log_rings, ring->next, ring));
+    }
+
+    pthread_setspecific(log_ring_key, ring);
+
+    my_ring = ring;
+
+    return ring;
+}
+
+/**
+ * \brief Function to parse a conversion specification
+ * \param p The position of '%' in a format string
+ * \param spec The specification without length modifiers (output)
+ * \param cls Argument class (output)
+ * \param lmod Length modifier (output)
+ * \param stars The number of '*' (output)
+ * \return The position after the specification
+ */
+static const char *log_ring_spec(const char *p, char *spec, int *cls, int *lmod, int *stars)
+{
+    int n = 0;
+
+    *cls = LR_NONE;
+    *lmod = LM_NONE;
+    *stars = 0;
+
+    spec[n++] = *p++;
+
+    if (*p == '%') {
+        *cls = LR_PCT;
+        return p + 1;
+    }
+
+    while (*p && strchr("-+ #0'", *p) && n < LR_SPEC_LEN - 4)
+        spec[n++] = *p++;
+
+    if (*p == '*') {
+        (*stars)++;
+        spec[n++] = *p++;
+    } else {
+        while (isdigit(*p) && n < LR_SPEC_LEN - 4)
+            spec[n++] = *p++;
+    }
+
+    if (*p == '.') {
+        spec[n++] = *p++;
+        if (*p == '*') {
+            (*stars)++;
+            spec[n++] = *p++;
+        } else {
+            while (isdigit(*p) && n < LR_SPEC_LEN - 4)
+                spec[n++] = *p++;
+        }
+    }
+
+    switch (*p) {
+    case 'h':
+        if (*(p+1) == 'h') { *lmod = LM_HH; p += 2; }
+        else { *lmod = LM_H; p++; }
+        break;
+    case 'l':
+        if (*(p+1) == 'l') { *lmod = LM_LL; p += 2; }
+        else { *lmod = LM_L; p++; }
+        break;
+    case 'q': *lmod = LM_LL; p++; break;
+    case 'j': *lmod = LM_J; p++; break;
+    case 'z': *lmod = LM_Z; p++; break;
+    case 't': *lmod = LM_T; p++; break;
+    case 'L': *lmod = LM_LD; p++; break;
+    default: break;
+    }
+
+    switch (*p) {
+    case 'd': case 'i':
+        *cls = LR_INT;
+        break;
+    case 'u': case 'o': case 'x': case 'X':
+        *cls = LR_UINT;
+        break;
+    case 'c':
+        *cls = (*lmod == LM_NONE) ? LR_CHAR : LR_NONE;
+        break;
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+        *cls = LR_DOUBLE;
+        break;
+    case 'p':
+        *cls = LR_PTR;
+        break;
+    case 's':
+        *cls = (*lmod == LM_NONE) ? LR_STR : LR_NONE;
+        break;
+    case 'n':
+        *cls = LR_SKIP;
+        break;
+    default:
+        return p;
+    }
+
+    // integers are stored as 64-bit values, so they are printed with 'll'
+    if (*cls == LR_INT || *cls == LR_UINT) {
+        spec[n++] = 'l';
+        spec[n++] = 'l';
+    }
+
+    spec[n++] = *p++;
+    spec[n] = '\0';
+
+    return p;
+}
+
+/**
+ * \brief Function to encode the arguments of a log message in binary
+ * \param rec Log record
+ * \param format Format string
+ * \param ap Arguments
+ */
+static void log_ring_encode(log_rec_t *rec, const char *format, va_list ap)
+{
+    char spec[LR_SPEC_LEN];
+    const char *p = format;
+    char *buf = rec->args;
+    int off = 0;
+
+    while ((p = strchr(p, '%')) != NULL) {
+        int cls, lmod, stars;
+        p = log_ring_spec(p, spec, &cls, &lmod, &stars);
+
+        if (cls == LR_NONE) break;
+        if (cls == LR_PCT) continue;
+
+        int need = stars * sizeof(int) + sizeof(uint64_t);
+        if (off + need > __LOG_ARG_LEN) {
+            rec->trunc = TRUE;
+            break;
+        }
+
+        int i;
+        for (i=0; i<stars; i++) {
+            int width = va_arg(ap, int);
+            memcpy(buf + off, &width, sizeof(int));
+            off += sizeof(int);
+        }
+
+        if (cls == LR_INT) {
+            int64_t v;
+            switch (lmod) {
+            case LM_HH: v = (signed char)va_arg(ap, int); break;
+            case LM_H: v = (short)va_arg(ap, int); break;
+            case LM_L: v = va_arg(ap, long); break;
+            case LM_LL: v = va_arg(ap, long long); break;
+            case LM_J: v = va_arg(ap, intmax_t); break;
+            case LM_Z: v = va_arg(ap, ssize_t); break;
+            case LM_T: v = va_arg(ap, ptrdiff_t); break;
+            default: v = va_arg(ap, int); break;
+            }
+            memcpy(buf + off, &v, sizeof(v));
+            off += sizeof(v);
+        } else if (cls == LR_UINT) {
+            uint64_t v;
+            switch (lmod) {
+            case LM_HH: v = (unsigned char)va_arg(ap, unsigned int); break;
+            case LM_H: v = (unsigned short)va_arg(ap, unsigned int); break;
+            case LM_L: v = va_arg(ap, unsigned long); break;
+            case LM_LL: v = va_arg(ap, unsigned long long); break;
+            case LM_J: v = va_arg(ap, uintmax_t); break;
+            case LM_Z: v = va_arg(ap, size_t); break;
+            case LM_T: v = (unsigned long)va_arg(ap, ptrdiff_t); break;
+            default: v = va_arg(ap, unsigned int); break;
+            }
+            memcpy(buf + off, &v, sizeof(v));
+            off += sizeof(v);
+        } else if (cls == LR_CHAR) {
+            int v = va_arg(ap, int);
+            memcpy(buf + off, &v, sizeof(v));
+            off += sizeof(v);
+        } else if (cls == LR_DOUBLE) {
+            double v;
+            if (lmod == LM_LD) v = (double)va_arg(ap, long double);
+            else v = va_arg(ap, double);
+            memcpy(buf + off, &v, sizeof(v));
+            off += sizeof(v);
+        } else if (cls == LR_PTR || cls == LR_SKIP) {
+            void *v = va_arg(ap, void *);
+            memcpy(buf + off, &v, sizeof(v));
+            off += sizeof(v);
+        } else { // LR_STR
+            const char *s = va_arg(ap, const char *);
+            if (s == NULL) s = "(null)";
+
+            int len = strlen(s);
+            if (off + len + 1 > __LOG_ARG_LEN) {
+                len = __LOG_ARG_LEN - off - 1;
+                rec->trunc = TRUE;
+            }
+
+            memcpy(buf + off, s, len);
+            buf[off + len] = '\0';
+            off += len + 1;
+        }
+
+        rec->nargs++;
+
+        if (rec->trunc) break;
+    }
+
+    rec->len = off;
+}
+
+/**
+ * \brief Function to reserve a record in the log ring of the current thread
+ * \param ring Log ring
+ * \param id Component ID
+ * \param type Log level
+ * \return Log record (NULL if the ring is full)
+ */
+static log_rec_t *log_ring_reserve(log_ring_t *ring, uint32_t id, uint16_t type)
+{
+    uint32_t head = ring->head;
+
+    if (head - ring->tail >= __LOG_RING_SIZE) {
+        ring->dropped++;
+        return NULL;
+    }
+
+    log_rec_t *rec = &ring->rec[head & (__LOG_RING_SIZE - 1)];
+
+    rec->id = id;
+    rec->type = type;
+    rec->nargs = 0;
+    rec->len = 0;
+    rec->trunc = FALSE;
+
+    clock_gettime(CLOCK_REALTIME, &rec->time);
+
+    return rec;
+}
+
+/**
+ * \brief Function to publish a reserved record to the log writer
+ * \param ring Log ring
+ * \param urgent The flag to wake up the log writer immediately
+ */
+static void log_ring_commit(log_ring_t *ring, int urgent)
+{
+    uint32_t head = ring->head + 1;
+
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+
+    ring->pushed++;
+
+    if (urgent || head - ring->tail == __LOG_RING_SIZE / 2)
+        sem_post(&log_ring_sem);
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to push a log message without formatting it
+ * \param id Component ID
+ * \param type Log level
+ * \param urgent The flag to wake up the log writer immediately
+ * \param format Format string (it should be a string literal)
+ * \param ap Arguments
+ */
+int log_ring_push(uint32_t id, uint16_t type, int urgent, const char *format, va_list ap)
+{
+    log_ring_t *ring = log_ring_get();
+    if (ring == NULL) return -1;
+
+    log_rec_t *rec = log_ring_reserve(ring, id, type);
+    if (rec == NULL) return -1;
+
+    rec->format = format;
+    log_ring_encode(rec, format, ap);
+
+    log_ring_commit(ring, urgent);
+
+    return 0;
+}
+
+/**
+ * \brief Function to push a formatted log message
+ * \param id Component ID
+ * \param type Log level
+ * \param urgent The flag to wake up the log writer immediately
+ * \param text Log message
+ */
+int log_ring_push_text(uint32_t id, uint16_t type, int urgent, const char *text)
+{
+    log_ring_t *ring = log_ring_get();
+    if (ring == NULL) return -1;
+
+    log_rec_t *rec = log_ring_reserve(ring, id, type);
+    if (rec == NULL) return -1;
+
+    rec->format = NULL;
+    snprintf(rec->args, __LOG_ARG_LEN, "%s", text);
+    rec->len = strlen(rec->args) + 1;
+
+    log_ring_commit(ring, urgent);
+
+    return 0;
+}
+
+/**
+ * \brief Function to consume all pushed records (log writer only)
+ * \param func The function to process a record
+ * \return The number of consumed records
+ */
+int log_ring_drain(int (*func)(const log_rec_t *rec))
+{
+    int cnt = 0;
+
+    log_ring_t *ring;
+    for (ring = log_rings; ring; ring = ring->next) {
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint32_t tail = ring->tail;
+
+        while (tail != head) {
+            func(&ring->rec[tail & (__LOG_RING_SIZE - 1)]);
+            tail++;
+            cnt++;
+        }
+
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+
+    return cnt;
+}
+
+/**
+ * \brief Function to wait for urgent records (log writer only)
+ * \param msec Timeout (millisecond)
+ */
+int log_ring_wait(int msec)
+{
+    pthread_once(&log_ring_once, log_ring_init);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    ts.tv_sec += msec / 1000;
+    ts.tv_nsec += (msec % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+
+    while (sem_timedwait(&log_ring_sem, &ts) != 0) {
+        if (errno != EINTR) return -1;
+    }
+
+    // collapse the pending wake-ups into this one
+    while (sem_trywait(&log_ring_sem) == 0);
+
+    return 0;
+}
+
+/** \brief Function to print an argument with 0, 1, or 2 '*' values */
+#define LR_PRINT(v) \
+    ((stars == 0) ? snprintf(out + n, size - n, spec, v) : \
+     (stars == 1) ? snprintf(out + n, size - n, spec, w[0], v) : \
+                    snprintf(out + n, size - n, spec, w[0], w[1], v))
+
+/**
+ * \brief Function to format a log record
+ * \param rec Log record
+ * \param out Output buffer
+ * \param size The size of the output buffer
+ * \return The length of the formatted message
+ */
+int log_ring_format(const log_rec_t *rec, char *out, int size)
+{
+    if (rec->format == NULL)
+        return snprintf(out, size, "%s", rec->args);
+
+    char spec[LR_SPEC_LEN];
+    const char *p = rec->format;
+    const char *buf = rec->args;
+    int n = 0, off = 0, idx = 0;
+
+    while (*p && n < size - 1) {
+        const char *pct = strchr(p, '%');
+        int lit = (pct) ? pct - p : strlen(p);
+
+        if (lit) {
+            if (lit > size - 1 - n) lit = size - 1 - n;
+            memcpy(out + n, p, lit);
+            n += lit;
+            p += lit;
+            continue;
+        }
+
+        int cls, lmod, stars;
+        const char *next = log_ring_spec(p, spec, &cls, &lmod, &stars);
+
+        if (cls == LR_NONE) {
+            // unsupported conversion; print the rest as it is
+            lit = strlen(p);
+            if (lit > size - 1 - n) lit = size - 1 - n;
+            memcpy(out + n, p, lit);
+            n += lit;
+            break;
+        } else if (cls == LR_PCT) {
+            out[n++] = '%';
+            p = next;
+            continue;
+        } else if (idx >= rec->nargs) {
+            break;
+        }
+
+        int i, w[2] = {0};
+        for (i=0; i<stars; i++) {
+            memcpy(&w[i], buf + off, sizeof(int));
+            off += sizeof(int);
+        }
+
+        int r = 0;
+        if (cls == LR_INT) {
+            long long v;
+            memcpy(&v, buf + off, sizeof(v));
+            off += sizeof(v);
+            r = LR_PRINT(v);
+        } else if (cls == LR_UINT) {
+            unsigned long long v;
+            memcpy(&v, buf + off, sizeof(v));
+            off += sizeof(v);
+            r = LR_PRINT(v);
+        } else if (cls == LR_CHAR) {
+            int v;
+            memcpy(&v, buf + off, sizeof(v));
+            off += sizeof(v);
+            r = LR_PRINT(v);
+        } else if (cls == LR_DOUBLE) {
+            double v;
+            memcpy(&v, buf + off, sizeof(v));
+            off += sizeof(v);
+            r = LR_PRINT(v);
+        } else if (cls == LR_PTR) {
+            void *v;
+            memcpy(&v, buf + off, sizeof(v));
+            off += sizeof(v);
+            r = LR_PRINT(v);
+        } else if (cls == LR_SKIP) {
+            off += sizeof(void *);
+        } else { // LR_STR
+            const char *v = buf + off;
+            off += strlen(v) + 1;
+            r = LR_PRINT(v);
+        }
+
+        if (r > 0) n += r;
+        if (n > size - 1) n = size - 1;
+
+        idx++;
+        p = next;
+    }
+
+    if (rec->trunc && n + 4 < size) {
+        memcpy(out + n, "...", 3);
+        n += 3;
+    }
+
+    out[n] = '\0';
+
+    return n;
+}
+
+/**
+ * \brief Function to get the statistics of the log rings
+ * \param num_rings The number of rings (output)
+ * \param pushed The number of pushed records (output)
+ * \param dropped The number of dropped records (output)
+ */
+int log_ring_stats(int *num_rings, uint64_t *pushed, uint64_t *dropped)
+{
+    *num_rings = 0;
+    *pushed = 0;
+    *dropped = 0;
+
+    log_ring_t *ring;
+    for (ring = log_rings; ring; ring = ring->next) {
+        (*num_rings)++;
+        *pushed += ring->pushed;
+        *dropped += ring->dropped;
+    }
+
+    return 0;
+}
+
+/**
+ * @}
+ *
+ * @}
+ */
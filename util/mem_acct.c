@@ -0,0 +1,334 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \ingroup util
+ * @{
+ *
+ * \defgroup mem_acct Memory Accounting
+ * \brief Functions to account allocations to the components and applications that make them
+ * @{
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#include "common.h"
+#include "mem_acct.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The number of slots to map names and file name pointers to sites (power of 2) */
+#define MEM_ACCT_SLOTS 512
+
+/** \brief The header in front of an accounted block (16 bytes to keep the alignment of malloc) */
+typedef struct _mem_hdr_t {
+    uint32_t site; /**< The index of the site that allocated the block */
+    uint32_t reserved; /**< Padding */
+    uint64_t size; /**< The size of the block */
+} mem_hdr_t;
+
+/** \brief Sites */
+static mem_site_t mem_sites[__MEM_ACCT_MAX_SITES];
+
+/** \brief The number of sites */
+static volatile int mem_num_sites;
+
+/** \brief File name pointers (__FILE__ of each translation unit) */
+static const char *volatile mem_keys[MEM_ACCT_SLOTS];
+
+/** \brief The sites of file name pointers */
+static uint32_t mem_vals[MEM_ACCT_SLOTS];
+
+/** \brief The sites of owner names (the index of a site + 1, 0: empty) */
+static volatile uint32_t mem_owners[MEM_ACCT_SLOTS];
+
+/** \brief The lock to add sites */
+static pthread_mutex_t mem_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief The component or the application that the current thread works for (NULL: core) */
+static __thread const char *mem_owner;
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to add a site (the lock should be held)
+ * \param name Site name
+ * \return The index of the site
+ */
+static uint32_t mem_add_site(const char *name)
+{
+    int i;
+    for (i=0; i<mem_num_sites; i++) {
+        if (strncmp(mem_sites[i].name, name, __MEM_ACCT_NAME_LEN - 1) == 0)
+            return i;
+    }
+
+    // the last site takes whatever does not fit
+    if (mem_num_sites == __MEM_ACCT_MAX_SITES)
+        return __MEM_ACCT_MAX_SITES - 1;
+
+    mem_site_t *site = &mem_sites[mem_num_sites];
+    strncpy(site->name, name, __MEM_ACCT_NAME_LEN - 1);
+    clock_gettime(CLOCK_MONOTONIC, &site->last_time);
+
+    __atomic_store_n(&mem_num_sites, mem_num_sites + 1, __ATOMIC_RELEASE);
+
+    return mem_num_sites - 1;
+}
+
+/**
+ * \brief Function to get the site of a core source file
+ * \param file Source file (the pointer of __FILE__)
+ * \return The index of the site
+ */
+static uint32_t mem_get_site(const char *file)
+{
+    uint32_t h = ((uintptr_t)file >> 3) & (MEM_ACCT_SLOTS - 1);
+
+    // the string literals of a translation unit stay at one address
+    while (1) {
+        const char *key = __atomic_load_n(&mem_keys[h], __ATOMIC_ACQUIRE);
+
+        if (key == file) return mem_vals[h];
+        else if (key == NULL) break;
+
+        h = (h + 1) & (MEM_ACCT_SLOTS - 1);
+    }
+
+    pthread_mutex_lock(&mem_lock);
+
+    while (mem_keys[h] != NULL && mem_keys[h] != file)
+        h = (h + 1) & (MEM_ACCT_SLOTS - 1);
+
+    if (mem_keys[h] == NULL) {
+        // named after the base name without its extension (e.g., components/flow_mgmt.c -> flow_mgmt)
+        char name[__MEM_ACCT_NAME_LEN] = {0};
+
+        const char *base = strrchr(file, '/');
+        base = (base) ? base + 1 : file;
+
+        strncpy(name, base, __MEM_ACCT_NAME_LEN - 1);
+
+        char *ext = strrchr(name, '.');
+        if (ext) *ext = '\0';
+
+        mem_vals[h] = mem_add_site(name);
+        __atomic_store_n(&mem_keys[h], file, __ATOMIC_RELEASE);
+    }
+
+    uint32_t idx = mem_vals[h];
+
+    pthread_mutex_unlock(&mem_lock);
+
+    return idx;
+}
+
+/**
+ * \brief Function to get the site of a component or an application
+ * \param name The name of a component or an application
+ * \return The index of the site
+ */
+static uint32_t mem_get_owner_site(const char *name)
+{
+    // names are hashed by their contents since their buffers can be reused by others
+    uint32_t h = 2166136261U;
+
+    int i;
+    for (i=0; i<__MEM_ACCT_NAME_LEN - 1 && name[i]; i++)
+        h = (h ^ (uint8_t)name[i]) * 16777619U;
+
+    h &= (MEM_ACCT_SLOTS - 1);
+
+    while (1) {
+        uint32_t val = __atomic_load_n(&mem_owners[h], __ATOMIC_ACQUIRE);
+
+        if (val == 0) break;
+        else if (strncmp(mem_sites[val - 1].name, name, __MEM_ACCT_NAME_LEN - 1) == 0) return val - 1;
+
+        h = (h + 1) & (MEM_ACCT_SLOTS - 1);
+    }
+
+    pthread_mutex_lock(&mem_lock);
+
+    uint32_t idx = mem_add_site(name);
+
+    // another thread may have taken the slot in the meantime
+    while (mem_owners[h] != 0 && mem_owners[h] != idx + 1)
+        h = (h + 1) & (MEM_ACCT_SLOTS - 1);
+
+    if (mem_owners[h] == 0)
+        __atomic_store_n(&mem_owners[h], idx + 1, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&mem_lock);
+
+    return idx;
+}
+
+/**
+ * \brief Function to add bytes to the live bytes of a site
+ * \param site Site
+ * \param len The number of bytes
+ */
+static void mem_charge(mem_site_t *site, int64_t len)
+{
+    int64_t live = __sync_add_and_fetch(&site->live, len);
+
+    int64_t peak = site->peak;
+    while (live > peak) {
+        if (__sync_bool_compare_and_swap(&site->peak, peak, live)) break;
+        peak = site->peak;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to set the owner of the allocations of the current thread
+ * \param name The name of a component or an application (NULL: the allocating source file)
+ * \return The previous owner
+ */
+const char *mem_acct_owner(const char *name)
+{
+    const char *prev = mem_owner;
+    mem_owner = name;
+
+    return prev;
+}
+
+/**
+ * \brief Function to allocate an accounted block
+ * The block is charged to the owner of the current thread, or to the source file if there is none.
+ * \param size The size of an element
+ * \param num The number of elements
+ * \param zero The flag to clear the block
+ * \param file The source file that allocates the block
+ */
+void *mem_alloc(size_t size, size_t num, int zero, const char *file)
+{
+    if (num && size > (SIZE_MAX - sizeof(mem_hdr_t)) / num) return NULL;
+
+    size_t len = size * num;
+
+    mem_hdr_t *hdr = (zero) ? calloc(1, sizeof(mem_hdr_t) + len) : malloc(sizeof(mem_hdr_t) + len);
+    if (hdr == NULL) return NULL;
+
+    uint32_t idx = (mem_owner) ? mem_get_owner_site(mem_owner) : mem_get_site(file);
+    mem_site_t *site = &mem_sites[idx];
+
+    hdr->site = idx;
+    hdr->size = len;
+
+    mem_charge(site, (int64_t)len);
+    __sync_fetch_and_add(&site->num_allocs, 1);
+
+    return hdr + 1;
+}
+
+/**
+ * \brief Function to resize an accounted block (charged to the site that allocated it)
+ * \param ptr Block (NULL: a new block)
+ * \param size New size
+ * \param file The source file that resizes the block
+ */
+void *mem_realloc(void *ptr, size_t size, const char *file)
+{
+    if (ptr == NULL) return mem_alloc(size, 1, FALSE, file);
+
+    if (size > SIZE_MAX - sizeof(mem_hdr_t)) return NULL;
+
+    mem_hdr_t *hdr = (mem_hdr_t *)ptr - 1;
+    uint64_t old = hdr->size;
+
+    hdr = realloc(hdr, sizeof(mem_hdr_t) + size);
+    if (hdr == NULL) return NULL;
+
+    hdr->size = size;
+
+    mem_charge(&mem_sites[hdr->site], (int64_t)size - (int64_t)old);
+
+    return hdr + 1;
+}
+
+/**
+ * \brief Function to release an accounted block
+ * \param ptr Block (allocated by MALLOC, CALLOC, or REALLOC)
+ */
+void mem_free(void *ptr)
+{
+    if (ptr == NULL) return;
+
+    mem_hdr_t *hdr = (mem_hdr_t *)ptr - 1;
+    mem_site_t *site = &mem_sites[hdr->site];
+
+    __sync_sub_and_fetch(&site->live, (int64_t)hdr->size);
+    __sync_fetch_and_add(&site->num_frees, 1);
+
+    free(hdr);
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to get the number of sites
+ */
+int mem_acct_num_sites(void)
+{
+    return __atomic_load_n(&mem_num_sites, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * \brief Function to get a site
+ * \param idx The index of a site
+ */
+mem_site_t *mem_acct_site(int idx)
+{
+    if (idx < 0 || idx >= mem_acct_num_sites()) return NULL;
+
+    return &mem_sites[idx];
+}
+
+/**
+ * \brief Function to find the site of a component or an application
+ * \param name The name of a component or an application
+ */
+mem_site_t *mem_acct_find(const char *name)
+{
+    int i, num_sites = mem_acct_num_sites();
+    for (i=0; i<num_sites; i++) {
+        if (strncmp(mem_sites[i].name, name, __MEM_ACCT_NAME_LEN - 1) == 0)
+            return &mem_sites[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief Function to get the allocation rate of a site since the last call
+ * \param site Site
+ * \return Allocations per second
+ */
+double mem_acct_rate(mem_site_t *site)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    double elapsed = (now.tv_sec - site->last_time.tv_sec) + (now.tv_nsec - site->last_time.tv_nsec) / 1e9;
+    uint64_t num_allocs = site->num_allocs;
+
+    double rate = (elapsed > 0) ? (num_allocs - site->last_allocs) / elapsed : 0;
+
+    site->last_allocs = num_allocs;
+    site->last_time = now;
+
+    return rate;
+}
+
+/**
+ * @}
+ *
+ * @}
+ */
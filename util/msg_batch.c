@@ -0,0 +1,166 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \ingroup util
+ * @{
+ *
+ * \defgroup msg_batch Message Batch
+ * \brief Functions to send events as multipart messages (a complete event per frame)
+ * @{
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#include "msg_batch.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to send the events in a batch (the lock should be held)
+ * \param batch Batch
+ * \param ctx MQ context
+ * \param addr The push address of the receiver
+ */
+static int msg_batch_send(msg_batch_t *batch, void *ctx, const char *addr)
+{
+    int ret = 0;
+
+    if (batch->num == 0) return 0;
+
+    void *push_sock = zmq_socket(ctx, ZMQ_PUSH);
+
+    if (zmq_connect(push_sock, addr)) {
+        PERROR("zmq_connect");
+        ret = -1;
+    } else {
+        int i, off = 0;
+        for (i=0; i<batch->num; i++) {
+            zmq_send(push_sock, batch->data + off, batch->size[i], (i < batch->num - 1) ? ZMQ_SNDMORE : 0);
+            off += batch->size[i];
+        }
+    }
+
+    zmq_close(push_sock);
+
+    batch->num = 0;
+    batch->len = 0;
+
+    return ret;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to create a batch
+ * \param max The number of events to send a batch
+ * \param usec The time to send a batch after its first event (us)
+ */
+msg_batch_t *msg_batch_create(int max, int usec)
+{
+    msg_batch_t *batch = (msg_batch_t *)MALLOC(sizeof(msg_batch_t));
+    if (batch == NULL) {
+        PERROR("malloc");
+        return NULL;
+    }
+
+    pthread_mutex_init(&batch->lock, NULL);
+
+    batch->max = (max > __MSG_BATCH_MAX) ? __MSG_BATCH_MAX : max;
+    batch->usec = (usec > 0) ? usec : __MSG_BATCH_USEC;
+
+    batch->num = 0;
+    batch->len = 0;
+
+    return batch;
+}
+
+/**
+ * \brief Function to destroy a batch (the events left are dropped)
+ * \param batch Batch
+ */
+int msg_batch_destroy(msg_batch_t *batch)
+{
+    if (batch == NULL) return -1;
+
+    pthread_mutex_destroy(&batch->lock);
+    FREE(batch);
+
+    return 0;
+}
+
+/**
+ * \brief Function to add an event to a batch (and to send the batch once it is full)
+ * \param batch Batch
+ * \param ctx MQ context
+ * \param addr The push address of the receiver
+ * \param msg Event (JSON)
+ * \param len The length of the event
+ */
+int msg_batch_add(msg_batch_t *batch, void *ctx, const char *addr, const char *msg, int len)
+{
+    int ret = 0;
+
+    if (len <= 0 || len > __MSG_BATCH_SIZE) return -1;
+
+    pthread_mutex_lock(&batch->lock);
+
+    if (batch->len + len > __MSG_BATCH_SIZE)
+        ret = msg_batch_send(batch, ctx, addr);
+
+    if (batch->num == 0)
+        clock_gettime(CLOCK_MONOTONIC, &batch->first);
+
+    memcpy(batch->data + batch->len, msg, len);
+    batch->size[batch->num++] = len;
+    batch->len += len;
+
+    if (batch->num >= batch->max)
+        ret = msg_batch_send(batch, ctx, addr);
+
+    pthread_mutex_unlock(&batch->lock);
+
+    return ret;
+}
+
+/**
+ * \brief Function to send a batch if it has been held long enough
+ * \param batch Batch
+ * \param ctx MQ context
+ * \param addr The push address of the receiver
+ * \param force The flag to send the batch regardless of its age
+ * \return The time until the batch should be sent (us), or -1 if it is empty
+ */
+int msg_batch_flush(msg_batch_t *batch, void *ctx, const char *addr, int force)
+{
+    int left = -1;
+
+    pthread_mutex_lock(&batch->lock);
+
+    if (batch->num > 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        int64_t age = (now.tv_sec - batch->first.tv_sec) * 1000000 +
+                      (now.tv_nsec - batch->first.tv_nsec) / 1000;
+
+        if (force || age >= batch->usec)
+            msg_batch_send(batch, ctx, addr);
+        else
+            left = batch->usec - age;
+    }
+
+    pthread_mutex_unlock(&batch->lock);
+
+    return left;
+}
+
+/**
+ * @}
+ *
+ * @}
+ */
@@ -0,0 +1,552 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \ingroup util
+ * @{
+ *
+ * \defgroup shm_ring Shared-Memory Ring
+ * \brief Functions to exchange events through single-producer single-consumer rings in shared memory
+ * @{
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#include "shm_ring.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief Function to get the space taken by a record */
+#define SHM_REC_SIZE(len) ((sizeof(shm_rec_t) + (len) + 7) & ~7)
+
+/** \brief The number of polls before the consumer goes to sleep */
+#define SHM_RING_SPINS 256
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to get the current time in milliseconds
+ */
+static int64_t shm_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * \brief Function to sleep on a futex word shared between processes
+ * \param addr Futex word
+ * \param val The value expected in the futex word
+ * \param timeout Timeout (ms)
+ */
+static int shm_futex_wait(volatile int32_t *addr, int32_t val, int64_t timeout)
+{
+    struct timespec ts;
+    ts.tv_sec = timeout / 1000;
+    ts.tv_nsec = (timeout % 1000) * 1000000;
+
+    return syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+/**
+ * \brief Function to wake up a process sleeping on a futex word
+ * \param addr Futex word
+ */
+static int shm_futex_wake(volatile int32_t *addr)
+{
+    return syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/**
+ * \brief Function to map a ring file
+ * \param ring Ring
+ */
+static int shm_ring_map(shm_ring_t *ring)
+{
+    void *map = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+    if (map == MAP_FAILED) {
+        PERROR("mmap");
+        close(ring->fd);
+        ring->fd = -1;
+        return -1;
+    }
+
+    ring->hdr = (shm_ring_hdr_t *)map;
+    ring->data = (uint8_t *)map + sizeof(shm_ring_hdr_t);
+
+    pthread_mutex_init(&ring->lock, NULL);
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to create a ring file
+ * \param ring Ring
+ * \param path The path of the ring file
+ * \param size The size of the data area (power of 2)
+ */
+int shm_ring_create(shm_ring_t *ring, const char *path, uint32_t size)
+{
+    if (size < 4096 || (size & (size - 1)))
+        return -1;
+
+    // a peer may still map the file of a previous run
+    unlink(path);
+
+    ring->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (ring->fd < 0) {
+        PERROR("open");
+        return -1;
+    }
+
+    ring->size = sizeof(shm_ring_hdr_t) + size;
+
+    if (ftruncate(ring->fd, ring->size) < 0) {
+        PERROR("ftruncate");
+        close(ring->fd);
+        ring->fd = -1;
+        return -1;
+    }
+
+    if (shm_ring_map(ring))
+        return -1;
+
+    memcpy(ring->hdr->magic, SHM_RING_MAGIC, sizeof(ring->hdr->magic));
+    ring->hdr->size = size;
+    ring->hdr->head = 0;
+
+    ring->data_size = size;
+    ring->mask = size - 1;
+    ring->hdr->tail = 0;
+    ring->hdr->waiting = FALSE;
+    ring->hdr->wakeup = 0;
+
+    ring->stalled = FALSE;
+
+    snprintf(ring->path, __CONF_WORD_LEN, "%s", path);
+
+    return 0;
+}
+
+/**
+ * \brief Function to open a ring file created by a peer
+ * \param ring Ring
+ * \param path The path of the ring file
+ */
+int shm_ring_open(shm_ring_t *ring, const char *path)
+{
+    ring->fd = open(path, O_RDWR);
+    if (ring->fd < 0) {
+        PERROR("open");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(ring->fd, &st) < 0 || st.st_size < sizeof(shm_ring_hdr_t) + 4096) {
+        close(ring->fd);
+        ring->fd = -1;
+        return -1;
+    }
+
+    ring->size = st.st_size;
+
+    if (shm_ring_map(ring))
+        return -1;
+
+    ring->stalled = FALSE;
+
+    shm_ring_hdr_t *hdr = ring->hdr;
+
+    // the size is checked once and kept here, since the peer can still write the header
+    uint32_t size = __atomic_load_n(&hdr->size, __ATOMIC_RELAXED);
+
+    if (memcmp(hdr->magic, SHM_RING_MAGIC, sizeof(hdr->magic)) != 0 ||
+        size < 4096 || (size & (size - 1)) || sizeof(shm_ring_hdr_t) + size != ring->size) {
+        shm_ring_close(ring, FALSE);
+        return -1;
+    }
+
+    ring->data_size = size;
+    ring->mask = size - 1;
+
+    snprintf(ring->path, __CONF_WORD_LEN, "%s", path);
+
+    return 0;
+}
+
+/**
+ * \brief Function to unmap a ring file
+ * \param ring Ring
+ * \param unlink_file The flag to remove the ring file
+ */
+int shm_ring_close(shm_ring_t *ring, int unlink_file)
+{
+    if (ring->hdr == NULL)
+        return -1;
+
+    munmap(ring->hdr, ring->size);
+    close(ring->fd);
+
+    if (unlink_file)
+        unlink(ring->path);
+
+    pthread_mutex_destroy(&ring->lock);
+
+    ring->hdr = NULL;
+    ring->data = NULL;
+    ring->fd = -1;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to append a record to a ring
+ * \param ring Ring
+ * \param id Component or application ID
+ * \param type Event type
+ * \param ret Return value
+ * \param seq Request sequence number (0: notification)
+ * \param data Data
+ * \param len The length of the data
+ * \return 0 on success, -1 if the ring stays full
+ */
+int shm_ring_push(shm_ring_t *ring, uint32_t id, uint16_t type, int ret, uint64_t seq, const void *data, uint32_t len)
+{
+    shm_ring_hdr_t *hdr = ring->hdr;
+    if (hdr == NULL) return -1;
+
+    uint32_t size = ring->data_size;
+    uint32_t rec_size = SHM_REC_SIZE(len);
+
+    if (rec_size > size / 2)
+        return -1;
+
+    pthread_mutex_lock(&ring->lock);
+
+    uint64_t head = hdr->head;
+    uint32_t off = head & ring->mask;
+    uint32_t remain = size - off;
+
+    // a record never wraps around; the rest of the data area is skipped instead
+    uint32_t need = (remain < rec_size) ? remain + rec_size : rec_size;
+
+    // once the consumer stalls, records are dropped without waiting until it catches up
+    int64_t deadline = 0;
+    while (head + need - __atomic_load_n(&hdr->tail, __ATOMIC_ACQUIRE) > size) {
+        if (deadline == 0 && !ring->stalled) {
+            deadline = shm_now() + __SHM_RING_FULL_WAIT;
+        } else if (ring->stalled || shm_now() > deadline) {
+            ring->stalled = TRUE;
+            pthread_mutex_unlock(&ring->lock);
+            return -1;
+        }
+
+        waitsec(0, 10 * 1000);
+    }
+
+    ring->stalled = FALSE;
+
+    if (remain < rec_size) {
+        if (remain >= sizeof(shm_rec_t)) {
+            shm_rec_t *pad = (shm_rec_t *)(ring->data + off);
+            pad->len = remain - sizeof(shm_rec_t);
+            pad->flags = SHM_REC_PAD;
+        }
+
+        head += remain;
+        off = 0;
+    }
+
+    shm_rec_t *rec = (shm_rec_t *)(ring->data + off);
+
+    rec->len = len;
+    rec->id = id;
+    rec->type = type;
+    rec->flags = 0;
+    rec->ret = ret;
+    rec->seq = seq;
+
+    if (len) memcpy(rec->data, data, len);
+
+    __atomic_store_n(&hdr->head, head + rec_size, __ATOMIC_RELEASE);
+
+    // pairs with the barrier in shm_ring_pop
+    __sync_synchronize();
+
+    if (hdr->waiting) {
+        __sync_fetch_and_add(&hdr->wakeup, 1);
+        shm_futex_wake(&hdr->wakeup);
+    }
+
+    pthread_mutex_unlock(&ring->lock);
+
+    return 0;
+}
+
+/**
+ * \brief Function to take the oldest record out of a ring (one consumer per ring)
+ * \param ring Ring
+ * \param rec The header of the record (output)
+ * \param data The buffer for the data (output)
+ * \param max The size of the buffer
+ * \param timeout Timeout (ms, 0: no wait, negative: wait forever)
+ * \return The length of the copied data, -1 if the ring is empty
+ */
+int shm_ring_pop(shm_ring_t *ring, shm_rec_t *rec, void *data, uint32_t max, int timeout)
+{
+    shm_ring_hdr_t *hdr = ring->hdr;
+    if (hdr == NULL) return -1;
+
+    uint32_t size = ring->data_size;
+    int64_t deadline = (timeout > 0) ? shm_now() + timeout : 0;
+    int spins = 0;
+
+    while (1) {
+        uint64_t tail = hdr->tail;
+        uint64_t head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+
+        if (head != tail) {
+            uint32_t off = tail & ring->mask;
+            uint32_t remain = size - off;
+
+            if (remain < sizeof(shm_rec_t)) {
+                __atomic_store_n(&hdr->tail, tail + remain, __ATOMIC_RELEASE);
+                continue;
+            }
+
+            shm_rec_t *r = (shm_rec_t *)(ring->data + off);
+
+            // the header is read once, so the peer cannot change the length after the check
+            shm_rec_t h;
+            memcpy(&h, r, sizeof(shm_rec_t));
+            __atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+            if (h.flags & SHM_REC_PAD) {
+                __atomic_store_n(&hdr->tail, tail + remain, __ATOMIC_RELEASE);
+                continue;
+            }
+
+            if (SHM_REC_SIZE(h.len) > remain || SHM_REC_SIZE(h.len) > head - tail) {
+                // corrupted by the peer; drop everything written so far
+                __atomic_store_n(&hdr->tail, head, __ATOMIC_RELEASE);
+                return -1;
+            }
+
+            *rec = h;
+
+            uint32_t len = MIN(h.len, max);
+            memcpy(data, r->data, len);
+
+            __atomic_store_n(&hdr->tail, tail + SHM_REC_SIZE(h.len), __ATOMIC_RELEASE);
+
+            return len;
+        }
+
+        if (timeout == 0)
+            return -1;
+
+        if (spins < SHM_RING_SPINS) {
+            spins++;
+            continue;
+        }
+
+        int64_t left = 1000;
+        if (timeout > 0) {
+            left = deadline - shm_now();
+            if (left <= 0) return -1;
+        }
+
+        int32_t wakeup = hdr->wakeup;
+
+        hdr->waiting = TRUE;
+        __sync_synchronize();
+
+        if (__atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE) == tail)
+            shm_futex_wait(&hdr->wakeup, wakeup, left);
+
+        hdr->waiting = FALSE;
+    }
+
+    return -1;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to send a request and wait for its reply
+ * \param chan Channel
+ * \param id Component or application ID
+ * \param type Event type
+ * \param input Request data
+ * \param len The length of the request data
+ * \param rec The header of the reply (output)
+ * \param output The buffer for the reply data (output)
+ * \param max The size of the buffer
+ * \param timeout The time to wait for the reply (ms)
+ */
+int shm_chan_call(shm_chan_t *chan, uint32_t id, uint16_t type, const void *input, uint32_t len,
+                  shm_rec_t *rec, void *output, uint32_t max, int timeout)
+{
+    pthread_mutex_lock(&chan->lock);
+
+    uint64_t seq = ++chan->seq;
+
+    if (shm_ring_push(&chan->req, id, type, 0, seq, input, len)) {
+        pthread_mutex_unlock(&chan->lock);
+        return -1;
+    }
+
+    int64_t deadline = shm_now() + timeout;
+
+    while (1) {
+        int64_t left = deadline - shm_now();
+        if (left <= 0) break;
+
+        if (shm_ring_pop(&chan->rep, rec, output, max, left) < 0)
+            continue;
+
+        // replies to requests that timed out earlier are discarded
+        if (rec->seq == seq) {
+            pthread_mutex_unlock(&chan->lock);
+            return 0;
+        }
+    }
+
+    pthread_mutex_unlock(&chan->lock);
+
+    return -1;
+}
+
+/**
+ * \brief Function to send the reply of a request
+ * \param chan Channel
+ * \param req The header of the request
+ * \param ret Return value
+ * \param output Reply data
+ * \param len The length of the reply data
+ */
+int shm_chan_reply(shm_chan_t *chan, const shm_rec_t *req, int ret, const void *output, uint32_t len)
+{
+    return shm_ring_push(&chan->rep, req->id, req->type, ret, req->seq, output, len);
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The suffixes of the ring files of a link */
+static const char *shm_link_suffix[] = {"down", "dreq", "drep", "up", "ureq", "urep"};
+
+/**
+ * \brief Function to get the rings of a link in the order of shm_link_suffix
+ * \param link Link
+ * \param ring Rings (output)
+ */
+static void shm_link_rings(shm_link_t *link, shm_ring_t *ring[6])
+{
+    ring[0] = &link->down;
+    ring[1] = &link->down_call.req;
+    ring[2] = &link->down_call.rep;
+    ring[3] = &link->up;
+    ring[4] = &link->up_call.req;
+    ring[5] = &link->up_call.rep;
+}
+
+/**
+ * \brief Function to create or open the rings of a link
+ * \param link Link
+ * \param prefix The prefix of the ring files
+ * \param size The size of the data area of each ring (0: open existing files)
+ */
+static int shm_link_init(shm_link_t *link, const char *prefix, uint32_t size)
+{
+    shm_ring_t *ring[6];
+
+    memset(link, 0, sizeof(shm_link_t));
+    shm_link_rings(link, ring);
+
+    int i;
+    for (i=0; i<6; i++) {
+        char path[__CONF_WORD_LEN];
+        snprintf(path, __CONF_WORD_LEN, "%s.%s", prefix, shm_link_suffix[i]);
+
+        int ret = (size) ? shm_ring_create(ring[i], path, size) : shm_ring_open(ring[i], path);
+        if (ret) {
+            while (i-- > 0)
+                shm_ring_close(ring[i], (size) ? TRUE : FALSE);
+            return -1;
+        }
+    }
+
+    pthread_mutex_init(&link->down_call.lock, NULL);
+    pthread_mutex_init(&link->up_call.lock, NULL);
+
+    link->active = TRUE;
+
+    return 0;
+}
+
+/**
+ * \brief Function to create the rings of a link (external side)
+ * \param link Link
+ * \param prefix The prefix of the ring files
+ * \param size The size of the data area of each ring
+ */
+int shm_link_create(shm_link_t *link, const char *prefix, uint32_t size)
+{
+    if (size == 0) return -1;
+
+    return shm_link_init(link, prefix, size);
+}
+
+/**
+ * \brief Function to open the rings of a link created by an external component or application
+ * \param link Link
+ * \param prefix The prefix of the ring files
+ */
+int shm_link_open(shm_link_t *link, const char *prefix)
+{
+    return shm_link_init(link, prefix, 0);
+}
+
+/**
+ * \brief Function to stop the consumers of a link and unmap its rings
+ * \param link Link
+ * \param unlink_file The flag to remove the ring files
+ */
+int shm_link_close(shm_link_t *link, int unlink_file)
+{
+    shm_ring_t *ring[6];
+
+    link->active = FALSE;
+
+    int i;
+    for (i=0; i<link->num_threads; i++)
+        pthread_join(link->thread[i], NULL);
+
+    link->num_threads = 0;
+
+    shm_link_rings(link, ring);
+
+    for (i=0; i<6; i++)
+        shm_ring_close(ring[i], unlink_file);
+
+    pthread_mutex_destroy(&link->down_call.lock);
+    pthread_mutex_destroy(&link->up_call.lock);
+
+    return 0;
+}
+
+/**
+ * @}
+ *
+ * @}
+ */
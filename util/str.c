@@ -105,7 +105,7 @@ char *str_read(char *fname)
     int size = ftell(fp);
     fseek(fp, 0L, SEEK_SET);
 
-    char *file = calloc(1, size + 1);
+    char *file = CALLOC(1, size + 1);
     if (file == NULL)
         return NULL;
 
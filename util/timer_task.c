@@ -0,0 +1,292 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \ingroup util
+ * @{
+ *
+ * \defgroup timer_task Periodic Tasks
+ * \brief Functions to run the periodic work of components on a few shared workers
+ * @{
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#include "timer_task.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief The tasks waiting for their next runs (in the order of due times) */
+static timer_task_t *timer_head;
+
+/** \brief The lock for the tasks */
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief The condition signaled when the first task changes */
+static pthread_cond_t timer_cond;
+
+/** \brief The condition signaled when a cancelled task finishes its run */
+static pthread_cond_t timer_done;
+
+/** \brief The flag whether a worker sleeps until the first task is due */
+static int timer_sleeping;
+
+/** \brief The flag to start the workers only once */
+static pthread_once_t timer_once = PTHREAD_ONCE_INIT;
+
+/** \brief The flag whether the workers are started */
+static int timer_ready;
+
+/** \brief The thread IDs of the workers */
+static pid_t timer_tids[__TIMER_WORKERS];
+
+/** \brief The names of the tasks that the workers ran last (the owners of the workers) */
+static char timer_owners[__TIMER_WORKERS][__CONF_WORD_LEN];
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to get the current time
+ * \return Monotonic time (ms)
+ */
+static uint64_t timer_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * \brief Function to queue a task in the order of due times (under timer_lock)
+ * \param task Periodic task
+ */
+static void timer_insert(timer_task_t *task)
+{
+    timer_task_t **pos = &timer_head;
+    while (*pos != NULL && (*pos)->due <= task->due)
+        pos = &(*pos)->next;
+
+    task->next = *pos;
+    *pos = task;
+
+    task->state = TIMER_QUEUED;
+
+    // the sleeping worker has to look at the new first task
+    if (timer_head == task)
+        pthread_cond_broadcast(&timer_cond);
+}
+
+/**
+ * \brief Function to run periodic tasks when they are due
+ * \param arg The index of the worker
+ */
+static void *timer_worker(void *arg)
+{
+    int idx = (int)(intptr_t)arg;
+
+    char name[16] = {0};
+    snprintf(name, sizeof(name), "timer%d", idx);
+    pthread_setname_np(pthread_self(), name);
+
+    pthread_mutex_lock(&timer_lock);
+
+    timer_tids[idx] = syscall(SYS_gettid);
+
+    while (1) {
+        if (timer_head == NULL) {
+            pthread_cond_wait(&timer_cond, &timer_lock);
+            continue;
+        }
+
+        uint64_t now = timer_now();
+
+        if (timer_head->due > now) {
+            // only one worker waits for the due time, and the others wait for it to take the task
+            if (timer_sleeping) {
+                pthread_cond_wait(&timer_cond, &timer_lock);
+                continue;
+            }
+
+            struct timespec ts;
+            ts.tv_sec = timer_head->due / 1000;
+            ts.tv_nsec = (timer_head->due % 1000) * 1000000;
+
+            timer_sleeping = TRUE;
+            pthread_cond_timedwait(&timer_cond, &timer_lock, &ts);
+            timer_sleeping = FALSE;
+
+            continue;
+        }
+
+        timer_task_t *task = timer_head;
+        timer_head = task->next;
+        task->next = NULL;
+        task->state = TIMER_RUNNING;
+
+        // the worker works for the component of the task until it takes another one
+        snprintf(timer_owners[idx], __CONF_WORD_LEN, "%s", task->name);
+
+        // another worker takes over waiting for the next task
+        if (timer_head != NULL)
+            pthread_cond_signal(&timer_cond);
+
+        pthread_mutex_unlock(&timer_lock);
+
+        MEM_OWNER_PUSH(task->name);
+        int delay = task->func(task->arg);
+        MEM_OWNER_POP();
+
+        pthread_mutex_lock(&timer_lock);
+
+        if (task->state == TIMER_CANCELLED) {
+            task->state = TIMER_STOPPED;
+            pthread_cond_broadcast(&timer_done);
+        } else if (delay < 0) {
+            task->state = TIMER_STOPPED;
+        } else {
+            task->due = timer_now() + ((delay > 0) ? delay : task->period);
+            timer_insert(task);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief Function to start the workers
+ */
+static void timer_init(void)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    pthread_cond_init(&timer_cond, &attr);
+    pthread_cond_init(&timer_done, NULL);
+
+    pthread_condattr_destroy(&attr);
+
+    int i;
+    for (i=0; i<__TIMER_WORKERS; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, &timer_worker, (void *)(intptr_t)i) < 0) {
+            PERROR("pthread_create");
+            return;
+        }
+        pthread_detach(thread);
+    }
+
+    timer_ready = TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to add a periodic task
+ * \param name Task name
+ * \param period The time between the end of a run and the next one (ms)
+ * \param delay The time until the first run (ms)
+ * \param func The function to run
+ * \param arg The argument of the function
+ * \return Periodic task (NULL: failed)
+ */
+timer_task_t *timer_task_add(const char *name, int period, int delay, timer_task_f func, void *arg)
+{
+    if (period <= 0 || func == NULL) return NULL;
+
+    pthread_once(&timer_once, timer_init);
+    if (timer_ready == FALSE) return NULL;
+
+    timer_task_t *task = (timer_task_t *)CALLOC(1, sizeof(timer_task_t));
+    if (task == NULL) {
+        PERROR("calloc");
+        return NULL;
+    }
+
+    snprintf(task->name, __CONF_WORD_LEN, "%s", name);
+
+    task->func = func;
+    task->arg = arg;
+    task->period = period;
+
+    pthread_mutex_lock(&timer_lock);
+
+    task->due = timer_now() + ((delay > 0) ? delay : 0);
+    timer_insert(task);
+
+    pthread_mutex_unlock(&timer_lock);
+
+    return task;
+}
+
+/**
+ * \brief Function to cancel a periodic task and release it
+ * The task does not run anymore once this returns. It waits for the current run of the task,
+ * so a task cannot cancel itself (it returns -1 to stop instead).
+ * \param task Periodic task
+ */
+int timer_task_cancel(timer_task_t *task)
+{
+    if (task == NULL) return -1;
+
+    pthread_mutex_lock(&timer_lock);
+
+    if (task->state == TIMER_QUEUED) {
+        timer_task_t **pos = &timer_head;
+        while (*pos != NULL && *pos != task)
+            pos = &(*pos)->next;
+
+        if (*pos != NULL)
+            *pos = task->next;
+
+        // the sleeping worker may be waiting for this task
+        pthread_cond_broadcast(&timer_cond);
+    } else if (task->state == TIMER_RUNNING) {
+        task->state = TIMER_CANCELLED;
+
+        while (task->state == TIMER_CANCELLED)
+            pthread_cond_wait(&timer_done, &timer_lock);
+    }
+
+    pthread_mutex_unlock(&timer_lock);
+
+    FREE(task);
+
+    return 0;
+}
+
+/**
+ * \brief Function to get the owner of a worker
+ * \param tid Thread ID
+ * \param name The buffer for the name of the task that the worker ran last (__CONF_WORD_LEN)
+ * \return 0 if the thread is a worker that ran a task, -1 otherwise
+ */
+int timer_task_owner(pid_t tid, char *name)
+{
+    int i, ret = -1;
+
+    pthread_mutex_lock(&timer_lock);
+
+    for (i=0; i<__TIMER_WORKERS; i++) {
+        if (timer_tids[i] == tid && timer_owners[i][0] != '\0') {
+            memcpy(name, timer_owners[i], __CONF_WORD_LEN);
+            ret = 0;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&timer_lock);
+
+    return ret;
+}
+
+/**
+ * @}
+ *
+ * @}
+ */
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2015-2019 NSSLab, KAIST
+ */
+
+/**
+ * \ingroup util
+ * @{
+ *
+ * \defgroup trace Event Trace
+ * \brief Functions to record events into a memory-mapped ring file and replay them
+ * @{
+ */
+
+/**
+ * \file
+ * \author Jaehyun Nam <namjh@kaist.ac.kr>
+ */
+
+#include "trace.h"
+
+/////////////////////////////////////////////////////////////////////
+
+/** \brief Function to get the pointer of a record in a slot */
+#define TRACE_REC(trace, slot) \
+    ((trace_rec_t *)((trace)->recs + (size_t)(slot) * (trace)->hdr->rec_size))
+
+/** \brief Function to convert a timespec to nanoseconds */
+#define TS_TO_NS(ts) ((int64_t)(ts).tv_sec * 1000000000 + (ts).tv_nsec)
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to map a trace file
+ * \param trace Trace
+ * \param prot Protection flags
+ */
+static int trace_map(trace_t *trace, int prot)
+{
+    void *map = mmap(NULL, trace->size, prot, MAP_SHARED, trace->fd, 0);
+    if (map == MAP_FAILED) {
+        PERROR("mmap");
+        close(trace->fd);
+        trace->fd = -1;
+        return -1;
+    }
+
+    trace->hdr = (trace_hdr_t *)map;
+    trace->recs = (uint8_t *)map + sizeof(trace_hdr_t);
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to create a trace file
+ * \param trace Trace
+ * \param path The path of the trace file
+ * \param num_recs The number of records in the ring
+ * \param payload_len The maximum payload captured in a record (0: digest only)
+ */
+int trace_create(trace_t *trace, const char *path, uint32_t num_recs, uint32_t payload_len)
+{
+    if (num_recs == 0 || payload_len > __TRACE_MAX_PAYLOAD_LEN)
+        return -1;
+
+    // records are aligned to cache lines
+    uint32_t rec_size = (sizeof(trace_rec_t) + payload_len + 63) & ~63;
+
+    trace->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (trace->fd < 0) {
+        PERROR("open");
+        return -1;
+    }
+
+    trace->size = sizeof(trace_hdr_t) + (size_t)rec_size * num_recs;
+
+    if (ftruncate(trace->fd, trace->size) < 0) {
+        PERROR("ftruncate");
+        close(trace->fd);
+        trace->fd = -1;
+        return -1;
+    }
+
+    if (trace_map(trace, PROT_READ | PROT_WRITE))
+        return -1;
+
+    memcpy(trace->hdr->magic, TRACE_MAGIC, sizeof(trace->hdr->magic));
+    trace->hdr->rec_size = rec_size;
+    trace->hdr->num_recs = num_recs;
+    trace->hdr->payload_len = payload_len;
+    trace->hdr->next = 0;
+
+    snprintf(trace->path, __CONF_WORD_LEN, "%s", path);
+
+    return 0;
+}
+
+/**
+ * \brief Function to open a recorded trace file (read-only)
+ * \param trace Trace
+ * \param path The path of the trace file
+ */
+int trace_open(trace_t *trace, const char *path)
+{
+    trace->fd = open(path, O_RDONLY);
+    if (trace->fd < 0) {
+        PERROR("open");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(trace->fd, &st) < 0 || st.st_size < sizeof(trace_hdr_t)) {
+        close(trace->fd);
+        trace->fd = -1;
+        return -1;
+    }
+
+    trace->size = st.st_size;
+
+    if (trace_map(trace, PROT_READ))
+        return -1;
+
+    trace_hdr_t *hdr = trace->hdr;
+
+    if (memcmp(hdr->magic, TRACE_MAGIC, sizeof(hdr->magic)) != 0 ||
+        hdr->rec_size < sizeof(trace_rec_t) + hdr->payload_len ||
+        sizeof(trace_hdr_t) + (size_t)hdr->rec_size * hdr->num_recs > trace->size) {
+        trace_close(trace);
+        return -1;
+    }
+
+    snprintf(trace->path, __CONF_WORD_LEN, "%s", path);
+
+    return 0;
+}
+
+/**
+ * \brief Function to unmap a trace file
+ * \param trace Trace
+ */
+int trace_close(trace_t *trace)
+{
+    if (trace->hdr == NULL)
+        return -1;
+
+    msync(trace->hdr, trace->size, MS_ASYNC);
+    munmap(trace->hdr, trace->size);
+    close(trace->fd);
+
+    trace->hdr = NULL;
+    trace->recs = NULL;
+    trace->fd = -1;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * \brief Function to append an event to a trace (lock-free, multiple writers)
+ * \param trace Trace
+ * \param id Trigger ID
+ * \param type Event type
+ * \param raised The time when the event was raised (NULL or zero: now)
+ * \param data Payload
+ * \param length The length of the payload
+ * \param aux Extra information
+ */
+int trace_record(trace_t *trace, uint32_t id, uint16_t type, const struct timespec *raised,
+                 const void *data, uint16_t length, uint32_t aux)
+{
+    trace_hdr_t *hdr = trace->hdr;
+    if (hdr == NULL) return -1;
+
+    uint64_t seq = __sync_fetch_and_add(&hdr->next, 1);
+    trace_rec_t *rec = TRACE_REC(trace, seq % hdr->num_recs);
+
+    rec->seq = 0;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    rec->id = id;
+    rec->type = type;
+    rec->length = length;
+    rec->aux = aux;
+    rec->recorded = TS_TO_NS(now);
+    rec->raised = (raised && raised->tv_sec) ? TS_TO_NS(*raised) : rec->recorded;
+
+    if (data && length) {
+        rec->digest = crc32c_func(data, length);
+        rec->captured = (length < hdr->payload_len) ? length : hdr->payload_len;
+        memcpy(rec->payload, data, rec->captured);
+    } else {
+        rec->digest = 0;
+        rec->captured = 0;
+    }
+
+    __atomic_store_n(&rec->seq, seq + 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+/**
+ * \brief Function to get the number of records kept in a trace
+ * \param trace Trace
+ */
+uint64_t trace_count(trace_t *trace)
+{
+    uint64_t next = __atomic_load_n(&trace->hdr->next, __ATOMIC_ACQUIRE);
+
+    return (next < trace->hdr->num_recs) ? next : trace->hdr->num_recs;
+}
+
+/**
+ * \brief Function to get the n-th oldest record in a trace
+ * \param trace Trace
+ * \param idx Index (0: the oldest one)
+ * \return Record (NULL if it is being written or was overwritten)
+ */
+const trace_rec_t *trace_get(trace_t *trace, uint64_t idx)
+{
+    uint64_t next = __atomic_load_n(&trace->hdr->next, __ATOMIC_ACQUIRE);
+    uint64_t count = (next < trace->hdr->num_recs) ? next : trace->hdr->num_recs;
+
+    if (idx >= count) return NULL;
+
+    uint64_t seq = next - count + idx;
+    const trace_rec_t *rec = TRACE_REC(trace, seq % trace->hdr->num_recs);
+
+    if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != seq + 1)
+        return NULL;
+
+    return rec;
+}
+
+/**
+ * \brief Function to replay the records of a trace with their original spacing
+ * \param trace Trace
+ * \param speed Speed-up factor (1: original speed, 0: as fast as possible)
+ * \param running The flag to keep replaying
+ * \param func The function to raise a record
+ * \param replayed The number of replayed records (output)
+ * \param skipped The number of skipped records (output)
+ */
+int trace_replay(trace_t *trace, double speed, volatile int *running,
+                 int (*func)(const trace_rec_t *rec), uint64_t *replayed, uint64_t *skipped)
+{
+    uint64_t count = trace_count(trace);
+    int64_t first = 0, start = 0;
+
+    *replayed = 0;
+    *skipped = 0;
+
+    uint64_t i;
+    for (i=0; i<count && *running; i++) {
+        const trace_rec_t *rec = trace_get(trace, i);
+        if (rec == NULL) {
+            (*skipped)++;
+            continue;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        if (start == 0) {
+            first = rec->raised;
+            start = TS_TO_NS(now);
+        } else if (speed > 0) {
+            int64_t target = start + (int64_t)((rec->raised - first) / speed);
+            int64_t wait = target - TS_TO_NS(now);
+
+            // sleep in short steps to stop quickly
+            while (wait > 0 && *running) {
+                int64_t step = (wait < 100000000) ? wait : 100000000;
+                waitsec(0, step);
+                wait -= step;
+            }
+        }
+
+        if (func(rec) < 0)
+            (*skipped)++;
+        else
+            (*replayed)++;
+    }
+
+    return 0;
+}
+
+/**
+ * @}
+ *
+ * @}
+ */